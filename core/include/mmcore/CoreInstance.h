@@ -55,6 +55,7 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace megamol {
 namespace core {
@@ -651,6 +652,43 @@ public:
      */
     void SetupGraphFromNetwork(const void* data);
 
+    /**
+     * Answer the compact ID of a parameter for relaying its changes within
+     * a rendering cluster.
+     *
+     * @param name  The full name of the parameter slot.
+     * @param outID Receives the ID of the parameter.
+     *
+     * @return true if the parameter has an ID, false otherwise.
+     */
+    bool GetNetworkParameterID(const vislib::StringA& name, UINT32& outID) const;
+
+    /**
+     * Answer the full name of the parameter slot with the given compact ID.
+     *
+     * @param id The ID of the parameter.
+     *
+     * @return The full name of the parameter slot or an empty string if the
+     *         ID is unknown.
+     */
+    vislib::StringA GetNetworkParameterName(const UINT32 id) const;
+
+    /**
+     * Answer the hash of the current table of compact parameter IDs. Nodes
+     * that built their tables from the same module graph have the same hash.
+     *
+     * @return The hash of the table, zero if the table is empty.
+     */
+    inline UINT32 GetNetworkParameterTableHash(void) const { return this->networkParamTableHash; }
+
+    /**
+     * Rebuilds the table of compact parameter IDs from the current module
+     * graph. The IDs are assigned in the order of the full names of the
+     * parameter slots, such that all nodes of a rendering cluster that set up
+     * the same graph agree on them without further communication.
+     */
+    void UpdateNetworkParameterIDs(void);
+
     /**
      * Instantiates a call.
      *
@@ -1274,6 +1312,15 @@ private:
     /** Global hash of all parameters (is increased if any parameter defintion changes) */
     size_t parameterHash;
 
+    /** The compact IDs of the parameters for relaying changes in a cluster */
+    std::unordered_map<std::string, UINT32> networkParamIDs;
+
+    /** The full names of the parameters indexed by their compact IDs */
+    std::vector<vislib::StringA> networkParamNames;
+
+    /** The hash of 'networkParamNames' */
+    UINT32 networkParamTableHash;
+
 #ifdef _WIN32
 #    pragma warning(default : 4251)
 #endif /* _WIN32 */
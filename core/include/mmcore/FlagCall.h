@@ -13,6 +13,7 @@
 #    pragma once
 #endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
 
+#include <algorithm>
 #include "FlagStorage.h"
 #include "mmcore/Call.h"
 #include "mmcore/factories/CallAutoDescription.h"
@@ -25,6 +26,11 @@ namespace core {
  * Call for passing flag data (FlagStorage) between modules that tries to be thread-safe
  * and conflict-free by behaving like a unique pointer. A unique pointer cannot be used since
  * it interferes with the leftCall = rightCall paradigm.
+ *
+ * Modules that only read the flags should prefer the snapshot function, which
+ * does not block other readers or writers beyond the time needed to hand out
+ * the snapshot. Writers should report the ranges they changed via
+ * MarkChanged() to allow consumers to update only these ranges.
  */
 
 class MEGAMOLCORE_API FlagCall : public megamol::core::Call {
@@ -48,12 +54,15 @@ public:
 
     static const unsigned int CallUnmapFlags;
 
+    /** Index of the function providing a read-only snapshot of the flags */
+    static const unsigned int CallGetSnapshot;
+
     /**
      * Answer the number of functions used for this call.
      *
      * @return The number of functions used for this call.
      */
-    static unsigned int FunctionCount(void) { return 2; }
+    static unsigned int FunctionCount(void) { return 3; }
 
     /**
      * Answer the name of the function used for this call.
@@ -68,6 +77,8 @@ public:
             return "mapFlags";
         case 1:
             return "unmapFlags";
+        case 2:
+            return "getFlagsSnapshot";
         default:
             return "out_of_bounds_error";
         }
@@ -109,6 +120,60 @@ public:
         f.reset();
     }
 
+    /**
+     * Extract the read-only snapshot of the flags retrieved via CallGetSnapshot from the call. The snapshot does
+     * not change while you hold it, writers work on a copy instead. Hence, release it as soon as possible.
+     */
+    inline std::shared_ptr<const FlagStorage::FlagVectorType> GetSnapshot(void) {
+        std::shared_ptr<const FlagStorage::FlagVectorType> ret;
+        ret.swap(this->snapshot);
+        return ret;
+    }
+
+    /**
+     * Reports that the flags in [first, last) have been changed. Writers should call this before returning the
+     * flags with a new version. If a writer changes the flags without reporting any range, all flags are
+     * considered changed.
+     */
+    inline void MarkChanged(const size_t first, const size_t last) {
+        if (first < last) {
+            this->changes.emplace_back(first, last);
+        }
+    }
+
+    /**
+     * Answer the ranges of flags that have been changed between the version 'since' and the version of the flags
+     * currently contained in the call. The ranges are sorted and do not overlap.
+     *
+     * @param since The version the caller has already seen.
+     * @param outRanges Receives the changed ranges.
+     *
+     * @return 'true' if the ranges are known, 'false' if the changes are not tracked that far back, e.g. because
+     *         the number of flags changed, and the caller has to update all flags.
+     */
+    inline bool GetChangedRanges(const FlagStorage::FlagVersionType since, FlagStorage::RangeVectorType& outRanges) const {
+        outRanges.clear();
+        if (this->allChanged) return false;
+        if (since == this->version) return true;
+        if ((since < this->changeLogStart) || (since > this->version)) return false;
+
+        for (auto const& c : this->changeLog) {
+            if (c.first > since) outRanges.push_back(c.second);
+        }
+        outRanges.insert(outRanges.end(), this->changes.begin(), this->changes.end());
+        std::sort(outRanges.begin(), outRanges.end());
+        size_t cnt = 0;
+        for (auto const& r : outRanges) {
+            if ((cnt > 0) && (r.first <= outRanges[cnt - 1].second)) {
+                outRanges[cnt - 1].second = (std::max)(outRanges[cnt - 1].second, r.second);
+            } else {
+                outRanges[cnt++] = r;
+            }
+        }
+        outRanges.resize(cnt);
+        return true;
+    }
+
     /**
      * Makes sure there are enough flags for count items. The storage is initialized
      * with FlagStorage::ENABLED by default.
@@ -118,6 +183,7 @@ public:
         if (f && f->size() != count) {
             f->resize(count, init);
             ++version;
+            this->allChanged = true;
         }
     }
 
@@ -126,8 +192,25 @@ public:
     virtual ~FlagCall(void);
 
 private:
+    friend class FlagStorage;
+
     std::shared_ptr<FlagStorage::FlagVectorType> flags;
     FlagStorage::FlagVersionType version;
+
+    /** The snapshot requested via CallGetSnapshot */
+    std::shared_ptr<const FlagStorage::FlagVectorType> snapshot;
+
+    /** The ranges reported by MarkChanged() since the flags have been mapped */
+    FlagStorage::RangeVectorType changes;
+
+    /** Whether all flags have been changed since they have been mapped */
+    bool allChanged;
+
+    /** A copy of the change log of the storage at the time of mapping */
+    FlagStorage::ChangeLogType changeLog;
+
+    /** The oldest version for which 'changeLog' holds all changes */
+    FlagStorage::FlagVersionType changeLogStart;
 };
 
 /** Description class typedef */
@@ -11,7 +11,9 @@
 #    pragma once
 #endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
 
+#include <deque>
 #include <mutex>
+#include <utility>
 #include "mmcore/CalleeSlot.h"
 #include "mmcore/Module.h"
 #include "mmcore/moldyn/MultiParticleDataCall.h"
@@ -28,6 +30,12 @@ namespace core {
  * Class storing a stream of uints which contain flags that say something
  * about a synchronized other piece of data (index equality).
  * Can be used for storing selection etc.
+ *
+ * Writers map the flags exclusively. Readers can instead request a read-only
+ * snapshot, which stays valid while writers continue: a writer mapping flags
+ * that are still referenced by a snapshot works on a copy. Additionally, the
+ * storage keeps a log of the index ranges writers reported as changed, such
+ * that consumers can update only these instead of all flags.
  */
 class MEGAMOLCORE_API FlagStorage : public core::Module {
 public:
@@ -38,6 +46,19 @@ public:
 
     typedef std::vector<FlagItemType> FlagVectorType;
 
+    /** A half-open range [first, second) of flag indices */
+    typedef std::pair<size_t, size_t> RangeType;
+
+    typedef std::vector<RangeType> RangeVectorType;
+
+    /** A range that has been changed to reach the given version */
+    typedef std::pair<FlagVersionType, RangeType> ChangeType;
+
+    typedef std::deque<ChangeType> ChangeLogType;
+
+    /** The maximum number of ranges in the change log */
+    static const size_t MaxChangeLogSize;
+
     /**
      * Answer the name of this module.
      *
@@ -99,14 +120,59 @@ private:
      */
     bool unmapFlagsCallback(core::Call& caller);
 
+    /**
+     * Provides a read-only snapshot of the current flags.
+     *
+     * @param caller The calling call.
+     *
+     * @return 'true' on success, 'false' on failure.
+     */
+    bool getSnapshotCallback(core::Call& caller);
+
+    /**
+     * Appends the changes a writer reported to the change log.
+     *
+     * @param ranges The ranges the writer changed.
+     * @param all Whether the writer changed the flags without reporting
+     *            the ranges.
+     */
+    void appendChanges(RangeVectorType const& ranges, bool all);
+
+    /**
+     * Run-length encodes the flags if enabled and worth it. 'mut' must be
+     * held.
+     */
+    void compress(void);
+
+    /**
+     * Restores the flags from their run-length encoding. 'mut' must be
+     * held.
+     */
+    void decompress(void);
+
     /** The slot for requesting data */
     core::CalleeSlot getFlagsSlot;
 
-    /** The data */
+    /** Enables run-length encoding of the flags while they are not mapped */
+    core::param::ParamSlot compressSlot;
+
+    /** The data, nullptr while they are compressed */
     std::shared_ptr<FlagVectorType> flags;
 
     FlagVersionType version;
 
+    /** The ranges changed since 'changeLogStart' */
+    ChangeLogType changeLog;
+
+    /** The oldest version for which 'changeLog' holds all changes */
+    FlagVersionType changeLogStart;
+
+    /** The run-length encoded flags as pairs of value and run length */
+    std::vector<std::pair<FlagItemType, uint32_t>> runs;
+
+    /** The number of flags encoded in 'runs' */
+    size_t runsSize;
+
     // std::recursive_mutex mut;
     std::mutex mut;
 };
@@ -12,7 +12,11 @@
 #endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
 
 #include <atomic>
+#include <chrono>
 #include <climits>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 #ifdef _WIN32
 #include <WinSock2.h>
@@ -183,9 +187,34 @@ namespace mpi {
             double InstanceTime;
             bool InvalidateMaster;
             bool InitSwapGroup;
+            bool Pipelined;
             size_t RelaySize;
         } FrameState;
 
+        /** The time in milliseconds spent in the phases of the frames. */
+        typedef struct FrameTimings {
+            double Sync;
+            double Update;
+            double Reduce;
+            double Render;
+            double Barrier;
+            unsigned int Frames;
+        } FrameTimings;
+
+        /**
+         * The number of bytes of relayed messages that are sent along with
+         * the status in pipelined mode. Larger messages require an additional
+         * blocking broadcast.
+         */
+        static const size_t PIPELINE_RELAY_CAPACITY = 64 * 1024;
+
+        /**
+         * The bits of the status that all ranks combine in each frame: whether
+         * the rank can render and whether it could apply all parameter deltas.
+         */
+        static const int RANK_CAN_RENDER = 0x1;
+        static const int RANK_APPLIED_PARAM_DELTAS = 0x2;
+
         /** Defines the state that the view is in. */
         typedef enum ViewState {
             CREATED,
@@ -193,6 +222,13 @@ namespace mpi {
             FORCE_UINT = UINT_MAX
         } ViewState;
 
+        /**
+         * Set the parameters transmitted in a MSG_PARAMDELTA message.
+         *
+         * @param msg The message holding the parameter values.
+         */
+        void applyParamDelta(const vislib::net::AbstractSimpleMessage& msg);
+
         /**
          * Implementation of 'Create'.
          *
@@ -211,11 +247,38 @@ namespace mpi {
          */
         size_t filterRelayBuffer(void);
 
+        /**
+         * Encodes all parameter updates in 'params' for which the core knows
+         * a compact ID into a single MSG_PARAMDELTA message in
+         * 'paramDeltaBuffer'. The encoded updates are removed from 'params'.
+         *
+         * @param params    The offsets and sizes of the MSG_PARAMUPDATE
+         *                  messages in 'relayBuffer' by parameter name.
+         * @param outOffset Receives the smallest offset of the encoded
+         *                  messages, which determines where the delta is
+         *                  relayed.
+         *
+         * @return The size of the delta message, zero if no update could be
+         *         encoded.
+         */
+        size_t encodeParamDelta(std::unordered_map<std::string, std::pair<size_t, size_t> >& params,
+            size_t& outOffset);
+
         /**
          * Finalise MPI, but only if it was initialised by this object.
          */
         virtual void finaliseMpi(void);
 
+        /**
+         * Completes the synchronisation of the status started by
+         * startPipelinedSync() during the last frame.
+         *
+         * @param state Receives the status of the master.
+         *
+         * @return true if a synchronisation was pending, false otherwise.
+         */
+        bool finishPipelinedSync(FrameState& state);
+
         /**
          * Gets the master rank for MPI broadcasts.
          *
@@ -276,6 +339,15 @@ namespace mpi {
             return (this->bcastMaster >= 0);
         }
 
+        /**
+         * Answer the time since 'timer' and reset 'timer' to now.
+         *
+         * @param timer The start of the measurement.
+         *
+         * @return The elapsed time in milliseconds.
+         */
+        static double lapTime(std::chrono::steady_clock::time_point& timer);
+
         /**
          * Negotiate the master for MPI broadcasts.
          *
@@ -286,11 +358,37 @@ namespace mpi {
          */
         bool negotiateBcastMaster(void);
 
+        /**
+         * Relay the current values of all parameters by name. The master does
+         * this if any rank could not apply a parameter delta, because its
+         * parameter IDs differ.
+         */
+        void relayAllParameters(void);
+
         /**
          * Implementation of 'Release'.
          */
         virtual void release(void);
 
+        /**
+         * Count the frame and log the average timings if the configured
+         * number of frames has been reached.
+         *
+         * @param isPipelined Whether the frame used the pipelined mode.
+         */
+        void reportTimings(const bool isPipelined);
+
+        /**
+         * Start the non-blocking synchronisation of the status for the next
+         * frame, which is completed by finishPipelinedSync(). All ranks must
+         * call this method in the same frame.
+         *
+         * @param context   The context of the current frame.
+         * @param status    The RANK_* status bits of this rank.
+         */
+        void startPipelinedSync(const mmcRenderViewContext& context,
+            int status);
+
         /**
          * Store the given message for relay to other nodes.
          *
@@ -301,6 +399,15 @@ namespace mpi {
         void storeMessageForRelay(
             const vislib::net::AbstractSimpleMessage& msg);
 
+        /**
+         * Negotiate the master if necessary and broadcast its status and the
+         * messages to be relayed to all ranks.
+         *
+         * @param state The status of this rank, receives the status of the
+         *              master.
+         */
+        void synchroniseState(FrameState& state);
+
     private:
 
         /** Base class typedef. */
@@ -357,9 +464,54 @@ namespace mpi {
          */
         bool mustNegotiateMaster;
 
+        /** The message relaying the compactly encoded parameter updates. */
+        vislib::RawStorage paramDeltaBuffer;
+
+        /** The sequence number of the last parameter delta that was applied. */
+        unsigned int paramDeltaSequence;
+
+        /**
+         * Remembers on the master that parameter updates must be relayed by
+         * name until the graph changes, because the parameter IDs of some
+         * ranks differ.
+         */
+        bool paramDeltaFallback;
+
+        /**
+         * Remembers that this rank ignored a parameter delta, because its
+         * parameter IDs differ from the ones of the master.
+         */
+        bool paramDeltaMismatch;
+
+        /**
+         * Configures whether parameter updates are relayed with compact IDs
+         * instead of their names.
+         */
+        param::ParamSlot paramDelta;
+
+        /**
+         * Configures whether the status of the next frame is synchronised
+         * while the current one is rendered.
+         */
+        param::ParamSlot paramPipeline;
+
+        /** Configures after how many frames the timings are reported. */
+        param::ParamSlot paramTimingInterval;
+
         /** Configures whether the view should try to enable GSync. */
         param::ParamSlot paramUseGsync;
 
+        /** The status and messages of the pipelined broadcast. */
+        vislib::RawStorage pipelineBuffer;
+
+#ifdef WITH_MPI
+        /** The local and the reduced status bits in pipelined mode. */
+        int pipelineCanRender[2];
+
+        /** The pending broadcast and reduction in pipelined mode. */
+        MPI_Request pipelineRequests[2];
+#endif /* WITH_MPI */
+
         /**
          * The buffer used to compose the status that is relayed to all
          * nodes before rendering the next frame.
@@ -372,6 +524,9 @@ namespace mpi {
         /** The offset of the next part to be added to 'relayBuffer'. */
         size_t relayOffset;
 
+        /** The accumulated timings since the last report. */
+        FrameTimings timings;
+
         /** Remembers the state of this view. */
         ViewState viewState;
 
@@ -62,6 +62,26 @@ namespace simple {
 #define MSG_REQUESTTCUPDATE 11
 #define MSG_TCUPDATE 12
 #define MSG_MODULGRAPH_LUA 13
+#define MSG_PARAMDELTA 14
+
+    /**
+     * The header of a MSG_PARAMDELTA message. It is followed by 'Count'
+     * entries, each one consisting of the UINT32 ID of the parameter, the
+     * UINT32 length of the value and the UTF-8 encoded value itself without
+     * terminating zero.
+     */
+    typedef struct _paramdeltaheader_t {
+
+        /** The sequence number of the message */
+        unsigned int Sequence;
+
+        /** The hash of the ID table the message has been encoded with */
+        unsigned int TableHash;
+
+        /** The number of parameter values in the message */
+        unsigned int Count;
+
+    } ParamDeltaHeader;
 
     /**
      * Struct layout a simple cluster datagram
@@ -40,6 +40,13 @@ namespace misc {
         /** Structure containing all required metadata about a data set. */
         typedef struct megamol::core::misc::VolumetricMetadata_t Metadata;
 
+        /** Describes a single brick of a bricked data set. */
+        typedef struct megamol::core::misc::VolumetricBrick_t Brick;
+
+        /** Describes the bricks a caller is interested in. */
+        typedef struct megamol::core::misc::VolumetricBrickRequest_t
+            BrickRequest;
+
         /**
          * Answer the name of this module.
          *
@@ -109,6 +116,24 @@ namespace misc {
          */
         virtual ~VolumetricDataCall(void);
 
+        /**
+         * Answer whether the data source delivered all bricks that have been
+         * requested via SetBrickRequest().
+         *
+         * @return true if all requested bricks are available, false if some
+         *         of them are still being loaded.
+         */
+        inline bool AreBricksComplete(void) const {
+            return this->isBricksComplete;
+        }
+
+        /**
+         * Remove the brick request such that the call asks for whole frames.
+         */
+        inline void ClearBrickRequest(void) {
+            this->isBrickRequest = false;
+        }
+
         /**
          * Gets the number of frames starting at GetData().
          *
@@ -118,6 +143,35 @@ namespace misc {
             return this->cntFrames;
         }
 
+        /**
+         * Gets the number of bricks in GetBricks().
+         *
+         * @return The number of bricks delivered by the data source.
+         */
+        inline size_t GetBrickCount(void) const {
+            return this->cntBricks;
+        }
+
+        /**
+         * Gets the current brick request.
+         *
+         * @return The current brick request, which is only meaningful if
+         *         IsBrickRequest() is true.
+         */
+        inline const BrickRequest& GetBrickRequest(void) const {
+            return this->brickRequest;
+        }
+
+        /**
+         * Gets the bricks delivered by the data source in response to a
+         * brick request.
+         *
+         * @return The bricks. The data source remains owner of the memory.
+         */
+        inline const Brick *GetBricks(void) const {
+            return this->bricks;
+        }
+
         /**
          * Gets the number of components per grid point.
          *
@@ -254,6 +308,16 @@ namespace misc {
         const float GetAbsoluteVoxelValue(
             const uint32_t x, const uint32_t y, const uint32_t z, const uint32_t c = 0) const;
 
+        /**
+         * Answer whether the caller requests individual bricks rather than
+         * whole frames.
+         *
+         * @return true if a brick request has been set.
+         */
+        inline bool IsBrickRequest(void) const {
+            return this->isBrickRequest;
+        }
+
         /**
          * Answer whether the given axis is uniform or has
          * this->GetResolution(axis) entries in the slice distance area.
@@ -264,6 +328,42 @@ namespace misc {
          */
         bool IsUniform(const int axis) const;
 
+        /**
+         * Request that the next call to IDX_GET_DATA or IDX_TRY_GET_DATA
+         * delivers only the bricks of the given level of detail that overlap
+         * the given region instead of the whole frame.
+         *
+         * Data sources that do not support bricking (check
+         * Metadata::BrickSize) ignore the request and deliver the whole
+         * frame.
+         *
+         * @param level The requested level of detail, 0 being the full
+         *              resolution.
+         * @param min   The first voxel of the region in full resolution
+         *              voxel coordinates.
+         * @param max   The end of the region in full resolution voxel
+         *              coordinates (exclusive).
+         */
+        void SetBrickRequest(const unsigned int level, const size_t min[3],
+            const size_t max[3]);
+
+        /**
+         * Sets the bricks loaded in response to a brick request.
+         *
+         * @param bricks     The bricks. The caller remains owner of the
+         *                   memory, which must be valid until the call is
+         *                   unlocked.
+         * @param cntBricks  The number of bricks in 'bricks'.
+         * @param isComplete Indicates whether 'bricks' comprises all bricks
+         *                   overlapping the requested region.
+         */
+        inline void SetBricks(const Brick *bricks, const size_t cntBricks,
+                const bool isComplete) {
+            this->bricks = bricks;
+            this->cntBricks = cntBricks;
+            this->isBricksComplete = isComplete;
+        }
+
         /**
          * Sets the data pointer.
          *
@@ -314,6 +414,15 @@ namespace misc {
         /** The functions that are provided by the call. */
         static const char *FUNCTIONS[6];
 
+        /** The bricks delivered by the data source. */
+        const Brick *bricks;
+
+        /** The region and level of detail requested by the caller. */
+        BrickRequest brickRequest;
+
+        /** The number of elements in 'bricks'. */
+        size_t cntBricks;
+
         /** The number of frames that 'data' designates. */
         size_t cntFrames;
 
@@ -323,6 +432,12 @@ namespace misc {
 		/** The texture name of the volume data if data is already located in VRAM. */
 		uint32_t vram_volume_name;
 
+        /** Determines whether the caller requested bricks. */
+        bool isBrickRequest;
+
+        /** Determines whether 'bricks' comprises all requested bricks. */
+        bool isBricksComplete;
+
         /** Pointer to the metadata descriptor of the data set. */
         const Metadata *metadata;
 
@@ -40,6 +40,8 @@ struct VolumetricMetadata_t {
         MinValues = nullptr;
         MaxValues = nullptr;
 		MemLoc = RAM;
+        BrickSize = 0;
+        Levels = 1;
     }
 
     // creates a deep copy of the instance. beware that the owner of the copy
@@ -72,6 +74,8 @@ struct VolumetricMetadata_t {
         memcpy(clone.MinValues, this->MinValues, sizeof(double) * this->Components);
         memcpy(clone.MaxValues, this->MaxValues, sizeof(double) * this->Components);
 		clone.MemLoc = this->MemLoc;
+        clone.BrickSize = this->BrickSize;
+        clone.Levels = this->Levels;
         return clone;
     }
 
@@ -130,6 +134,69 @@ struct VolumetricMetadata_t {
 	 * (Physical) memory location of the volume data.
 	 */
 	enum MemoryLocation	MemLoc;
+
+    /**
+     * The edge length of a brick in voxels if the data set is stored in
+     * bricks, zero if it can only be retrieved in whole frames.
+     */
+    size_t BrickSize;
+
+    /**
+     * The number of levels of detail available for bricked data sets. Level
+     * 0 has the full resolution, each following level halves the resolution
+     * of the previous one.
+     */
+    unsigned int Levels;
+};
+
+/**
+ * Specifies the region of a bricked data set and the level of detail which
+ * a caller wants to retrieve.
+ */
+struct VolumetricBrickRequest_t {
+
+    /** Initialise a new instance requesting nothing. */
+    VolumetricBrickRequest_t(void) : Level(0) {
+        ::memset(this->Min, 0, sizeof(this->Min));
+        ::memset(this->Max, 0, sizeof(this->Max));
+    }
+
+    /** The requested level of detail. */
+    unsigned int Level;
+
+    /** The first voxel of the region in full resolution voxel coordinates. */
+    size_t Min[3];
+
+    /**
+     * The end of the region in full resolution voxel coordinates (exclusive).
+     */
+    size_t Max[3];
+};
+
+/** Describes a single brick of a bricked data set that has been loaded. */
+struct VolumetricBrick_t {
+
+    /** The level of detail the brick belongs to. */
+    unsigned int Level;
+
+    /** The position of the brick in the brick grid of its level. */
+    size_t Index[3];
+
+    /** The first voxel of the brick in voxel coordinates of its level. */
+    size_t Offset[3];
+
+    /**
+     * The number of voxels of the brick. Bricks overlap their upper
+     * neighbours by one voxel in order to allow for seamless interpolation,
+     * and bricks at the border of the volume might be smaller.
+     */
+    size_t Resolution[3];
+
+    /**
+     * The voxels of the brick, x running fastest. The data source remains
+     * owner of the memory, which is valid until the call is unlocked.
+     */
+    const void* Data;
 };
 
 } /* end namespace misc */
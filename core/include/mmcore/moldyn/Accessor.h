@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <type_traits>
 
 #if !defined(_MSC_VER)
@@ -25,6 +27,47 @@ template <class T> T const* access(char const* ptr, size_t idx, size_t stride) {
 }
 
 
+/**
+ * Converts 'cnt' values of type S, which are 'N' elements of S apart, into the
+ * densely packed array 'dst'. The step being a compile-time constant allows
+ * the compiler to vectorise the de-interleaving.
+ */
+template <class S, class D, size_t N> void convert_step(S const* src, size_t cnt, D* dst) {
+    for (size_t i = 0; i < cnt; ++i) {
+        dst[i] = static_cast<D>(src[i * N]);
+    }
+}
+
+
+/**
+ * Converts 'cnt' values of type S, which are 'stride' bytes apart and start at
+ * 'ptr', into the densely packed array 'dst' of type D.
+ */
+template <class S, class D> void convert_strided(char const* ptr, size_t stride, size_t cnt, D* dst) {
+    auto const src = reinterpret_cast<S const*>(ptr);
+    if ((stride % sizeof(S)) != 0) {
+        for (size_t i = 0; i < cnt; ++i) {
+            dst[i] = static_cast<D>(*access<S>(ptr, i, stride));
+        }
+        return;
+    }
+    switch (stride / sizeof(S)) {
+    case 0: std::fill(dst, dst + cnt, static_cast<D>(*src)); break;
+    case 1: convert_step<S, D, 1>(src, cnt, dst); break;
+    case 2: convert_step<S, D, 2>(src, cnt, dst); break;
+    case 3: convert_step<S, D, 3>(src, cnt, dst); break;
+    case 4: convert_step<S, D, 4>(src, cnt, dst); break;
+    case 7: convert_step<S, D, 7>(src, cnt, dst); break;
+    default: {
+        auto const step = stride / sizeof(S);
+        for (size_t i = 0; i < cnt; ++i) {
+            dst[i] = static_cast<D>(src[i * step]);
+        }
+    }
+    }
+}
+
+
 /**
  * Interface for accessor classes.
  */
@@ -41,6 +84,10 @@ public:
     virtual unsigned int Get_u32(size_t idx) const = 0;
     virtual unsigned short Get_u16(size_t idx) const = 0;
     virtual unsigned char Get_u8(size_t idx) const = 0;
+    /** Converts the 'cnt' elements starting at 'first' into 'dst'. */
+    virtual void Get_f(size_t first, size_t cnt, float* dst) const = 0;
+    /** Converts the 'cnt' elements starting at 'first' into 'dst'. */
+    virtual void Get_d(size_t first, size_t cnt, double* dst) const = 0;
     virtual ~Accessor() = default;
 };
 
@@ -92,6 +139,14 @@ public:
 
     unsigned char Get_u8(size_t idx) const override { return Get<unsigned char>(idx); }
 
+    template <class R> void Get(size_t const first, size_t const cnt, R* dst) const {
+        convert_strided<T, R>(ptr_ + first * stride_, stride_, cnt, dst);
+    }
+
+    void Get_f(size_t first, size_t cnt, float* dst) const override { Get<float>(first, cnt, dst); }
+
+    void Get_d(size_t first, size_t cnt, double* dst) const override { Get<double>(first, cnt, dst); }
+
     virtual ~Accessor_Impl() = default;
 
 private:
@@ -118,6 +173,12 @@ public:
 
     template <class R> R Get() const { return static_cast<R>(this->val_); }
 
+    template <class R> R Get(size_t const idx) const { return Get<R>(); }
+
+    template <class R> void Get(size_t const first, size_t const cnt, R* dst) const {
+        std::fill(dst, dst + cnt, Get<R>());
+    }
+
     float Get_f(size_t idx) const override { return Get<float>(); }
 
     double Get_d(size_t idx) const override { return Get<double>(); }
@@ -130,6 +191,10 @@ public:
 
     unsigned char Get_u8(size_t idx) const override { return Get<unsigned char>(); }
 
+    void Get_f(size_t first, size_t cnt, float* dst) const override { Get<float>(first, cnt, dst); }
+
+    void Get_d(size_t first, size_t cnt, double* dst) const override { Get<double>(first, cnt, dst); }
+
     virtual ~Accessor_Val() = default;
 
 private:
@@ -152,6 +217,12 @@ public:
 
     Accessor_0& operator=(Accessor_0&& rhs) = default;
 
+    template <class R> R Get(size_t const idx) const { return static_cast<R>(0); }
+
+    template <class R> void Get(size_t const first, size_t const cnt, R* dst) const {
+        std::fill(dst, dst + cnt, static_cast<R>(0));
+    }
+
     float Get_f(size_t idx) const override { return static_cast<float>(0); }
 
     double Get_d(size_t idx) const override { return static_cast<double>(0); }
@@ -164,6 +235,10 @@ public:
 
     unsigned char Get_u8(size_t idx) const override { return static_cast<unsigned char>(0); }
 
+    void Get_f(size_t first, size_t cnt, float* dst) const override { Get<float>(first, cnt, dst); }
+
+    void Get_d(size_t first, size_t cnt, double* dst) const override { Get<double>(first, cnt, dst); }
+
     virtual ~Accessor_0() = default;
 
 private:
@@ -11,6 +11,13 @@
 #pragma once
 #endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "mmcore/AbstractDataWriter.h"
 #include "mmcore/CallerSlot.h"
 #include "mmcore/moldyn/MultiParticleDataCall.h"
@@ -25,6 +32,11 @@ namespace moldyn {
 
     /**
      * MMPLD (MegaMol Particle List Dump) file writer
+     *
+     * Frames are serialised into memory and handed to a dedicated I/O thread
+     * via a bounded queue. The I/O thread writes the file in large blocks
+     * whose offsets are multiples of the block size, such that fetching and
+     * serialising the next frames overlaps with writing the previous ones.
      */
     class MMPLDWriter : public AbstractDataWriter {
     public:
@@ -103,25 +115,85 @@ namespace moldyn {
 
     private:
 
+        /** A serialised part of the file waiting to be written. */
+        typedef std::vector<uint8_t> FrameBuffer;
+
+        /**
+         * Appends 'size' bytes from 'data' to 'buffer'.
+         *
+         * @param buffer The buffer to be extended.
+         * @param data   The data to be appended.
+         * @param size   The number of bytes to be appended.
+         */
+        static inline void append(FrameBuffer& buffer, const void *data,
+                const size_t size) {
+            auto d = static_cast<const uint8_t *>(data);
+            buffer.insert(buffer.end(), d, d + size);
+        }
+
+        /**
+         * Hands a buffer to the I/O thread, waiting while the queue is full.
+         *
+         * @param buffer    The buffer to be written.
+         * @param maxQueued The maximum number of buffers in the queue.
+         *
+         * @return The time in seconds the caller was blocked.
+         */
+        double pushBuffer(std::unique_ptr<FrameBuffer>&& buffer,
+            const size_t maxQueued);
+
         /**
-         * Writes the data of one frame to the file
+         * Serialises the data of one frame
          *
-         * @param file The output data file
+         * @param buffer Receives the serialised frame
          * @param data The data of the current frame
          *
          * @return True on success
          */
-        bool writeFrame(vislib::sys::File& file, MultiParticleDataCall& data);
+        bool serialiseFrame(FrameBuffer& buffer, MultiParticleDataCall& data);
+
+        /**
+         * The body of the I/O thread, which writes all queued buffers to
+         * 'file' until the queue is closed.
+         *
+         * @param file      The output data file
+         * @param blockSize The size of the blocks written to the file
+         */
+        void writeQueue(vislib::sys::File& file, const size_t blockSize);
 
         /** The file name of the file to be written */
         param::ParamSlot filenameSlot;
 
+        /** The number of serialised frames that may wait for the I/O thread */
+        param::ParamSlot queueLengthSlot;
+
+        /** The size of the blocks written to disk in MB */
+        param::ParamSlot blockSizeSlot;
+
         /** The file format version to be written */
         param::ParamSlot versionSlot;
 
         /** The slot asking for data */
         CallerSlot dataSlot;
 
+        /** The buffers waiting for the I/O thread */
+        std::deque<std::unique_ptr<FrameBuffer> > queue;
+
+        /** Signals changes of 'queue' and 'isQueueClosed' */
+        std::condition_variable queueChanged;
+
+        /** Protects 'queue', 'isQueueClosed' and 'isWriteFailed' */
+        std::mutex queueLock;
+
+        /** Tells the I/O thread that no more buffers will be queued */
+        bool isQueueClosed;
+
+        /** Indicates that the I/O thread failed writing the file */
+        bool isWriteFailed;
+
+        /** The time in seconds the I/O thread spent writing */
+        double writeTime;
+
     };
 
 } /* end namespace moldyn */
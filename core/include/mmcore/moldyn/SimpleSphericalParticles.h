@@ -72,6 +72,10 @@ public:
 
         void SetVertexData(SimpleSphericalParticles::VertexDataType const t, char const* p, unsigned int const s = 0,
             float const globRad = 0.5f) {
+            this->vert_type_ = t;
+            this->vert_ptr_ = p;
+            this->vert_stride_ = s;
+            this->glob_rad_ = globRad;
             switch (t) {
             case SimpleSphericalParticles::VERTDATA_DOUBLE_XYZ: {
                 this->x_acc_ = std::make_shared<Accessor_Impl<double>>(p, s);
@@ -110,6 +114,13 @@ public:
         void SetColorData(SimpleSphericalParticles::ColourDataType const t, char const* p, unsigned int const s = 0,
             unsigned char const r = 255, unsigned char const g = 255, unsigned char const b = 255,
             unsigned char const a = 255) {
+            this->col_type_ = t;
+            this->col_ptr_ = p;
+            this->col_stride_ = s;
+            this->glob_col_[0] = r;
+            this->glob_col_[1] = g;
+            this->glob_col_[2] = b;
+            this->glob_col_[3] = a;
             switch (t) {
             case SimpleSphericalParticles::COLDATA_DOUBLE_I: {
                 this->cr_acc_ = std::make_shared<Accessor_Impl<double>>(p, s);
@@ -215,6 +226,138 @@ public:
 
         std::shared_ptr<Accessor> const& GetIDAcc() const { return this->id_acc_; }
 
+        /**
+         * Calls 'v' once with concrete accessors for x, y, z and the radius of
+         * the current vertex data. The accessors are passed by their actual
+         * type such that their Get<T>(idx) methods are resolved at compile
+         * time and can be inlined into the loop of the visitor. Therefore,
+         * 'v' must be callable with any combination of Accessor_Impl,
+         * Accessor_Val and Accessor_0, e.g. by being a generic lambda.
+         *
+         * @param v The visitor.
+         */
+        template <class V> void VisitVertexData(V&& v) const {
+            auto const p = this->vert_ptr_;
+            auto const s = this->vert_stride_;
+            Accessor_Val<float> const globRad(this->glob_rad_);
+            switch (this->vert_type_) {
+            case SimpleSphericalParticles::VERTDATA_DOUBLE_XYZ: {
+                v(Accessor_Impl<double>(p, s), Accessor_Impl<double>(p + sizeof(double), s),
+                    Accessor_Impl<double>(p + 2 * sizeof(double), s), globRad);
+            } break;
+            case SimpleSphericalParticles::VERTDATA_FLOAT_XYZ: {
+                v(Accessor_Impl<float>(p, s), Accessor_Impl<float>(p + sizeof(float), s),
+                    Accessor_Impl<float>(p + 2 * sizeof(float), s), globRad);
+            } break;
+            case SimpleSphericalParticles::VERTDATA_FLOAT_XYZR: {
+                v(Accessor_Impl<float>(p, s), Accessor_Impl<float>(p + sizeof(float), s),
+                    Accessor_Impl<float>(p + 2 * sizeof(float), s), Accessor_Impl<float>(p + 3 * sizeof(float), s));
+            } break;
+            case SimpleSphericalParticles::VERTDATA_SHORT_XYZ: {
+                v(Accessor_Impl<unsigned short>(p, s), Accessor_Impl<unsigned short>(p + sizeof(unsigned short), s),
+                    Accessor_Impl<unsigned short>(p + 2 * sizeof(unsigned short), s), globRad);
+            } break;
+            case SimpleSphericalParticles::VERTDATA_NONE:
+            default: { v(Accessor_0(), Accessor_0(), Accessor_0(), globRad); }
+            }
+        }
+
+        /**
+         * Calls 'v' once with concrete accessors for the red, green, blue and
+         * alpha channel of the current colour data. For intensities, only the
+         * red channel carries data. See VisitVertexData for the requirements
+         * on 'v'.
+         *
+         * @param v The visitor.
+         */
+        template <class V> void VisitColourData(V&& v) const {
+            auto const p = this->col_ptr_;
+            auto const s = this->col_stride_;
+            switch (this->col_type_) {
+            case SimpleSphericalParticles::COLDATA_DOUBLE_I: {
+                v(Accessor_Impl<double>(p, s), Accessor_0(), Accessor_0(), Accessor_0());
+            } break;
+            case SimpleSphericalParticles::COLDATA_FLOAT_I: {
+                v(Accessor_Impl<float>(p, s), Accessor_0(), Accessor_0(), Accessor_0());
+            } break;
+            case SimpleSphericalParticles::COLDATA_FLOAT_RGB: {
+                v(Accessor_Impl<float>(p, s), Accessor_Impl<float>(p + sizeof(float), s),
+                    Accessor_Impl<float>(p + 2 * sizeof(float), s), Accessor_Val<float>(1.0f));
+            } break;
+            case SimpleSphericalParticles::COLDATA_FLOAT_RGBA: {
+                v(Accessor_Impl<float>(p, s), Accessor_Impl<float>(p + sizeof(float), s),
+                    Accessor_Impl<float>(p + 2 * sizeof(float), s), Accessor_Impl<float>(p + 3 * sizeof(float), s));
+            } break;
+            case SimpleSphericalParticles::COLDATA_UINT8_RGB: {
+                v(Accessor_Impl<unsigned char>(p, s), Accessor_Impl<unsigned char>(p + sizeof(unsigned char), s),
+                    Accessor_Impl<unsigned char>(p + 2 * sizeof(unsigned char), s),
+                    Accessor_Val<unsigned char>(255));
+            } break;
+            case SimpleSphericalParticles::COLDATA_UINT8_RGBA: {
+                v(Accessor_Impl<unsigned char>(p, s), Accessor_Impl<unsigned char>(p + sizeof(unsigned char), s),
+                    Accessor_Impl<unsigned char>(p + 2 * sizeof(unsigned char), s),
+                    Accessor_Impl<unsigned char>(p + 3 * sizeof(unsigned char), s));
+            } break;
+            case SimpleSphericalParticles::COLDATA_USHORT_RGBA: {
+                v(Accessor_Impl<unsigned short>(p, s), Accessor_Impl<unsigned short>(p + sizeof(unsigned short), s),
+                    Accessor_Impl<unsigned short>(p + 2 * sizeof(unsigned short), s),
+                    Accessor_Impl<unsigned short>(p + 3 * sizeof(unsigned short), s));
+            } break;
+            case SimpleSphericalParticles::COLDATA_NONE:
+            default: {
+                v(Accessor_Val<unsigned char>(this->glob_col_[0]), Accessor_Val<unsigned char>(this->glob_col_[1]),
+                    Accessor_Val<unsigned char>(this->glob_col_[2]), Accessor_Val<unsigned char>(this->glob_col_[3]));
+            }
+            }
+        }
+
+        /**
+         * Converts the positions and radii of the particles [first, first +
+         * cnt) into separate, densely packed arrays. The type of the data is
+         * only dispatched once for the whole range. Values are converted like
+         * by the single element accessors, i.e. without any normalisation.
+         *
+         * @param first The index of the first particle.
+         * @param cnt   The number of particles.
+         * @param x     Receives 'cnt' x-coordinates, or nullptr to skip.
+         * @param y     Receives 'cnt' y-coordinates, or nullptr to skip.
+         * @param z     Receives 'cnt' z-coordinates, or nullptr to skip.
+         * @param r     Receives 'cnt' radii, or nullptr to skip.
+         */
+        template <class T>
+        void GetVertexData(size_t const first, size_t const cnt, T* x, T* y, T* z, T* r = nullptr) const {
+            static_assert(std::is_floating_point<T>::value, "Only float and double buffers are supported.");
+            this->VisitVertexData([=](auto const& xa, auto const& ya, auto const& za, auto const& ra) {
+                if (x != nullptr) xa.template Get<T>(first, cnt, x);
+                if (y != nullptr) ya.template Get<T>(first, cnt, y);
+                if (z != nullptr) za.template Get<T>(first, cnt, z);
+                if (r != nullptr) ra.template Get<T>(first, cnt, r);
+            });
+        }
+
+        /**
+         * Converts the colours of the particles [first, first + cnt) into
+         * separate, densely packed arrays. See GetVertexData.
+         *
+         * @param first The index of the first particle.
+         * @param cnt   The number of particles.
+         * @param r     Receives 'cnt' red values or intensities, or nullptr.
+         * @param g     Receives 'cnt' green values, or nullptr to skip.
+         * @param b     Receives 'cnt' blue values, or nullptr to skip.
+         * @param a     Receives 'cnt' alpha values, or nullptr to skip.
+         */
+        template <class T>
+        void GetColourData(size_t const first, size_t const cnt, T* r, T* g = nullptr, T* b = nullptr,
+            T* a = nullptr) const {
+            static_assert(std::is_floating_point<T>::value, "Only float and double buffers are supported.");
+            this->VisitColourData([=](auto const& ra, auto const& ga, auto const& ba, auto const& aa) {
+                if (r != nullptr) ra.template Get<T>(first, cnt, r);
+                if (g != nullptr) ga.template Get<T>(first, cnt, g);
+                if (b != nullptr) ba.template Get<T>(first, cnt, b);
+                if (a != nullptr) aa.template Get<T>(first, cnt, a);
+            });
+        }
+
     private:
         std::shared_ptr<Accessor> x_acc_  = std::make_shared<Accessor_0>();
         std::shared_ptr<Accessor> y_acc_  = std::make_shared<Accessor_0>();
@@ -228,6 +371,15 @@ public:
         std::shared_ptr<Accessor> dy_acc_ = std::make_shared<Accessor_0>();
         std::shared_ptr<Accessor> dz_acc_ = std::make_shared<Accessor_0>();
         std::shared_ptr<Accessor> id_acc_ = std::make_shared<Accessor_0>();
+
+        SimpleSphericalParticles::VertexDataType vert_type_ = SimpleSphericalParticles::VERTDATA_NONE;
+        char const* vert_ptr_ = nullptr;
+        size_t vert_stride_ = 0;
+        float glob_rad_ = 0.5f;
+        SimpleSphericalParticles::ColourDataType col_type_ = SimpleSphericalParticles::COLDATA_NONE;
+        char const* col_ptr_ = nullptr;
+        size_t col_stride_ = 0;
+        unsigned char glob_col_[4] = {255, 255, 255, 255};
     };
 
     /** possible values of accumulated data sizes over all vertex coordinates */
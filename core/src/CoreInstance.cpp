@@ -14,6 +14,8 @@
 #    pragma warning(default : 4996)
 #endif /* (_MSC_VER > 1000) */
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 
 #include "job/PluginsStateFileGeneratorJob.h"
@@ -151,7 +153,10 @@ megamol::core::CoreInstance::CoreInstance(void)
     , plugins(nullptr)
     , all_call_descriptions()
     , all_module_descriptions()
-    , parameterHash(1) {
+    , parameterHash(1)
+    , networkParamIDs()
+    , networkParamNames()
+    , networkParamTableHash(0) {
     // setup log as early as possible.
     this->log.SetLogFileName(static_cast<const char*>(NULL), false);
     this->log.SetLevel(vislib::sys::Log::LEVEL_ALL);
@@ -2342,6 +2347,25 @@ void megamol::core::CoreInstance::Shutdown(void) {
 }
 
 
+/*
+ * megamol::core::CoreInstance::GetNetworkParameterID
+ */
+bool megamol::core::CoreInstance::GetNetworkParameterID(const vislib::StringA& name, UINT32& outID) const {
+    auto it = this->networkParamIDs.find(std::string(name.PeekBuffer()));
+    if (it == this->networkParamIDs.end()) return false;
+    outID = it->second;
+    return true;
+}
+
+
+/*
+ * megamol::core::CoreInstance::GetNetworkParameterName
+ */
+vislib::StringA megamol::core::CoreInstance::GetNetworkParameterName(const UINT32 id) const {
+    return (id < this->networkParamNames.size()) ? this->networkParamNames[id] : vislib::StringA::EMPTY;
+}
+
+
 /*
  * megamol::core::CoreInstance::SetupGraphFromNetwork
  */
@@ -2467,6 +2491,8 @@ void megamol::core::CoreInstance::SetupGraphFromNetwork(const void* data) {
         }
         // printf("\n");
 
+        this->UpdateNetworkParameterIDs();
+
     } catch (vislib::Exception ex) {
         Log::DefaultLog.WriteMsg(
             Log::LEVEL_ERROR, "Failed to setup module graph from network message: %s\n", ex.GetMsgA());
@@ -3276,6 +3302,35 @@ megamol::core::Call* megamol::core::CoreInstance::InstantiateCall(
 }
 
 
+/*
+ * megamol::core::CoreInstance::UpdateNetworkParameterIDs
+ */
+void megamol::core::CoreInstance::UpdateNetworkParameterIDs(void) {
+    std::vector<vislib::StringA> names;
+    this->EnumParameters([&names](const Module& mod, param::ParamSlot& slot) { names.push_back(slot.FullName()); });
+    std::sort(names.begin(), names.end(),
+        [](const vislib::StringA& l, const vislib::StringA& r) { return ::strcmp(l.PeekBuffer(), r.PeekBuffer()) < 0; });
+
+    this->networkParamIDs.clear();
+    this->networkParamIDs.reserve(names.size());
+    // FNV-1a, because the hash must be the same on all nodes.
+    UINT32 hash = 2166136261u;
+    for (UINT32 i = 0; i < static_cast<UINT32>(names.size()); ++i) {
+        this->networkParamIDs[std::string(names[i].PeekBuffer())] = i;
+        // Include the terminating zero to separate the names.
+        for (vislib::StringA::Size c = 0; c <= names[i].Length(); ++c) {
+            hash = (hash ^ static_cast<unsigned char>(names[i].PeekBuffer()[c])) * 16777619u;
+        }
+    }
+    this->networkParamNames = std::move(names);
+    this->networkParamTableHash = this->networkParamNames.empty() ? 0 : ((hash != 0) ? hash : 1);
+
+    vislib::sys::Log::DefaultLog.WriteMsg(vislib::sys::Log::LEVEL_INFO + 10,
+        "Assigned network IDs to %u parameters (table hash 0x%08x)\n",
+        static_cast<unsigned int>(this->networkParamNames.size()), this->networkParamTableHash);
+}
+
+
 /*
  * megamol::core::CoreInstance::enumParameters
  */
@@ -15,12 +15,20 @@ const unsigned int FlagCall::CallMapFlags = 0;
  */
 const unsigned int FlagCall::CallUnmapFlags = 1;
 
+/*
+ * FlagCall::CallGetSnapshot
+ */
+const unsigned int FlagCall::CallGetSnapshot = 2;
+
 /*
  *	IntSelectionCall:IntSelectionCall
  */
-FlagCall::FlagCall(void) : flags() {}
+FlagCall::FlagCall(void) : flags(), version(0), snapshot(), changes(), allChanged(false), changeLog(), changeLogStart(0) {}
 
 /*
  *	IntSelectionCall::~IntSelectionCall
  */
-FlagCall::~FlagCall(void) { flags = nullptr; }
+FlagCall::~FlagCall(void) {
+    flags = nullptr;
+    snapshot = nullptr;
+}
@@ -1,22 +1,37 @@
 #include "stdafx.h"
 #include "mmcore/FlagStorage.h"
 #include "mmcore/FlagCall.h"
+#include "mmcore/param/BoolParam.h"
 
 using namespace megamol;
 using namespace megamol::core;
 
 
+const size_t FlagStorage::MaxChangeLogSize = 1024;
+
+
 FlagStorage::FlagStorage(void)
     : getFlagsSlot("getFlags", "Provides flag data to clients.")
+    , compressSlot("compress", "Run-length encodes the flags while no client uses them. This saves memory if most "
+                               "flags are the same, but costs time whenever the flags are accessed.")
     , flags(std::make_shared<FlagVectorType>())
     , mut()
-    , version(0) {
+    , version(0)
+    , changeLog()
+    , changeLogStart(0)
+    , runs()
+    , runsSize(0) {
 
     this->getFlagsSlot.SetCallback(
         FlagCall::ClassName(), FlagCall::FunctionName(FlagCall::CallMapFlags), &FlagStorage::mapFlagsCallback);
     this->getFlagsSlot.SetCallback(
         FlagCall::ClassName(), FlagCall::FunctionName(FlagCall::CallUnmapFlags), &FlagStorage::unmapFlagsCallback);
+    this->getFlagsSlot.SetCallback(
+        FlagCall::ClassName(), FlagCall::FunctionName(FlagCall::CallGetSnapshot), &FlagStorage::getSnapshotCallback);
     this->MakeSlotAvailable(&this->getFlagsSlot);
+
+    this->compressSlot << new param::BoolParam(false);
+    this->MakeSlotAvailable(&this->compressSlot);
 }
 
 
@@ -36,7 +51,16 @@ bool FlagStorage::mapFlagsCallback(core::Call& caller) {
     if (fc == nullptr) return false;
 
     mut.lock();
+    this->decompress();
+    if (this->flags.use_count() > 1) {
+        // Readers still hold snapshots of the flags, so the writer gets a copy.
+        this->flags = std::make_shared<FlagVectorType>(*this->flags);
+    }
     fc->SetFlags(this->flags, this->version);
+    fc->changes.clear();
+    fc->allChanged = false;
+    fc->changeLog = this->changeLog;
+    fc->changeLogStart = this->changeLogStart;
 
     return true;
 }
@@ -47,8 +71,99 @@ bool FlagStorage::unmapFlagsCallback(core::Call& caller) {
     if (fc == nullptr) return false;
 
     this->flags = fc->GetFlags();
-    this->version = fc->GetVersion();
+    if (fc->GetVersion() != this->version) {
+        this->version = fc->GetVersion();
+        this->appendChanges(fc->changes, fc->allChanged || fc->changes.empty());
+    }
+    fc->changes.clear();
+    fc->allChanged = false;
+    fc->changeLog.clear();
+    this->compress();
     mut.unlock();
 
     return true;
 }
+
+
+bool FlagStorage::getSnapshotCallback(core::Call& caller) {
+    FlagCall* fc = dynamic_cast<FlagCall*>(&caller);
+    if (fc == nullptr) return false;
+
+    std::lock_guard<std::mutex> lock(this->mut);
+    this->decompress();
+    fc->snapshot = this->flags;
+    fc->version = this->version;
+    fc->changes.clear();
+    fc->allChanged = false;
+    fc->changeLog = this->changeLog;
+    fc->changeLogStart = this->changeLogStart;
+
+    return true;
+}
+
+
+void FlagStorage::appendChanges(RangeVectorType const& ranges, bool all) {
+    if (all) {
+        this->changeLog.clear();
+        this->changeLogStart = this->version;
+        return;
+    }
+
+    for (auto const& r : ranges) {
+        this->changeLog.emplace_back(this->version, r);
+    }
+    // Forget whole versions only, the log must be complete for all versions
+    // after 'changeLogStart'.
+    while (this->changeLog.size() > MaxChangeLogSize) {
+        auto const v = this->changeLog.front().first;
+        while (!this->changeLog.empty() && (this->changeLog.front().first == v)) {
+            this->changeLog.pop_front();
+        }
+        this->changeLogStart = v;
+    }
+}
+
+
+void FlagStorage::compress(void) {
+    // Small vectors are not worth the effort, and if readers hold snapshots,
+    // dropping our reference would not free anything.
+    if (!this->compressSlot.Param<param::BoolParam>()->Value() || !this->flags || (this->flags.use_count() > 1) ||
+        (this->flags->size() < (1 << 16))) {
+        return;
+    }
+
+    auto const& f = *this->flags;
+    auto const maxRuns = f.size() * sizeof(FlagItemType) / (4 * sizeof(decltype(this->runs)::value_type));
+    size_t cnt = 1;
+    for (size_t i = 1; i < f.size(); ++i) {
+        if ((f[i] != f[i - 1]) && (++cnt > maxRuns)) {
+            // Less than 75 % savings.
+            return;
+        }
+    }
+
+    this->runs.clear();
+    this->runs.reserve(cnt);
+    for (size_t i = 0; i < f.size();) {
+        size_t j = i + 1;
+        while ((j < f.size()) && (f[j] == f[i]) && (j - i < UINT32_MAX)) ++j;
+        this->runs.emplace_back(f[i], static_cast<uint32_t>(j - i));
+        i = j;
+    }
+    this->runsSize = f.size();
+    this->flags.reset();
+}
+
+
+void FlagStorage::decompress(void) {
+    if (this->flags) return;
+
+    this->flags = std::make_shared<FlagVectorType>();
+    this->flags->reserve(this->runsSize);
+    for (auto const& r : this->runs) {
+        this->flags->insert(this->flags->end(), r.second, r.first);
+    }
+    this->runs.clear();
+    this->runs.shrink_to_fit();
+    this->runsSize = 0;
+}
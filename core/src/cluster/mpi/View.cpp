@@ -8,6 +8,7 @@
 #include "stdafx.h"
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
 #include <string>
 #include <unordered_map>
@@ -26,6 +27,7 @@
 #include "vislib/graphics/gl/IncludeAllGL.h"
 
 #include "mmcore/param/BoolParam.h"
+#include "mmcore/param/IntParam.h"
 #include "mmcore/param/StringParam.h"
 
 #include "vislib/RawStorageSerialiser.h"
@@ -36,6 +38,7 @@
 #include "vislib/net/IPHostEntry.h"
 #include "vislib/net/NetworkInformation.h"
 #include "vislib/net/ShallowSimpleMessage.h"
+#include "vislib/net/SimpleMessage.h"
 #include "vislib/sys/AutoLock.h"
 #include "vislib/sys/CmdLineProvider.h"
 #include "vislib/sys/SystemInformation.h"
@@ -100,11 +103,25 @@ megamol::core::cluster::mpi::View::View(void)
     , mpiRank(-1)
     , mpiSize(-1)
     , mustNegotiateMaster(true)
+    , paramDeltaSequence(0)
+    , paramDeltaFallback(false)
+    , paramDeltaMismatch(false)
+    , paramDelta("paramDelta", "Relay parameter updates with compact IDs instead of their names. The IDs are "
+                               "assigned when the module graph is set up.")
+    , paramPipeline("pipeline", "Synchronise the state of the next frame while rendering the current one. This "
+                                "hides the latency of the network, but delays all updates by one frame.")
+    , paramTimingInterval("timingInterval", "Number of frames after which each rank reports where its time was "
+                                            "spent. Zero disables the reports.")
     , paramUseGsync("useGsync", "Try to synchronise buffer swaps if possible.")
     , relayOffset(0) {
 #ifdef WITH_MPI
     this->comm = MPI_COMM_NULL;
+    this->pipelineRequests[0] = MPI_REQUEST_NULL;
+    this->pipelineRequests[1] = MPI_REQUEST_NULL;
+    this->pipelineCanRender[0] = 0;
+    this->pipelineCanRender[1] = 0;
 #endif /* WITH_MPI */
+    ::ZeroMemory(&this->timings, sizeof(this->timings));
 
     this->callRequestMpi.SetCompatibleCall<MpiCallDescription>();
     this->MakeSlotAvailable(&this->callRequestMpi);
@@ -114,6 +131,15 @@ megamol::core::cluster::mpi::View::View(void)
 
     this->hasMasterConnection.store(false);
 
+    this->paramDelta << new param::BoolParam(true);
+    this->MakeSlotAvailable(&this->paramDelta);
+
+    this->paramPipeline << new param::BoolParam(false);
+    this->MakeSlotAvailable(&this->paramPipeline);
+
+    this->paramTimingInterval << new param::IntParam(0, 0);
+    this->MakeSlotAvailable(&this->paramTimingInterval);
+
     this->paramUseGsync << new param::BoolParam(false);
     this->MakeSlotAvailable(&this->paramUseGsync);
 }
@@ -198,81 +224,16 @@ void megamol::core::cluster::mpi::View::Render(const mmcRenderViewContext& conte
     state.Time = context.Time;
     state.InstanceTime = context.InstanceTime;
 
-    /* Ensure that we know where to get the status from. */
-    if (!this->knowsBcastMaster()) {
-        this->mustNegotiateMaster = true;
-        _TRACE_INFO("Rank %d must negotiate the master, because it does not "
-                    "know one.\n",
-            this->mpiRank);
-    }
-    if (this->mustNegotiateMaster) {
-        // We have no master, so we try to negotiate one.
-        this->mustNegotiateMaster = !this->negotiateBcastMaster();
-        _TRACE_INFO("Rank %d has negotiated the master. Must negotiate "
-                    "again: %d\n",
-            this->mpiRank, this->mustNegotiateMaster);
-
-        // Request all nodes to enable Gsync (join the swap group) given that
-        // - we have negotiated a master
-        // - the master has a Gsync-capable graphics adapter
-        // - Gsync has not yet been enabled
-        // - the user did not disable Gsync
-        state.InitSwapGroup = !this->mustNegotiateMaster && this->isBcastMaster() && this->hasGsync() &&
-                              !this->isGsyncEnabled() && this->paramUseGsync.Param<param::BoolParam>()->Value();
-    } else {
-        // We have a master, check whether it is still valid. It is OK to do
-        // this everywhere, because only the data from the real master will
-        // remain after the broadcast. Furthermore, nodes that are currently not
-        // the master can never invalidate it.
-        state.InvalidateMaster = (this->isBcastMaster() && !this->hasMasterConnection);
-        _TRACE_INFO("Rank %d thinks that the broadcast master %s be "
-                    "invalidated.\n",
-            this->mpiRank, (state.InvalidateMaster ? "should" : "should not"));
+    /*
+     * Synchronise the state, either by completing the synchronisation that
+     * was started during the last frame or by doing it right now.
+     */
+    auto timer = std::chrono::steady_clock::now();
+    bool const isPipelined = this->finishPipelinedSync(state);
+    if (!isPipelined) {
+        this->synchroniseState(state);
     }
-
-    /* If we have a master, synchronise the state now. */
-    if (this->knowsBcastMaster() && (this->mpiSize > 1)) {
-        _TRACE_BARRIERS("Rank %d is before status synchronisation.\n", this->mpiRank);
-#ifdef WITH_MPI
-        ASSERT(this->knowsBcastMaster());
-
-        state.RelaySize = this->filterRelayBuffer();
-        _TRACE_MESSAGING("Rank %d found RelaySize to be %d\n", this->mpiRank, state.RelaySize);
-        // It is safe using this size without any lock, because filtering of the
-        // relay buffer must only be triggered by the rendering thread, ie
-        // cannot occur concurrently while the following code is executed.
-
-        ::MPI_Bcast(&state, sizeof(state), MPI_BYTE, this->getBcastMaster(), this->comm);
-
-        if (state.InitSwapGroup) {
-            SwapGroupApi::GetInstance().JoinSwapGroup(1);
-        }
-
-        if (state.InvalidateMaster) {
-            this->mustNegotiateMaster = true;
-            _TRACE_INFO("Rank %d invalidated the broadcast master. Will "
-                        "be renegotiated in the next frame.\n",
-                this->mpiRank);
-        }
-
-        if (!this->isBcastMaster()) {
-            _TRACE_MESSAGING("Rank %d is preparing to receive %u bytes of "
-                             "relayed messages...\n",
-                this->mpiRank, state.RelaySize);
-            this->filteredRelayBuffer.AssertSize(state.RelaySize);
-        } else {
-            _TRACE_MESSAGING("Rank %d thinks itself the master and will receive nothing\n", this->mpiRank);
-        }
-
-        if (state.RelaySize > 0) {
-            _TRACE_MESSAGING("Rank %d is participating in relay of %u bytes.\n", this->mpiRank, state.RelaySize);
-            ::MPI_Bcast(static_cast<void*>(this->filteredRelayBuffer), static_cast<int>(state.RelaySize), MPI_BYTE,
-                this->getBcastMaster(), this->comm);
-        } else {
-            _TRACE_MESSAGING("Rank %d has nothing to relay\n", this->mpiRank);
-        }
-#endif /* WITH_MPI */
-    }  /* if (this->knowsBcastMaster() && (this->mpiSize > 1)) */
+    this->timings.Sync += this->lapTime(timer);
 
 
     // Post-process status
@@ -347,6 +308,10 @@ void megamol::core::cluster::mpi::View::Render(const mmcRenderViewContext& conte
                 }
             } break;
 
+            case MSG_PARAMDELTA:
+                this->applyParamDelta(msg);
+                break;
+
             case MSG_CAMERAUPDATE:
                 if ((av != nullptr) && (msg.GetHeader().GetBodySize() > 0)) {
                     vislib::RawStorageSerialiser ser(msg.GetBodyAs<BYTE>(), msg.GetHeader().GetBodySize());
@@ -368,19 +333,44 @@ void megamol::core::cluster::mpi::View::Render(const mmcRenderViewContext& conte
     /* Ensure that we have a rendering call that we can execute. */
     crv = this->getCallRenderView();
     canRender = (crv != nullptr);
+    this->timings.Update += this->lapTime(timer);
 
 #ifdef WITH_MPI
     int allCanRender = 0; // TODO: RESET ALLCANRENDER FOR NEW MODULE GRAPH
-    if (!allCanRender) {
-        MPI_Allreduce(&canRender, &allCanRender, 1, MPI_INT, MPI_LAND, this->comm);
+    int allStatus = 0;
+    if (isPipelined) {
+        // The reduction has been started in the last frame.
+        allStatus = this->pipelineCanRender[1];
+    } else {
+        int status = (canRender ? RANK_CAN_RENDER : 0) | (this->paramDeltaMismatch ? 0 : RANK_APPLIED_PARAM_DELTAS);
+        MPI_Allreduce(&status, &allStatus, 1, MPI_INT, MPI_BAND, this->comm);
+    }
+    // Only derived from the reduced status, because all ranks must agree on
+    // it to enter the collectives below together.
+    allCanRender = ((allStatus & RANK_CAN_RENDER) != 0);
+
+    if ((allStatus & RANK_APPLIED_PARAM_DELTAS) == 0) {
+        // Some rank has missed parameter updates. All ranks know this now, so
+        // the master resends everything by name.
+        this->paramDeltaMismatch = false;
+        if (this->isBcastMaster()) {
+            this->paramDeltaFallback = true;
+            this->relayAllParameters();
+        }
+    }
+
+    /* Overlap the synchronisation of the next frame with rendering this one. */
+    if (state.Pipelined && this->knowsBcastMaster() && !this->mustNegotiateMaster && (this->mpiSize > 1)) {
+        this->startPipelinedSync(context,
+            (canRender ? RANK_CAN_RENDER : 0) | (this->paramDeltaMismatch ? 0 : RANK_APPLIED_PARAM_DELTAS));
     }
 #else
     int const allCanRender = 1;
 #endif
+    this->timings.Reduce += this->lapTime(timer);
 
-    /* Render the view if any; do fallback rendering otherwise. */
-    if (allCanRender) {
 #ifdef WITH_MPI
+    if (allCanRender) {
         SyncDataSourcesCall* ss = this->syncDataSlot.CallAs<SyncDataSourcesCall>();
         if (ss != nullptr) {
             if (!(*ss)(0)) { // check for dirty filenamesslot
@@ -405,8 +395,15 @@ void megamol::core::cluster::mpi::View::Render(const mmcRenderViewContext& conte
         } else {
             vislib::sys::Log::DefaultLog.WriteInfo("MPIClusterView: No sync object connected.\n");
         }
+        this->timings.Reduce += this->lapTime(timer);
+    }
 #endif
 
+    /*
+     * Render the view if any; do fallback rendering otherwise. In pipelined
+     * mode, the local graph may have changed since the reduction.
+     */
+    if (allCanRender && canRender) {
         ASSERT(crv != nullptr);
         this->checkParameters();
 
@@ -442,18 +439,22 @@ void megamol::core::cluster::mpi::View::Render(const mmcRenderViewContext& conte
 
         //::glFlush();
         ::glFinish();
+        this->timings.Render += this->lapTime(timer);
 
     } else {
         this->renderFallbackView();
         vislib::sys::Log::DefaultLog.WriteInfo("Waiting for all nodes to create the module graph.\n");
+        this->timings.Render += this->lapTime(timer);
     } /* end if (canRender) */
 
 #ifdef WITH_MPI
     _TRACE_BARRIERS("Rank %d is before swap barrier.\n", this->mpiRank);
     ::MPI_Barrier(this->comm);
+    this->timings.Barrier += this->lapTime(timer);
     _TRACE_BARRIERS("Rank %d is after swap barrier.\n", this->mpiRank);
     _TRACE_BARRIERS("Rank %d is after swap barrier.\n", this->mpiRank);
 #endif /* WITH_MPI */
+    this->reportTimings(isPipelined);
 
     if (state.InitSwapGroup && this->isBcastMaster()) {
         // Now all nodes should have joined the swap group, so the master
@@ -599,6 +600,65 @@ megamol::core::cluster::mpi::View::SwapGroupApi::SwapGroupApi(void) : isAvailabl
 }
 
 
+/*
+ * megamol::core::cluster::mpi::View::applyParamDelta
+ */
+void megamol::core::cluster::mpi::View::applyParamDelta(const vislib::net::AbstractSimpleMessage& msg) {
+    using vislib::sys::Log;
+    const auto core = this->GetCoreInstance();
+    const auto bodySize = static_cast<size_t>(msg.GetHeader().GetBodySize());
+
+    if (bodySize < sizeof(simple::ParamDeltaHeader)) {
+        Log::DefaultLog.WriteWarn("Rank %d got a truncated parameter delta.\n", this->mpiRank);
+        return;
+    }
+
+    const auto header = msg.GetBodyAs<simple::ParamDeltaHeader>();
+    if (header->TableHash != core->GetNetworkParameterTableHash()) {
+        // The IDs of this rank might be outdated if the graph changed since
+        // they have been assigned.
+        core->UpdateNetworkParameterIDs();
+    }
+    if (header->TableHash != core->GetNetworkParameterTableHash()) {
+        Log::DefaultLog.WriteWarn("Rank %d ignores parameter delta %u, because its parameter IDs (0x%08x) differ "
+                                  "from the ones of the master (0x%08x). Requesting all parameters by name.\n",
+            this->mpiRank, header->Sequence, core->GetNetworkParameterTableHash(), header->TableHash);
+        this->paramDeltaMismatch = true;
+        return;
+    }
+    if (header->Sequence != this->paramDeltaSequence + 1) {
+        Log::DefaultLog.WriteWarn("Rank %d expected parameter delta %u, but got %u.\n", this->mpiRank,
+            this->paramDeltaSequence + 1, header->Sequence);
+    }
+    this->paramDeltaSequence = header->Sequence;
+
+    size_t pos = sizeof(simple::ParamDeltaHeader);
+    for (unsigned int i = 0; i < header->Count; ++i) {
+        if (pos + 2 * sizeof(UINT32) > bodySize) break;
+        const auto id = *msg.GetBodyAsAt<UINT32>(pos);
+        const auto len = static_cast<size_t>(*msg.GetBodyAsAt<UINT32>(pos + sizeof(UINT32)));
+        pos += 2 * sizeof(UINT32);
+        if (pos + len > bodySize) break;
+        vislib::StringA utf8(msg.GetBodyAsAt<char>(pos), static_cast<vislib::StringA::Size>(len));
+        pos += len;
+
+        vislib::StringA name = core->GetNetworkParameterName(id);
+        vislib::TString value;
+        vislib::UTF8Encoder::Decode(value, utf8);
+        AbstractNamedObject::ptr_type psp = this->FindNamedObject(name, true);
+        param::ParamSlot* ps = dynamic_cast<param::ParamSlot*>(psp.get());
+        if (ps != nullptr) {
+            ps->Param<param::AbstractParam>()->ParseValue(value);
+        }
+    }
+
+    if (pos != bodySize) {
+        Log::DefaultLog.WriteWarn(
+            "Rank %d got a malformed parameter delta %u.\n", this->mpiRank, header->Sequence);
+    }
+}
+
+
 /*
  * megamol::core::cluster::mpi::View::create
  */
@@ -614,12 +674,72 @@ bool megamol::core::cluster::mpi::View::create(void) {
 }
 
 
+/*
+ * megamol::core::cluster::mpi::View::encodeParamDelta
+ */
+size_t megamol::core::cluster::mpi::View::encodeParamDelta(
+    std::unordered_map<std::string, std::pair<size_t, size_t> >& params, size_t& outOffset) {
+    typedef vislib::net::SimpleMessageHeaderData HeaderType;
+    const auto core = this->GetCoreInstance();
+    simple::ParamDeltaHeader header;
+    size_t pos = sizeof(HeaderType) + sizeof(header);
+
+    header.Sequence = this->paramDeltaSequence + 1;
+    header.TableHash = core->GetNetworkParameterTableHash();
+    header.Count = 0;
+    outOffset = this->relayOffset;
+    if (header.TableHash == 0) return 0;
+
+    for (auto it = params.begin(); it != params.end();) {
+        UINT32 id;
+        if (!core->GetNetworkParameterID(vislib::StringA(it->first.c_str()), id)) {
+            /* Unknown parameters are relayed by name. */
+            ++it;
+            continue;
+        }
+
+        vislib::net::ShallowSimpleMessage msg(this->relayBuffer.At(it->second.first));
+        auto body = msg.GetBodyAs<char>();
+        auto value = body + it->first.size() + 1;
+        auto end = body + msg.GetHeader().GetBodySize();
+        while ((end > value) && (*(end - 1) == 0)) --end;
+        const auto len = static_cast<UINT32>(end - value);
+
+        this->paramDeltaBuffer.AssertSize(pos + 2 * sizeof(UINT32) + len, true);
+        *this->paramDeltaBuffer.AsAt<UINT32>(pos) = id;
+        *this->paramDeltaBuffer.AsAt<UINT32>(pos + sizeof(UINT32)) = len;
+        ::memcpy(this->paramDeltaBuffer.At(pos + 2 * sizeof(UINT32)), value, len);
+        pos += 2 * sizeof(UINT32) + len;
+
+        outOffset = (std::min)(outOffset, it->second.first);
+        ++header.Count;
+        it = params.erase(it);
+    }
+
+    if (header.Count == 0) return 0;
+
+    this->paramDeltaBuffer.AssertSize(pos, true);
+    *this->paramDeltaBuffer.AsAt<simple::ParamDeltaHeader>(sizeof(HeaderType)) = header;
+    vislib::net::ShallowSimpleMessage msg(this->paramDeltaBuffer.At(0), pos);
+    msg.GetHeader().SetMessageID(MSG_PARAMDELTA);
+    msg.GetHeader().SetBodySize(static_cast<vislib::net::SimpleMessageSize>(pos - sizeof(HeaderType)));
+
+    _TRACE_PACKAGING("Rank %d encoded %u parameter updates into delta %u of "
+                     "%u bytes.\n",
+        this->mpiRank, header.Count, header.Sequence, pos);
+    return pos;
+}
+
+
 /*
  * megamol::core::cluster::mpi::View::filterRelayBuffer
  */
 size_t megamol::core::cluster::mpi::View::filterRelayBuffer(void) {
     typedef std::pair<size_t, size_t> RangeType;
 
+    size_t deltaOffset = 0;
+    size_t deltaSize = 0;
+    bool isGraphChanging = false;
     size_t retval = 0;
     std::unordered_map<vislib::net::SimpleMessageID, RangeType> msgs;
     std::unordered_map<std::string, RangeType> params;
@@ -647,12 +767,29 @@ size_t megamol::core::cluster::mpi::View::filterRelayBuffer(void) {
 
             } else {
                 /* Only keep the last of these messages. */
-                msgs[msg.GetHeader().GetMessageID()] = RangeType(offset, msg.GetMessageSize());
+                auto id = msg.GetHeader().GetMessageID();
+                isGraphChanging = isGraphChanging || (id == MSG_MODULGRAPH) || (id == MSG_MODULGRAPH_LUA) ||
+                                  (id == MSG_TIMESYNC);
+                msgs[id] = RangeType(offset, msg.GetMessageSize());
             }
 
             offset += msg.GetMessageSize();
         } /* for (size_t offset = 0; offset < this->relayOffset;) */
 
+        /*
+         * Phase 1b: Replace the parameter updates by a single delta using the
+         * compact IDs. The IDs are reassigned if the graph changes, so this
+         * must not be done if the graph is changed by the same relay.
+         */
+        if (isGraphChanging) {
+            // The new graph gets new IDs, so give the deltas another try.
+            this->paramDeltaFallback = false;
+        } else if (!this->paramDeltaFallback && !params.empty() &&
+                   this->paramDelta.Param<param::BoolParam>()->Value()) {
+            deltaSize = this->encodeParamDelta(params, deltaOffset);
+            retval += deltaSize;
+        }
+
         /*
          * Phase 2: Sort all required messages according to their original
          * order in 'relayBuffer'.
@@ -670,16 +807,24 @@ size_t megamol::core::cluster::mpi::View::filterRelayBuffer(void) {
             ranges.begin(), ranges.end(), [](const RangeType& l, const RangeType& r) { return l.first < r.first; });
 
         /* Phase 3: Copy the data. */
-        ASSERT(!ranges.empty());
+        ASSERT(!ranges.empty() || (deltaSize > 0));
         this->filteredRelayBuffer.AssertSize(retval);
 
-        if (retval != this->relayOffset) {
+        if ((retval != this->relayOffset) || (deltaSize > 0)) {
             //::DebugBreak();
             size_t offset = 0;
             for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+                if ((deltaSize > 0) && (deltaOffset < it->first)) {
+                    ::memcpy(this->filteredRelayBuffer.At(offset), this->paramDeltaBuffer.At(0), deltaSize);
+                    offset += deltaSize;
+                    deltaSize = 0;
+                }
                 ::memcpy(this->filteredRelayBuffer.At(offset), this->relayBuffer.At(it->first), it->second);
                 offset += it->second;
             }
+            if (deltaSize > 0) {
+                ::memcpy(this->filteredRelayBuffer.At(offset), this->paramDeltaBuffer.At(0), deltaSize);
+            }
         } else {
             /* Can copy at once. */
             ::memcpy(this->filteredRelayBuffer.At(0), this->relayBuffer.At(0), retval);
@@ -711,6 +856,47 @@ void megamol::core::cluster::mpi::View::finaliseMpi(void) {
 }
 
 
+/*
+ * megamol::core::cluster::mpi::View::finishPipelinedSync
+ */
+bool megamol::core::cluster::mpi::View::finishPipelinedSync(FrameState& state) {
+#ifdef WITH_MPI
+    if (this->pipelineRequests[0] == MPI_REQUEST_NULL) {
+        return false;
+    }
+
+    _TRACE_BARRIERS("Rank %d is completing the pipelined status synchronisation.\n", this->mpiRank);
+    ::MPI_Waitall(2, this->pipelineRequests, MPI_STATUSES_IGNORE);
+    state = *this->pipelineBuffer.As<FrameState>();
+
+    if (state.RelaySize > PIPELINE_RELAY_CAPACITY) {
+        // The messages did not fit into the pipelined broadcast. The master
+        // still holds them in 'filteredRelayBuffer'.
+        if (!this->isBcastMaster()) {
+            this->filteredRelayBuffer.AssertSize(state.RelaySize);
+        }
+        ::MPI_Bcast(static_cast<void*>(this->filteredRelayBuffer), static_cast<int>(state.RelaySize), MPI_BYTE,
+            this->getBcastMaster(), this->comm);
+    } else if ((state.RelaySize > 0) && !this->isBcastMaster()) {
+        this->filteredRelayBuffer.AssertSize(state.RelaySize);
+        ::memcpy(static_cast<void*>(this->filteredRelayBuffer), this->pipelineBuffer.At(sizeof(FrameState)),
+            state.RelaySize);
+    }
+
+    if (state.InvalidateMaster) {
+        this->mustNegotiateMaster = true;
+        _TRACE_INFO("Rank %d invalidated the broadcast master. Will "
+                    "be renegotiated in the next frame.\n",
+            this->mpiRank);
+    }
+
+    return true;
+#else  /* WITH_MPI */
+    return false;
+#endif /* WITH_MPI */
+}
+
+
 /*
  * megamol::core::cluster::mpi::View::hasGsync
  */
@@ -806,6 +992,17 @@ bool megamol::core::cluster::mpi::View::isGsyncEnabled(void) const {
 }
 
 
+/*
+ * megamol::core::cluster::mpi::View::lapTime
+ */
+double megamol::core::cluster::mpi::View::lapTime(std::chrono::steady_clock::time_point& timer) {
+    auto const now = std::chrono::steady_clock::now();
+    auto const retval = std::chrono::duration<double, std::milli>(now - timer).count();
+    timer = now;
+    return retval;
+}
+
+
 /*
  * megamol::core::cluster::mpi::View::negotiateBcastMaster
  */
@@ -841,10 +1038,46 @@ bool megamol::core::cluster::mpi::View::negotiateBcastMaster(void) {
 }
 
 
+/*
+ * megamol::core::cluster::mpi::View::relayAllParameters
+ */
+void megamol::core::cluster::mpi::View::relayAllParameters(void) {
+    const auto core = this->GetCoreInstance();
+    vislib::sys::Log::DefaultLog.WriteWarn("Rank %d relays all parameters by name, because the parameter IDs of "
+                                           "some ranks differ.\n",
+        this->mpiRank);
+
+    vislib::sys::AutoLock lock(this->ModuleGraphLock());
+    for (UINT32 id = 0;; ++id) {
+        vislib::StringA name = core->GetNetworkParameterName(id);
+        if (name.IsEmpty()) break;
+
+        AbstractNamedObject::ptr_type psp = this->FindNamedObject(name, true);
+        param::ParamSlot* ps = dynamic_cast<param::ParamSlot*>(psp.get());
+        if (ps == nullptr) continue;
+
+        vislib::StringA value;
+        vislib::UTF8Encoder::Encode(value, ps->Param<param::AbstractParam>()->ValueString());
+        name.Append("=");
+        name.Append(value);
+        vislib::net::SimpleMessage msg;
+        msg.GetHeader().SetMessageID(MSG_PARAMUPDATE);
+        msg.SetBody(name, name.Length());
+        this->storeMessageForRelay(msg);
+    }
+}
+
+
 /*
  * megamol::core::cluster::mpi::View::release
  */
 void megamol::core::cluster::mpi::View::release(void) {
+#ifdef WITH_MPI
+    // All ranks have started the pending operations, so they will complete.
+    if (this->pipelineRequests[0] != MPI_REQUEST_NULL) {
+        ::MPI_Waitall(2, this->pipelineRequests, MPI_STATUSES_IGNORE);
+    }
+#endif /* WITH_MPI */
     if (this->isGsyncEnabled()) {
         // Swap group ID 1 is because-i-know (we always use 1).
         SwapGroupApi::GetInstance().BindSwapBarrier(1, 0);
@@ -855,6 +1088,65 @@ void megamol::core::cluster::mpi::View::release(void) {
 }
 
 
+/*
+ * megamol::core::cluster::mpi::View::reportTimings
+ */
+void megamol::core::cluster::mpi::View::reportTimings(const bool isPipelined) {
+    auto const interval = this->paramTimingInterval.Param<param::IntParam>()->Value();
+    if (interval <= 0) {
+        ::ZeroMemory(&this->timings, sizeof(this->timings));
+        return;
+    }
+
+    if (++this->timings.Frames >= static_cast<unsigned int>(interval)) {
+        auto const n = static_cast<double>(this->timings.Frames);
+        vislib::sys::Log::DefaultLog.WriteInfo("MPIClusterView: Rank %d spent %.3f ms synchronising the status, "
+                                               "%.3f ms applying updates, %.3f ms in reductions, %.3f ms rendering "
+                                               "and %.3f ms in the swap barrier per frame over the last %u frames "
+                                               "(%s).",
+            this->mpiRank, this->timings.Sync / n, this->timings.Update / n, this->timings.Reduce / n,
+            this->timings.Render / n, this->timings.Barrier / n, this->timings.Frames,
+            isPipelined ? "pipelined" : "blocking");
+        ::ZeroMemory(&this->timings, sizeof(this->timings));
+    }
+}
+
+
+/*
+ * megamol::core::cluster::mpi::View::startPipelinedSync
+ */
+void megamol::core::cluster::mpi::View::startPipelinedSync(const mmcRenderViewContext& context, int status) {
+#ifdef WITH_MPI
+    ASSERT(this->pipelineRequests[0] == MPI_REQUEST_NULL);
+    FrameState state;
+    ::ZeroMemory(&state, sizeof(state));
+    state.Time = context.Time;
+    state.InstanceTime = context.InstanceTime;
+    state.InvalidateMaster = (this->isBcastMaster() && !this->hasMasterConnection);
+    state.Pipelined = this->paramPipeline.Param<param::BoolParam>()->Value();
+    // The messages of the current frame have already been processed, so the
+    // buffer can be reused for the next one.
+    state.RelaySize = this->filterRelayBuffer();
+
+    // The status and small sets of messages are sent in a single broadcast of
+    // fixed size, such that the receivers need not know the size in advance.
+    this->pipelineBuffer.AssertSize(sizeof(FrameState) + PIPELINE_RELAY_CAPACITY);
+    *this->pipelineBuffer.As<FrameState>() = state;
+    if ((state.RelaySize > 0) && (state.RelaySize <= PIPELINE_RELAY_CAPACITY)) {
+        ::memcpy(this->pipelineBuffer.At(sizeof(FrameState)), static_cast<void*>(this->filteredRelayBuffer),
+            state.RelaySize);
+    }
+
+    _TRACE_BARRIERS("Rank %d is starting the pipelined status synchronisation.\n", this->mpiRank);
+    ::MPI_Ibcast(static_cast<void*>(this->pipelineBuffer), static_cast<int>(this->pipelineBuffer.GetSize()), MPI_BYTE,
+        this->getBcastMaster(), this->comm, &this->pipelineRequests[0]);
+    this->pipelineCanRender[0] = status;
+    ::MPI_Iallreduce(&this->pipelineCanRender[0], &this->pipelineCanRender[1], 1, MPI_INT, MPI_BAND, this->comm,
+        &this->pipelineRequests[1]);
+#endif /* WITH_MPI */
+}
+
+
 /*
  * megamol::core::cluster::mpi::View::storeMessageForRelay
  */
@@ -875,3 +1167,88 @@ void megamol::core::cluster::mpi::View::storeMessageForRelay(const vislib::net::
         _TRACE_RELEASE_LOCK("relay buffer");
     }
 }
+
+
+/*
+ * megamol::core::cluster::mpi::View::synchroniseState
+ */
+void megamol::core::cluster::mpi::View::synchroniseState(FrameState& state) {
+    /* Ensure that we know where to get the status from. */
+    if (!this->knowsBcastMaster()) {
+        this->mustNegotiateMaster = true;
+        _TRACE_INFO("Rank %d must negotiate the master, because it does not "
+                    "know one.\n",
+            this->mpiRank);
+    }
+    if (this->mustNegotiateMaster) {
+        // We have no master, so we try to negotiate one.
+        this->mustNegotiateMaster = !this->negotiateBcastMaster();
+        _TRACE_INFO("Rank %d has negotiated the master. Must negotiate "
+                    "again: %d\n",
+            this->mpiRank, this->mustNegotiateMaster);
+
+        // Request all nodes to enable Gsync (join the swap group) given that
+        // - we have negotiated a master
+        // - the master has a Gsync-capable graphics adapter
+        // - Gsync has not yet been enabled
+        // - the user did not disable Gsync
+        state.InitSwapGroup = !this->mustNegotiateMaster && this->isBcastMaster() && this->hasGsync() &&
+                              !this->isGsyncEnabled() && this->paramUseGsync.Param<param::BoolParam>()->Value();
+    } else {
+        // We have a master, check whether it is still valid. It is OK to do
+        // this everywhere, because only the data from the real master will
+        // remain after the broadcast. Furthermore, nodes that are currently not
+        // the master can never invalidate it.
+        state.InvalidateMaster = (this->isBcastMaster() && !this->hasMasterConnection);
+        _TRACE_INFO("Rank %d thinks that the broadcast master %s be "
+                    "invalidated.\n",
+            this->mpiRank, (state.InvalidateMaster ? "should" : "should not"));
+    }
+
+    /* If we have a master, synchronise the state now. */
+    if (this->knowsBcastMaster() && (this->mpiSize > 1)) {
+        _TRACE_BARRIERS("Rank %d is before status synchronisation.\n", this->mpiRank);
+#ifdef WITH_MPI
+        ASSERT(this->knowsBcastMaster());
+
+        state.RelaySize = this->filterRelayBuffer();
+        _TRACE_MESSAGING("Rank %d found RelaySize to be %d\n", this->mpiRank, state.RelaySize);
+        // It is safe using this size without any lock, because filtering of the
+        // relay buffer must only be triggered by the rendering thread, ie
+        // cannot occur concurrently while the following code is executed.
+
+        // The master decides for all ranks whether the next frame is pipelined.
+        state.Pipelined = this->paramPipeline.Param<param::BoolParam>()->Value();
+
+        ::MPI_Bcast(&state, sizeof(state), MPI_BYTE, this->getBcastMaster(), this->comm);
+
+        if (state.InitSwapGroup) {
+            SwapGroupApi::GetInstance().JoinSwapGroup(1);
+        }
+
+        if (state.InvalidateMaster) {
+            this->mustNegotiateMaster = true;
+            _TRACE_INFO("Rank %d invalidated the broadcast master. Will "
+                        "be renegotiated in the next frame.\n",
+                this->mpiRank);
+        }
+
+        if (!this->isBcastMaster()) {
+            _TRACE_MESSAGING("Rank %d is preparing to receive %u bytes of "
+                             "relayed messages...\n",
+                this->mpiRank, state.RelaySize);
+            this->filteredRelayBuffer.AssertSize(state.RelaySize);
+        } else {
+            _TRACE_MESSAGING("Rank %d thinks itself the master and will receive nothing\n", this->mpiRank);
+        }
+
+        if (state.RelaySize > 0) {
+            _TRACE_MESSAGING("Rank %d is participating in relay of %u bytes.\n", this->mpiRank, state.RelaySize);
+            ::MPI_Bcast(static_cast<void*>(this->filteredRelayBuffer), static_cast<int>(state.RelaySize), MPI_BYTE,
+                this->getBcastMaster(), this->comm);
+        } else {
+            _TRACE_MESSAGING("Rank %d has nothing to relay\n", this->mpiRank);
+        }
+#endif /* WITH_MPI */
+    }  /* if (this->knowsBcastMaster() && (this->mpiSize > 1)) */
+}
@@ -320,6 +320,7 @@ void cluster::simple::View::processInitialisationMessage(void) {
                 }
             } else {
                 // this needs to be delayed until the 'next' frame, otherwise the graph does not exist yet!!!
+                this->GetCoreInstance()->UpdateNetworkParameterIDs();
                 this->client->ContinueSetup();
             }
 
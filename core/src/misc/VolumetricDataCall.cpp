@@ -78,7 +78,9 @@ const unsigned int megamol::core::misc::VolumetricDataCall::IDX_TRY_GET_DATA
  * megamol::core::misc::VolumetricDataCall::VolumetricDataCall
  */
 megamol::core::misc::VolumetricDataCall::VolumetricDataCall(void)
-        : cntFrames(0), data(nullptr), metadata(nullptr), vram_volume_name(0) {
+        : bricks(nullptr), cntBricks(0), cntFrames(0), data(nullptr),
+        vram_volume_name(0), isBrickRequest(false), isBricksComplete(false),
+        metadata(nullptr) {
 }
 
 
@@ -86,7 +88,9 @@ megamol::core::misc::VolumetricDataCall::VolumetricDataCall(void)
  * megamol::core::misc::VolumetricDataCall::VolumetricDataCall
  */
 megamol::core::misc::VolumetricDataCall::VolumetricDataCall(
-        const VolumetricDataCall& rhs) : data(nullptr), metadata(nullptr), vram_volume_name(0) {
+        const VolumetricDataCall& rhs) : bricks(nullptr), cntBricks(0),
+        data(nullptr), vram_volume_name(0), isBrickRequest(false),
+        isBricksComplete(false), metadata(nullptr) {
     *this = rhs;
 }
 
@@ -288,6 +292,20 @@ bool megamol::core::misc::VolumetricDataCall::IsUniform(const int axis) const {
 }
 
 
+/*
+ * megamol::core::misc::VolumetricDataCall::SetBrickRequest
+ */
+void megamol::core::misc::VolumetricDataCall::SetBrickRequest(
+        const unsigned int level, const size_t min[3], const size_t max[3]) {
+    this->brickRequest.Level = level;
+    for (int i = 0; i < 3; ++i) {
+        this->brickRequest.Min[i] = min[i];
+        this->brickRequest.Max[i] = max[i];
+    }
+    this->isBrickRequest = true;
+}
+
+
 /*
  * megamol::core::misc::VolumetricDataCall::SetMetadata
  */
@@ -307,6 +325,11 @@ megamol::core::misc::VolumetricDataCall::operator =(const VolumetricDataCall& rh
         this->cntFrames = rhs.cntFrames;
         this->data = rhs.data;
         this->metadata = rhs.metadata;
+        this->bricks = rhs.bricks;
+        this->brickRequest = rhs.brickRequest;
+        this->cntBricks = rhs.cntBricks;
+        this->isBrickRequest = rhs.isBrickRequest;
+        this->isBricksComplete = rhs.isBricksComplete;
     }
     return *this;
 }
@@ -7,10 +7,13 @@
 
 #include "stdafx.h"
 #include <algorithm>
+#include <chrono>
+#include <thread>
 #include "mmcore/BoundingBoxes.h"
 #include "mmcore/moldyn/MMPLDWriter.h"
 #include "mmcore/param/EnumParam.h"
 #include "mmcore/param/FilePathParam.h"
+#include "mmcore/param/IntParam.h"
 #include "vislib/String.h"
 #include "vislib/sys/FastFile.h"
 #include "vislib/sys/Log.h"
@@ -26,12 +29,23 @@ using namespace megamol::core;
 moldyn::MMPLDWriter::MMPLDWriter(void)
     : AbstractDataWriter()
     , filenameSlot("filename", "The path to the MMPLD file to be written")
+    , queueLengthSlot("queueLength", "The number of serialised frames that may wait for being written")
+    , blockSizeSlot("blockSize", "The size of the blocks written to disk in MB")
     , versionSlot("version", "The file format version to be written")
-    , dataSlot("data", "The slot requesting the data to be written") {
+    , dataSlot("data", "The slot requesting the data to be written")
+    , isQueueClosed(false)
+    , isWriteFailed(false)
+    , writeTime(0.0) {
 
     this->filenameSlot << new param::FilePathParam("");
     this->MakeSlotAvailable(&this->filenameSlot);
 
+    this->queueLengthSlot << new param::IntParam(4, 1);
+    this->MakeSlotAvailable(&this->queueLengthSlot);
+
+    this->blockSizeSlot << new param::IntParam(8, 1);
+    this->MakeSlotAvailable(&this->blockSizeSlot);
+
     param::EnumParam* verPar = new param::EnumParam(100);
     verPar->SetTypePair(100, "1.0");
 #ifdef WITH_CLUSTERINFO
@@ -66,10 +80,13 @@ void moldyn::MMPLDWriter::release(void) {}
 
 
 /*
- * moldyn::MMPLDWriter::`
+ * moldyn::MMPLDWriter::run
  */
 bool moldyn::MMPLDWriter::run(void) {
     using vislib::sys::Log;
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double> Seconds;
+
     vislib::TString filename(this->filenameSlot.Param<param::FilePathParam>()->Value());
     if (filename.IsEmpty()) {
         Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "No file name specified. Abort.");
@@ -124,7 +141,8 @@ bool moldyn::MMPLDWriter::run(void) {
     //    frameCnt = 10;
     // END DEBUG
 
-    vislib::sys::FastFile file;
+    // The I/O thread writes large blocks itself, so no buffering is needed.
+    vislib::sys::File file;
     if (!file.Open(filename, vislib::sys::File::WRITE_ONLY, vislib::sys::File::SHARE_EXCLUSIVE,
             vislib::sys::File::CREATE_OVERWRITE)) {
         Log::DefaultLog.WriteMsg(
@@ -133,50 +151,60 @@ bool moldyn::MMPLDWriter::run(void) {
         return false;
     }
 
-#define ASSERT_WRITEOUT(A, S)                                                                                          \
-    if (file.Write((A), (S)) != (S)) {                                                                                 \
-        Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Write error %d", __LINE__);                                        \
-        file.Close();                                                                                                  \
-        mpdc->Unlock();                                                                                                \
-        return false;                                                                                                  \
-    }
+    const size_t maxQueued = static_cast<size_t>(this->queueLengthSlot.Param<param::IntParam>()->Value());
+    const size_t blockSize = static_cast<size_t>(this->blockSizeSlot.Param<param::IntParam>()->Value()) << 20;
 
+    /* Serialise the header with an empty seek table. */
+    std::unique_ptr<FrameBuffer> buffer(new FrameBuffer());
     vislib::StringA magicID("MMPLD");
-    ASSERT_WRITEOUT(magicID.PeekBuffer(), 6);
+    append(*buffer, magicID.PeekBuffer(), 6);
     UINT16 version = 0;
-    ASSERT_WRITEOUT(&version, 2);
-    ASSERT_WRITEOUT(&frameCnt, 4);
-    ASSERT_WRITEOUT(bbox.PeekBounds(), 6 * 4);
-    ASSERT_WRITEOUT(cbox.PeekBounds(), 6 * 4);
-
-    UINT64 seekTable = static_cast<UINT64>(file.Tell());
-    UINT64 frameOffset = 0;
-    for (UINT32 i = 0; i <= frameCnt; i++) {
-        ASSERT_WRITEOUT(&frameOffset, 8);
+    append(*buffer, &version, 2);
+    append(*buffer, &frameCnt, 4);
+    append(*buffer, bbox.PeekBounds(), 6 * 4);
+    append(*buffer, cbox.PeekBounds(), 6 * 4);
+
+    const UINT64 seekTable = static_cast<UINT64>(buffer->size());
+    std::vector<UINT64> frameOffsets(frameCnt + 1, 0);
+    append(*buffer, frameOffsets.data(), frameOffsets.size() * 8);
+    UINT64 fileSize = static_cast<UINT64>(buffer->size());
+
+    /* Start the I/O thread. */
+    {
+        std::lock_guard<std::mutex> l(this->queueLock);
+        this->queue.clear();
+        this->isQueueClosed = false;
+        this->isWriteFailed = false;
+        this->writeTime = 0.0;
     }
+    std::thread writer(&MMPLDWriter::writeQueue, this, std::ref(file), blockSize);
+
+    double fetchTime = 0.0;
+    double serialiseTime = 0.0;
+    double stallTime = this->pushBuffer(std::move(buffer), maxQueued);
+    bool retval = true;
+    const auto startTime = Clock::now();
 
     mpdc->Unlock();
-    for (UINT32 i = 0; i < frameCnt; i++) {
-        frameOffset = static_cast<UINT64>(file.Tell());
-        file.Seek(seekTable + i * 8);
-        ASSERT_WRITEOUT(&frameOffset, 8);
-        file.Seek(frameOffset);
+    for (UINT32 i = 0; (i < frameCnt) && retval; i++) {
+        frameOffsets[i] = fileSize;
 
         Log::DefaultLog.WriteMsg(Log::LEVEL_INFO, "Started writing data frame %u\n", i);
 
+        auto fetchStart = Clock::now();
         int missCnt = -9;
         do {
             mpdc->Unlock();
             mpdc->SetFrameID(i, true);
             if (!(*mpdc)(1)) {
                 Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Cannot request frame %u. Abort.\n", i);
-                file.Close();
-                return false;
+                retval = false;
+                break;
             }
             if (!(*mpdc)(0)) {
                 Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Cannot get data frame %u. Abort.\n", i);
-                file.Close();
-                return false;
+                retval = false;
+                break;
             }
             if (mpdc->FrameID() != i) {
                 if ((missCnt % 10) == 0) {
@@ -184,34 +212,77 @@ bool moldyn::MMPLDWriter::run(void) {
                         Log::LEVEL_WARN, "Frame %u returned on request for frame %u\n", mpdc->FrameID(), i);
                 }
                 ++missCnt;
-                vislib::sys::Thread::Sleep(static_cast<DWORD>(1 + std::max<int>(missCnt, 0) * 100));
+                // Back off exponentially, but do not wait longer than 128 ms.
+                vislib::sys::Thread::Sleep(static_cast<DWORD>(1) << std::min<int>(std::max<int>(missCnt, 0), 7));
             }
         } while (mpdc->FrameID() != i);
+        if (!retval) {
+            break;
+        }
 
-        if (!this->writeFrame(file, *mpdc)) {
+        auto serialiseStart = Clock::now();
+        fetchTime += Seconds(serialiseStart - fetchStart).count();
+
+        buffer.reset(new FrameBuffer());
+        if (!this->serialiseFrame(*buffer, *mpdc)) {
             mpdc->Unlock();
             Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Cannot write data frame %u. Abort.\n", i);
-            file.Close();
-            return false;
+            retval = false;
+            break;
         }
+        // Release the data as early as possible such that the source can
+        // proceed with the next frames while this one is being written.
         mpdc->Unlock();
-    }
-
-    frameOffset = static_cast<UINT64>(file.Tell());
-    file.Seek(seekTable + frameCnt * 8);
-    ASSERT_WRITEOUT(&frameOffset, 8);
+        serialiseTime += Seconds(Clock::now() - serialiseStart).count();
 
-    file.Seek(6); // set correct version to show that file is complete
-    version = this->versionSlot.Param<param::EnumParam>()->Value();
-    ASSERT_WRITEOUT(&version, 2);
+        fileSize += buffer->size();
+        stallTime += this->pushBuffer(std::move(buffer), maxQueued);
 
-    file.Seek(frameOffset);
+        {
+            std::lock_guard<std::mutex> l(this->queueLock);
+            if (this->isWriteFailed) {
+                Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Cannot write data frame %u. Abort.\n", i);
+                retval = false;
+            }
+        }
+    }
+    frameOffsets[frameCnt] = fileSize;
 
-    Log::DefaultLog.WriteMsg(Log::LEVEL_INFO, "Completed writing data\n");
+    /* Wait for the I/O thread to write everything. */
+    {
+        std::lock_guard<std::mutex> l(this->queueLock);
+        this->isQueueClosed = true;
+    }
+    this->queueChanged.notify_all();
+    writer.join();
+    retval = retval && !this->isWriteFailed;
+
+    if (retval) {
+        // Complete the seek table and set correct version to show that file
+        // is complete.
+        version = this->versionSlot.Param<param::EnumParam>()->Value();
+        file.Seek(seekTable);
+        retval = (file.Write(frameOffsets.data(), frameOffsets.size() * 8) == frameOffsets.size() * 8);
+        file.Seek(6);
+        retval = retval && (file.Write(&version, 2) == 2);
+        if (!retval) {
+            Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Write error %d", __LINE__);
+        }
+    }
     file.Close();
 
-#undef ASSERT_WRITEOUT
-    return true;
+    if (retval) {
+        const double totalTime = Seconds(Clock::now() - startTime).count();
+        const double mb = static_cast<double>(fileSize) / (1024.0 * 1024.0);
+        Log::DefaultLog.WriteMsg(Log::LEVEL_INFO,
+            "Completed writing %u frames (%.1f MB) in %.2f s: fetching %.1f frames/s, serialising %.1f MB/s, "
+            "writing %.1f MB/s, %.2f s stalled on the I/O queue.\n",
+            frameCnt, mb, totalTime, (fetchTime > 0.0) ? frameCnt / fetchTime : 0.0,
+            (serialiseTime > 0.0) ? mb / serialiseTime : 0.0, (this->writeTime > 0.0) ? mb / this->writeTime : 0.0,
+            stallTime);
+    }
+
+    return retval;
 }
 
 
@@ -225,26 +296,38 @@ bool moldyn::MMPLDWriter::getCapabilities(DataWriterCtrlCall& call) {
 
 
 /*
- * moldyn::MMPLDWriter::writeFrame
+ * moldyn::MMPLDWriter::pushBuffer
  */
-bool moldyn::MMPLDWriter::writeFrame(vislib::sys::File& file, moldyn::MultiParticleDataCall& data) {
-#define ASSERT_WRITEOUT(A, S)                                                                                          \
-    if (file.Write((A), (S)) != (S)) {                                                                                 \
-        Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Write error %d", __LINE__);                                        \
-        file.Close();                                                                                                  \
-        return false;                                                                                                  \
+double moldyn::MMPLDWriter::pushBuffer(std::unique_ptr<FrameBuffer>&& buffer, const size_t maxQueued) {
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> l(this->queueLock);
+        this->queueChanged.wait(
+            l, [this, maxQueued](void) { return (this->queue.size() < maxQueued) || this->isWriteFailed; });
+        if (!this->isWriteFailed) {
+            this->queue.push_back(std::move(buffer));
+        }
     }
+    this->queueChanged.notify_all();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+/*
+ * moldyn::MMPLDWriter::serialiseFrame
+ */
+bool moldyn::MMPLDWriter::serialiseFrame(FrameBuffer& buffer, moldyn::MultiParticleDataCall& data) {
     using vislib::sys::Log;
     uint8_t const alpha = 255;
     int ver = this->versionSlot.Param<param::EnumParam>()->Value();
 
     if (ver == 102) {
         float ts = data.GetTimeStamp();
-        ASSERT_WRITEOUT(&ts, 4);
+        append(buffer, &ts, 4);
     }
 
     UINT32 listCnt = data.GetParticleListCount();
-    ASSERT_WRITEOUT(&listCnt, 4);
+    append(buffer, &listCnt, 4);
 
     for (UINT32 li = 0; li < listCnt; li++) {
         MultiParticleDataCall::Particles& points = data.AccessParticles(li);
@@ -318,18 +401,18 @@ bool moldyn::MMPLDWriter::writeFrame(vislib::sys::File& file, moldyn::MultiParti
         } else {
             ct = 0;
         }
-        ASSERT_WRITEOUT(&vt, 1);
+        append(buffer, &vt, 1);
         if (ct == 1) ct = 2; // UINT8_RGB is unaligned and will never be written again.
         if (vt == 4 && ct < 5) { // TODO: fragile if we add another color type beyond DOUBLE_I!
             if (ct == 3) { // VERTDATA_DOUBLE_XYZ needs COLDATA_DOUBLE_I instead of COLDATA_FLOAT_I to be aligned for modern renderers (NG and OPSRay)
                 UINT8 x = 7;
-                ASSERT_WRITEOUT(&x, 1);
+                append(buffer, &x, 1);
             } else { // VERTDATA_DOUBLE_XYZ needs COLDATA_USHORT_RGBA to be aligned for modern renderers (NG and OPSRay)
                 UINT8 x = 6;
-                ASSERT_WRITEOUT(&x, 1);
+                append(buffer, &x, 1);
             }
         } else {
-            ASSERT_WRITEOUT(&ct, 1);
+            append(buffer, &ct, 1);
         }
 
         if (points.GetVertexDataStride() > vs) {
@@ -345,24 +428,24 @@ bool moldyn::MMPLDWriter::writeFrame(vislib::sys::File& file, moldyn::MultiParti
 
         if ((vt == 1) || (vt == 3) || (vt == 4)) {
             float f = points.GetGlobalRadius();
-            ASSERT_WRITEOUT(&f, 4);
+            append(buffer, &f, 4);
         }
         if (ct == 0) {
             const unsigned char* col = points.GetGlobalColour();
-            ASSERT_WRITEOUT(col, 4);
+            append(buffer, col, 4);
         } else if (ct == 3 || ct == 7) {
             float f = points.GetMinColourIndexValue();
-            ASSERT_WRITEOUT(&f, 4);
+            append(buffer, &f, 4);
             f = points.GetMaxColourIndexValue();
-            ASSERT_WRITEOUT(&f, 4);
+            append(buffer, &f, 4);
         }
 
         UINT64 cnt = points.GetCount();
         if (vt == 0) cnt = 0;
-        ASSERT_WRITEOUT(&cnt, 8);
+        append(buffer, &cnt, 8);
 
         if (ver == 103) {
-            ASSERT_WRITEOUT(points.GetBBox().PeekBounds(), 24);
+            append(buffer, points.GetBBox().PeekBounds(), 24);
         }
 
         if (vt == 0) continue;
@@ -375,9 +458,9 @@ bool moldyn::MMPLDWriter::writeFrame(vislib::sys::File& file, moldyn::MultiParti
                     auto col = points.GetGlobalColour();
                     uint16_t colNew[4] = {col[0] * 257, col[1] * 257, col[2] * 257, col[3] * 257};
                     for (UINT64 i = 0; i < cnt; ++i) {
-                        ASSERT_WRITEOUT(vp, vs);
+                        append(buffer, vp, vs);
                         vp += vo;
-                        ASSERT_WRITEOUT(colNew, 8);
+                        append(buffer, colNew, 8);
                     }
                 }
                 break;
@@ -385,13 +468,13 @@ bool moldyn::MMPLDWriter::writeFrame(vislib::sys::File& file, moldyn::MultiParti
                 {
                     uint16_t colNew[4];
                     for (UINT64 i = 0; i < cnt; ++i) {
-                        ASSERT_WRITEOUT(vp, vs);
+                        append(buffer, vp, vs);
                         vp += vo;
                         colNew[0] = cp[0] * 257;
                         colNew[1] = cp[1] * 257;
                         colNew[2] = cp[2] * 257;
                         colNew[3] = 65535;
-                        ASSERT_WRITEOUT(colNew, 8);
+                        append(buffer, colNew, 8);
                         cp += co;
                     }
                 }
@@ -400,13 +483,13 @@ bool moldyn::MMPLDWriter::writeFrame(vislib::sys::File& file, moldyn::MultiParti
                 {
                     uint16_t colNew[4];
                     for (UINT64 i = 0; i < cnt; ++i) {
-                        ASSERT_WRITEOUT(vp, vs);
+                        append(buffer, vp, vs);
                         vp += vo;
                         colNew[0] = cp[0] * 257;
                         colNew[1] = cp[1] * 257;
                         colNew[2] = cp[2] * 257;
                         colNew[3] = cp[3] * 257;
-                        ASSERT_WRITEOUT(colNew, 8);
+                        append(buffer, colNew, 8);
                         cp += co;
                     }
                 }
@@ -414,24 +497,24 @@ bool moldyn::MMPLDWriter::writeFrame(vislib::sys::File& file, moldyn::MultiParti
             case MultiParticleDataCall::Particles::COLDATA_FLOAT_I: {
                 double iNew;
                 for (UINT64 i = 0; i < cnt; ++i) {
-                    ASSERT_WRITEOUT(vp, vs);
+                    append(buffer, vp, vs);
                     vp += vo;
                     iNew = *(reinterpret_cast<const float *>(cp));
-                    ASSERT_WRITEOUT(&iNew, 8);
+                    append(buffer, &iNew, 8);
                     cp += co;
                 }
             } break;
             case MultiParticleDataCall::Particles::COLDATA_FLOAT_RGB: {
                 uint16_t colNew[4];
                 for (UINT64 i = 0; i < cnt; ++i) {
-                    ASSERT_WRITEOUT(vp, vs);
+                    append(buffer, vp, vs);
                     vp += vo;
                     const auto * col = reinterpret_cast<const float*>(cp);
                     colNew[0] = col[0] * 65535.0f;
                     colNew[1] = col[1] * 65535.0f;
                     colNew[2] = col[2] * 65535.0f;
                     colNew[3] = 65535.0f;
-                    ASSERT_WRITEOUT(colNew, 8);
+                    append(buffer, colNew, 8);
                     cp += co;
                 }
             } break;
@@ -440,15 +523,19 @@ bool moldyn::MMPLDWriter::writeFrame(vislib::sys::File& file, moldyn::MultiParti
                     "MMPLDWriter: incoming unknown color type %u", points.GetColourDataType());
                 break;
             }
+        } else if ((ct == 0) && (vo == vs)) {
+            // Tightly packed positions can be copied at once.
+            append(buffer, vp, static_cast<size_t>(cnt * vs));
         } else {
+            buffer.reserve(buffer.size() + static_cast<size_t>(cnt * (vs + ((cs == 3) ? 4 : cs))));
             for (UINT64 i = 0; i < cnt; i++) {
-                ASSERT_WRITEOUT(vp, vs);
+                append(buffer, vp, vs);
                 vp += vo;
                 if (ct != 0) {
-                    ASSERT_WRITEOUT(cp, cs);
+                    append(buffer, cp, cs);
                     // warning: this only works since only one format is 3 bytes long, the illegal ct = 1
                     if (cs == 3) { // the unaligned ct == 1, UINT8_RGB, will be silently upgraded to ct 2 / cs 4
-                        ASSERT_WRITEOUT(&alpha, 1);
+                        append(buffer, &alpha, 1);
                     }
                     cp += co;
                 }
@@ -457,19 +544,85 @@ bool moldyn::MMPLDWriter::writeFrame(vislib::sys::File& file, moldyn::MultiParti
 #ifdef WITH_CLUSTERINFO
         if (ver == 101) {
             if (points.GetClusterInfos() != NULL) {
-                ASSERT_WRITEOUT(&points.GetClusterInfos()->numClusters, sizeof(unsigned int));
-                ASSERT_WRITEOUT(&points.GetClusterInfos()->sizeofPlainData, sizeof(size_t));
-                ASSERT_WRITEOUT(points.GetClusterInfos()->plainData, points.GetClusterInfos()->sizeofPlainData);
+                append(buffer, &points.GetClusterInfos()->numClusters, sizeof(unsigned int));
+                append(buffer, &points.GetClusterInfos()->sizeofPlainData, sizeof(size_t));
+                append(buffer, points.GetClusterInfos()->plainData, points.GetClusterInfos()->sizeofPlainData);
             } else {
                 unsigned int zero1 = 0u;
                 size_t zero2 = 0;
-                ASSERT_WRITEOUT(&zero1, sizeof(unsigned int));
-                ASSERT_WRITEOUT(&zero2, sizeof(size_t));
+                append(buffer, &zero1, sizeof(unsigned int));
+                append(buffer, &zero2, sizeof(size_t));
             }
         }
 #endif
     }
 
     return true;
-#undef ASSERT_WRITEOUT
+}
+
+
+/*
+ * moldyn::MMPLDWriter::writeQueue
+ */
+void moldyn::MMPLDWriter::writeQueue(vislib::sys::File& file, const size_t blockSize) {
+    using vislib::sys::Log;
+    FrameBuffer block;
+    block.reserve(blockSize);
+    bool isFailed = false;
+
+    auto writeBlock = [&](const uint8_t* data, const size_t size) {
+        auto start = std::chrono::steady_clock::now();
+        isFailed = (file.Write(data, size) != size);
+        this->writeTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (isFailed) {
+            Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Write error %d", __LINE__);
+            {
+                std::lock_guard<std::mutex> l(this->queueLock);
+                this->isWriteFailed = true;
+                this->queue.clear();
+            }
+            this->queueChanged.notify_all();
+        }
+    };
+
+    while (!isFailed) {
+        std::unique_ptr<FrameBuffer> buffer;
+        {
+            std::unique_lock<std::mutex> l(this->queueLock);
+            this->queueChanged.wait(l, [this](void) { return !this->queue.empty() || this->isQueueClosed; });
+            if (this->queue.empty()) {
+                break;
+            }
+            buffer = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+        this->queueChanged.notify_all();
+
+        /*
+         * Fill the current block and write it once it is full. Whole blocks
+         * are written directly from the frame, such that all writes start
+         * at a multiple of the block size.
+         */
+        size_t pos = 0;
+        while ((pos < buffer->size()) && !isFailed) {
+            auto rem = buffer->size() - pos;
+            if (block.empty() && (rem >= blockSize)) {
+                auto size = rem - rem % blockSize;
+                writeBlock(buffer->data() + pos, size);
+                pos += size;
+            } else {
+                auto size = std::min(blockSize - block.size(), rem);
+                block.insert(block.end(), buffer->data() + pos, buffer->data() + pos + size);
+                pos += size;
+                if (block.size() == blockSize) {
+                    writeBlock(block.data(), block.size());
+                    block.clear();
+                }
+            }
+        }
+    }
+
+    if (!isFailed && !block.empty()) {
+        writeBlock(block.data(), block.size());
+    }
 }
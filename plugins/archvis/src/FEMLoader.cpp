@@ -1,26 +1,155 @@
 #include "stdafx.h"
 
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
-#include <sstream>
+
+#include "omp.h"
 
 #include "FEMLoader.h"
 
+#include "mmcore/param/BoolParam.h"
 #include "mmcore/param/FilePathParam.h"
+#include "vislib/sys/Log.h"
+#include "vislib/sys/MemmappedFile.h"
 
 namespace {
+
+/** The header of the binary cache file */
+struct CacheHeader {
+    char magic[8];
+    uint64_t source_size[3];
+    int64_t source_time[3];
+    uint64_t node_cnt;
+    uint64_t element_idx_cnt[3];
+    uint64_t dyn_data_cnt;
+    uint64_t timesteps;
+};
+
+const char CacheMagic[8] = {'M', 'M', 'F', 'E', 'M', 'C', '1', '\0'};
+
+/*
+ * Records size and modification time of the source files in the header.
+ */
+void stampSources(std::array<std::string, 3> const& sources, CacheHeader& header) {
+    for (size_t i = 0; i < sources.size(); ++i) {
+        struct stat st;
+        if (!sources[i].empty() && (::stat(sources[i].c_str(), &st) == 0)) {
+            header.source_size[i] = static_cast<uint64_t>(st.st_size);
+            header.source_time[i] = static_cast<int64_t>(st.st_mtime);
+        } else {
+            header.source_size[i] = 0;
+            header.source_time[i] = 0;
+        }
+    }
+}
+
 /*
- * Hidden, local helper function for parsing strings.
- * Source: https://www.fluentcpp.com/2017/04/21/how-to-split-a-string-in-c/
+ * Reads the whole file into 'out' and appends a terminating zero. Note that
+ * this copies the file into 'out', as the parser relies on the terminating
+ * zero, which a view of the mapped file cannot provide.
  */
-std::vector<std::string> split(std::string const& s, char delimiter) {
-    std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream tokenStream(s);
-    while (std::getline(tokenStream, token, delimiter)) {
-        tokens.push_back(token);
-    }
-    return tokens;
+bool readFile(std::string const& filename, std::vector<char>& out) {
+    using vislib::sys::File;
+    vislib::sys::MemmappedFile file;
+
+    out.clear();
+    if (filename.empty() || !file.Open(filename.c_str(), File::READ_ONLY, File::SHARE_READ, File::OPEN_ONLY)) {
+        return false;
+    }
+    out.resize(static_cast<size_t>(file.GetSize()));
+    out.resize(static_cast<size_t>(file.Read(out.data(), out.size())));
+    out.push_back('\0');
+    file.Close();
+    return true;
 }
+
+/*
+ * Parses all lines of 'data' that consist of exactly 'cols' comma-separated
+ * numbers and returns their values row by row. All other lines, e.g. headers,
+ * are skipped. The data are split into chunks at line boundaries, which are
+ * parsed in parallel. 'data' must be zero-terminated.
+ */
+std::vector<double> parseRows(std::vector<char> const& data, size_t const cols) {
+    std::vector<double> retval;
+    if (data.size() < 2) return retval;
+
+    auto const size = data.size() - 1;
+    auto const chunk_cnt = static_cast<int>(
+        std::max<size_t>(1, std::min<size_t>(omp_get_max_threads(), size / (1 << 16))));
+    std::vector<std::vector<double>> chunks(chunk_cnt);
+
+#pragma omp parallel for
+    for (int c = 0; c < chunk_cnt; ++c) {
+        // A chunk parses all lines starting within its bounds.
+        char const* p = data.data() + size * c / chunk_cnt;
+        char const* const end = data.data() + size * (c + 1) / chunk_cnt;
+        if (c > 0) {
+            while ((p < end) && (p[-1] != '\n')) ++p;
+        }
+
+        std::vector<double> row(cols);
+        auto& out = chunks[c];
+        while (p < end) {
+            char const* q = p;
+            size_t col = 0;
+            bool valid = true;
+            while (true) {
+                while ((*q == ' ') || (*q == '\t')) ++q;
+                if ((*q == '\n') || (*q == '\r') || (*q == '\0')) break;
+                char* e = nullptr;
+                auto const v = std::strtod(q, &e);
+                if ((e == q) || (col == cols)) {
+                    valid = false;
+                    break;
+                }
+                row[col++] = v;
+                q = e;
+                while ((*q == ' ') || (*q == '\t')) ++q;
+                if (*q == ',') {
+                    ++q;
+                } else if ((*q != '\n') && (*q != '\r') && (*q != '\0')) {
+                    valid = false;
+                    break;
+                }
+            }
+            if (valid && (col == cols)) {
+                out.insert(out.end(), row.begin(), row.end());
+            }
+
+            while ((*q != '\n') && (*q != '\0')) ++q;
+            if (*q == '\0') break;
+            p = q + 1;
+        }
+    }
+
+    size_t total = 0;
+    std::vector<size_t> offsets(chunk_cnt);
+    for (int c = 0; c < chunk_cnt; ++c) {
+        offsets[c] = total;
+        total += chunks[c].size();
+    }
+    retval.resize(total);
+#pragma omp parallel for
+    for (int c = 0; c < chunk_cnt; ++c) {
+        std::copy(chunks[c].begin(), chunks[c].end(), retval.begin() + offsets[c]);
+    }
+
+    return retval;
+}
+
+/*
+ * Reads 'cnt' elements into 'out'.
+ */
+template <typename T> bool readArray(vislib::sys::File& file, std::vector<T>& out, uint64_t const cnt) {
+    out.resize(static_cast<size_t>(cnt));
+    auto const bytes = static_cast<vislib::sys::File::FileSize>(cnt * sizeof(T));
+    return (bytes == 0) || (file.Read(out.data(), bytes) == bytes);
+}
+
 } // namespace
 
 namespace megamol {
@@ -28,10 +157,14 @@ namespace archvis {
 
 FEMLoader::FEMLoader()
     : core::Module()
+    , m_data_hash(0)
     , m_femNodes_filename_slot("FEM node list filename", "The name of the txt file containing the FEM nodes")
     , m_femElements_filename_slot("FEM element list filename", "The name of the txt file containing the FEM elemets")
     , m_femDeformation_filename_slot(
           "FEM displacment filename", "The name of the txt file containing displacements for the FEM nodes")
+    , m_useCache_slot("Use binary cache",
+          "Stores the loaded model in a binary cache file next to the node file, which is used as long as the source "
+          "files do not change")
     , m_getData_slot("getData", "The slot for publishing the loaded data") {
     this->m_getData_slot.SetCallback(FEMDataCall::ClassName(), "GetData", &FEMLoader::getDataCallback);
     this->MakeSlotAvailable(&this->m_getData_slot);
@@ -44,6 +177,9 @@ FEMLoader::FEMLoader()
 
     this->m_femElements_filename_slot << new core::param::FilePathParam("");
     this->MakeSlotAvailable(&this->m_femElements_filename_slot);
+
+    this->m_useCache_slot << new core::param::BoolParam(false);
+    this->MakeSlotAvailable(&this->m_useCache_slot);
 }
 
 FEMLoader::~FEMLoader() {}
@@ -58,44 +194,45 @@ bool FEMLoader::getDataCallback(core::Call& caller) {
 
     if (cd == NULL) return false;
 
-    //      cd->clearUpdateFlag();
-    //      m_update_flag = std::max(0, m_update_flag - 1);
-    //      
-    //      if (this->m_femNodes_filename_slot.IsDirty()) {
-    //          this->m_femNodes_filename_slot.ResetDirty();
-    //      
-    //          auto vislib_filename = m_femNodes_filename_slot.Param<megamol::core::param::FilePathParam>()->Value();
-    //          std::string filename(vislib_filename.PeekBuffer());
-    //      
-    //          m_fem_data->setNodes(loadNodesFromFile(filename));
-    //      
-    //          m_update_flag = std::min(2, m_update_flag + 2);
-    //      }
-    //      
-    //      if (this->m_femElements_filename_slot.IsDirty()) {
-    //          this->m_femElements_filename_slot.ResetDirty();
-    //      
-    //          auto vislib_filename = m_femElements_filename_slot.Param<megamol::core::param::FilePathParam>()->Value();
-    //          std::string filename(vislib_filename.PeekBuffer());
-    //      
-    //          m_fem_data->setElements(loadElementsFromFile(filename));
-    //      
-    //          m_update_flag = std::min(2, m_update_flag + 2);
-    //      }
-    //      
-    //      if (this->m_femDeformation_filename_slot.IsDirty()) {
-    //          this->m_femDeformation_filename_slot.ResetDirty();
-    //      
-    //          auto vislib_filename = m_femDeformation_filename_slot.Param<megamol::core::param::FilePathParam>()->Value();
-    //          std::string filename(vislib_filename.PeekBuffer());
-    //      
-    //          m_fem_data->setNodeDeformations(loadNodeDeformationsFromFile(filename));
-    //      
-    //          m_update_flag = std::min(2, m_update_flag + 2);
-    //      }
-    //      
-    //      cd->setFEMData(m_fem_data);
-    //      if (m_update_flag > 0) cd->setUpdateFlag();
+    if (this->m_femNodes_filename_slot.IsDirty() || this->m_femElements_filename_slot.IsDirty() ||
+        this->m_femDeformation_filename_slot.IsDirty() || this->m_useCache_slot.IsDirty()) {
+        this->m_femNodes_filename_slot.ResetDirty();
+        this->m_femElements_filename_slot.ResetDirty();
+        this->m_femDeformation_filename_slot.ResetDirty();
+        this->m_useCache_slot.ResetDirty();
+
+        std::array<std::string, 3> const sources = {
+            std::string(this->m_femNodes_filename_slot.Param<core::param::FilePathParam>()->Value().PeekBuffer()),
+            std::string(this->m_femElements_filename_slot.Param<core::param::FilePathParam>()->Value().PeekBuffer()),
+            std::string(
+                this->m_femDeformation_filename_slot.Param<core::param::FilePathParam>()->Value().PeekBuffer())};
+        auto const use_cache = this->m_useCache_slot.Param<core::param::BoolParam>()->Value() && !sources[0].empty();
+        auto const cache_filename = sources[0] + ".femcache";
+
+        auto fem_data = std::make_shared<FEMModel>();
+        if (!use_cache || !this->loadCache(cache_filename, sources, *fem_data)) {
+            fem_data->setNodes(loadNodesFromFile(sources[0]));
+            fem_data->setElements(FEMModel::CUBE, loadElementsFromFile(sources[1]));
+
+            // The dynamic data file holds the same number of rows for each
+            // time step, one time step after another.
+            auto dyn_data = loadDynamicDataFromFile(sources[2]);
+            auto const node_cnt = fem_data->getNodes().size();
+            auto const timesteps =
+                ((node_cnt > 0) && (dyn_data.size() % node_cnt == 0)) ? dyn_data.size() / node_cnt : 1;
+            fem_data->setDynamicData(std::move(dyn_data), timesteps);
+
+            if (use_cache) {
+                this->writeCache(cache_filename, sources, *fem_data);
+            }
+        }
+
+        m_fem_data = fem_data;
+        ++m_data_hash;
+    }
+
+    cd->setFEMData(m_fem_data);
+    cd->SetDataHash(m_data_hash);
 
     return true;
 }
@@ -103,77 +240,165 @@ bool FEMLoader::getDataCallback(core::Call& caller) {
 void FEMLoader::release() {}
 
 std::vector<FEMModel::Vec3> FEMLoader::loadNodesFromFile(std::string const& filename) {
-    std::vector<FEMModel::Vec3> retval;
-
-    std::ifstream file;
-    file.open(filename, std::ifstream::in);
-
-    if (file.is_open()) {
-        file.seekg(0, std::ifstream::beg);
-
-        unsigned int lines_read = 0;
-        while (!file.eof()) {
-            std::string line;
-            std::getline(file, line, '\n');
+    std::vector<char> data;
+    readFile(filename, data);
+    auto const rows = parseRows(data, 4);
+    data.clear();
+
+    std::vector<FEMModel::Vec3> retval(rows.size() / 4);
+#pragma omp parallel for
+    for (int64_t i = 0; i < static_cast<int64_t>(retval.size()); ++i) {
+        auto const row = rows.data() + i * 4;
+        retval[i].Set(static_cast<float>(row[1]), static_cast<float>(row[2]), static_cast<float>(row[3]));
+    }
 
-            auto sl = split(line, ',');
+    return retval;
+}
 
-            if (sl.size() == 4)
-                retval.push_back(FEMModel::Vec3(std::stof(sl[1]), std::stof(sl[2]), std::stof(sl[3])));
+std::vector<uint32_t> FEMLoader::loadElementsFromFile(std::string const& filename) {
+    std::vector<char> data;
+    readFile(filename, data);
+    auto const rows = parseRows(data, 9);
+    data.clear();
+
+    std::vector<uint32_t> retval(rows.size() / 9 * 8);
+#pragma omp parallel for
+    for (int64_t i = 0; i < static_cast<int64_t>(rows.size() / 9); ++i) {
+        for (int64_t j = 0; j < 8; ++j) {
+            retval[i * 8 + j] = static_cast<uint32_t>(rows[i * 9 + j + 1]);
         }
     }
 
     return retval;
 }
 
-std::vector<std::array<size_t, 8>> FEMLoader::loadElementsFromFile(std::string const& filename) {
-    std::vector<std::array<size_t, 8>> retval;
+std::vector<FEMModel::DynamicData> FEMLoader::loadDynamicDataFromFile(std::string const& filename) {
+    std::vector<char> data;
+    readFile(filename, data);
+
+    std::vector<FEMModel::DynamicData> retval;
+    auto rows = parseRows(data, 13);
+    if (!rows.empty()) {
+        retval.resize(rows.size() / 13);
+#pragma omp parallel for
+        for (int64_t i = 0; i < static_cast<int64_t>(retval.size()); ++i) {
+            auto const row = rows.data() + i * 13;
+            auto& d = retval[i];
+            d.node_number = static_cast<int>(row[0]);
+            d.node_posX = static_cast<float>(row[1]);
+            d.node_posY = static_cast<float>(row[2]);
+            d.node_posZ = static_cast<float>(row[3]);
+            d.node_displX = static_cast<float>(row[4]);
+            d.node_displY = static_cast<float>(row[5]);
+            d.node_displZ = static_cast<float>(row[6]);
+            // same scaling as in CreateFEMModel
+            d.norm_stressX = static_cast<float>(row[7] / 100000000);
+            d.norm_stressY = static_cast<float>(row[8] / 100000000);
+            d.norm_stressZ = static_cast<float>(row[9] / 100000000);
+            d.shear_stressX = static_cast<float>(row[10] / 100000000);
+            d.shear_stressY = static_cast<float>(row[11] / 100000000);
+            d.shear_stressZ = static_cast<float>(row[12] / 100000000);
+            d.padding0 = d.padding1 = d.padding2 = 0.0f;
+        }
+        return retval;
+    }
 
-    std::ifstream file;
-    file.open(filename, std::ifstream::in);
+    // displacements only
+    rows = parseRows(data, 4);
+    retval.resize(rows.size() / 4);
+#pragma omp parallel for
+    for (int64_t i = 0; i < static_cast<int64_t>(retval.size()); ++i) {
+        auto const row = rows.data() + i * 4;
+        auto& d = retval[i];
+        std::memset(&d, 0, sizeof(d));
+        d.node_number = static_cast<int>(row[0]);
+        d.node_displX = static_cast<float>(row[1]);
+        d.node_displY = static_cast<float>(row[2]);
+        d.node_displZ = static_cast<float>(row[3]);
+    }
 
-    if (file.is_open()) {
-        file.seekg(0, std::ifstream::beg);
+    return retval;
+}
 
-        unsigned int lines_read = 0;
-        while (!file.eof()) {
-            std::string line;
-            std::getline(file, line, '\n');
+bool FEMLoader::loadCache(std::string const& filename, std::array<std::string, 3> const& sources, FEMModel& model) {
+    using vislib::sys::File;
+    vislib::sys::MemmappedFile file;
 
-            auto sl = split(line, ',');
+    if (!File::Exists(filename.c_str()) ||
+        !file.Open(filename.c_str(), File::READ_ONLY, File::SHARE_READ, File::OPEN_ONLY)) {
+        return false;
+    }
 
-            if (sl.size() == 9)
-                retval.push_back({std::stoul(sl[1]), std::stoul(sl[2]), std::stoul(sl[3]), std::stoul(sl[4]),
-                    std::stoul(sl[5]), std::stoul(sl[6]), std::stoul(sl[7]), std::stoul(sl[8])});
-        }
+    CacheHeader header, expected;
+    stampSources(sources, expected);
+    if ((file.Read(&header, sizeof(header)) != sizeof(header)) ||
+        (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0) ||
+        (std::memcmp(header.source_size, expected.source_size, sizeof(expected.source_size)) != 0) ||
+        (std::memcmp(header.source_time, expected.source_time, sizeof(expected.source_time)) != 0)) {
+        return false;
     }
 
-    return retval;
-}
+    std::vector<float> positions;
+    std::array<std::vector<uint32_t>, 3> elements;
+    std::vector<FEMModel::DynamicData> dyn_data;
+    bool ok = readArray(file, positions, header.node_cnt * 3);
+    for (size_t i = 0; i < elements.size(); ++i) {
+        ok = ok && readArray(file, elements[i], header.element_idx_cnt[i]);
+    }
+    ok = ok && readArray(file, dyn_data, header.dyn_data_cnt);
+    file.Close();
+    if (!ok) {
+        vislib::sys::Log::DefaultLog.WriteWarn("FEMLoader: Cache file \"%s\" is truncated.", filename.c_str());
+        return false;
+    }
 
-std::vector<FEMModel::Vec4> FEMLoader::loadNodeDeformationsFromFile(std::string const& filename) {
-    std::vector<FEMModel::Vec4> retval;
+    std::vector<FEMModel::Vec3> nodes(static_cast<size_t>(header.node_cnt));
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        nodes[i].Set(positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2]);
+    }
+    model.setNodes(std::move(nodes));
+    model.setElements(FEMModel::LINE, std::move(elements[0]));
+    model.setElements(FEMModel::PLANE, std::move(elements[1]));
+    model.setElements(FEMModel::CUBE, std::move(elements[2]));
+    model.setDynamicData(std::move(dyn_data), static_cast<size_t>(header.timesteps));
 
-    std::ifstream file;
-    file.open(filename, std::ifstream::in);
+    return true;
+}
 
-    if (file.is_open()) {
-        file.seekg(0, std::ifstream::beg);
+void FEMLoader::writeCache(std::string const& filename, std::array<std::string, 3> const& sources, FEMModel& model) {
+    std::array<FEMModel::ElementType, 3> const types = {FEMModel::LINE, FEMModel::PLANE, FEMModel::CUBE};
 
-        unsigned int lines_read = 0;
-        while (!file.eof()) {
-            std::string line;
-            std::getline(file, line, '\n');
+    CacheHeader header;
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    stampSources(sources, header);
+    header.node_cnt = model.getNodes().size();
+    for (size_t i = 0; i < types.size(); ++i) {
+        header.element_idx_cnt[i] = model.getElements(types[i]).size();
+    }
+    header.dyn_data_cnt = model.getDynamicData().size();
+    header.timesteps = model.getTimestepCount();
 
-            auto sl = split(line, ',');
+    std::vector<float> positions;
+    positions.reserve(model.getNodes().size() * 3);
+    for (auto const& node : model.getNodes()) {
+        positions.insert(positions.end(), {node.X(), node.Y(), node.Z()});
+    }
 
-            if (sl.size() == 4)
-                retval.push_back(
-                    FEMModel::Vec4(std::stof(sl[1]), std::stof(sl[2]), std::stof(sl[3]), 0.0f /*padding*/));
-        }
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.write(reinterpret_cast<char const*>(positions.data()), positions.size() * sizeof(float));
+    for (auto const type : types) {
+        auto const& elements = model.getElements(type);
+        file.write(reinterpret_cast<char const*>(elements.data()), elements.size() * sizeof(uint32_t));
     }
+    file.write(reinterpret_cast<char const*>(model.getDynamicData().data()),
+        model.getDynamicData().size() * sizeof(FEMModel::DynamicData));
 
-    return retval;
+    if (!file) {
+        vislib::sys::Log::DefaultLog.WriteWarn("FEMLoader: Could not write cache file \"%s\".", filename.c_str());
+        file.close();
+        std::remove(filename.c_str());
+    }
 }
 
 } // namespace archvis
@@ -11,6 +11,8 @@
 #    pragma once
 #endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
 
+#include <array>
+
 #include "FEMDataCall.h"
 #include "archvis/archvis.h"
 #include "mmcore/CalleeSlot.h"
@@ -69,14 +71,35 @@ protected:
 
     std::vector<FEMModel::Vec3> loadNodesFromFile(std::string const& filename);
 
-    std::vector<std::array<size_t, 8>> loadElementsFromFile(std::string const& filename);
+    /**
+     * Loads the cube elements, returning the eight node indices of each
+     * element one after another.
+     */
+    std::vector<uint32_t> loadElementsFromFile(std::string const& filename);
 
-    std::vector<FEMModel::Vec4> loadNodeDeformationsFromFile(std::string const& filename);
+    /**
+     * Loads the dynamic data of all time steps. Rows either hold the full
+     * dynamic data (13 columns) or node displacements only (4 columns).
+     */
+    std::vector<FEMModel::DynamicData> loadDynamicDataFromFile(std::string const& filename);
+
+    /**
+     * Restores the model from the binary cache file, if it is up to date with
+     * respect to the given source files.
+     *
+     * @return 'true' on success, 'false' if the cache must be rebuilt.
+     */
+    bool loadCache(std::string const& filename, std::array<std::string, 3> const& sources, FEMModel& model);
+
+    /**
+     * Writes the model to the binary cache file.
+     */
+    void writeCache(std::string const& filename, std::array<std::string, 3> const& sources, FEMModel& model);
 
 private:
     std::shared_ptr<FEMModel> m_fem_data;
 
-    int m_update_flag;
+    uint64_t m_data_hash;
 
     /** The fem node file name */
     core::param::ParamSlot m_femNodes_filename_slot;
@@ -87,6 +110,9 @@ private:
     /** Example displacement data */
     core::param::ParamSlot m_femDeformation_filename_slot;
 
+    /** Enables the binary cache next to the node file */
+    core::param::ParamSlot m_useCache_slot;
+
     /** The slot for requesting data */
     megamol::core::CalleeSlot m_getData_slot;
 };
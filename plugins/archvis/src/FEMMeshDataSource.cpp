@@ -46,46 +46,33 @@ bool megamol::archvis::FEMMeshDataSource::getDataCallback(core::Call& caller) {
         glowl::VertexLayout vertex_descriptor(0, attribs);
 
     // Create std-container holding index data
+    auto const& cubes = fem_data->getElements(FEMModel::CUBE);
     std::vector<uint32_t> indices;
-    std::vector<size_t> node_indices;
-
-    for (auto& element : fem_data->getElements()) {
-        switch (element.getType()) {
-        case FEMModel::CUBE:
-
-            // TODO indices for a cube....
-            node_indices = element.getNodeIndices();
-
-            indices.insert(indices.end(),
-                {// front
-                    static_cast<uint32_t>(node_indices[0] - 1), static_cast<uint32_t>(node_indices[1] - 1),
-                    static_cast<uint32_t>(node_indices[2] - 1), static_cast<uint32_t>(node_indices[2] - 1),
-                    static_cast<uint32_t>(node_indices[3] - 1), static_cast<uint32_t>(node_indices[0] - 1),
-                    // right
-                    static_cast<uint32_t>(node_indices[1] - 1), static_cast<uint32_t>(node_indices[5] - 1),
-                    static_cast<uint32_t>(node_indices[6] - 1), static_cast<uint32_t>(node_indices[6] - 1),
-                    static_cast<uint32_t>(node_indices[2] - 1), static_cast<uint32_t>(node_indices[1] - 1),
-                    // back
-                    static_cast<uint32_t>(node_indices[7] - 1), static_cast<uint32_t>(node_indices[6] - 1),
-                    static_cast<uint32_t>(node_indices[5] - 1), static_cast<uint32_t>(node_indices[5] - 1),
-                    static_cast<uint32_t>(node_indices[4] - 1), static_cast<uint32_t>(node_indices[7] - 1),
-                    // left
-                    static_cast<uint32_t>(node_indices[4] - 1), static_cast<uint32_t>(node_indices[0] - 1),
-                    static_cast<uint32_t>(node_indices[3] - 1), static_cast<uint32_t>(node_indices[3] - 1),
-                    static_cast<uint32_t>(node_indices[7] - 1), static_cast<uint32_t>(node_indices[4] - 1),
-                    // bottom
-                    static_cast<uint32_t>(node_indices[4] - 1), static_cast<uint32_t>(node_indices[5] - 1),
-                    static_cast<uint32_t>(node_indices[1] - 1), static_cast<uint32_t>(node_indices[1] - 1),
-                    static_cast<uint32_t>(node_indices[0] - 1), static_cast<uint32_t>(node_indices[4] - 1),
-                    // top
-                    static_cast<uint32_t>(node_indices[3] - 1), static_cast<uint32_t>(node_indices[2] - 1),
-                    static_cast<uint32_t>(node_indices[6] - 1), static_cast<uint32_t>(node_indices[6] - 1),
-                    static_cast<uint32_t>(node_indices[7] - 1), static_cast<uint32_t>(node_indices[3] - 1)});
-
-            break;
-        default:
-            break;
-        }
+    indices.reserve(cubes.size() / 8 * 36);
+
+    for (size_t element_idx = 0; element_idx < cubes.size() / 8; ++element_idx) {
+        // node indices of the file are one-based
+        auto const node_indices = cubes.data() + element_idx * 8;
+
+        indices.insert(indices.end(),
+            {// front
+                node_indices[0] - 1, node_indices[1] - 1, node_indices[2] - 1,
+                node_indices[2] - 1, node_indices[3] - 1, node_indices[0] - 1,
+                // right
+                node_indices[1] - 1, node_indices[5] - 1, node_indices[6] - 1,
+                node_indices[6] - 1, node_indices[2] - 1, node_indices[1] - 1,
+                // back
+                node_indices[7] - 1, node_indices[6] - 1, node_indices[5] - 1,
+                node_indices[5] - 1, node_indices[4] - 1, node_indices[7] - 1,
+                // left
+                node_indices[4] - 1, node_indices[0] - 1, node_indices[3] - 1,
+                node_indices[3] - 1, node_indices[7] - 1, node_indices[4] - 1,
+                // bottom
+                node_indices[4] - 1, node_indices[5] - 1, node_indices[1] - 1,
+                node_indices[1] - 1, node_indices[0] - 1, node_indices[4] - 1,
+                // top
+                node_indices[3] - 1, node_indices[2] - 1, node_indices[6] - 1,
+                node_indices[6] - 1, node_indices[7] - 1, node_indices[3] - 1});
     }
 
     std::vector<std::pair<std::vector<float>::iterator, std::vector<float>::iterator>> vb_iterators = {
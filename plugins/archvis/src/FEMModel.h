@@ -12,6 +12,7 @@
 #endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
 
 #include <array>
+#include <cstdint>
 #include <tuple>
 #include <vector>
 
@@ -54,68 +55,6 @@ public:
         CUBE = 8   // 3D volumetric element, connects 8 nodes
     };
 
-    struct ElementConcept {
-        virtual ElementConcept* clone() const = 0;
-        virtual ElementType getType() const = 0;
-        virtual std::vector<size_t> getNodeIndices() const = 0;
-    };
-
-    template <typename N> struct ElementModel : ElementConcept {
-        ElementModel(ElementType type, N node_indices) : m_type(type), m_node_indices(node_indices) {}
-
-        ElementConcept* clone() const { return new ElementModel(m_type, m_node_indices); }
-
-        ElementType getType() const { return m_type; }
-
-        std::vector<size_t> getNodeIndices() const {
-            return std::vector<size_t>(m_node_indices.begin(), m_node_indices.end());
-        }
-
-        ElementType m_type;
-        N m_node_indices;
-    };
-
-    class Element {
-    public:
-        template <typename N>
-        Element(ElementType type, N node_indices) : m_element(new ElementModel<N>(type, node_indices)) {}
-
-        Element() : m_element(nullptr){};
-
-        ~Element() {
-            if (m_element != nullptr) delete m_element;
-        }
-
-        Element(Element const& other) : m_element(nullptr) {
-            if (other.m_element != nullptr) m_element = other.m_element->clone();
-        }
-
-        Element(Element&& other) : Element() { std::swap(m_element, other.m_element); }
-
-        Element& operator=(Element const& rhs) {
-            delete m_element;
-            if (rhs.m_element != nullptr)
-                m_element = rhs.m_element->clone();
-            else
-                m_element = nullptr;
-
-            return *this;
-        }
-
-        Element& operator=(Element&& other) { 
-            std::swap(m_element, other.m_element);
-
-            return *this;
-        };
-
-        ElementType getType() const { return m_element->getType(); }
-
-        std::vector<size_t> getNodeIndices() const { return m_element->getNodeIndices(); }
-
-    private:
-        ElementConcept* m_element;
-    };
-
     FEMModel();
     ~FEMModel();
 
@@ -127,22 +66,57 @@ public:
 
     void setElements(std::vector<std::array<size_t, 8>> const& elements);
 
+    /**
+     * Sets all elements of the given type. 'node_indices' holds the indices of
+     * the nodes of all elements one after another, i.e. 'type' indices per
+     * element.
+     */
+    void setElements(ElementType type, std::vector<uint32_t>&& node_indices);
+
     void setDynamicData(std::vector<DynamicData> const& dyn_data);
 
+    /**
+     * Sets the dynamic data of all time steps. 'dyn_data' holds the same
+     * number of entries for each time step, one time step after another.
+     */
+    void setDynamicData(std::vector<DynamicData>&& dyn_data, size_t timesteps);
+
     std::vector<Vec3> const& getNodes();
 
     size_t getElementCount();
 
-    std::vector<Element> const& getElements();
+    size_t getElementCount(ElementType type);
+
+    /**
+     * Answer the node indices of all elements of the given type, 'type'
+     * indices per element.
+     */
+    std::vector<uint32_t> const& getElements(ElementType type);
 
+    size_t getTimestepCount();
+
+    /**
+     * Answer the dynamic data of all time steps, one time step after another.
+     */
     std::vector<DynamicData> const& getDynamicData();
 
+    /**
+     * Answer the first entry of the dynamic data of the given time step.
+     * Each time step holds getDynamicData().size() / getTimestepCount()
+     * entries.
+     */
+    DynamicData const* getDynamicData(size_t timestep);
+
 private:
+    static size_t typeIndex(ElementType type);
+
     size_t m_node_cnt;
     size_t m_timesteps;
 
     std::vector<Vec3> m_node_positions;
-    std::vector<Element> m_elements;
+
+    /** The node indices of the elements of each type, see typeIndex() */
+    std::array<std::vector<uint32_t>, 3> m_elements;
 
     std::vector<DynamicData> m_dynamic_data;
 };
@@ -156,10 +130,8 @@ inline FEMModel::~FEMModel() {}
 
 inline FEMModel::FEMModel(
     std::vector<Vec3> const& nodes, std::vector<std::array<size_t, 8>> const& elements)
-    : m_node_cnt(nodes.size()), m_timesteps(0), m_node_positions(nodes), m_elements(elements.size()), m_dynamic_data() {
-    for (size_t element_idx = 0; element_idx < elements.size(); ++element_idx) {
-        m_elements[element_idx] = Element(ElementType::CUBE, elements[element_idx]);
-    }
+    : m_node_cnt(nodes.size()), m_timesteps(0), m_node_positions(nodes), m_elements(), m_dynamic_data() {
+    setElements(elements);
 }
 
 inline void FEMModel::setNodes(std::vector<Vec3> const& nodes) {
@@ -168,31 +140,68 @@ inline void FEMModel::setNodes(std::vector<Vec3> const& nodes) {
 }
 
 inline void FEMModel::setNodes(std::vector<Vec3>&& nodes) {
-    m_node_positions = nodes;
+    m_node_positions = std::move(nodes);
     m_node_cnt = m_node_positions.size();
 }
 
 inline void FEMModel::setElements(std::vector<std::array<size_t, 8>> const& elements) {
-    m_elements.clear();
-    m_elements.reserve(elements.size());
+    m_elements[typeIndex(LINE)].clear();
+    m_elements[typeIndex(PLANE)].clear();
+
+    auto& cubes = m_elements[typeIndex(CUBE)];
+    cubes.resize(elements.size() * 8);
 
     for (size_t element_idx = 0; element_idx < elements.size(); ++element_idx) {
-        m_elements.push_back(Element(ElementType::CUBE, elements[element_idx]));
+        for (size_t i = 0; i < 8; ++i) {
+            cubes[element_idx * 8 + i] = static_cast<uint32_t>(elements[element_idx][i]);
+        }
     }
 }
 
+inline void FEMModel::setElements(ElementType type, std::vector<uint32_t>&& node_indices) {
+    m_elements[typeIndex(type)] = std::move(node_indices);
+}
+
 inline void FEMModel::setDynamicData(std::vector<DynamicData> const& dyn_data) {
     m_dynamic_data = dyn_data;
+    m_timesteps = dyn_data.empty() ? 0 : 1;
+}
+
+inline void FEMModel::setDynamicData(std::vector<DynamicData>&& dyn_data, size_t timesteps) {
+    m_dynamic_data = std::move(dyn_data);
+    m_timesteps = m_dynamic_data.empty() ? 0 : timesteps;
 }
 
 inline std::vector<FEMModel::Vec3> const& FEMModel::getNodes() { return m_node_positions; }
 
-inline size_t FEMModel::getElementCount() { return m_elements.size(); }
+inline size_t FEMModel::getElementCount() {
+    return getElementCount(LINE) + getElementCount(PLANE) + getElementCount(CUBE);
+}
+
+inline size_t FEMModel::getElementCount(ElementType type) { return m_elements[typeIndex(type)].size() / type; }
 
-inline std::vector<FEMModel::Element> const& FEMModel::getElements() { return m_elements; }
+inline std::vector<uint32_t> const& FEMModel::getElements(ElementType type) { return m_elements[typeIndex(type)]; }
+
+inline size_t FEMModel::getTimestepCount() { return m_timesteps; }
 
 inline std::vector<FEMModel::DynamicData> const& FEMModel::getDynamicData() { return m_dynamic_data; }
 
+inline FEMModel::DynamicData const* FEMModel::getDynamicData(size_t timestep) {
+    if (timestep >= m_timesteps) return nullptr;
+    return m_dynamic_data.data() + timestep * (m_dynamic_data.size() / m_timesteps);
+}
+
+inline size_t FEMModel::typeIndex(ElementType type) {
+    switch (type) {
+    case LINE:
+        return 0;
+    case PLANE:
+        return 1;
+    default:
+        return 2;
+    }
+}
+
 } // namespace archvis
 } // namespace megamol
 
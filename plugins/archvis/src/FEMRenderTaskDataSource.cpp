@@ -1,5 +1,6 @@
 #include "FEMRenderTaskDataSource.h"
 
+#include <algorithm>
 #include <variant>
 
 #include "mesh/GPUMeshCollection.h"
@@ -8,7 +9,7 @@
 #include "FEMDataCall.h"
 
 megamol::archvis::FEMRenderTaskDataSource::FEMRenderTaskDataSource()
-    : m_fem_callerSlot("getFEMFile", "Connects the data source with loaded FEM data"), m_FEM_model_hash(0) {
+    : m_fem_callerSlot("getFEMFile", "Connects the data source with loaded FEM data"), m_FEM_model_hash(0), m_FEM_timestep(0) {
     this->m_fem_callerSlot.SetCompatibleCall<FEMDataCallDescription>();
     this->MakeSlotAvailable(&this->m_fem_callerSlot);
 }
@@ -52,7 +53,25 @@ bool megamol::archvis::FEMRenderTaskDataSource::getDataCallback(core::Call& call
 
     rtc->setData(m_gpu_render_tasks);
 
+    // Only the requested time step is uploaded, not the dynamic data of all time steps.
+    auto fem_data = fem_call->getFEMData();
+    auto const timestep_cnt = fem_data->getTimestepCount();
+    size_t const timestep =
+        (timestep_cnt > 0) ? std::min<size_t>(rtc->getMetaData().m_frame_ID, timestep_cnt - 1) : 0;
+    auto const timestep_data = [&fem_data, timestep_cnt, timestep]() {
+        std::vector<FEMModel::DynamicData> retval;
+        auto const first = fem_data->getDynamicData(timestep);
+        if (first != nullptr) {
+            retval.assign(first, first + fem_data->getDynamicData().size() / timestep_cnt);
+        }
+        return retval;
+    };
+
     if (this->m_FEM_model_hash == fem_call->DataHash()) {
+        if (this->m_FEM_timestep != timestep) {
+            m_gpu_render_tasks->updatePerFrameDataBuffer(timestep_data(), 1);
+            this->m_FEM_timestep = timestep;
+        }
         return true;
     }
 
@@ -81,9 +100,7 @@ bool megamol::archvis::FEMRenderTaskDataSource::getDataCallback(core::Call& call
         m_gpu_render_tasks->addRenderTasks(shader, gpu_batch_mesh, draw_commands, object_transform);
     }
 
-    auto const& node_deformation = fem_call->getFEMData()->getDynamicData();
-
-    m_gpu_render_tasks->addPerFrameDataBuffer(node_deformation, 1);
+    m_gpu_render_tasks->addPerFrameDataBuffer(timestep_data(), 1);
 
     { 
         // TODO get transfer function texture and add as per frame data
@@ -100,6 +117,7 @@ bool megamol::archvis::FEMRenderTaskDataSource::getDataCallback(core::Call& call
     rtc->setData(m_gpu_render_tasks);
 
     this->m_FEM_model_hash = fem_call->DataHash();
+    this->m_FEM_timestep = timestep;
 
     return true;
 }
@@ -50,6 +50,9 @@ private:
     megamol::core::CallerSlot m_fem_callerSlot;
 
     uint64_t m_FEM_model_hash;
+
+    /** The time step whose dynamic data have been uploaded */
+    size_t m_FEM_timestep;
 };
 
 } // namespace archvis
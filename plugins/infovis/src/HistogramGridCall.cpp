@@ -0,0 +1,17 @@
+#include "stdafx.h"
+#include "HistogramGridCall.h"
+
+megamol::infovis::HistogramGridCall::HistogramGridCall(void)
+    : core::AbstractGetDataCall()
+    , binCnt(0)
+    , colCnt(0)
+    , frameCnt(0)
+    , frameID(0)
+    , grids(nullptr)
+    , histograms(nullptr)
+    , maximums(nullptr)
+    , minimums(nullptr)
+    , selectedGrids(nullptr)
+    , selectedHistograms(nullptr) {}
+
+megamol::infovis::HistogramGridCall::~HistogramGridCall(void) {}
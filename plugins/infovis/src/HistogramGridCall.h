@@ -0,0 +1,145 @@
+#ifndef MEGAMOL_INFOVIS_HISTOGRAMGRIDCALL_H_INCLUDED
+#define MEGAMOL_INFOVIS_HISTOGRAMGRIDCALL_H_INCLUDED
+
+#include <cstdint>
+
+#include "mmcore/AbstractGetDataCall.h"
+#include "mmcore/factories/CallAutoDescription.h"
+
+namespace megamol {
+namespace infovis {
+
+/**
+ * Call transporting binned table data: a histogram for each column and a
+ * two-dimensional histogram for each pair of columns. The latter serves as
+ * scatterplot density as well as line density between two parallel
+ * coordinates axes, since a line is determined by the bins of its end
+ * points.
+ *
+ * Each histogram comes in two flavours, one counting all rows that are
+ * enabled and not filtered and one counting only the selected ones among
+ * these. The data are owned by the callee and stay valid until the next
+ * request.
+ */
+class HistogramGridCall : public core::AbstractGetDataCall {
+public:
+    /**
+     * Answer the name of the objects of this description.
+     *
+     * @return The name of the objects of this description.
+     */
+    static const char* ClassName(void) { return "HistogramGridCall"; }
+
+    /**
+     * Gets a human readable description of the module.
+     *
+     * @return A human readable description of the module.
+     */
+    static const char* Description(void) { return "Call to get histograms of all columns and column pairs of a table"; }
+
+    /**
+     * Answer the number of functions used for this call.
+     *
+     * @return The number of functions used for this call.
+     */
+    static unsigned int FunctionCount(void) { return AbstractGetDataCall::FunctionCount(); }
+
+    /**
+     * Answer the name of the function used for this call.
+     *
+     * @param idx The index of the function to return it's name.
+     *
+     * @return The name of the requested function.
+     */
+    static const char* FunctionName(unsigned int idx) { return AbstractGetDataCall::FunctionName(idx); }
+
+    /**
+     * Answer the index of the grid of the columns 'x' and 'y' in the
+     * sequence of all grids. 'x' must be less than 'y'.
+     */
+    static inline size_t PairIndex(size_t x, size_t y, size_t colCnt) {
+        return x * colCnt - x * (x + 1) / 2 + (y - x - 1);
+    }
+
+    /** ctor */
+    HistogramGridCall(void);
+
+    /** dtor */
+    virtual ~HistogramGridCall(void);
+
+    inline size_t GetBinCount(void) const { return this->binCnt; }
+
+    inline size_t GetColumnCount(void) const { return this->colCnt; }
+
+    inline unsigned int GetFrameCount(void) const { return this->frameCnt; }
+
+    inline unsigned int GetFrameID(void) const { return this->frameID; }
+
+    /**
+     * Answer the two-dimensional histogram of the columns 'x' and 'y', where
+     * 'x' must be less than 'y'. The bins of 'x' run fastest, i.e. the
+     * count of the bins (i, j) is at index j * GetBinCount() + i.
+     */
+    inline uint32_t const* GetGrid(size_t x, size_t y) const {
+        return this->grids + PairIndex(x, y, this->colCnt) * this->binCnt * this->binCnt;
+    }
+
+    /** Answer the histogram of column 'col'. */
+    inline uint32_t const* GetHistogram(size_t col) const { return this->histograms + col * this->binCnt; }
+
+    /** Answer the maximum value of column 'col', i.e. the upper bound of the last bin. */
+    inline float GetMaximum(size_t col) const { return this->maximums[col]; }
+
+    /** Answer the minimum value of column 'col', i.e. the lower bound of the first bin. */
+    inline float GetMinimum(size_t col) const { return this->minimums[col]; }
+
+    /** Answer the same as GetGrid(), counting only selected rows. */
+    inline uint32_t const* GetSelectedGrid(size_t x, size_t y) const {
+        return this->selectedGrids + PairIndex(x, y, this->colCnt) * this->binCnt * this->binCnt;
+    }
+
+    /** Answer the same as GetHistogram(), counting only selected rows. */
+    inline uint32_t const* GetSelectedHistogram(size_t col) const {
+        return this->selectedHistograms + col * this->binCnt;
+    }
+
+    /**
+     * Sets the data. 'grids' and 'selectedGrids' hold the grids of all
+     * column pairs in the order given by PairIndex().
+     */
+    inline void Set(size_t colCnt, size_t binCnt, float const* minimums, float const* maximums,
+        uint32_t const* histograms, uint32_t const* selectedHistograms, uint32_t const* grids,
+        uint32_t const* selectedGrids) {
+        this->colCnt = colCnt;
+        this->binCnt = binCnt;
+        this->minimums = minimums;
+        this->maximums = maximums;
+        this->histograms = histograms;
+        this->selectedHistograms = selectedHistograms;
+        this->grids = grids;
+        this->selectedGrids = selectedGrids;
+    }
+
+    inline void SetFrameCount(unsigned int frameCnt) { this->frameCnt = frameCnt; }
+
+    inline void SetFrameID(unsigned int frameID) { this->frameID = frameID; }
+
+private:
+    size_t binCnt;
+    size_t colCnt;
+    unsigned int frameCnt;
+    unsigned int frameID;
+    uint32_t const* grids;
+    uint32_t const* histograms;
+    float const* maximums;
+    float const* minimums;
+    uint32_t const* selectedGrids;
+    uint32_t const* selectedHistograms;
+};
+
+typedef core::factories::CallAutoDescription<HistogramGridCall> HistogramGridCallDescription;
+
+} /* end namespace infovis */
+} /* end namespace megamol */
+
+#endif /* end ifndef MEGAMOL_INFOVIS_HISTOGRAMGRIDCALL_H_INCLUDED */
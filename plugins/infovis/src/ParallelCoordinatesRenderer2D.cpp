@@ -421,8 +421,17 @@ void ParallelCoordinatesRenderer2D::assertData(core::view::CallRender2D& call) {
         auto flagsvector = flagsc->GetFlags();
 
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, flagsBuffer);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, this->itemCount * sizeof(core::FlagStorage::FlagItemType),
-            flagsvector.get()->data(), GL_STATIC_DRAW);
+        core::FlagStorage::RangeVectorType ranges;
+        if (this->currentFlagsVersion != 0 && flagsc->GetChangedRanges(this->currentFlagsVersion, ranges)) {
+            // only upload what others have changed since our last upload
+            for (auto const& r : ranges) {
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, r.first * sizeof(core::FlagStorage::FlagItemType),
+                    (r.second - r.first) * sizeof(core::FlagStorage::FlagItemType), flagsvector->data() + r.first);
+            }
+        } else {
+            glBufferData(GL_SHADER_STORAGE_BUFFER, this->itemCount * sizeof(core::FlagStorage::FlagItemType),
+                flagsvector.get()->data(), GL_DYNAMIC_DRAW);
+        }
 
         // give the data back
         flagsc->SetFlags(flagsvector);
@@ -654,17 +654,35 @@ void ScatterplotMatrixRenderer2D::bindFlagsAttribute() {
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->flagsBuffer);
 
     if (this->flagsBufferVersion != this->flagStorage->GetVersion() || this->flagsBufferVersion == 0) {
-        (*this->flagStorage)(core::FlagCall::CallMapFlags);
-        this->flagStorage->validateFlagsCount(this->floatTable->GetRowsCount());
-        auto flags = this->flagStorage->GetFlags();
+        // Uploading only reads the flags, so a snapshot does not block writers.
+        const size_t rowCount = this->floatTable->GetRowsCount();
+        (*this->flagStorage)(core::FlagCall::CallGetSnapshot);
+        auto flags = this->flagStorage->GetSnapshot();
+        if (flags == nullptr || flags->size() != rowCount) {
+            // Adjusting the number of flags requires write access.
+            flags.reset();
+            (*this->flagStorage)(core::FlagCall::CallMapFlags);
+            this->flagStorage->validateFlagsCount(rowCount);
+            auto writable = this->flagStorage->GetFlags();
+            this->flagStorage->SetFlags(writable);
+            (*this->flagStorage)(core::FlagCall::CallUnmapFlags);
+            (*this->flagStorage)(core::FlagCall::CallGetSnapshot);
+            flags = this->flagStorage->GetSnapshot();
+        }
 
-        // Upload flags.
-        glBufferData(GL_SHADER_STORAGE_BUFFER, flags->size() * sizeof(core::FlagStorage::FlagItemType), flags->data(),
-            GL_STATIC_DRAW);
+        // Upload flags, only the changed ones if possible.
+        core::FlagStorage::RangeVectorType ranges;
+        if (this->flagsBufferVersion != 0 &&
+            this->flagStorage->GetChangedRanges(this->flagsBufferVersion, ranges)) {
+            for (auto const& r : ranges) {
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, r.first * sizeof(core::FlagStorage::FlagItemType),
+                    (r.second - r.first) * sizeof(core::FlagStorage::FlagItemType), flags->data() + r.first);
+            }
+        } else {
+            glBufferData(GL_SHADER_STORAGE_BUFFER, flags->size() * sizeof(core::FlagStorage::FlagItemType),
+                flags->data(), GL_DYNAMIC_DRAW);
+        }
         this->flagsBufferVersion = this->flagStorage->GetVersion();
-
-        this->flagStorage->SetFlags(flags);
-        (*this->flagStorage)(core::FlagCall::CallUnmapFlags);
     }
 
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FlagsBindingPoint, this->flagsBuffer);
@@ -1090,18 +1108,28 @@ void ScatterplotMatrixRenderer2D::updateSelection() {
     auto version = this->flagStorage->GetVersion();
 
     // Test if distance is within limits.
+    bool changed = false;
     auto kernelRadiusSq = std::pow(0.5 * this->kernelWidthParam.Param<core::param::FloatParam>()->Value(), 2.0);
     for (size_t i = 0; i < k; ++i) {
         if (dis[i] <= kernelRadiusSq) {
             size_t row = this->indexPoints->idx_to_row(idx[i]);
+            const auto oldFlag = (*flags)[row];
             if (this->mouse.selector == BrushState::ADD) {
                 (*flags)[row] |= core::FlagStorage::SELECTED;
             } else if (this->mouse.selector == BrushState::REMOVE) {
                 (*flags)[row] &= ~core::FlagStorage::SELECTED;
             }
+            if ((*flags)[row] != oldFlag) {
+                this->flagStorage->MarkChanged(row, row + 1);
+                changed = true;
+            }
         }
     }
-    this->flagStorage->SetFlags(flags, version + 1);
+    if (changed) {
+        this->flagStorage->SetFlags(flags, version + 1);
+    } else {
+        this->flagStorage->SetFlags(flags);
+    }
     (*this->flagStorage)(core::FlagCall::CallUnmapFlags);
 
     this->screenValid = false;
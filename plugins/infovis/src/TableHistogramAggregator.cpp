@@ -0,0 +1,264 @@
+#include "stdafx.h"
+#include "TableHistogramAggregator.h"
+
+#include <algorithm>
+
+#include "mmcore/param/IntParam.h"
+
+using namespace megamol;
+using namespace megamol::infovis;
+
+namespace {
+
+/** A row whose state has changed */
+struct RowChange {
+    size_t row;
+    int count;
+    int selected;
+};
+
+} // namespace
+
+
+TableHistogramAggregator::TableHistogramAggregator(void)
+    : core::Module()
+    , gridOutSlot("gridOut", "Output of the histograms")
+    , tableInSlot("tableIn", "Input of the table to be binned")
+    , flagsInSlot("flagsIn", "Input of the flags selecting and filtering rows")
+    , binsSlot("bins", "Number of bins per column")
+    , dataHash(0)
+    , tableHash(0)
+    , frameID(0)
+    , flagsVersion(0)
+    , flagsValid(false)
+    , colCnt(0)
+    , rowCnt(0)
+    , binCnt(0) {
+
+    this->gridOutSlot.SetCallback(HistogramGridCall::ClassName(), HistogramGridCall::FunctionName(0),
+        &TableHistogramAggregator::getDataCallback);
+    this->MakeSlotAvailable(&this->gridOutSlot);
+
+    this->tableInSlot.SetCompatibleCall<stdplugin::datatools::table::TableDataCallDescription>();
+    this->MakeSlotAvailable(&this->tableInSlot);
+
+    this->flagsInSlot.SetCompatibleCall<core::FlagCallDescription>();
+    this->MakeSlotAvailable(&this->flagsInSlot);
+
+    this->binsSlot << new core::param::IntParam(128, 2, 4096);
+    this->MakeSlotAvailable(&this->binsSlot);
+}
+
+
+TableHistogramAggregator::~TableHistogramAggregator(void) { this->Release(); }
+
+
+bool TableHistogramAggregator::create(void) { return true; }
+
+
+void TableHistogramAggregator::release(void) {
+    this->bins.clear();
+    this->states.clear();
+    this->histograms.clear();
+    this->selectedHistograms.clear();
+    this->grids.clear();
+    this->selectedGrids.clear();
+}
+
+
+bool TableHistogramAggregator::getDataCallback(core::Call& c) {
+    auto out = dynamic_cast<HistogramGridCall*>(&c);
+    if (out == nullptr) return false;
+
+    auto table = this->tableInSlot.CallAs<stdplugin::datatools::table::TableDataCall>();
+    if (table == nullptr) return false;
+
+    table->SetFrameID(out->GetFrameID());
+    if (!(*table)()) return false;
+
+    bool const rebin = (this->tableHash != table->DataHash()) || (this->frameID != table->GetFrameID()) ||
+                       this->binsSlot.IsDirty();
+    if (rebin) {
+        this->binsSlot.ResetDirty();
+        this->binRows(table);
+        this->tableHash = table->DataHash();
+        this->frameID = table->GetFrameID();
+    }
+    if (this->updateStates(this->flagsInSlot.CallAs<core::FlagCall>(), rebin) || rebin) {
+        ++this->dataHash;
+    }
+
+    out->SetFrameCount(table->GetFrameCount());
+    out->SetFrameID(this->frameID);
+    out->SetDataHash(this->dataHash);
+    out->Set(this->colCnt, this->binCnt, this->minimums.data(), this->maximums.data(), this->histograms.data(),
+        this->selectedHistograms.data(), this->grids.data(), this->selectedGrids.data());
+
+    return true;
+}
+
+
+void TableHistogramAggregator::binRows(stdplugin::datatools::table::TableDataCall* table) {
+    this->colCnt = table->GetColumnsCount();
+    this->rowCnt = table->GetRowsCount();
+    this->binCnt = static_cast<size_t>(this->binsSlot.Param<core::param::IntParam>()->Value());
+
+    this->minimums.resize(this->colCnt);
+    this->maximums.resize(this->colCnt);
+    for (size_t col = 0; col < this->colCnt; ++col) {
+        this->minimums[col] = table->GetColumnsInfos()[col].MinimumValue();
+        this->maximums[col] = table->GetColumnsInfos()[col].MaximumValue();
+    }
+
+    // Store the bins column by column, such that accumulating a histogram
+    // only touches the columns involved.
+    this->bins.resize(this->colCnt * this->rowCnt);
+    auto const data = table->GetData();
+    auto const maxBin = static_cast<int64_t>(this->binCnt) - 1;
+#pragma omp parallel for
+    for (int64_t row = 0; row < static_cast<int64_t>(this->rowCnt); ++row) {
+        for (size_t col = 0; col < this->colCnt; ++col) {
+            auto const range = this->maximums[col] - this->minimums[col];
+            auto const pos = (range > 0.0f) ? (data[row * this->colCnt + col] - this->minimums[col]) / range : 0.0f;
+            // Also maps NaN to the first bin.
+            auto const bin = (pos > 0.0f) ? std::min(static_cast<int64_t>(pos * this->binCnt), maxBin) : 0;
+            this->bins[col * this->rowCnt + row] = static_cast<uint16_t>(bin);
+        }
+    }
+
+    auto const pairCnt = this->colCnt * (this->colCnt - 1) / 2;
+    this->histograms.resize(this->colCnt * this->binCnt);
+    this->selectedHistograms.resize(this->histograms.size());
+    this->grids.resize(pairCnt * this->binCnt * this->binCnt);
+    this->selectedGrids.resize(this->grids.size());
+}
+
+
+bool TableHistogramAggregator::updateStates(core::FlagCall* flags, bool full) {
+    if ((flags == nullptr) || !(*flags)(core::FlagCall::CallGetSnapshot)) {
+        // Without flags, all rows are counted and none is selected.
+        if (!full && !this->flagsValid) return false;
+        this->states.assign(this->rowCnt, COUNTED);
+        this->flagsValid = false;
+        this->accumulate();
+        return true;
+    }
+
+    auto const version = flags->GetVersion();
+    core::FlagStorage::RangeVectorType ranges;
+    bool const incremental =
+        !full && this->flagsValid && flags->GetChangedRanges(this->flagsVersion, ranges);
+    auto const snapshot = flags->GetSnapshot();
+    this->flagsVersion = version;
+    this->flagsValid = true;
+    if (incremental && ranges.empty()) return false;
+
+    // Rows without flags are enabled by default, see FlagCall::validateFlagsCount.
+    auto const flagCnt = (snapshot != nullptr) ? snapshot->size() : 0;
+    auto const stateOf = [&snapshot, flagCnt](size_t row) -> uint8_t {
+        if (row >= flagCnt) return COUNTED;
+        auto const f = (*snapshot)[row];
+        if (((f & core::FlagStorage::ENABLED) == 0) || ((f & core::FlagStorage::FILTERED) != 0)) return IGNORED;
+        return ((f & core::FlagStorage::SELECTED) != 0) ? SELECTED : COUNTED;
+    };
+
+    if (!incremental) {
+        this->states.resize(this->rowCnt);
+#pragma omp parallel for
+        for (int64_t row = 0; row < static_cast<int64_t>(this->rowCnt); ++row) {
+            this->states[row] = stateOf(row);
+        }
+        this->accumulate();
+        return true;
+    }
+
+    std::vector<RowChange> changes;
+    for (auto const& r : ranges) {
+        for (size_t row = r.first; row < std::min(r.second, this->rowCnt); ++row) {
+            auto const s = stateOf(row);
+            auto const o = this->states[row];
+            if (s != o) {
+                changes.push_back({row, (s != IGNORED) - (o != IGNORED), (s == SELECTED) - (o == SELECTED)});
+                this->states[row] = s;
+            }
+        }
+    }
+    if (changes.empty()) return false;
+
+#pragma omp parallel for
+    for (int64_t col = 0; col < static_cast<int64_t>(this->colCnt); ++col) {
+        auto const b = this->bins.data() + col * this->rowCnt;
+        auto const h = this->histograms.data() + col * this->binCnt;
+        auto const sh = this->selectedHistograms.data() + col * this->binCnt;
+        for (auto const& change : changes) {
+            h[b[change.row]] += change.count;
+            sh[b[change.row]] += change.selected;
+        }
+    }
+
+    auto const pairCnt = static_cast<int64_t>(this->colCnt * (this->colCnt - 1) / 2);
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t pair = 0; pair < pairCnt; ++pair) {
+        // Invert HistogramGridCall::PairIndex.
+        size_t x = 0, first = 0;
+        while (first + (this->colCnt - x - 1) <= static_cast<size_t>(pair)) {
+            first += this->colCnt - x - 1;
+            ++x;
+        }
+        auto const y = x + 1 + (pair - first);
+        auto const bx = this->bins.data() + x * this->rowCnt;
+        auto const by = this->bins.data() + y * this->rowCnt;
+        auto const g = this->grids.data() + pair * this->binCnt * this->binCnt;
+        auto const sg = this->selectedGrids.data() + pair * this->binCnt * this->binCnt;
+        for (auto const& change : changes) {
+            auto const cell = by[change.row] * this->binCnt + bx[change.row];
+            g[cell] += change.count;
+            sg[cell] += change.selected;
+        }
+    }
+
+    return true;
+}
+
+
+void TableHistogramAggregator::accumulate(void) {
+    std::fill(this->histograms.begin(), this->histograms.end(), 0);
+    std::fill(this->selectedHistograms.begin(), this->selectedHistograms.end(), 0);
+    std::fill(this->grids.begin(), this->grids.end(), 0);
+    std::fill(this->selectedGrids.begin(), this->selectedGrids.end(), 0);
+
+    auto const s = this->states.data();
+
+#pragma omp parallel for
+    for (int64_t col = 0; col < static_cast<int64_t>(this->colCnt); ++col) {
+        auto const b = this->bins.data() + col * this->rowCnt;
+        auto const h = this->histograms.data() + col * this->binCnt;
+        auto const sh = this->selectedHistograms.data() + col * this->binCnt;
+        for (size_t row = 0; row < this->rowCnt; ++row) {
+            if (s[row] == IGNORED) continue;
+            ++h[b[row]];
+            if (s[row] == SELECTED) ++sh[b[row]];
+        }
+    }
+
+    // Each thread fills whole grids, so no synchronisation is needed.
+    std::vector<std::pair<size_t, size_t>> pairs;
+    for (size_t x = 0; x < this->colCnt; ++x) {
+        for (size_t y = x + 1; y < this->colCnt; ++y) {
+            pairs.emplace_back(x, y);
+        }
+    }
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t pair = 0; pair < static_cast<int64_t>(pairs.size()); ++pair) {
+        auto const bx = this->bins.data() + pairs[pair].first * this->rowCnt;
+        auto const by = this->bins.data() + pairs[pair].second * this->rowCnt;
+        auto const g = this->grids.data() + pair * this->binCnt * this->binCnt;
+        auto const sg = this->selectedGrids.data() + pair * this->binCnt * this->binCnt;
+        for (size_t row = 0; row < this->rowCnt; ++row) {
+            if (s[row] == IGNORED) continue;
+            auto const cell = by[row] * this->binCnt + bx[row];
+            ++g[cell];
+            if (s[row] == SELECTED) ++sg[cell];
+        }
+    }
+}
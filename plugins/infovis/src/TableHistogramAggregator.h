@@ -0,0 +1,123 @@
+#ifndef MEGAMOL_INFOVIS_TABLEHISTOGRAMAGGREGATOR_H_INCLUDED
+#define MEGAMOL_INFOVIS_TABLEHISTOGRAMAGGREGATOR_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+#include "mmcore/CalleeSlot.h"
+#include "mmcore/CallerSlot.h"
+#include "mmcore/FlagCall.h"
+#include "mmcore/Module.h"
+#include "mmcore/param/ParamSlot.h"
+#include "mmstd_datatools/table/TableDataCall.h"
+
+#include "HistogramGridCall.h"
+
+namespace megamol {
+namespace infovis {
+
+/**
+ * Bins all rows of a table on the CPU and provides the histograms of all
+ * columns and column pairs via HistogramGridCall.
+ *
+ * The bins of all rows are computed once per table. Changes of the flags
+ * only update the histograms for the rows in the ranges reported by the
+ * flag storage, unless it cannot tell which flags have changed.
+ */
+class TableHistogramAggregator : public core::Module {
+public:
+    /** Return module class name */
+    static inline const char* ClassName(void) { return "TableHistogramAggregator"; }
+
+    /** Return module class description */
+    static inline const char* Description(void) {
+        return "Computes histograms of all columns and column pairs of a table, e.g. for density-based rendering";
+    }
+
+    /** Module is always available */
+    static inline bool IsAvailable(void) { return true; }
+
+    /** Constructor */
+    TableHistogramAggregator(void);
+
+    /** Destructor */
+    virtual ~TableHistogramAggregator(void);
+
+protected:
+    /** Lazy initialization of the module */
+    virtual bool create(void);
+
+    /** Resource release */
+    virtual void release(void);
+
+private:
+    /** The states of a row with respect to the histograms */
+    enum RowState : uint8_t { IGNORED = 0, COUNTED = 1, SELECTED = 3 };
+
+    /** Data callback */
+    bool getDataCallback(core::Call& c);
+
+    /** Computes the bins of all rows of the table. */
+    void binRows(stdplugin::datatools::table::TableDataCall* table);
+
+    /**
+     * Updates the row states from the flags and the histograms accordingly.
+     *
+     * @param full Forces the update of all rows.
+     *
+     * @return 'true' if the histograms have changed.
+     */
+    bool updateStates(core::FlagCall* flags, bool full);
+
+    /** Recomputes all histograms from the bins and states of all rows. */
+    void accumulate(void);
+
+    /** Output slot */
+    core::CalleeSlot gridOutSlot;
+
+    /** Table input slot */
+    core::CallerSlot tableInSlot;
+
+    /** Flag storage input slot */
+    core::CallerSlot flagsInSlot;
+
+    /** Parameter slot for the number of bins per column */
+    core::param::ParamSlot binsSlot;
+
+    /** Hash of the output data */
+    size_t dataHash;
+
+    /** Hash of the binned table */
+    size_t tableHash;
+
+    /** Frame of the binned table */
+    unsigned int frameID;
+
+    /** Version of the flags reflected in 'states' */
+    core::FlagStorage::FlagVersionType flagsVersion;
+
+    /** Whether 'flagsVersion' is meaningful */
+    bool flagsValid;
+
+    size_t colCnt;
+    size_t rowCnt;
+    size_t binCnt;
+
+    /** The bins of all rows, column by column */
+    std::vector<uint16_t> bins;
+
+    /** The RowState of all rows */
+    std::vector<uint8_t> states;
+
+    std::vector<float> minimums;
+    std::vector<float> maximums;
+    std::vector<uint32_t> histograms;
+    std::vector<uint32_t> selectedHistograms;
+    std::vector<uint32_t> grids;
+    std::vector<uint32_t> selectedGrids;
+};
+
+} // namespace infovis
+} // namespace megamol
+
+#endif /* MEGAMOL_INFOVIS_TABLEHISTOGRAMAGGREGATOR_H_INCLUDED */
@@ -14,11 +14,13 @@
 
 #include "DiagramSeries.h"
 #include "DiagramSeriesCall.h"
+#include "HistogramGridCall.h"
 #include "MDSProjection.h"
 #include "PCAProjection.h"
 #include "ParallelCoordinatesRenderer2D.h"
 #include "ScatterplotMatrixRenderer2D.h"
 #include "TSNEProjection.h"
+#include "TableHistogramAggregator.h"
 
 /* anonymous namespace hides this type from any other object files */
 namespace {
@@ -49,9 +51,11 @@ public:
         this->module_descriptions.RegisterAutoDescription<megamol::infovis::TSNEProjection>();
         this->module_descriptions.RegisterAutoDescription<megamol::infovis::MDSProjection>();
         this->module_descriptions.RegisterAutoDescription<megamol::infovis::DiagramSeries>();
+        this->module_descriptions.RegisterAutoDescription<megamol::infovis::TableHistogramAggregator>();
 
         // register calls here:
         this->call_descriptions.RegisterAutoDescription<megamol::infovis::DiagramSeriesCall>();
+        this->call_descriptions.RegisterAutoDescription<megamol::infovis::HistogramGridCall>();
     }
     MEGAMOLCORE_PLUGIN200UTIL_IMPLEMENT_plugininstance_connectStatics
 };
@@ -7,10 +7,16 @@
  */
 #pragma once
 
+#include <functional>
+#include <string>
+
 #include "mmcore/CalleeSlot.h"
 #include "mmcore/CallerSlot.h"
 #include "mmcore/Module.h"
 #include "mmcore/factories/CallAutoDescription.h"
+#include "mmcore/param/IntParam.h"
+#include "mmcore/param/ParamSlot.h"
+#include "mmstd_datatools/ManipulatorResultCache.h"
 #include "mmstd_datatools/mmstd_datatools.h"
 
 namespace megamol {
@@ -19,6 +25,12 @@ namespace datatools {
 
 /**
  * Abstract class data manipulators for calls with getData/getExtent interface
+ *
+ * If the call type supports it, the results of manipulateData can be cached
+ * across frames. A result is reused as long as the data hash and the frame of
+ * the input data and the values of all parameters of the module are the same.
+ * The cache is disabled by default, because it cannot see inputs other than
+ * the in data slot, for instance transfer functions.
  */
 template <class C> class AbstractManipulator : public megamol::core::Module {
 public:
@@ -83,6 +95,20 @@ private:
      */
     bool getExtentCallback(megamol::core::Call& c);
 
+    /**
+     * Answer a hash over the values of all parameters of the module except
+     * for the cache size
+     *
+     * @return The hash of the parameter values
+     */
+    size_t hashParameters(void);
+
+    /** The cached results of manipulateData */
+    ManipulatorResultCache<C> resultCache;
+
+    /** The memory budget of the result cache in MB */
+    megamol::core::param::ParamSlot resultCacheSizeSlot;
+
     /** The slot providing access to the manipulated data */
     megamol::core::CalleeSlot outDataSlot;
 
@@ -94,6 +120,8 @@ private:
 template <class C>
 AbstractManipulator<C>::AbstractManipulator(const char* outSlotName, const char* inSlotName)
     : megamol::core::Module()
+    , resultCache()
+    , resultCacheSizeSlot("resultCacheSize", "Memory budget (MB) for reusing results across frames, 0 disables it")
     , outDataSlot(outSlotName, "providing access to the manipulated data")
     , inDataSlot(inSlotName, "accessing the original data") {
 
@@ -103,6 +131,11 @@ AbstractManipulator<C>::AbstractManipulator(const char* outSlotName, const char*
 
     this->inDataSlot.template SetCompatibleCall<core::factories::CallAutoDescription<C>>();
     this->MakeSlotAvailable(&this->inDataSlot);
+
+    this->resultCacheSizeSlot.SetParameter(new core::param::IntParam(0, 0));
+    if (ManipulatorResultCache<C>::IsSupported) {
+        this->MakeSlotAvailable(&this->resultCacheSizeSlot);
+    }
 }
 
 
@@ -112,7 +145,7 @@ template <class C> AbstractManipulator<C>::~AbstractManipulator() { this->Releas
 template <class C> bool AbstractManipulator<C>::create() { return true; }
 
 
-template <class C> void AbstractManipulator<C>::release() {}
+template <class C> void AbstractManipulator<C>::release() { this->resultCache.Clear(); }
 
 
 template <class C> bool AbstractManipulator<C>::manipulateData(C& outData, C& inData) {
@@ -139,11 +172,30 @@ template <class C> bool AbstractManipulator<C>::getDataCallback(megamol::core::C
     *inMpdc = *outMpdc; // to get the correct request time
     if (!(*inMpdc)(0)) return false;
 
+    // a data hash of zero does not tell anything about the data
+    size_t const budget =
+        static_cast<size_t>(this->resultCacheSizeSlot.template Param<core::param::IntParam>()->Value()) << 20;
+    bool const useCache = ManipulatorResultCache<C>::IsSupported && (budget > 0) && (inMpdc->DataHash() != 0);
+    if (!useCache) this->resultCache.Clear();
+
+    ManipulatorResultKey key{inMpdc->DataHash(), inMpdc->FrameID(), 0};
+    if (useCache) {
+        key.paramHash = this->hashParameters();
+        if (this->resultCache.Restore(key, *outMpdc)) {
+            inMpdc->Unlock();
+            return true;
+        }
+    }
+
     if (!this->manipulateData(*outMpdc, *inMpdc)) {
         inMpdc->Unlock();
         return false;
     }
 
+    if (useCache) {
+        this->resultCache.Store(key, *outMpdc, budget);
+    }
+
     inMpdc->Unlock();
 
     return true;
@@ -171,6 +223,18 @@ template <class C> bool AbstractManipulator<C>::getExtentCallback(megamol::core:
 }
 
 
+template <class C> size_t AbstractManipulator<C>::hashParameters(void) {
+    size_t hash = 0;
+    for (auto it = this->ChildList_Begin(); it != this->ChildList_End(); ++it) {
+        auto slot = dynamic_cast<core::param::ParamSlot*>((*it).get());
+        if ((slot == nullptr) || (slot == &this->resultCacheSizeSlot) || slot->Parameter().IsNull()) continue;
+        std::string const value(vislib::StringA(slot->Name()) + "=" + vislib::StringA(slot->Parameter()->ValueString()));
+        hash ^= std::hash<std::string>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+
 } /* end namespace datatools */
 } /* end namespace stdplugin */
 } /* end namespace megamol */
@@ -0,0 +1,235 @@
+/*
+ * ManipulatorResultCache.h
+ *
+ * Copyright (C) 2020 by MegaMol Dev Team
+ * Alle Rechte vorbehalten.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <vector>
+
+#include "mmcore/moldyn/MultiParticleDataCall.h"
+
+namespace megamol {
+namespace stdplugin {
+namespace datatools {
+
+/**
+ * Identifies a result of a manipulator.
+ */
+struct ManipulatorResultKey {
+    /** The data hash of the input data */
+    size_t inHash;
+
+    /** The frame of the input data */
+    unsigned int frameID;
+
+    /** The combined hash of the values of all parameters of the manipulator */
+    size_t paramHash;
+
+    inline bool operator==(ManipulatorResultKey const& rhs) const {
+        return (this->inHash == rhs.inHash) && (this->frameID == rhs.frameID) && (this->paramHash == rhs.paramHash);
+    }
+};
+
+
+/**
+ * LRU cache of deep copies of the results of a manipulator.
+ *
+ * The generic version does not cache anything. Calls whose data can be
+ * copied provide a specialisation.
+ */
+template <class C> class ManipulatorResultCache {
+public:
+    /** Answer whether results of C can be cached at all */
+    static constexpr bool IsSupported = false;
+
+    /** Drops all cached results */
+    void Clear(void) {}
+
+    /**
+     * Restores the result identified by 'key' into 'outData'.
+     *
+     * @param key The key of the result
+     * @param outData The call receiving the result
+     *
+     * @return True if the result was found, false otherwise
+     */
+    bool Restore(ManipulatorResultKey const& key, C& outData) { return false; }
+
+    /**
+     * Stores a copy of the result in 'outData' under 'key' and evicts the
+     * least recently used results until all of them fit into 'budget' bytes.
+     *
+     * @param key The key of the result
+     * @param outData The call holding the result
+     * @param budget The maximum size of all cached results in bytes
+     */
+    void Store(ManipulatorResultKey const& key, C const& outData, size_t budget) {}
+};
+
+
+/**
+ * Caches particle data. Each list is copied into a single buffer holding the
+ * densely packed attribute arrays one after another.
+ */
+template <> class ManipulatorResultCache<core::moldyn::MultiParticleDataCall> {
+public:
+    static constexpr bool IsSupported = true;
+
+    void Clear(void) {
+        this->entries.clear();
+        this->size = 0;
+    }
+
+    bool Restore(ManipulatorResultKey const& key, core::moldyn::MultiParticleDataCall& outData) {
+        using core::moldyn::SimpleSphericalParticles;
+
+        auto it = this->entries.begin();
+        while ((it != this->entries.end()) && !(it->key == key)) ++it;
+        if (it == this->entries.end()) return false;
+        this->entries.splice(this->entries.begin(), this->entries, it);
+
+        outData.SetUnlocker(nullptr);
+        outData.SetDataHash(it->dataHash);
+        outData.SetFrameID(it->frameID, outData.IsFrameForced());
+        outData.SetFrameCount(it->frameCount);
+        outData.AccessBoundingBoxes() = it->bboxes;
+        outData.SetTimeStamp(it->timeStamp);
+        outData.SetParticleListCount(static_cast<unsigned int>(it->lists.size()));
+        for (size_t i = 0; i < it->lists.size(); ++i) {
+            auto const& l = it->lists[i];
+            auto& p = outData.AccessParticles(static_cast<unsigned int>(i));
+            // Start over with a particle store of our own, the old one might
+            // be shared with the lists of other calls.
+            p = SimpleSphericalParticles();
+            p.SetCount(l.count);
+            p.SetGlobalRadius(l.radius);
+            p.SetGlobalColour(l.colour[0], l.colour[1], l.colour[2], l.colour[3]);
+            p.SetGlobalType(l.type);
+            p.SetColourMapIndexValues(l.minColI, l.maxColI);
+            p.SetBBox(l.bbox);
+            auto const base = l.data.data();
+            p.SetVertexData(l.vertType, (l.vertType != SimpleSphericalParticles::VERTDATA_NONE) ? base : nullptr);
+            p.SetColourData(
+                l.colType, (l.colType != SimpleSphericalParticles::COLDATA_NONE) ? base + l.colOffset : nullptr);
+            p.SetDirData(l.dirType, (l.dirType != SimpleSphericalParticles::DIRDATA_NONE) ? base + l.dirOffset : nullptr);
+            p.SetIDData(l.idType, (l.idType != SimpleSphericalParticles::IDDATA_NONE) ? base + l.idOffset : nullptr);
+        }
+        return true;
+    }
+
+    void Store(
+        ManipulatorResultKey const& key, core::moldyn::MultiParticleDataCall const& outData, size_t const budget) {
+        using core::moldyn::SimpleSphericalParticles;
+
+        this->entries.emplace_front();
+        auto& e = this->entries.front();
+        e.key = key;
+        e.dataHash = outData.DataHash();
+        e.frameID = outData.FrameID();
+        e.frameCount = outData.FrameCount();
+        e.bboxes = outData.GetBoundingBoxes();
+        e.timeStamp = outData.GetTimeStamp();
+        e.size = 0;
+        e.lists.resize(outData.GetParticleListCount());
+        for (unsigned int i = 0; i < outData.GetParticleListCount(); ++i) {
+            auto const& p = outData.AccessParticles(i);
+            auto& l = e.lists[i];
+            l.count = p.GetCount();
+            l.radius = p.GetGlobalRadius();
+            std::memcpy(l.colour, p.GetGlobalColour(), sizeof(l.colour));
+            l.type = p.GetGlobalType();
+            l.minColI = p.GetMinColourIndexValue();
+            l.maxColI = p.GetMaxColourIndexValue();
+            l.bbox = p.GetBBox();
+            l.vertType = p.GetVertexDataType();
+            l.colType = p.GetColourDataType();
+            l.dirType = p.GetDirDataType();
+            l.idType = p.GetIDDataType();
+
+            auto const vs = SimpleSphericalParticles::VertexDataSize[l.vertType];
+            auto const cs = SimpleSphericalParticles::ColorDataSize[l.colType];
+            auto const ds = SimpleSphericalParticles::DirDataSize[l.dirType];
+            auto const is = SimpleSphericalParticles::IDDataSize[l.idType];
+            auto const cnt = static_cast<size_t>(l.count);
+            l.colOffset = cnt * vs;
+            l.dirOffset = l.colOffset + cnt * cs;
+            l.idOffset = l.dirOffset + cnt * ds;
+            l.data.resize(l.idOffset + cnt * is);
+
+            auto const dst = l.data.data();
+            copyPacked(dst, p.GetVertexData(), p.GetVertexDataStride(), vs, cnt);
+            copyPacked(dst + l.colOffset, p.GetColourData(), p.GetColourDataStride(), cs, cnt);
+            copyPacked(dst + l.dirOffset, p.GetDirData(), p.GetDirDataStride(), ds, cnt);
+            copyPacked(dst + l.idOffset, p.GetIDData(), p.GetIDDataStride(), is, cnt);
+            e.size += l.data.size();
+        }
+        this->size += e.size;
+
+        // The newest entry is never evicted, even if it exceeds the budget on
+        // its own. It is referenced by 'outData' until the next request.
+        while ((this->size > budget) && (this->entries.size() > 1)) {
+            this->size -= this->entries.back().size;
+            this->entries.pop_back();
+        }
+    }
+
+private:
+    /** A deep copy of a particle list */
+    struct List {
+        UINT64 count;
+        float radius;
+        unsigned char colour[4];
+        unsigned int type;
+        float minColI;
+        float maxColI;
+        vislib::math::Cuboid<float> bbox;
+        core::moldyn::SimpleSphericalParticles::VertexDataType vertType;
+        core::moldyn::SimpleSphericalParticles::ColourDataType colType;
+        core::moldyn::SimpleSphericalParticles::DirDataType dirType;
+        core::moldyn::SimpleSphericalParticles::IDDataType idType;
+        size_t colOffset;
+        size_t dirOffset;
+        size_t idOffset;
+        std::vector<char> data;
+    };
+
+    /** A cached result */
+    struct Entry {
+        ManipulatorResultKey key;
+        size_t dataHash;
+        unsigned int frameID;
+        unsigned int frameCount;
+        core::BoundingBoxes bboxes;
+        float timeStamp;
+        std::vector<List> lists;
+        size_t size;
+    };
+
+    /** Copies 'cnt' elements of 'size' bytes which are 'stride' bytes apart */
+    static void copyPacked(char* dst, void const* src, unsigned int stride, size_t size, size_t cnt) {
+        if ((size == 0) || (cnt == 0) || (src == nullptr)) return;
+        auto const s = static_cast<char const*>(src);
+        if ((stride == 0) || (stride == size)) {
+            std::memcpy(dst, s, size * cnt);
+        } else {
+            for (size_t i = 0; i < cnt; ++i) {
+                std::memcpy(dst + i * size, s + i * stride, size);
+            }
+        }
+    }
+
+    /** The cached results, the most recently used first */
+    std::list<Entry> entries;
+
+    /** The summed up size of the data of all entries in bytes */
+    size_t size = 0;
+};
+
+} /* end namespace datatools */
+} /* end namespace stdplugin */
+} /* end namespace megamol */
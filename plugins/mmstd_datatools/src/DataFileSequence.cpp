@@ -17,9 +17,27 @@
 #include "vislib/sys/File.h"
 #include "vislib/sys/Log.h"
 #include "vislib/String.h"
+#include <sys/stat.h>
+#include <cstring>
+#include <fstream>
+#include <vector>
 
 using namespace megamol;
 
+namespace {
+
+/** The magic number of index files */
+const char IndexMagic[8] = {'M', 'M', 'D', 'F', 'S', 'I', '1', '\0'};
+
+/** An entry of the index as stored in the file */
+template<class E> struct IndexRecord {
+    UINT32 number;
+    UINT32 reserved;
+    E entry;
+};
+
+} /* end namespace */
+
 
 /*
  * moldyn::DataFileSequence::DataFileSequence
@@ -35,11 +53,13 @@ stdplugin::datatools::DataFileSequence::DataFileSequence(void) : core::Module(),
         fileNumberStepSlot("fileNumberStep", "Slot for the file number increase step"),
         fileNameSlotNameSlot("fileNameSlotName", "The name of the data source file name parameter slot"),
         useClipBoxAsBBox("useClipBoxAsBBox", "If true will use the all-data clip box as bounding box"),
+        prefetchCountSlot("prefetchCount", "The number of upcoming files read ahead in the background to have them in the file system cache when they are requested"),
+        useIndexSlot("useIndex", "If true, the extents of the files are stored in an index next to the first file, such that the clip box can be computed without loading files"),
         outDataSlot("outData", "The slot for publishing data to the writer"),
         inDataSlot("inData", "The slot for requesting data from the source"),
         clipbox(-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f), datahash(0),
         fileNameTemplate(_T("")), fileNumMin(0), fileNumMax(0), fileNumStep(1),
-        needDataUpdate(true), frameCnt(1), lastIdxRequested(0) {
+        needDataUpdate(true), frameCnt(1), lastIdxRequested(0), index(), indexFile(), isIndexDirty(false), prefetcher() {
 
     this->fileNameTemplateSlot << new core::param::StringParam(this->fileNameTemplate);
     this->fileNameTemplateSlot.SetUpdateCallback(&DataFileSequence::onFileNameTemplateChanged);
@@ -61,6 +81,12 @@ stdplugin::datatools::DataFileSequence::DataFileSequence(void) : core::Module(),
     this->useClipBoxAsBBox << new core::param::BoolParam(false);
     this->MakeSlotAvailable(&this->useClipBoxAsBBox);
 
+    this->prefetchCountSlot << new core::param::IntParam(2, 0);
+    this->MakeSlotAvailable(&this->prefetchCountSlot);
+
+    this->useIndexSlot << new core::param::BoolParam(true);
+    this->MakeSlotAvailable(&this->useIndexSlot);
+
     //core::CallDescriptionManager::DescriptionIterator iter(core::CallDescriptionManager::Instance()->GetIterator());
     //const core::CallDescription *cd = NULL;
     //while ((cd = this->moveToNextCompatibleCall(iter)) != NULL) {
@@ -102,6 +128,21 @@ bool stdplugin::datatools::DataFileSequence::create(void) {
  * moldyn::DataFileSequence::release
  */
 void stdplugin::datatools::DataFileSequence::release(void) {
+    this->prefetcher.Stop();
+    this->saveIndex();
+}
+
+
+/*
+ * stdplugin::datatools::DataFileSequence::getFileStamp
+ */
+bool stdplugin::datatools::DataFileSequence::getFileStamp(const vislib::TString& filename,
+        UINT64& outSize, INT64& outTime) {
+    struct stat st;
+    if (::stat(vislib::StringA(filename).PeekBuffer(), &st) != 0) return false;
+    outSize = static_cast<UINT64>(st.st_size);
+    outTime = static_cast<INT64>(st.st_mtime);
+    return true;
 }
 
 
@@ -143,6 +184,7 @@ bool stdplugin::datatools::DataFileSequence::getDataCallback(core::Call& caller)
         unsigned int idx = this->fileNumMin + this->fileNumStep * frameID;
         filename.Format(this->fileNameTemplate, idx);
         fnSlot->Parameter()->ParseValue(filename);
+        this->prefetch(frameID);
 
         if (this->lastIdxRequested != pgdc->FrameID()) {
             this->lastIdxRequested = pgdc->FrameID();
@@ -213,6 +255,7 @@ bool stdplugin::datatools::DataFileSequence::getExtentCallback(core::Call& calle
         if (!(*ggdc)(1)) {
             return false; // unable to get data
         }
+        this->recordExtents(idx, filename, ggdc->AccessBoundingBoxes());
 
         if (this->useClipBoxAsBBox.Param<core::param::BoolParam>()->Value()) {
             pgdc->AccessBoundingBoxes().SetObjectSpaceBBox(this->clipbox);
@@ -269,6 +312,17 @@ void stdplugin::datatools::DataFileSequence::checkParameters(void) {
         this->needDataUpdate = true;
     }
 
+    if (this->useIndexSlot.IsDirty()) {
+        this->useIndexSlot.ResetDirty();
+        this->needDataUpdate = true;
+    }
+    if (this->prefetchCountSlot.IsDirty()) {
+        this->prefetchCountSlot.ResetDirty();
+        if (this->prefetchCountSlot.Param<core::param::IntParam>()->Value() <= 0) {
+            this->prefetcher.Stop();
+        }
+    }
+
     if (this->fileNumMax < this->fileNumMin) {
         unsigned int i = this->fileNumMax;
         this->fileNumMax = this->fileNumMin;
@@ -511,14 +565,33 @@ void stdplugin::datatools::DataFileSequence::assertData(void) {
         return;
     }
 
-    // count really available frames
+    const bool useIndex = this->useIndexSlot.Param<core::param::BoolParam>()->Value();
+    if (useIndex && (this->indexFile != this->indexFileName())) {
+        this->saveIndex();
+        this->loadIndex();
+    }
+
+    // count really available frames and drop the index entries of changed files
+    unsigned int indexedCnt = 0;
     for (unsigned int i = this->fileNumMin; i <= this->fileNumMax; i += this->fileNumStep) {
+        UINT64 size;
+        INT64 time;
         filename.Format(this->fileNameTemplate, i);
-        if (vislib::sys::File::Exists(filename)) {
+        if (getFileStamp(filename, size, time)) {
             this->frameCnt++;
         } else {
             break;
         }
+
+        auto it = this->index.find(i);
+        if (it != this->index.end()) {
+            if ((it->second.size == size) && (it->second.time == time)) {
+                indexedCnt++;
+            } else {
+                this->index.erase(it);
+                this->isIndexDirty = true;
+            }
+        }
     }
     if (this->frameCnt == 0) {
         Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR,
@@ -526,42 +599,217 @@ void stdplugin::datatools::DataFileSequence::assertData(void) {
         return;
     }
 
-    // collect heuristic approach for clipping box
-    filename.Format(this->fileNameTemplate, this->fileNumMin);
-    fnSlot->Parameter()->ParseValue(filename);
-    gdc->SetFrameID(0);
-    if (!(*gdc)(1)) {
-        this->frameCnt = 0;
-        Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "DataFileSequence: Unable to clipping box of file %u (#1)", this->fileNumMin);
-        return;
-    }
-    this->clipbox = gdc->AccessBoundingBoxes().ClipBox();
+    if (useIndex && (indexedCnt == this->frameCnt)) {
+        // all extents are known, so the clip box is exact without loading anything
+        for (unsigned int f = 0; f < this->frameCnt; f++) {
+            const float *cb = this->index[this->fileNumMin + this->fileNumStep * f].clipBox;
+            vislib::math::Cuboid<float> box(cb[0], cb[1], cb[2], cb[3], cb[4], cb[5]);
+            if (f == 0) {
+                this->clipbox = box;
+            } else {
+                this->clipbox.Union(box);
+            }
+        }
 
-    if (this->frameCnt > 1) {
-        unsigned int idx = this->fileNumMin + this->fileNumStep * (this->frameCnt - 1);
-        filename.Format(this->fileNameTemplate, idx);
-        fnSlot->Parameter()->ParseValue(filename);
-        gdc->SetFrameID(0);
-        if (!(*gdc)(1)) {
+    } else {
+        // collect heuristic approach for clipping box
+        if (!this->probeClipBox(this->fileNumMin, fnSlot, gdc, this->clipbox)) {
             this->frameCnt = 0;
-            Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "DataFileSequence: Unable to clipping box of file %u (#2)", idx);
+            Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "DataFileSequence: Unable to clipping box of file %u (#1)", this->fileNumMin);
             return;
         }
-        this->clipbox.Union(gdc->AccessBoundingBoxes().ClipBox());
-        if (this->frameCnt > 2) {
-            idx = this->fileNumMin + this->fileNumStep * ((this->frameCnt - 1) / 2);
-            filename.Format(this->fileNameTemplate, idx);
-            fnSlot->Parameter()->ParseValue(filename);
-            gdc->SetFrameID(0);
-            if (!(*gdc)(1)) {
+
+        if (this->frameCnt > 1) {
+            vislib::math::Cuboid<float> box;
+            unsigned int idx = this->fileNumMin + this->fileNumStep * (this->frameCnt - 1);
+            if (!this->probeClipBox(idx, fnSlot, gdc, box)) {
                 this->frameCnt = 0;
-                Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "DataFileSequence: Unable to clipping box of file %u (#3)", idx);
+                Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "DataFileSequence: Unable to clipping box of file %u (#2)", idx);
                 return;
             }
-            this->clipbox.Union(gdc->AccessBoundingBoxes().ClipBox());
+            this->clipbox.Union(box);
+            if (this->frameCnt > 2) {
+                idx = this->fileNumMin + this->fileNumStep * ((this->frameCnt - 1) / 2);
+                if (!this->probeClipBox(idx, fnSlot, gdc, box)) {
+                    this->frameCnt = 0;
+                    Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "DataFileSequence: Unable to clipping box of file %u (#3)", idx);
+                    return;
+                }
+                this->clipbox.Union(box);
+            }
         }
     }
 
+    this->saveIndex();
     this->datahash++;
 
 }
+
+
+/*
+ * stdplugin::datatools::DataFileSequence::indexFileName
+ */
+vislib::TString stdplugin::datatools::DataFileSequence::indexFileName(void) const {
+    vislib::TString filename;
+    filename.Format(this->fileNameTemplate, this->fileNumMin);
+    filename.Append(_T(".dfsindex"));
+    return filename;
+}
+
+
+/*
+ * stdplugin::datatools::DataFileSequence::loadIndex
+ */
+void stdplugin::datatools::DataFileSequence::loadIndex(void) {
+    using vislib::sys::Log;
+    this->index.clear();
+    this->isIndexDirty = false;
+    this->indexFile = this->indexFileName();
+
+    std::ifstream file(vislib::StringA(this->indexFile).PeekBuffer(), std::ios::binary | std::ios::ate);
+    if (!file.good()) return;
+    const UINT64 fileSize = static_cast<UINT64>(file.tellg());
+    file.seekg(0);
+
+    // the lengths read from the file are checked against its size before
+    // anything is allocated, a corrupt index is simply rebuilt
+    char magic[sizeof(IndexMagic)];
+    UINT32 templateLen = 0;
+    UINT64 cnt = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&templateLen), sizeof(templateLen));
+    if (!file.good() || (templateLen > fileSize - static_cast<UINT64>(file.tellg()))) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_WARN, "DataFileSequence: Ignoring corrupt index \"%s\"",
+            vislib::StringA(this->indexFile).PeekBuffer());
+        return;
+    }
+    std::vector<char> fnt(templateLen);
+    file.read(fnt.data(), templateLen);
+    file.read(reinterpret_cast<char*>(&cnt), sizeof(cnt));
+    if (!file.good() || (::memcmp(magic, IndexMagic, sizeof(magic)) != 0)
+            || !vislib::StringA(fnt.data(), templateLen).Equals(vislib::StringA(this->fileNameTemplate))) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_WARN, "DataFileSequence: Ignoring index \"%s\" of another sequence",
+            vislib::StringA(this->indexFile).PeekBuffer());
+        return;
+    }
+
+    if (cnt > (fileSize - static_cast<UINT64>(file.tellg())) / sizeof(IndexRecord<IndexEntry>)) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_WARN, "DataFileSequence: Ignoring truncated index \"%s\"",
+            vislib::StringA(this->indexFile).PeekBuffer());
+        return;
+    }
+    std::vector<IndexRecord<IndexEntry> > records(static_cast<size_t>(cnt));
+    file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(IndexRecord<IndexEntry>));
+    if (!file.good()) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_WARN, "DataFileSequence: Ignoring truncated index \"%s\"",
+            vislib::StringA(this->indexFile).PeekBuffer());
+        return;
+    }
+    for (auto& r : records) {
+        this->index[r.number] = r.entry;
+    }
+    Log::DefaultLog.WriteMsg(Log::LEVEL_INFO, "DataFileSequence: Loaded extents of %u files from index",
+        static_cast<unsigned int>(this->index.size()));
+}
+
+
+/*
+ * stdplugin::datatools::DataFileSequence::prefetch
+ */
+void stdplugin::datatools::DataFileSequence::prefetch(unsigned int frameID) {
+    const int cnt = this->prefetchCountSlot.Param<core::param::IntParam>()->Value();
+    if ((cnt <= 0) || (this->frameCnt <= 1)) return;
+
+    std::vector<std::string> files;
+    vislib::TString filename;
+    for (int i = 1; (i <= cnt) && (static_cast<unsigned int>(i) < this->frameCnt); i++) {
+        // playback usually loops, so continue at the beginning
+        unsigned int f = (frameID + static_cast<unsigned int>(i)) % this->frameCnt;
+        filename.Format(this->fileNameTemplate, this->fileNumMin + this->fileNumStep * f);
+        files.push_back(vislib::StringA(filename).PeekBuffer());
+    }
+    this->prefetcher.Prefetch(files);
+}
+
+
+/*
+ * stdplugin::datatools::DataFileSequence::probeClipBox
+ */
+bool stdplugin::datatools::DataFileSequence::probeClipBox(unsigned int idx, core::param::ParamSlot *fnSlot,
+        core::AbstractGetData3DCall *gdc, vislib::math::Cuboid<float>& outBox) {
+    // assertData has already removed the entries of files that have changed
+    auto it = this->index.find(idx);
+    if (this->useIndexSlot.Param<core::param::BoolParam>()->Value() && (it != this->index.end())) {
+        const float *cb = it->second.clipBox;
+        outBox.Set(cb[0], cb[1], cb[2], cb[3], cb[4], cb[5]);
+        return true;
+    }
+
+    vislib::TString filename;
+    filename.Format(this->fileNameTemplate, idx);
+    fnSlot->Parameter()->ParseValue(filename);
+    gdc->SetFrameID(0);
+    if (!(*gdc)(1)) return false;
+    this->recordExtents(idx, filename, gdc->AccessBoundingBoxes());
+    outBox = gdc->AccessBoundingBoxes().ClipBox();
+    return true;
+}
+
+
+/*
+ * stdplugin::datatools::DataFileSequence::recordExtents
+ */
+void stdplugin::datatools::DataFileSequence::recordExtents(unsigned int idx, const vislib::TString& filename,
+        const core::BoundingBoxes& bboxes) {
+    if (!this->useIndexSlot.Param<core::param::BoolParam>()->Value()) return;
+
+    IndexEntry e;
+    if (!getFileStamp(filename, e.size, e.time)) return;
+    const auto& bb = bboxes.ObjectSpaceBBox();
+    const auto& cb = bboxes.ClipBox();
+    const float b[12] = {bb.Left(), bb.Bottom(), bb.Back(), bb.Right(), bb.Top(), bb.Front(),
+        cb.Left(), cb.Bottom(), cb.Back(), cb.Right(), cb.Top(), cb.Front()};
+    ::memcpy(e.bbox, b, sizeof(e.bbox));
+    ::memcpy(e.clipBox, b + 6, sizeof(e.clipBox));
+
+    auto it = this->index.find(idx);
+    if ((it == this->index.end()) || (::memcmp(&it->second, &e, sizeof(e)) != 0)) {
+        this->index[idx] = e;
+        this->isIndexDirty = true;
+    }
+}
+
+
+/*
+ * stdplugin::datatools::DataFileSequence::saveIndex
+ */
+void stdplugin::datatools::DataFileSequence::saveIndex(void) {
+    using vislib::sys::Log;
+    if (!this->isIndexDirty || this->indexFile.IsEmpty()) return;
+    if (!this->useIndexSlot.Param<core::param::BoolParam>()->Value()) return;
+    this->isIndexDirty = false;
+
+    std::vector<IndexRecord<IndexEntry> > records;
+    records.reserve(this->index.size());
+    for (auto& i : this->index) {
+        IndexRecord<IndexEntry> r;
+        r.number = i.first;
+        r.reserved = 0;
+        r.entry = i.second;
+        records.push_back(r);
+    }
+
+    vislib::StringA fnt(this->fileNameTemplate);
+    const UINT32 templateLen = static_cast<UINT32>(fnt.Length());
+    const UINT64 cnt = static_cast<UINT64>(records.size());
+    std::ofstream file(vislib::StringA(this->indexFile).PeekBuffer(), std::ios::binary | std::ios::trunc);
+    file.write(IndexMagic, sizeof(IndexMagic));
+    file.write(reinterpret_cast<const char*>(&templateLen), sizeof(templateLen));
+    file.write(fnt.PeekBuffer(), templateLen);
+    file.write(reinterpret_cast<const char*>(&cnt), sizeof(cnt));
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(IndexRecord<IndexEntry>));
+    if (!file.good()) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_WARN, "DataFileSequence: Unable to write index \"%s\"",
+            vislib::StringA(this->indexFile).PeekBuffer());
+    }
+}
@@ -13,10 +13,14 @@
 
 #include "mmcore/Module.h"
 #include "mmcore/factories/CallDescription.h"
+#include "mmcore/AbstractGetData3DCall.h"
+#include "mmcore/BoundingBoxes.h"
 #include "mmcore/CalleeSlot.h"
 #include "mmcore/CallerSlot.h"
 #include "mmcore/param/ParamSlot.h"
 #include "vislib/math/Cuboid.h"
+#include "FilePrefetcher.h"
+#include <map>
 
 
 namespace megamol {
@@ -28,6 +32,12 @@ namespace datatools {
      * In-Between management module for seralize multiple data files with one
      * data frame each (the first if more are available) to write a continous
      * data series into a data writer
+     *
+     * The upcoming files can be read ahead in the background to warm the file
+     * system cache for the data source. The extents of all files that have
+     * been loaded are kept in an index file next to the first data file, such
+     * that reopening the sequence does not need to load files for computing
+     * the clip box.
      */
     class DataFileSequence : public core::Module {
     public:
@@ -90,6 +100,25 @@ namespace datatools {
 
     private:
 
+        /** The extents of a data file as stored in the index. */
+        typedef struct _indexentry_t {
+            UINT64 size;
+            INT64 time;
+            float bbox[6];
+            float clipBox[6];
+        } IndexEntry;
+
+        /**
+         * Answer the size and the time of the last modification of a file.
+         *
+         * @param filename The path to the file.
+         * @param outSize  Receives the size of the file.
+         * @param outTime  Receives the time of the last modification.
+         *
+         * @return True if the file exists.
+         */
+        static bool getFileStamp(const vislib::TString& filename, UINT64& outSize, INT64& outTime);
+
         /**
          * Tests if th description of a call seems compatible
          *
@@ -162,6 +191,55 @@ namespace datatools {
          */
         void assertData(void);
 
+        /**
+         * Answer the path of the index file of the current sequence.
+         *
+         * @return The path of the index file.
+         */
+        vislib::TString indexFileName(void) const;
+
+        /**
+         * Loads the index of the current sequence, replacing 'index'.
+         */
+        void loadIndex(void);
+
+        /**
+         * Starts reading the files following the given frame in the
+         * background.
+         *
+         * @param frameID The frame being requested.
+         */
+        void prefetch(unsigned int frameID);
+
+        /**
+         * Answers the clip box of a file, either from the index or by loading
+         * the extents from the data source.
+         *
+         * @param idx    The number of the file.
+         * @param fnSlot The file name parameter of the data source.
+         * @param gdc    The call to the data source.
+         * @param outBox Receives the clip box.
+         *
+         * @return True on success, false if the data source failed.
+         */
+        bool probeClipBox(unsigned int idx, core::param::ParamSlot *fnSlot,
+            core::AbstractGetData3DCall *gdc, vislib::math::Cuboid<float>& outBox);
+
+        /**
+         * Stores the extents of a file in the index.
+         *
+         * @param idx      The number of the file.
+         * @param filename The path of the file.
+         * @param bboxes   The extents reported by the data source.
+         */
+        void recordExtents(unsigned int idx, const vislib::TString& filename,
+            const core::BoundingBoxes& bboxes);
+
+        /**
+         * Writes 'index' to the index file if it has been changed.
+         */
+        void saveIndex(void);
+
         /** The file name template */
         core::param::ParamSlot fileNameTemplateSlot;
 
@@ -180,6 +258,12 @@ namespace datatools {
         /** Flag controlling the bounding box */
         core::param::ParamSlot useClipBoxAsBBox;
 
+        /** The number of upcoming files read ahead */
+        core::param::ParamSlot prefetchCountSlot;
+
+        /** Flag controlling whether the extents are persisted in an index */
+        core::param::ParamSlot useIndexSlot;
+
         /** The slot for publishing data to the writer */
         core::CalleeSlot outDataSlot;
 
@@ -213,6 +297,18 @@ namespace datatools {
         /** The last frame index requested */
         unsigned int lastIdxRequested;
 
+        /** The extents of the files by their number */
+        std::map<unsigned int, IndexEntry> index;
+
+        /** The index file 'index' belongs to */
+        vislib::TString indexFile;
+
+        /** Whether 'index' differs from the index file */
+        bool isIndexDirty;
+
+        /** Reads the upcoming files in the background */
+        FilePrefetcher prefetcher;
+
     };
 
 } /* end namespace datatools */
@@ -0,0 +1,125 @@
+/*
+ * FilePrefetcher.cpp
+ *
+ * Copyright (C) 2020 by VISUS (Universitaet Stuttgart)
+ * Alle Rechte vorbehalten.
+ */
+
+#include "stdafx.h"
+#include "FilePrefetcher.h"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace megamol;
+
+
+const size_t stdplugin::datatools::FilePrefetcher::RecentCapacity = 64;
+
+const size_t stdplugin::datatools::FilePrefetcher::ChunkSize = 4 * 1024 * 1024;
+
+
+/*
+ * stdplugin::datatools::FilePrefetcher::FilePrefetcher
+ */
+stdplugin::datatools::FilePrefetcher::FilePrefetcher(void) : isTerminating(false) {
+    this->cancelCurrent.store(false);
+}
+
+
+/*
+ * stdplugin::datatools::FilePrefetcher::~FilePrefetcher
+ */
+stdplugin::datatools::FilePrefetcher::~FilePrefetcher(void) {
+    this->Stop();
+}
+
+
+/*
+ * stdplugin::datatools::FilePrefetcher::Prefetch
+ */
+void stdplugin::datatools::FilePrefetcher::Prefetch(const std::vector<std::string>& files) {
+    std::lock_guard<std::mutex> l(this->lock);
+
+    this->queue.clear();
+    for (auto& f : files) {
+        if ((f != this->current) && !this->isRecent(f)) {
+            this->queue.push_back(f);
+        }
+    }
+    if (!this->current.empty() && (std::find(files.begin(), files.end(), this->current) == files.end())) {
+        this->cancelCurrent.store(true);
+    }
+
+    if (!this->worker.joinable()) {
+        this->isTerminating = false;
+        this->worker = std::thread(&FilePrefetcher::run, this);
+    }
+    this->cond.notify_one();
+}
+
+
+/*
+ * stdplugin::datatools::FilePrefetcher::Stop
+ */
+void stdplugin::datatools::FilePrefetcher::Stop(void) {
+    {
+        std::lock_guard<std::mutex> l(this->lock);
+        this->queue.clear();
+        this->isTerminating = true;
+        this->cancelCurrent.store(true);
+        this->cond.notify_one();
+    }
+    if (this->worker.joinable()) {
+        this->worker.join();
+    }
+}
+
+
+/*
+ * stdplugin::datatools::FilePrefetcher::isRecent
+ */
+bool stdplugin::datatools::FilePrefetcher::isRecent(const std::string& file) const {
+    return (std::find(this->recent.begin(), this->recent.end(), file) != this->recent.end());
+}
+
+
+/*
+ * stdplugin::datatools::FilePrefetcher::run
+ */
+void stdplugin::datatools::FilePrefetcher::run(void) {
+    std::vector<char> buffer(ChunkSize);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> l(this->lock);
+            this->cond.wait(l, [this]() { return this->isTerminating || !this->queue.empty(); });
+            if (this->isTerminating) break;
+            this->current = this->queue.front();
+            this->queue.pop_front();
+            this->cancelCurrent.store(false);
+        }
+
+        // The content is discarded, we only want the file system to cache it.
+        std::ifstream file(this->current, std::ios::binary);
+        bool isComplete = file.good();
+        while (file.good()) {
+            if (this->cancelCurrent.load()) {
+                isComplete = false;
+                break;
+            }
+            file.read(buffer.data(), buffer.size());
+        }
+
+        {
+            std::lock_guard<std::mutex> l(this->lock);
+            if (isComplete) {
+                this->recent.push_back(this->current);
+                while (this->recent.size() > RecentCapacity) {
+                    this->recent.pop_front();
+                }
+            }
+            this->current.clear();
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * FilePrefetcher.h
+ *
+ * Copyright (C) 2020 by VISUS (Universitaet Stuttgart)
+ * Alle Rechte vorbehalten.
+ */
+
+#ifndef MEGAMOL_DATATOOLS_FILEPREFETCHER_H_INCLUDED
+#define MEGAMOL_DATATOOLS_FILEPREFETCHER_H_INCLUDED
+#if (defined(_MSC_VER) && (_MSC_VER > 1000))
+#pragma once
+#endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace megamol {
+namespace stdplugin {
+namespace datatools {
+
+
+    /**
+     * Reads files in a background thread without interpreting them, such
+     * that a data source opening them later on is served from the file
+     * system cache instead of the disk or the network.
+     */
+    class FilePrefetcher {
+    public:
+
+        /** Ctor. */
+        FilePrefetcher(void);
+
+        /** Dtor. */
+        ~FilePrefetcher(void);
+
+        /**
+         * Replaces the files waiting to be read. The file currently being
+         * read is abandoned unless it is part of 'files'. Files that have
+         * been read recently are skipped.
+         *
+         * The background thread is started on the first call.
+         *
+         * @param files The files to be read, the most urgent one first.
+         */
+        void Prefetch(const std::vector<std::string>& files);
+
+        /**
+         * Abandons all pending files and terminates the background thread.
+         */
+        void Stop(void);
+
+    private:
+
+        /** The number of recently read files remembered. */
+        static const size_t RecentCapacity;
+
+        /** The size of the chunks the files are read in. */
+        static const size_t ChunkSize;
+
+        /**
+         * Answer whether 'file' has been read recently. The caller must hold
+         * 'lock'.
+         *
+         * @param file The file name.
+         *
+         * @return true if the file has been read recently.
+         */
+        bool isRecent(const std::string& file) const;
+
+        /**
+         * The loop of the background thread.
+         */
+        void run(void);
+
+        /** Tells the background thread to abandon the current file. */
+        std::atomic_bool cancelCurrent;
+
+        /** Signals changes of 'queue' and 'isTerminating'. */
+        std::condition_variable cond;
+
+        /** The file currently being read. */
+        std::string current;
+
+        /** Tells the background thread to exit. */
+        bool isTerminating;
+
+        /** Protects all attributes but the atomic ones. */
+        mutable std::mutex lock;
+
+        /** The files waiting to be read. */
+        std::deque<std::string> queue;
+
+        /** The files read recently, the latest last. */
+        std::deque<std::string> recent;
+
+        /** The background thread. */
+        std::thread worker;
+
+    };
+
+} /* end namespace datatools */
+} /* end namespace stdplugin */
+} /* end namespace megamol */
+
+#endif /* MEGAMOL_DATATOOLS_FILEPREFETCHER_H_INCLUDED */
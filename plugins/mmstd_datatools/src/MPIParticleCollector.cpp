@@ -7,28 +7,88 @@
 #include "stdafx.h"
 #include "MPIParticleCollector.h"
 #include "mmcore/cluster/mpi/MpiCall.h"
+#include "mmcore/param/EnumParam.h"
+#include "mmcore/param/IntParam.h"
 #include "vislib/sys/SystemInformation.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
 
 using namespace megamol;
 using namespace megamol::stdplugin;
 
 
+#ifdef WITH_MPI
+namespace {
+
+/** Number of position samples each rank contributes to the slab border estimation */
+const uint64_t SPLIT_SAMPLES_PER_RANK = 1024;
+
+/** Tag used for the point-to-point messages of the tree gather */
+const int TREE_GATHER_TAG = 4711;
+
+/** Reads the 'axis' coordinate of the position at the beginning of 'rec' */
+float recordCoord(const uint8_t* rec, core::moldyn::MultiParticleDataCall::Particles::VertexDataType vdt, int axis) {
+    using megamol::core::moldyn::MultiParticleDataCall;
+    switch (vdt) {
+    case MultiParticleDataCall::Particles::VERTDATA_FLOAT_XYZ:
+    case MultiParticleDataCall::Particles::VERTDATA_FLOAT_XYZR:
+        return reinterpret_cast<const float*>(rec)[axis];
+    case MultiParticleDataCall::Particles::VERTDATA_DOUBLE_XYZ:
+        return static_cast<float>(reinterpret_cast<const double*>(rec)[axis]);
+    case MultiParticleDataCall::Particles::VERTDATA_SHORT_XYZ:
+        return static_cast<float>(reinterpret_cast<const unsigned short*>(rec)[axis]);
+    default:
+        return 0.0f;
+    }
+}
+
+/** Largest number of records that can be transferred in one message of the record type */
+uint64_t maxRecordsPerMessage() { return static_cast<uint64_t>(std::numeric_limits<int>::max()); }
+
+} /* end anonymous namespace */
+#endif /* WITH_MPI */
+
+
 /*
  * datatools::MPIParticleCollector::MPIParticleCollector
  */
 datatools::MPIParticleCollector::MPIParticleCollector(void)
     : AbstractParticleManipulator("outData", "indata")
-    , callRequestMpi("requestMpi", "Requests initialisation of MPI and the communicator for the view.") {
+    , callRequestMpi("requestMpi", "Requests initialisation of MPI and the communicator for the view.")
+    , modeSlot("mode", "The strategy used to collect the distributed particles")
+    , budgetSlot("budget", "The maximum number of particles per list arriving at rank 0 in the budgeted gather") {
 
     this->callRequestMpi.SetCompatibleCall<core::cluster::mpi::MpiCallDescription>();
     this->MakeSlotAvailable(&this->callRequestMpi);
+
+    auto* ep = new core::param::EnumParam(MODE_GATHER);
+    ep->SetTypePair(MODE_GATHER, "Gather");
+    ep->SetTypePair(MODE_BUDGET_GATHER, "Budgeted Gather");
+    ep->SetTypePair(MODE_TREE_GATHER, "Tree Gather");
+    ep->SetTypePair(MODE_SPATIAL_REDISTRIBUTE, "Spatial Redistribution");
+    this->modeSlot.SetParameter(ep);
+    this->MakeSlotAvailable(&this->modeSlot);
+
+    this->budgetSlot.SetParameter(new core::param::IntParam(1000000, 1));
+    this->MakeSlotAvailable(&this->budgetSlot);
 }
 
 
 /*
  * datatools::MPIParticleCollector::~MPIParticleCollector
  */
-datatools::MPIParticleCollector::~MPIParticleCollector(void) { this->Release(); }
+datatools::MPIParticleCollector::~MPIParticleCollector(void) {
+    this->Release();
+#ifdef WITH_MPI
+    int finalized = 0;
+    ::MPI_Finalized(&finalized);
+    if (!finalized && (this->recType != MPI_DATATYPE_NULL)) {
+        ::MPI_Type_free(&this->recType);
+    }
+#endif /* WITH_MPI */
+}
 
 
 /*
@@ -44,8 +104,13 @@ bool datatools::MPIParticleCollector::manipulateData(
                                         // original data will be unlocked through outData
 #ifdef WITH_MPI
     bool useMpi = initMPI();
+    if (!useMpi) return true;
+
+    const auto mode = static_cast<CollectionMode>(this->modeSlot.Param<core::param::EnumParam>()->Value());
+    const uint64_t budget = static_cast<uint64_t>(this->budgetSlot.Param<core::param::IntParam>()->Value());
 
     unsigned int plc = outData.GetParticleListCount();
+    this->listData.resize(plc);
     for (unsigned int i = 0; i < plc; i++) {
         MultiParticleDataCall::Particles& p = outData.AccessParticles(i);
 
@@ -55,73 +120,58 @@ bool datatools::MPIParticleCollector::manipulateData(
         unsigned int cds = p.GetColourDataStride();
         MultiParticleDataCall::Particles::ColourDataType cdt = p.GetColourDataType();
         unsigned int csize = MultiParticleDataCall::Particles::ColorDataSize[cdt];
+        if (cds == 0) cds = csize;
 
         const uint8_t* vd = reinterpret_cast<const uint8_t*>(p.GetVertexData());
         unsigned int vds = p.GetVertexDataStride();
         MultiParticleDataCall::Particles::VertexDataType vdt = p.GetVertexDataType();
         unsigned int vsize = MultiParticleDataCall::Particles::VertexDataSize[vdt];
+        if (vds == 0) vds = vsize;
 
-        //vislib::sys::Log::DefaultLog.WriteInfo("Count = %lu", cnt);
-        //vislib::sys::Log::DefaultLog.WriteInfo("csize = %u, vsize = %u", csize, vsize);
-
-        std::vector<uint64_t> counts;
-        std::vector<int32_t> vertSizes, colSizes, vertOffsets, colOffsets;
-        counts.resize(this->mpiSize);
-        vertSizes.resize(this->mpiSize);
-        colSizes.resize(this->mpiSize);
-        vertOffsets.resize(this->mpiSize);
-        vertOffsets[0] = 0;
-        colOffsets.resize(this->mpiSize);
-        colOffsets[0] = 0;
-        uint64_t allCount = 0;
-        // MPI_Reduce(&cnt, &allCount, 1, MPI_INT64_T, MPI_SUM, 0, this->comm);
-        MPI_Gather(&cnt, 1, MPI_UINT64_T, counts.data(), 1, MPI_UINT64_T, 0, this->comm);
-
-        if (this->mpiRank == 0) {
-            for (auto x = 0; x < this->mpiSize; ++x) {
-                allCount += counts[x];
-                vertSizes[x] = counts[x] * vsize;
-                colSizes[x] = counts[x] * csize;
-                if (x > 0) {
-                    vertOffsets[x] = vertOffsets[x - 1] + counts[x - 1] * vsize;
-                    colOffsets[x] = colOffsets[x - 1] + counts[x - 1] * csize;
-                }
-            }
-            //vislib::sys::Log::DefaultLog.WriteInfo("allCount = %lu", allCount);
-            if (allCount * csize > std::numeric_limits<int>::max() ||
-                allCount * vsize > std::numeric_limits<int>::max()) {
-                // this is so bad there is no way to fix it
-                vislib::sys::Log::DefaultLog.WriteError("allCount is more powerful than MPI, kill me now. Try subsampling more aggressively", allCount);
-                abort();
+        const unsigned int rsize = vsize + csize;
+        if (rsize == 0) continue;
+
+        // the budgeted gather keeps every n-th particle such that all ranks together stay within the budget
+        uint64_t keep = cnt;
+        if (mode == MODE_BUDGET_GATHER) {
+            uint64_t allCount = 0;
+            MPI_Allreduce(&cnt, &allCount, 1, MPI_UINT64_T, MPI_SUM, this->comm);
+            if (allCount > budget) {
+                keep = static_cast<uint64_t>(static_cast<double>(cnt) * static_cast<double>(budget) /
+                                             static_cast<double>(allCount));
             }
-            p.SetCount(allCount);
-            allVertexData.resize(allCount * vsize);
-            allColorData.resize(allCount * csize);
-        } else {
-            p.SetCount(cnt);
         }
-        vertexData.resize(cnt * vsize);
-        colorData.resize(cnt * csize);
-
-        vislib::sys::Log::DefaultLog.FlushLog();
 
+        auto& data = this->listData[i];
+        data.resize(keep * rsize);
 #    pragma omp parallel for
-        for (long long idx = 0; idx < cnt; ++idx) {
-            memcpy(colorData.data() + csize * idx, cd + cds * idx, csize);
-            memcpy(vertexData.data() + vsize * idx, vd + vds * idx, vsize);
+        for (long long idx = 0; idx < static_cast<long long>(keep); ++idx) {
+            const uint64_t src = (keep == cnt) ? idx : (static_cast<uint64_t>(idx) * cnt) / keep;
+            memcpy(data.data() + rsize * idx, vd + vds * src, vsize);
+            memcpy(data.data() + rsize * idx + vsize, cd + cds * src, csize);
         }
 
-        MPI_Gatherv(colorData.data(), cnt * csize, MPI_BYTE, allColorData.data(), colSizes.data(), colOffsets.data(), MPI_BYTE, 0, this->comm);
-        MPI_Gatherv(vertexData.data(), cnt * vsize, MPI_BYTE, allVertexData.data(), vertSizes.data(), vertOffsets.data(),
-            MPI_BYTE, 0, this->comm);
-
-        if (this->mpiRank == 0) {
-            p.SetColourData(cdt, allColorData.data(), csize);
-            p.SetVertexData(vdt, allVertexData.data(), vsize);
-        } else {
-            p.SetColourData(cdt, colorData.data(), csize);
-            p.SetVertexData(vdt, vertexData.data(), vsize);
+        uint64_t resCount = keep;
+        switch (mode) {
+        case MODE_GATHER:
+        case MODE_BUDGET_GATHER:
+            resCount = this->gatherRecords(data, keep, rsize);
+            break;
+        case MODE_TREE_GATHER:
+            resCount = this->treeGatherRecords(data, keep, rsize);
+            break;
+        case MODE_SPATIAL_REDISTRIBUTE: {
+            vislib::math::Cuboid<float> slab = p.GetBBox();
+            if (vsize > 0) {
+                resCount = this->redistributeRecords(data, keep, rsize, vdt, slab);
+            }
+            p.SetBBox(slab);
+        } break;
         }
+
+        p.SetCount(resCount);
+        p.SetVertexData(vdt, data.data(), rsize);
+        p.SetColourData(cdt, data.data() + vsize, rsize);
     }
 #endif /* WITH_MPI */
 
@@ -160,4 +210,216 @@ bool datatools::MPIParticleCollector::initMPI() {
     retval = (this->comm != MPI_COMM_NULL);
 #endif /* WITH_MPI */
     return retval;
-}
\ No newline at end of file
+}
+
+#ifdef WITH_MPI
+
+/*
+ * datatools::MPIParticleCollector::recordType
+ */
+MPI_Datatype datatools::MPIParticleCollector::recordType(unsigned int recSize) {
+    if (this->recTypeSize != recSize) {
+        if (this->recType != MPI_DATATYPE_NULL) {
+            ::MPI_Type_free(&this->recType);
+        }
+        ::MPI_Type_contiguous(static_cast<int>(recSize), MPI_BYTE, &this->recType);
+        ::MPI_Type_commit(&this->recType);
+        this->recTypeSize = recSize;
+    }
+    return this->recType;
+}
+
+
+/*
+ * datatools::MPIParticleCollector::gatherRecords
+ */
+uint64_t datatools::MPIParticleCollector::gatherRecords(
+    std::vector<uint8_t>& data, uint64_t cnt, unsigned int recSize) {
+    std::vector<uint64_t> counts(this->mpiSize);
+    MPI_Gather(&cnt, 1, MPI_UINT64_T, counts.data(), 1, MPI_UINT64_T, 0, this->comm);
+
+    // counting in records instead of bytes buys us a factor of the record size before MPI's int limits bite
+    std::vector<int> recCounts(this->mpiSize), recOffsets(this->mpiSize);
+    uint64_t allCount = 0;
+    if (this->mpiRank == 0) {
+        for (int x = 0; x < this->mpiSize; ++x) {
+            recOffsets[x] = static_cast<int>(allCount);
+            recCounts[x] = static_cast<int>(counts[x]);
+            allCount += counts[x];
+        }
+    }
+    int tooMany = (allCount > maxRecordsPerMessage()) ? 1 : 0;
+    MPI_Bcast(&tooMany, 1, MPI_INT, 0, this->comm);
+    if (tooMany) {
+        vislib::sys::Log::DefaultLog.WriteError("MPIParticleCollector: %llu particles exceed what a single "
+                                                "MPI_Gatherv can transfer. Use the budgeted or tree gather instead.",
+            static_cast<unsigned long long>(allCount));
+        return (this->mpiRank == 0) ? 0 : cnt;
+    }
+
+    std::vector<uint8_t> allData;
+    if (this->mpiRank == 0) {
+        allData.resize(allCount * recSize);
+    }
+    auto type = this->recordType(recSize);
+    MPI_Gatherv(data.data(), static_cast<int>(cnt), type, allData.data(), recCounts.data(), recOffsets.data(), type,
+        0, this->comm);
+
+    if (this->mpiRank == 0) {
+        data.swap(allData);
+        return allCount;
+    }
+    return cnt;
+}
+
+
+/*
+ * datatools::MPIParticleCollector::treeGatherRecords
+ */
+uint64_t datatools::MPIParticleCollector::treeGatherRecords(
+    std::vector<uint8_t>& data, uint64_t cnt, unsigned int recSize) {
+    auto type = this->recordType(recSize);
+    const uint64_t maxMsg = maxRecordsPerMessage();
+    const uint64_t localCnt = cnt;
+
+    // binomial tree: in round k, ranks with bit k set send everything they have accumulated to rank - 2^k
+    for (int step = 1; step < this->mpiSize; step <<= 1) {
+        if ((this->mpiRank & step) != 0) {
+            const int dst = this->mpiRank - step;
+            MPI_Send(&cnt, 1, MPI_UINT64_T, dst, TREE_GATHER_TAG, this->comm);
+            for (uint64_t sent = 0; sent < cnt; sent += maxMsg) {
+                const int n = static_cast<int>(std::min(maxMsg, cnt - sent));
+                MPI_Send(data.data() + sent * recSize, n, type, dst, TREE_GATHER_TAG, this->comm);
+            }
+            // like gatherRecords, only rank 0 returns the gathered particles; intermediate ranks drop those of
+            // their subtree again, otherwise they would show them a second time
+            data.resize(localCnt * recSize);
+            return localCnt;
+        } else if (this->mpiRank + step < this->mpiSize) {
+            const int src = this->mpiRank + step;
+            uint64_t recvCnt = 0;
+            MPI_Recv(&recvCnt, 1, MPI_UINT64_T, src, TREE_GATHER_TAG, this->comm, MPI_STATUS_IGNORE);
+            data.resize((cnt + recvCnt) * recSize);
+            for (uint64_t recvd = 0; recvd < recvCnt; recvd += maxMsg) {
+                const int n = static_cast<int>(std::min(maxMsg, recvCnt - recvd));
+                MPI_Recv(data.data() + (cnt + recvd) * recSize, n, type, src, TREE_GATHER_TAG, this->comm,
+                    MPI_STATUS_IGNORE);
+            }
+            cnt += recvCnt;
+        }
+    }
+    return cnt;
+}
+
+
+/*
+ * datatools::MPIParticleCollector::redistributeRecords
+ */
+uint64_t datatools::MPIParticleCollector::redistributeRecords(std::vector<uint8_t>& data, uint64_t cnt,
+    unsigned int recSize, core::moldyn::MultiParticleDataCall::Particles::VertexDataType vdt,
+    vislib::math::Cuboid<float>& outBox) {
+    // global bounding box of the actual positions
+    float bounds[6] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max()};
+    for (uint64_t idx = 0; idx < cnt; ++idx) {
+        const uint8_t* rec = data.data() + idx * recSize;
+        for (int d = 0; d < 3; ++d) {
+            const float v = recordCoord(rec, vdt, d);
+            bounds[d] = std::min(bounds[d], v);
+            bounds[d + 3] = std::min(bounds[d + 3], -v);
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, bounds, 6, MPI_FLOAT, MPI_MIN, this->comm);
+    for (int d = 3; d < 6; ++d) bounds[d] = -bounds[d];
+    int axis = 0;
+    for (int d = 1; d < 3; ++d) {
+        if (bounds[d + 3] - bounds[d] > bounds[axis + 3] - bounds[axis]) axis = d;
+    }
+
+    // weighted sample of the coordinates along the split axis
+    const uint64_t numSamples = std::min(cnt, SPLIT_SAMPLES_PER_RANK);
+    std::vector<float> samples(numSamples);
+    for (uint64_t s = 0; s < numSamples; ++s) {
+        samples[s] = recordCoord(data.data() + ((s * cnt) / numSamples) * recSize, vdt, axis);
+    }
+    const float weight = (numSamples > 0) ? static_cast<float>(cnt) / static_cast<float>(numSamples) : 0.0f;
+    std::vector<int> sampleCounts(this->mpiSize), sampleOffsets(this->mpiSize);
+    const int localSamples = static_cast<int>(numSamples);
+    MPI_Allgather(&localSamples, 1, MPI_INT, sampleCounts.data(), 1, MPI_INT, this->comm);
+    std::vector<float> weights(this->mpiSize);
+    MPI_Allgather(&weight, 1, MPI_FLOAT, weights.data(), 1, MPI_FLOAT, this->comm);
+    int allSamples = 0;
+    for (int x = 0; x < this->mpiSize; ++x) {
+        sampleOffsets[x] = allSamples;
+        allSamples += sampleCounts[x];
+    }
+    std::vector<float> allSampleVals(allSamples);
+    MPI_Allgatherv(samples.data(), localSamples, MPI_FLOAT, allSampleVals.data(), sampleCounts.data(),
+        sampleOffsets.data(), MPI_FLOAT, this->comm);
+
+    std::vector<std::pair<float, float>> weighted;
+    weighted.reserve(allSamples);
+    double totalWeight = 0.0;
+    for (int x = 0; x < this->mpiSize; ++x) {
+        for (int s = 0; s < sampleCounts[x]; ++s) {
+            weighted.emplace_back(allSampleVals[sampleOffsets[x] + s], weights[x]);
+        }
+        totalWeight += static_cast<double>(weights[x]) * sampleCounts[x];
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    // slab borders at the weighted quantiles; every rank computes the same borders
+    std::vector<float> borders(this->mpiSize + 1);
+    borders[0] = bounds[axis];
+    borders[this->mpiSize] = bounds[axis + 3];
+    double acc = 0.0;
+    size_t w = 0;
+    for (int x = 1; x < this->mpiSize; ++x) {
+        const double target = totalWeight * x / this->mpiSize;
+        while (w < weighted.size() && acc + weighted[w].second < target) {
+            acc += weighted[w].second;
+            ++w;
+        }
+        borders[x] = (w < weighted.size()) ? weighted[w].first : bounds[axis + 3];
+    }
+
+    // bucket the local records by destination slab
+    std::vector<int> dest(cnt);
+    std::vector<int> sendCounts(this->mpiSize, 0);
+    for (uint64_t idx = 0; idx < cnt; ++idx) {
+        const float v = recordCoord(data.data() + idx * recSize, vdt, axis);
+        int r = static_cast<int>(std::upper_bound(borders.begin() + 1, borders.end() - 1, v) - (borders.begin() + 1));
+        dest[idx] = r;
+        ++sendCounts[r];
+    }
+    std::vector<int> sendOffsets(this->mpiSize, 0);
+    for (int x = 1; x < this->mpiSize; ++x) sendOffsets[x] = sendOffsets[x - 1] + sendCounts[x - 1];
+    std::vector<uint8_t> sendData(cnt * recSize);
+    std::vector<int> fill(sendOffsets);
+    for (uint64_t idx = 0; idx < cnt; ++idx) {
+        memcpy(sendData.data() + static_cast<uint64_t>(fill[dest[idx]]++) * recSize, data.data() + idx * recSize,
+            recSize);
+    }
+
+    std::vector<int> recvCounts(this->mpiSize), recvOffsets(this->mpiSize, 0);
+    MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, this->comm);
+    uint64_t recvTotal = recvCounts[0];
+    for (int x = 1; x < this->mpiSize; ++x) {
+        recvOffsets[x] = recvOffsets[x - 1] + recvCounts[x - 1];
+        recvTotal += recvCounts[x];
+    }
+    data.resize(recvTotal * recSize);
+    auto type = this->recordType(recSize);
+    MPI_Alltoallv(sendData.data(), sendCounts.data(), sendOffsets.data(), type, data.data(), recvCounts.data(),
+        recvOffsets.data(), type, this->comm);
+
+    float box[6] = {bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]};
+    box[axis] = borders[this->mpiRank];
+    box[axis + 3] = borders[this->mpiRank + 1];
+    outBox.Set(box[0], box[1], box[2], box[3], box[4], box[5]);
+
+    return recvTotal;
+}
+
+#endif /* WITH_MPI */
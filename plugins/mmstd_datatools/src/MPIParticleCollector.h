@@ -13,6 +13,9 @@
 
 #include "mmstd_datatools/AbstractParticleManipulator.h"
 #include "mmcore/param/ParamSlot.h"
+#include "mmcore/CallerSlot.h"
+#include "vislib/math/Cuboid.h"
+#include <vector>
 
 #ifdef WITH_MPI
 #include "mpi.h"
@@ -24,9 +27,11 @@ namespace datatools {
 
     /**
      * Module merging object-space distributed MultiparticleDataCalls over MPI.
-     * This should be used for gathering large in situ SUBSAMPLED (ParticleThinner) data sets:
+     * The plain gather mode should be used for gathering large in situ SUBSAMPLED (ParticleThinner) data sets:
      * Everything is collected at once and MPI cannot push that much data
-     * at once.
+     * at once. The budgeted gather subsamples on each rank such that the root receives at most a given number of
+     * particles, the tree gather collects along a binomial tree instead of serializing on the root's link, and the
+     * spatial redistribution does not gather at all but leaves each rank with a contiguous slab of the domain.
      */
     class MPIParticleCollector : public AbstractParticleManipulator {
     public:
@@ -75,6 +80,56 @@ namespace datatools {
 
     private:
 
+        /** Available collection strategies */
+        enum CollectionMode {
+            MODE_GATHER = 0,
+            MODE_BUDGET_GATHER = 1,
+            MODE_TREE_GATHER = 2,
+            MODE_SPATIAL_REDISTRIBUTE = 3
+        };
+
+#ifdef WITH_MPI
+        /**
+         * Gathers the packed records of all ranks on rank 0 using MPI_Gatherv.
+         *
+         * @param data The packed local records, replaced by the collected records on rank 0
+         * @param cnt The number of local records in 'data'
+         * @param recSize The size of one record in bytes
+         *
+         * @return The number of records in 'data' after the operation
+         */
+        uint64_t gatherRecords(std::vector<uint8_t>& data, uint64_t cnt, unsigned int recSize);
+
+        /**
+         * Gathers the packed records of all ranks on rank 0 along a binomial tree.
+         *
+         * @param data The packed local records, replaced by the collected records on rank 0
+         * @param cnt The number of local records in 'data'
+         * @param recSize The size of one record in bytes
+         *
+         * @return The number of records in 'data' after the operation
+         */
+        uint64_t treeGatherRecords(std::vector<uint8_t>& data, uint64_t cnt, unsigned int recSize);
+
+        /**
+         * Redistributes the packed records such that each rank holds a slab of the global bounding box along its
+         * longest axis. The slab borders are chosen from a weighted sample of all positions to balance the counts.
+         *
+         * @param data The packed local records, replaced by the records of the slab of this rank
+         * @param cnt The number of local records in 'data'
+         * @param recSize The size of one record in bytes
+         * @param vdt The vertex data type at the beginning of each record
+         * @param outBox Receives the bounding box of the slab of this rank
+         *
+         * @return The number of records in 'data' after the operation
+         */
+        uint64_t redistributeRecords(std::vector<uint8_t>& data, uint64_t cnt, unsigned int recSize,
+            core::moldyn::MultiParticleDataCall::Particles::VertexDataType vdt, vislib::math::Cuboid<float>& outBox);
+
+        /** Creates (or reuses) a contiguous MPI type for records of the given size */
+        MPI_Datatype recordType(unsigned int recSize);
+#endif /* WITH_MPI */
+
 #ifdef WITH_MPI
         /** The communicator that the view uses. */
         MPI_Comm comm = MPI_COMM_NULL;
@@ -83,11 +138,23 @@ namespace datatools {
         /** slot for MPIprovider */
         core::CallerSlot callRequestMpi;
 
+        /** The collection strategy */
+        core::param::ParamSlot modeSlot;
+
+        /** The maximum number of particles per list arriving at rank 0 in the budgeted gather */
+        core::param::ParamSlot budgetSlot;
+
         int mpiRank = 0;
         int mpiSize = 0;
 
-        std::vector<uint8_t> vertexData, colorData;
-        std::vector<uint8_t> allVertexData, allColorData;
+        /** Packed records (vertex followed by colour) per particle list */
+        std::vector<std::vector<uint8_t>> listData;
+
+#ifdef WITH_MPI
+        /** Cached record type and the size it has been created for */
+        MPI_Datatype recType = MPI_DATATYPE_NULL;
+        unsigned int recTypeSize = 0;
+#endif /* WITH_MPI */
     };
 
 } /* end namespace datatools */
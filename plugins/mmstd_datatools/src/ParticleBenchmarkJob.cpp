@@ -0,0 +1,264 @@
+/*
+ * ParticleBenchmarkJob.cpp
+ *
+ * Copyright (C) 2020 by MegaMol Team
+ * Alle Rechte vorbehalten.
+ */
+#include "stdafx.h"
+#include "ParticleBenchmarkJob.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include "ParticleBenchmarkProbe.h"
+#include "mmcore/moldyn/MultiParticleDataCall.h"
+#include "mmcore/param/FilePathParam.h"
+#include "mmcore/param/IntParam.h"
+#include "vislib/sys/Log.h"
+#ifdef _WIN32
+#    include <psapi.h>
+#    pragma comment(lib, "psapi.lib")
+#else /* _WIN32 */
+#    include <sys/resource.h>
+#endif /* _WIN32 */
+
+using namespace megamol;
+using namespace megamol::stdplugin::datatools;
+
+
+ParticleBenchmarkJob::ParticleBenchmarkJob(void)
+    : core::job::AbstractThreadedJob()
+    , core::Module()
+    , dataSlot("data", "Fetches the data of the chain to be measured")
+    , framesSlot("frames", "Number of frames to be fetched per pass, 0 for all")
+    , passesSlot("passes", "Number of measured passes over all frames")
+    , warmupSlot("warmup", "Number of passes over all frames before measuring")
+    , outputFileSlot("outputFile", "JSON file receiving the results, none if empty")
+    , probes() {
+
+    this->dataSlot.SetCompatibleCall<core::moldyn::MultiParticleDataCallDescription>();
+    this->MakeSlotAvailable(&this->dataSlot);
+
+    this->framesSlot.SetParameter(new core::param::IntParam(0, 0));
+    this->MakeSlotAvailable(&this->framesSlot);
+
+    this->passesSlot.SetParameter(new core::param::IntParam(1, 1));
+    this->MakeSlotAvailable(&this->passesSlot);
+
+    this->warmupSlot.SetParameter(new core::param::IntParam(1, 0));
+    this->MakeSlotAvailable(&this->warmupSlot);
+
+    this->outputFileSlot.SetParameter(new core::param::FilePathParam(""));
+    this->MakeSlotAvailable(&this->outputFileSlot);
+}
+
+
+ParticleBenchmarkJob::~ParticleBenchmarkJob(void) { this->Release(); }
+
+
+bool ParticleBenchmarkJob::create(void) { return true; }
+
+
+void ParticleBenchmarkJob::release(void) { this->probes.clear(); }
+
+
+DWORD ParticleBenchmarkJob::Run(void* userData) {
+    using core::moldyn::MultiParticleDataCall;
+    using vislib::sys::Log;
+
+    auto mpdc = this->dataSlot.CallAs<MultiParticleDataCall>();
+    if (mpdc == nullptr) {
+        Log::DefaultLog.WriteError("ParticleBenchmarkJob: No data source connected. Abort.");
+        this->signalEnd(true);
+        return 1;
+    }
+
+    unsigned int frameCnt = 1;
+    if ((*mpdc)(1)) {
+        frameCnt = mpdc->FrameCount();
+    }
+    mpdc->Unlock();
+    auto const maxFrames = static_cast<unsigned int>(this->framesSlot.Param<core::param::IntParam>()->Value());
+    if (maxFrames > 0) frameCnt = std::min(frameCnt, maxFrames);
+    if (frameCnt == 0) {
+        Log::DefaultLog.WriteError("ParticleBenchmarkJob: Data source counts zero frames. Abort.");
+        this->signalEnd(true);
+        return 1;
+    }
+    auto const passes = static_cast<unsigned int>(this->passesSlot.Param<core::param::IntParam>()->Value());
+    auto const warmup = static_cast<unsigned int>(this->warmupSlot.Param<core::param::IntParam>()->Value());
+
+    this->probes.clear();
+    std::unordered_set<void const*> visited;
+    this->collectProbes(*this, -1, visited);
+
+    uint64_t particles = 0;
+    for (unsigned int pass = 0; (pass < warmup) && !this->shouldTerminate(); ++pass) {
+        for (unsigned int frame = 0; (frame < frameCnt) && !this->shouldTerminate(); ++frame) {
+            if (!this->fetchFrame(frame, particles)) {
+                this->signalEnd(true);
+                return 1;
+            }
+        }
+    }
+    for (auto const& p : this->probes) {
+        p.module->TakeSamples();
+    }
+
+    std::vector<FrameSample> samples;
+    samples.reserve(static_cast<size_t>(passes) * frameCnt);
+    uint64_t totalParticles = 0;
+    auto const start = std::chrono::high_resolution_clock::now();
+    for (unsigned int pass = 0; (pass < passes) && !this->shouldTerminate(); ++pass) {
+        for (unsigned int frame = 0; (frame < frameCnt) && !this->shouldTerminate(); ++frame) {
+            auto const frameStart = std::chrono::high_resolution_clock::now();
+            if (!this->fetchFrame(frame, particles)) {
+                this->signalEnd(true);
+                return 1;
+            }
+            std::chrono::duration<double> const duration = std::chrono::high_resolution_clock::now() - frameStart;
+            samples.push_back({pass, frame, duration.count(), particles});
+            totalParticles += particles;
+        }
+    }
+    std::chrono::duration<double> const total = std::chrono::high_resolution_clock::now() - start;
+    for (auto& p : this->probes) {
+        p.samples = p.module->TakeSamples();
+    }
+    auto const peakMem = peakMemoryUsage();
+
+    Log::DefaultLog.WriteInfo("ParticleBenchmarkJob: %u frames in %u passes took %f s, %f particles/s, peak memory %f MB",
+        frameCnt, passes, total.count(), (total.count() > 0.0) ? (totalParticles / total.count()) : 0.0,
+        peakMem / (1024.0 * 1024.0));
+    for (auto const& p : this->probes) {
+        double inclusive = 0.0;
+        for (auto s : p.samples) inclusive += s;
+        double exclusive = inclusive;
+        for (auto u : p.upstream) {
+            for (auto s : this->probes[u].samples) exclusive -= s;
+        }
+        Log::DefaultLog.WriteInfo("ParticleBenchmarkJob: %s: %f s upstream, %f s up to the next probe",
+            p.name.c_str(), inclusive, exclusive);
+    }
+
+    auto const path = std::string(
+        vislib::StringA(this->outputFileSlot.Param<core::param::FilePathParam>()->Value()).PeekBuffer());
+    if (!path.empty() && !this->writeResults(path, samples, total.count(), totalParticles, peakMem)) {
+        Log::DefaultLog.WriteError("ParticleBenchmarkJob: Cannot write results to \"%s\".", path.c_str());
+    }
+
+    this->signalEnd(this->shouldTerminate());
+    return 0;
+}
+
+
+uint64_t ParticleBenchmarkJob::peakMemoryUsage(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (::GetProcessMemoryInfo(::GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return static_cast<uint64_t>(pmc.PeakWorkingSetSize);
+    }
+    return 0;
+#else /* _WIN32 */
+    struct rusage usage;
+    if (::getrusage(RUSAGE_SELF, &usage) == 0) {
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // kilobytes on Linux
+    }
+    return 0;
+#endif /* _WIN32 */
+}
+
+
+void ParticleBenchmarkJob::collectProbes(
+    core::Module const& module, int downstream, std::unordered_set<void const*>& visited) {
+    if (!visited.insert(&module).second) return;
+
+    for (auto it = module.ChildList_Begin(); it != module.ChildList_End(); ++it) {
+        auto callerSlot = dynamic_cast<core::CallerSlot*>((*it).get());
+        if (callerSlot == nullptr) continue;
+        auto call = callerSlot->CallAs<core::Call>();
+        if ((call == nullptr) || (call->PeekCalleeSlot() == nullptr)) continue;
+        auto upstream = std::dynamic_pointer_cast<const core::Module>(call->PeekCalleeSlot()->Parent());
+        if (!upstream) continue;
+
+        auto probe = std::dynamic_pointer_cast<const ParticleBenchmarkProbe>(upstream);
+        if (probe && (visited.count(upstream.get()) == 0)) {
+            this->probes.push_back({std::string(probe->FullName().PeekBuffer()), probe, {}, {}});
+            auto const idx = static_cast<int>(this->probes.size() - 1);
+            if (downstream >= 0) this->probes[downstream].upstream.push_back(idx);
+            this->collectProbes(*upstream, idx, visited);
+        } else {
+            this->collectProbes(*upstream, downstream, visited);
+        }
+    }
+}
+
+
+bool ParticleBenchmarkJob::fetchFrame(unsigned int frame, uint64_t& outParticles) {
+    using core::moldyn::MultiParticleDataCall;
+    using vislib::sys::Log;
+
+    auto mpdc = this->dataSlot.CallAs<MultiParticleDataCall>();
+    if (mpdc == nullptr) return false;
+
+    int missCnt = 0;
+    while (true) {
+        mpdc->SetFrameID(frame, true);
+        if (!(*mpdc)(0)) {
+            Log::DefaultLog.WriteError("ParticleBenchmarkJob: Cannot get data frame %u. Abort.", frame);
+            return false;
+        }
+        if (mpdc->FrameID() == frame) break;
+        mpdc->Unlock();
+        if (++missCnt > 100) {
+            Log::DefaultLog.WriteError("ParticleBenchmarkJob: Frame %u is not delivered. Abort.", frame);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    outParticles = 0;
+    for (unsigned int i = 0; i < mpdc->GetParticleListCount(); ++i) {
+        outParticles += mpdc->AccessParticles(i).GetCount();
+    }
+    mpdc->Unlock();
+
+    return true;
+}
+
+
+bool ParticleBenchmarkJob::writeResults(std::string const& path, std::vector<FrameSample> const& frames,
+    double seconds, uint64_t particles, uint64_t peakMem) const {
+    std::ofstream file(path);
+    if (!file) return false;
+    file.precision(12);
+
+    file << "{\n"
+         << "  \"seconds\": " << seconds << ",\n"
+         << "  \"particles\": " << particles << ",\n"
+         << "  \"particlesPerSecond\": " << ((seconds > 0.0) ? (particles / seconds) : 0.0) << ",\n"
+         << "  \"peakMemoryBytes\": " << peakMem << ",\n"
+         << "  \"frames\": [";
+    for (size_t i = 0; i < frames.size(); ++i) {
+        file << ((i == 0) ? "\n" : ",\n") << "    {\"pass\": " << frames[i].pass << ", \"frame\": " << frames[i].frame
+             << ", \"seconds\": " << frames[i].seconds << ", \"particles\": " << frames[i].particles << "}";
+    }
+    file << "\n  ],\n"
+         << "  \"probes\": [";
+    for (size_t i = 0; i < this->probes.size(); ++i) {
+        auto const& p = this->probes[i];
+        file << ((i == 0) ? "\n" : ",\n") << "    {\"name\": \"" << p.name << "\", \"upstream\": [";
+        for (size_t j = 0; j < p.upstream.size(); ++j) {
+            file << ((j == 0) ? "" : ", ") << "\"" << this->probes[p.upstream[j]].name << "\"";
+        }
+        file << "], \"seconds\": [";
+        for (size_t j = 0; j < p.samples.size(); ++j) {
+            file << ((j == 0) ? "" : ", ") << p.samples[j];
+        }
+        file << "]}";
+    }
+    file << "\n  ]\n"
+         << "}\n";
+
+    return file.good();
+}
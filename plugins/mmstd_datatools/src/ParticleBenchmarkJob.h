@@ -0,0 +1,167 @@
+/*
+ * ParticleBenchmarkJob.h
+ *
+ * Copyright (C) 2020 by MegaMol Team
+ * Alle Rechte vorbehalten.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "mmcore/CallerSlot.h"
+#include "mmcore/Module.h"
+#include "mmcore/job/AbstractThreadedJob.h"
+#include "mmcore/param/ParamSlot.h"
+
+namespace megamol {
+namespace stdplugin {
+namespace datatools {
+
+class ParticleBenchmarkProbe;
+
+/**
+ * Headless job pulling all frames of a particle module chain and measuring
+ * the throughput. Together with ParticleBoxGeneratorDataSource as synthetic
+ * source and ParticleBenchmarkProbe modules between the stages, it reports
+ * the time spent per frame, per section of the chain, the particles per
+ * second and the peak memory usage of the process. The results are logged
+ * and written to a JSON file, e.g. from a Lua project like:
+ *
+ *   mmCreateJob("bench", "ParticleBenchmarkJob", "::bench::job")
+ *   mmCreateModule("ParticleBoxGeneratorDataSource", "::bench::gen")
+ *   mmCreateModule("ParticleBenchmarkProbe", "::bench::probe")
+ *   mmCreateModule("ParticleThinner", "::bench::filter")
+ *   mmCreateCall("MultiParticleDataCall", "::bench::job::data", "::bench::filter::outData")
+ *   mmCreateCall("MultiParticleDataCall", "::bench::filter::indata", "::bench::probe::outData")
+ *   mmCreateCall("MultiParticleDataCall", "::bench::probe::inData", "::bench::gen::data")
+ *   mmSetParamValue("::bench::gen::count", "10000000")
+ *   mmSetParamValue("::bench::job::outputFile", "bench.json")
+ */
+class ParticleBenchmarkJob : public core::job::AbstractThreadedJob, public core::Module {
+public:
+    /** Return module class name */
+    static const char* ClassName(void) { return "ParticleBenchmarkJob"; }
+
+    /** Return module class description */
+    static const char* Description(void) {
+        return "Pulls all frames of a particle module chain and reports timings and throughput";
+    }
+
+    /** Module is always available */
+    static bool IsAvailable(void) { return true; }
+
+    /** Disallow usage in quickstarts */
+    static bool SupportQuickstart(void) { return false; }
+
+    /** Ctor */
+    ParticleBenchmarkJob(void);
+
+    /** Dtor */
+    virtual ~ParticleBenchmarkJob(void);
+
+protected:
+    /** Lazy initialization of the module */
+    virtual bool create(void);
+
+    /** Resource release */
+    virtual void release(void);
+
+    /**
+     * Runs the benchmark.
+     *
+     * @param userData Not used.
+     *
+     * @return 0 on success, 1 otherwise.
+     */
+    virtual DWORD Run(void* userData);
+
+private:
+    /** A probe found upstream and its measurements */
+    struct Probe {
+        /** The full name of the probe module */
+        std::string name;
+
+        /** The probe module */
+        std::shared_ptr<const ParticleBenchmarkProbe> module;
+
+        /** The indices of the nearest probes upstream of this one */
+        std::vector<size_t> upstream;
+
+        /** The measured durations of the GetData requests in seconds */
+        std::vector<double> samples;
+    };
+
+    /** The measurement of a single frame */
+    struct FrameSample {
+        unsigned int pass;
+        unsigned int frame;
+        double seconds;
+        uint64_t particles;
+    };
+
+    /**
+     * Answer the peak resident set size of the process.
+     *
+     * @return The peak memory usage in bytes, zero if unknown.
+     */
+    static uint64_t peakMemoryUsage(void);
+
+    /**
+     * Searches all modules upstream of 'module' for probes.
+     *
+     * @param module The module to start at
+     * @param downstream The index of the nearest probe downstream of
+     *                   'module' or -1 if there is none
+     * @param visited The modules already searched
+     */
+    void collectProbes(core::Module const& module, int downstream, std::unordered_set<void const*>& visited);
+
+    /**
+     * Fetches a frame from the chain, waiting until the right frame arrives.
+     *
+     * @param frame The frame to fetch
+     * @param outParticles Receives the number of particles in the frame
+     *
+     * @return True on success
+     */
+    bool fetchFrame(unsigned int frame, uint64_t& outParticles);
+
+    /**
+     * Writes the results as JSON.
+     *
+     * @param path The output file
+     * @param frames The measured frames
+     * @param seconds The overall duration of the measured passes
+     * @param particles The overall number of particles fetched
+     * @param peakMem The peak memory usage in bytes
+     *
+     * @return True on success
+     */
+    bool writeResults(std::string const& path, std::vector<FrameSample> const& frames, double seconds,
+        uint64_t particles, uint64_t peakMem) const;
+
+    /** The slot fetching the data */
+    core::CallerSlot dataSlot;
+
+    /** The number of frames to be fetched, zero for all */
+    core::param::ParamSlot framesSlot;
+
+    /** The number of passes over the frames being measured */
+    core::param::ParamSlot passesSlot;
+
+    /** The number of passes over the frames before measuring */
+    core::param::ParamSlot warmupSlot;
+
+    /** The path of the JSON file receiving the results */
+    core::param::ParamSlot outputFileSlot;
+
+    /** The probes found upstream */
+    std::vector<Probe> probes;
+};
+
+} /* end namespace datatools */
+} /* end namespace stdplugin */
+} /* end namespace megamol */
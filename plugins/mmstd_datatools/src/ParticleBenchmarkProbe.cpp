@@ -0,0 +1,75 @@
+/*
+ * ParticleBenchmarkProbe.cpp
+ *
+ * Copyright (C) 2020 by MegaMol Team
+ * Alle Rechte vorbehalten.
+ */
+#include "stdafx.h"
+#include "ParticleBenchmarkProbe.h"
+#include <chrono>
+#include "mmcore/moldyn/MultiParticleDataCall.h"
+
+using namespace megamol;
+using namespace megamol::stdplugin::datatools;
+
+
+ParticleBenchmarkProbe::ParticleBenchmarkProbe(void)
+    : core::Module()
+    , outDataSlot("outData", "Provides the data of the modules upstream")
+    , inDataSlot("inData", "Fetches the data to be measured")
+    , samplesLock()
+    , samples() {
+
+    this->outDataSlot.SetCallback(core::moldyn::MultiParticleDataCall::ClassName(),
+        core::moldyn::MultiParticleDataCall::FunctionName(0), &ParticleBenchmarkProbe::getDataCallback);
+    this->outDataSlot.SetCallback(core::moldyn::MultiParticleDataCall::ClassName(),
+        core::moldyn::MultiParticleDataCall::FunctionName(1), &ParticleBenchmarkProbe::getExtentCallback);
+    this->MakeSlotAvailable(&this->outDataSlot);
+
+    this->inDataSlot.SetCompatibleCall<core::moldyn::MultiParticleDataCallDescription>();
+    this->MakeSlotAvailable(&this->inDataSlot);
+}
+
+
+ParticleBenchmarkProbe::~ParticleBenchmarkProbe(void) { this->Release(); }
+
+
+std::vector<double> ParticleBenchmarkProbe::TakeSamples(void) const {
+    std::lock_guard<std::mutex> guard(this->samplesLock);
+    std::vector<double> rv;
+    rv.swap(this->samples);
+    return rv;
+}
+
+
+bool ParticleBenchmarkProbe::create(void) { return true; }
+
+
+void ParticleBenchmarkProbe::release(void) {}
+
+
+bool ParticleBenchmarkProbe::forward(core::Call& c, unsigned int idx) {
+    using core::moldyn::MultiParticleDataCall;
+
+    auto outCall = dynamic_cast<MultiParticleDataCall*>(&c);
+    if (outCall == nullptr) return false;
+
+    auto inCall = this->inDataSlot.CallAs<MultiParticleDataCall>();
+    if (inCall == nullptr) return false;
+
+    *inCall = *outCall; // to get the correct request time
+    auto const start = std::chrono::high_resolution_clock::now();
+    bool const ok = (*inCall)(idx);
+    std::chrono::duration<double> const duration = std::chrono::high_resolution_clock::now() - start;
+    if (!ok) return false;
+
+    if (idx == 0) {
+        std::lock_guard<std::mutex> guard(this->samplesLock);
+        this->samples.push_back(duration.count());
+    }
+
+    *outCall = *inCall; // also transfers the unlocker to 'outCall'
+    inCall->SetUnlocker(nullptr, false);
+
+    return true;
+}
@@ -0,0 +1,92 @@
+/*
+ * ParticleBenchmarkProbe.h
+ *
+ * Copyright (C) 2020 by MegaMol Team
+ * Alle Rechte vorbehalten.
+ */
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "mmcore/CalleeSlot.h"
+#include "mmcore/CallerSlot.h"
+#include "mmcore/Module.h"
+
+namespace megamol {
+namespace stdplugin {
+namespace datatools {
+
+/**
+ * Pass-through module measuring how long the modules upstream take to answer
+ * GetData. Placed between the modules of a chain, the probes are picked up by
+ * ParticleBenchmarkJob, which derives the time spent in each section of the
+ * chain from them.
+ */
+class ParticleBenchmarkProbe : public core::Module {
+public:
+    /** Return module class name */
+    static const char* ClassName(void) { return "ParticleBenchmarkProbe"; }
+
+    /** Return module class description */
+    static const char* Description(void) {
+        return "Passes particle data through and measures the time spent upstream for ParticleBenchmarkJob";
+    }
+
+    /** Module is always available */
+    static bool IsAvailable(void) { return true; }
+
+    /** Ctor */
+    ParticleBenchmarkProbe(void);
+
+    /** Dtor */
+    virtual ~ParticleBenchmarkProbe(void);
+
+    /**
+     * Answer the durations of all GetData requests since the last call and
+     * forget about them.
+     *
+     * @return The durations in seconds in the order of the requests
+     */
+    std::vector<double> TakeSamples(void) const;
+
+protected:
+    /** Lazy initialization of the module */
+    virtual bool create(void);
+
+    /** Resource release */
+    virtual void release(void);
+
+private:
+    /**
+     * Forwards a request upstream and its answer downstream
+     *
+     * @param c The incoming call
+     * @param idx The function to be called upstream
+     *
+     * @return True on success
+     */
+    bool forward(core::Call& c, unsigned int idx);
+
+    /** Callback for GetData */
+    bool getDataCallback(core::Call& c) { return this->forward(c, 0); }
+
+    /** Callback for GetExtent */
+    bool getExtentCallback(core::Call& c) { return this->forward(c, 1); }
+
+    /** The slot providing the data */
+    core::CalleeSlot outDataSlot;
+
+    /** The slot fetching the data */
+    core::CallerSlot inDataSlot;
+
+    /** Protects 'samples' */
+    mutable std::mutex samplesLock;
+
+    /** The durations of the GetData requests not yet taken */
+    mutable std::vector<double> samples;
+};
+
+} /* end namespace datatools */
+} /* end namespace stdplugin */
+} /* end namespace megamol */
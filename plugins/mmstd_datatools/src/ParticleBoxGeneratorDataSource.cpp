@@ -47,6 +47,8 @@ ParticleBoxGeneratorDataSource::ParticleBoxGeneratorDataSource(void) : core::Mod
         interleavePosAndColorSlot("store::interleaved", "Flag to interleave position and color information"),
         radiusScaleSlot("radiusScale", "Scale factor for particle radii"),
         positionNoiseSlot("positionNoise", "Amount of noise for the position values"),
+        doublePrecisionSlot("store::double", "Flag to store positions as doubles, which implies a global radius"),
+        frameCountSlot("frameCount", "Number of frames reported, all of them holding the same data"),
         dataHash(0),
         cnt(0), data(), rad(0.0f),
         vdt(Particles::VERTDATA_NONE), vdp(nullptr), vds(0),
@@ -81,6 +83,12 @@ ParticleBoxGeneratorDataSource::ParticleBoxGeneratorDataSource(void) : core::Mod
     positionNoiseSlot.SetParameter(new core::param::FloatParam(1.25f, 0.0f));
     MakeSlotAvailable(&positionNoiseSlot);
 
+    doublePrecisionSlot.SetParameter(new core::param::BoolParam(false));
+    MakeSlotAvailable(&doublePrecisionSlot);
+
+    frameCountSlot.SetParameter(new core::param::IntParam(1, 1));
+    MakeSlotAvailable(&frameCountSlot);
+
     randomSeedSlot.SetParameter(new core::param::IntParam(2007, 0));
     randomSeedSlot.ForceSetDirty();
     MakeSlotAvailable(&randomSeedSlot);
@@ -137,13 +145,15 @@ bool ParticleBoxGeneratorDataSource::getDataCallback(core::Call& caller) {
     if (mpdc == nullptr) return false;
     if (particleCountSlot.IsDirty() || radiusPerParticleSlot.IsDirty() || colorDataSlot.IsDirty()
             || interleavePosAndColorSlot.IsDirty() || radiusScaleSlot.IsDirty() || positionNoiseSlot.IsDirty()
-            || randomSeedSlot.IsDirty()) {
+            || randomSeedSlot.IsDirty() || doublePrecisionSlot.IsDirty()) {
         this->assertData();
     }
 
+    unsigned int const frameCnt = static_cast<unsigned int>(frameCountSlot.Param<core::param::IntParam>()->Value());
     mpdc->SetParticleListCount(1);
     mpdc->SetDataHash(dataHash);
-    mpdc->SetExtent(1, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f);
+    mpdc->SetExtent(frameCnt, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f);
+    mpdc->SetFrameID(std::min(mpdc->FrameID(), frameCnt - 1));
     core::moldyn::MultiParticleDataCall::Particles& parties = mpdc->AccessParticles(0);
 
     parties.SetCount(cnt);
@@ -167,13 +177,14 @@ bool ParticleBoxGeneratorDataSource::getExtentCallback(core::Call& caller) {
     if (mpdc == nullptr) return false;
     if (particleCountSlot.IsDirty() || radiusPerParticleSlot.IsDirty() || colorDataSlot.IsDirty()
             || interleavePosAndColorSlot.IsDirty() || radiusScaleSlot.IsDirty() || positionNoiseSlot.IsDirty()
-            || randomSeedSlot.IsDirty()) {
+            || randomSeedSlot.IsDirty() || doublePrecisionSlot.IsDirty()) {
         this->assertData();
     }
 
     mpdc->SetParticleListCount(1);
     mpdc->SetDataHash(dataHash);
-    mpdc->SetExtent(1, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f);
+    mpdc->SetExtent(static_cast<unsigned int>(frameCountSlot.Param<core::param::IntParam>()->Value()),
+        -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f);
 
     mpdc->SetUnlocker(nullptr);
 
@@ -210,12 +221,15 @@ void ParticleBoxGeneratorDataSource::assertData(void) {
     interleavePosAndColorSlot.ResetDirty();
     radiusScaleSlot.ResetDirty();
     positionNoiseSlot.ResetDirty();
+    doublePrecisionSlot.ResetDirty();
 
     uint64_t pcnt = particleCountSlot.Param<core::param::IntParam>()->Value();
     bool radAtPart = radiusPerParticleSlot.Param<core::param::BoolParam>()->Value();
     MyColorType colType = static_cast<MyColorType>(colorDataSlot.Param<core::param::EnumParam>()->Value());
     float radScale = radiusScaleSlot.Param<core::param::FloatParam>()->Value();
     float posNoise = positionNoiseSlot.Param<core::param::FloatParam>()->Value();
+    bool dblPos = doublePrecisionSlot.Param<core::param::BoolParam>()->Value();
+    if (dblPos) radAtPart = false; // there is no double format with radius
 
     if (pcnt == 0) {
         clear();
@@ -230,7 +244,10 @@ void ParticleBoxGeneratorDataSource::assertData(void) {
     // setup storage and pointer
     int bpv = 12;
     int bpc = 0;
-    if (radAtPart) {
+    if (dblPos) {
+        vdt = Particles::VERTDATA_DOUBLE_XYZ;
+        bpv = 24;
+    } else if (radAtPart) {
         vdt = Particles::VERTDATA_FLOAT_XYZR;
         bpv += 4;
     } else {
@@ -316,11 +333,18 @@ void ParticleBoxGeneratorDataSource::assertData(void) {
                 float px = -1.0f + x_b + x_a * ix;
 
                 // position
-                float* vertDat = reinterpret_cast<float*>(vertDatPtr);
-                vertDat[0] = px + (rnd_uni(rnd_engine) * 2.0f - 1.0f) * pn;
-                vertDat[1] = py + (rnd_uni(rnd_engine) * 2.0f - 1.0f) * pn;
-                vertDat[2] = pz + (rnd_uni(rnd_engine) * 2.0f - 1.0f) * pn;
-                if (radAtPart) vertDat[3] = rad;
+                if (dblPos) {
+                    double* vertDat = reinterpret_cast<double*>(vertDatPtr);
+                    vertDat[0] = px + (rnd_uni(rnd_engine) * 2.0f - 1.0f) * pn;
+                    vertDat[1] = py + (rnd_uni(rnd_engine) * 2.0f - 1.0f) * pn;
+                    vertDat[2] = pz + (rnd_uni(rnd_engine) * 2.0f - 1.0f) * pn;
+                } else {
+                    float* vertDat = reinterpret_cast<float*>(vertDatPtr);
+                    vertDat[0] = px + (rnd_uni(rnd_engine) * 2.0f - 1.0f) * pn;
+                    vertDat[1] = py + (rnd_uni(rnd_engine) * 2.0f - 1.0f) * pn;
+                    vertDat[2] = pz + (rnd_uni(rnd_engine) * 2.0f - 1.0f) * pn;
+                    if (radAtPart) vertDat[3] = rad;
+                }
 
                 // color
                 switch (colType) {
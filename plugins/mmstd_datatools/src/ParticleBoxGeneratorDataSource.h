@@ -117,6 +117,8 @@ namespace datatools {
 		core::param::ParamSlot interleavePosAndColorSlot;
 		core::param::ParamSlot radiusScaleSlot;
 		core::param::ParamSlot positionNoiseSlot;
+		core::param::ParamSlot doublePrecisionSlot;
+		core::param::ParamSlot frameCountSlot;
 
 		size_t dataHash;
 
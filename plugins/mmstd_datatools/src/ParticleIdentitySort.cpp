@@ -1,6 +1,129 @@
 #include "stdafx.h"
 #include "ParticleIdentitySort.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <numeric>
+#include "omp.h"
+
+namespace {
+
+/** A strided array of one particle attribute. */
+struct Field {
+    char const* ptr;
+    size_t stride;
+    size_t size;
+};
+
+
+/**
+ * Sorts 'keys' in ascending order using a parallel LSD radix sort with 8-bit
+ * digits and applies the same permutation to 'idx'. The sort is stable.
+ * Digits above the highest bit set in any key are skipped.
+ */
+template <class K> void radixSort(std::vector<K>& keys, std::vector<size_t>& idx) {
+    auto const cnt = static_cast<int64_t>(keys.size());
+
+    K any = 0;
+    for (int64_t i = 0; i < cnt; ++i) {
+        any |= keys[i];
+    }
+    unsigned int passes = 0;
+    while ((passes < sizeof(K)) && ((any >> (8 * passes)) != 0)) {
+        ++passes;
+    }
+
+    std::vector<K> keysTmp(cnt);
+    std::vector<size_t> idxTmp(cnt);
+    std::vector<size_t> hist(static_cast<size_t>(omp_get_max_threads()) * 256);
+
+    for (unsigned int pass = 0; pass < passes; ++pass) {
+        auto const shift = 8 * pass;
+#pragma omp parallel
+        {
+            auto const numThr = static_cast<int64_t>(omp_get_num_threads());
+            auto const thr = static_cast<int64_t>(omp_get_thread_num());
+            auto const begin = cnt * thr / numThr;
+            auto const end = cnt * (thr + 1) / numThr;
+            auto const myHist = hist.data() + thr * 256;
+
+            std::fill(myHist, myHist + 256, 0);
+            for (int64_t i = begin; i < end; ++i) {
+                ++myHist[(keys[i] >> shift) & 0xFF];
+            }
+
+#pragma omp barrier
+#pragma omp single
+            {
+                // Exclusive prefix sum ordered by digit first and by thread
+                // second keeps the sort stable.
+                size_t sum = 0;
+                for (size_t d = 0; d < 256; ++d) {
+                    for (int64_t t = 0; t < numThr; ++t) {
+                        auto const c = hist[t * 256 + d];
+                        hist[t * 256 + d] = sum;
+                        sum += c;
+                    }
+                }
+            }
+
+            for (int64_t i = begin; i < end; ++i) {
+                auto const dst = myHist[(keys[i] >> shift) & 0xFF]++;
+                keysTmp[dst] = keys[i];
+                idxTmp[dst] = idx[i];
+            }
+        }
+        keys.swap(keysTmp);
+        idx.swap(idxTmp);
+    }
+}
+
+
+/**
+ * Reads the IDs of 'p' and sorts them together with the identity permutation.
+ */
+template <class K>
+void sortByIdentity(megamol::core::moldyn::SimpleSphericalParticles const& p, std::vector<size_t>& perm) {
+    auto const cnt = static_cast<int64_t>(p.GetCount());
+    auto const ip = reinterpret_cast<char const*>(p.GetIDData());
+    auto const is = std::max<size_t>(sizeof(K), p.GetIDDataStride());
+
+    std::vector<K> keys(cnt);
+#pragma omp parallel for
+    for (int64_t i = 0; i < cnt; ++i) {
+        keys[i] = *megamol::core::moldyn::access<K>(ip, i, is);
+    }
+
+    perm.resize(cnt);
+    std::iota(perm.begin(), perm.end(), 0);
+    radixSort(keys, perm);
+}
+
+
+/**
+ * Answer whether 'perm' sorts the IDs of 'p'.
+ */
+template <class K>
+bool isSortedBy(megamol::core::moldyn::SimpleSphericalParticles const& p, std::vector<size_t> const& perm) {
+    auto const cnt = static_cast<int64_t>(p.GetCount());
+    if (perm.size() != static_cast<size_t>(cnt)) {
+        return false;
+    }
+    auto const ip = reinterpret_cast<char const*>(p.GetIDData());
+    auto const is = std::max<size_t>(sizeof(K), p.GetIDDataStride());
+
+    int64_t violations = 0;
+#pragma omp parallel for reduction(+ : violations)
+    for (int64_t i = 1; i < cnt; ++i) {
+        if (*megamol::core::moldyn::access<K>(ip, perm[i - 1], is) >
+            *megamol::core::moldyn::access<K>(ip, perm[i], is)) {
+            ++violations;
+        }
+    }
+    return violations == 0;
+}
+
+} // namespace
 
 
 megamol::stdplugin::datatools::ParticleIdentitySort::ParticleIdentitySort(void)
@@ -13,6 +136,7 @@ megamol::stdplugin::datatools::ParticleIdentitySort::~ParticleIdentitySort(void)
 bool megamol::stdplugin::datatools::ParticleIdentitySort::manipulateData(
     megamol::core::moldyn::MultiParticleDataCall& outData, megamol::core::moldyn::MultiParticleDataCall& inData) {
     using megamol::core::moldyn::MultiParticleDataCall;
+    using megamol::core::moldyn::SimpleSphericalParticles;
 
     outData = inData; // also transfers the unlocker to 'outData'
 
@@ -20,83 +144,101 @@ bool megamol::stdplugin::datatools::ParticleIdentitySort::manipulateData(
                                         // original data will be unlocked through outData
 
     auto const plc = outData.GetParticleListCount();
-    this->data_.clear();
+    this->data_.resize(plc);
+    this->perms_.resize(plc);
     for (unsigned int i = 0; i < plc; ++i) {
         auto& p = outData.AccessParticles(i);
 
-        if (p.GetIDDataType() == core::moldyn::SimpleSphericalParticles::IDDATA_NONE) {
+        if (p.GetIDDataType() == SimpleSphericalParticles::IDDATA_NONE) {
             vislib::sys::Log::DefaultLog.WriteWarn("ParticleIdentitySort: Particlelist %d has no indentity array\n", i);
+            this->perms_[i].clear();
             continue;
         }
 
-        this->data_.emplace_back();
-        auto& dlist = this->data_.back();
-
-        auto vs = p.GetVertexDataStride();
-        auto cs = p.GetColourDataStride();
-        auto is = p.GetIDDataStride();
-
-        auto avs = vs;
-        auto acs = cs;
-        auto ais = is;
-
-        auto const vp = reinterpret_cast<char const* const>(p.GetVertexData());
-        auto const cp = reinterpret_cast<char const* const>(p.GetColourData());
-        auto const ip = reinterpret_cast<char const* const>(p.GetIDData());
-
-        auto ts = vs;
-
-        bool const sep = (vs == 0) || (cs == 0) || (is == 0);
-
-        if (sep) {
-            vs = core::moldyn::SimpleSphericalParticles::VertexDataSize[p.GetVertexDataType()];
-            cs = core::moldyn::SimpleSphericalParticles::ColorDataSize[p.GetColourDataType()];
-            is = core::moldyn::SimpleSphericalParticles::IDDataSize[p.GetIDDataType()];
-
-            ts = vs + cs + is;
-
-            // sep = true;
-        }
-
+        auto& dlist = this->data_[i];
+        auto& perm = this->perms_[i];
         auto const cnt = p.GetCount();
 
-        std::vector<size_t> keys(cnt);
-        std::iota(keys.begin(), keys.end(), 0);
+        // MD output usually keeps the order of the particles over time, so the
+        // permutation of the last frame is likely to still sort the IDs.
+        bool const is64 = p.GetIDDataType() == SimpleSphericalParticles::IDDATA_UINT64;
+        bool const reuse = is64 ? isSortedBy<uint64_t>(p, perm) : isSortedBy<uint32_t>(p, perm);
+        if (!reuse) {
+            if (is64) {
+                sortByIdentity<uint64_t>(p, perm);
+            } else {
+                sortByIdentity<uint32_t>(p, perm);
+            }
+        }
 
-        auto const& iAcc = p.GetParticleStore().GetIDAcc();
+        // The attributes are gathered into interleaved records of ts bytes,
+        // either as a whole if they already are interleaved or one by one.
+        auto const vs = SimpleSphericalParticles::VertexDataSize[p.GetVertexDataType()];
+        auto const cs = SimpleSphericalParticles::ColorDataSize[p.GetColourDataType()];
+        auto const ds = SimpleSphericalParticles::DirDataSize[p.GetDirDataType()];
+        auto const is = SimpleSphericalParticles::IDDataSize[p.GetIDDataType()];
+        Field fields[] = {
+            {reinterpret_cast<char const*>(p.GetVertexData()), std::max<size_t>(vs, p.GetVertexDataStride()), vs},
+            {reinterpret_cast<char const*>(p.GetColourData()), std::max<size_t>(cs, p.GetColourDataStride()), cs},
+            {reinterpret_cast<char const*>(p.GetDirData()), std::max<size_t>(ds, p.GetDirDataStride()), ds},
+            {reinterpret_cast<char const*>(p.GetIDData()), std::max<size_t>(is, p.GetIDDataStride()), is}};
+        size_t offsets[4] = {0, 0, 0, 0};
+
+        char const* lo = nullptr;
+        char const* hi = nullptr;
+        size_t stride = 0;
+        bool interleaved = true;
+        for (auto const& f : fields) {
+            if (f.size == 0) continue;
+            if (lo == nullptr) {
+                lo = f.ptr;
+                hi = f.ptr + f.size;
+                stride = f.stride;
+            } else {
+                lo = std::min(lo, f.ptr);
+                hi = std::max(hi, f.ptr + f.size);
+                interleaved = interleaved && (f.stride == stride);
+            }
+        }
+        interleaved = interleaved && (static_cast<size_t>(hi - lo) <= stride);
 
-        std::sort(keys.begin(), keys.end(),
-            [&iAcc](auto const& a, auto const& b) -> bool { return iAcc->Get_u64(a) < iAcc->Get_u64(b); });
+        size_t ts = 0;
+        if (interleaved) {
+            ts = stride;
+            for (size_t f = 0; f < 4; ++f) {
+                if (fields[f].size > 0) offsets[f] = fields[f].ptr - lo;
+            }
+        } else {
+            for (size_t f = 0; f < 4; ++f) {
+                offsets[f] = ts;
+                ts += fields[f].size;
+            }
+        }
 
         dlist.resize(cnt * ts);
-
         auto const basePtr = dlist.data();
+        auto const icnt = static_cast<int64_t>(cnt);
 
-        if (sep) {
-            for (size_t pidx = 0; pidx < cnt; ++pidx) {
-                auto const sidx = keys[pidx];
-                memcpy(basePtr + ts * pidx, vp + sidx * avs, vs);
-                memcpy(basePtr + ts * pidx + vs, cp + sidx * acs, cs);
-                memcpy(basePtr + ts * pidx + vs + cs, ip + sidx * ais, is);
-
-                /*auto const didx = iAcc->Get_u64(pidx);
-                memcpy(basePtr + ts * didx, vp, vs);
-                memcpy(basePtr + ts * didx + vs, cp, cs);
-                memcpy(basePtr + ts * didx + vs + cs, ip, is);*/
+        if (interleaved) {
+#pragma omp parallel for
+            for (int64_t pidx = 0; pidx < icnt; ++pidx) {
+                memcpy(basePtr + ts * pidx, lo + perm[pidx] * ts, ts);
             }
         } else {
-            for (size_t pidx = 0; pidx < cnt; ++pidx) {
-                auto const sidx = keys[pidx];
-                memcpy(basePtr + ts * pidx, vp + sidx * ts, ts);
-
-                /*auto const didx = iAcc->Get_u64(pidx);
-                memcpy(basePtr + ts * didx, vp, ts);*/
+#pragma omp parallel for
+            for (int64_t pidx = 0; pidx < icnt; ++pidx) {
+                auto const sidx = perm[pidx];
+                for (size_t f = 0; f < 4; ++f) {
+                    if (fields[f].size == 0) continue;
+                    memcpy(basePtr + ts * pidx + offsets[f], fields[f].ptr + sidx * fields[f].stride, fields[f].size);
+                }
             }
         }
 
-        p.SetVertexData(p.GetVertexDataType(), basePtr, ts);
-        p.SetColourData(p.GetColourDataType(), basePtr + vs, ts);
-        p.SetIDData(p.GetIDDataType(), basePtr + vs + cs, ts);
+        p.SetVertexData(p.GetVertexDataType(), basePtr + offsets[0], ts);
+        p.SetColourData(p.GetColourDataType(), basePtr + offsets[1], ts);
+        p.SetDirData(p.GetDirDataType(), basePtr + offsets[2], ts);
+        p.SetIDData(p.GetIDDataType(), basePtr + offsets[3], ts);
     }
     return true;
 }
@@ -48,7 +48,11 @@ namespace datatools {
 
     private:
 
+        /** The sorted, interleaved particle data of each list */
         std::vector<std::vector<char>> data_;
+
+        /** The permutation sorting each list, reused while it stays valid */
+        std::vector<std::vector<size_t>> perms_;
     };
 
 } /* end namespace datatools */
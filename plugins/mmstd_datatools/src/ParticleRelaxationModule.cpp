@@ -6,7 +6,14 @@
  */
 #include "stdafx.h"
 #include "ParticleRelaxationModule.h"
+#include "mmcore/param/BoolParam.h"
+#include "mmcore/param/FloatParam.h"
+#include "mmcore/param/IntParam.h"
+#include "vislib/sys/Log.h"
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
 
 using namespace megamol;
 using namespace megamol::stdplugin;
@@ -17,7 +24,33 @@ using namespace megamol::stdplugin;
  */
 datatools::ParticleRelaxationModule::ParticleRelaxationModule(void)
         : AbstractParticleManipulator("outData", "indata"),
-        dataHash(0), frameId(0), outDataHash(0), bbox(), cbox() {
+        iterationsSlot("iterations", "The maximum number of relaxation steps per frame"),
+        relaxationFactorSlot("relaxationFactor", "The fraction of the overlap removed per step"),
+        toleranceSlot("tolerance", "The overlap relative to the mean radius below which the relaxation stops"),
+        timeBudgetSlot("timeBudget", "The maximum time per frame in milliseconds (0 = unlimited)"),
+        warmStartSlot("warmStart", "Start from the displacements of the last frame if the particle count is unchanged"),
+        cellStart(), gridCellSize(0.0f), cellOf(), order(), sorted(), sortedNext(), cellCursor(), cellCursorSize(0),
+        displacement(), dataHash(0), frameId(0), outDataHash(0), bbox(), cbox() {
+
+    this->iterationsSlot.SetParameter(new core::param::IntParam(16, 0));
+    this->MakeSlotAvailable(&this->iterationsSlot);
+
+    this->relaxationFactorSlot.SetParameter(new core::param::FloatParam(0.5f, 0.0f, 1.0f));
+    this->MakeSlotAvailable(&this->relaxationFactorSlot);
+
+    this->toleranceSlot.SetParameter(new core::param::FloatParam(0.01f, 0.0f));
+    this->MakeSlotAvailable(&this->toleranceSlot);
+
+    this->timeBudgetSlot.SetParameter(new core::param::IntParam(0, 0));
+    this->MakeSlotAvailable(&this->timeBudgetSlot);
+
+    this->warmStartSlot.SetParameter(new core::param::BoolParam(true));
+    this->MakeSlotAvailable(&this->warmStartSlot);
+
+    for (int i = 0; i < 3; ++i) {
+        this->gridDim[i] = 0;
+        this->gridOrigin[i] = 0.0f;
+    }
 }
 
 
@@ -63,7 +96,17 @@ bool datatools::ParticleRelaxationModule::manipulateData(
         megamol::core::moldyn::MultiParticleDataCall& inData) {
     using megamol::core::moldyn::MultiParticleDataCall;
 
-    if ((this->frameId != inData.FrameID()) || (this->dataHash != inData.DataHash()) || (inData.DataHash() == 0)) {
+    bool paramsChanged = false;
+    for (core::param::ParamSlot *slot : {&this->iterationsSlot, &this->relaxationFactorSlot,
+            &this->toleranceSlot, &this->timeBudgetSlot, &this->warmStartSlot}) {
+        if (slot->IsDirty()) {
+            slot->ResetDirty();
+            paramsChanged = true;
+        }
+    }
+
+    if (paramsChanged || (this->frameId != inData.FrameID()) || (this->dataHash != inData.DataHash())
+            || (inData.DataHash() == 0)) {
         this->frameId = inData.FrameID();
         this->dataHash = inData.DataHash();
         this->outDataHash++;
@@ -110,15 +153,41 @@ bool datatools::ParticleRelaxationModule::manipulateData(
         }
 
         // now run relaxation code
+        vert = this->data.As<float>();
+        const int64_t n = static_cast<int64_t>(cnt);
+        if ((cnt > 0) && (this->iterationsSlot.Param<core::param::IntParam>()->Value() > 0)) {
+            // 'displacement' temporarily holds the unrelaxed positions
+            bool warmStart = this->warmStartSlot.Param<core::param::BoolParam>()->Value()
+                && (this->displacement.size() == static_cast<size_t>(cnt * 3));
+            this->displacement.resize(static_cast<size_t>(cnt * 3));
+            float *disp = this->displacement.data();
+#pragma omp parallel for
+            for (int64_t i = 0; i < n; ++i) {
+                for (int c = 0; c < 3; ++c) {
+                    const float p = vert[i * 4 + c];
+                    if (warmStart) vert[i * 4 + c] += disp[i * 3 + c];
+                    disp[i * 3 + c] = p;
+                }
+            }
 
-        // TODO: Implement!
+            this->relax(vert, cnt);
+
+#pragma omp parallel for
+            for (int64_t i = 0; i < n; ++i) {
+                for (int c = 0; c < 3; ++c) {
+                    disp[i * 3 + c] = vert[i * 4 + c] - disp[i * 3 + c];
+                }
+            }
+        } else {
+            this->displacement.clear();
+        }
 
         // finally compute new bounding boxes
         if (cnt > 0) {
-            float *vert = this->data.As<float>();
             this->bbox.Set(vert[0], vert[1], vert[2], vert[0], vert[1], vert[2]);
             float r = vert[3];
-            for (uint64_t pi = 1; pi < cnt; pi++, vert += 4) {
+            for (uint64_t pi = 1; pi < cnt; pi++) {
+                vert += 4;
                 this->bbox.GrowToPoint(vert[0], vert[1], vert[2]);
                 r = std::max<float>(r, vert[3]);
             }
@@ -151,3 +220,304 @@ bool datatools::ParticleRelaxationModule::manipulateData(
 
     return true;
 }
+
+
+/*
+ * datatools::ParticleRelaxationModule::buildGrid
+ */
+void datatools::ParticleRelaxationModule::buildGrid(const float *pos, uint32_t cnt, float cellSize) {
+    const int64_t n = static_cast<int64_t>(cnt);
+
+    float minP[3] = { pos[0], pos[1], pos[2] };
+    float maxP[3] = { pos[0], pos[1], pos[2] };
+#pragma omp parallel
+    {
+        float lMin[3] = { pos[0], pos[1], pos[2] };
+        float lMax[3] = { pos[0], pos[1], pos[2] };
+#pragma omp for
+        for (int64_t i = 0; i < n; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                lMin[c] = std::min(lMin[c], pos[i * 4 + c]);
+                lMax[c] = std::max(lMax[c], pos[i * 4 + c]);
+            }
+        }
+#pragma omp critical
+        {
+            for (int c = 0; c < 3; ++c) {
+                minP[c] = std::min(minP[c], lMin[c]);
+                maxP[c] = std::max(maxP[c], lMax[c]);
+            }
+        }
+    }
+
+    // Widely scattered particles would result in mostly empty cells, so the
+    // cells are enlarged until there are at most two per particle.
+    const double maxCells = 2.0 * static_cast<double>(cnt) + 1.0;
+    double cells;
+    while (true) {
+        cells = 1.0;
+        for (int c = 0; c < 3; ++c) {
+            double d = std::max(1.0, std::ceil(static_cast<double>(maxP[c] - minP[c]) / cellSize));
+            this->gridDim[c] = static_cast<uint32_t>(std::min(d, 1.0e6));
+            cells *= this->gridDim[c];
+        }
+        if (cells <= maxCells) break;
+        cellSize *= static_cast<float>(std::max(1.05, std::cbrt(cells / maxCells)));
+    }
+    for (int c = 0; c < 3; ++c) this->gridOrigin[c] = minP[c];
+    this->gridCellSize = cellSize;
+
+    const size_t cellCnt = static_cast<size_t>(cells);
+    const int64_t cellN = static_cast<int64_t>(cellCnt);
+    if (this->cellCursorSize < cellCnt) {
+        this->cellCursor.reset(new std::atomic<uint32_t>[cellCnt]);
+        this->cellCursorSize = cellCnt;
+    }
+    std::atomic<uint32_t> *cursor = this->cellCursor.get();
+    this->cellStart.resize(cellCnt + 1);
+    this->cellOf.resize(cnt);
+    this->order.resize(cnt);
+    this->sorted.resize(static_cast<size_t>(cnt) * 4);
+    this->sortedNext.resize(static_cast<size_t>(cnt) * 4);
+
+#pragma omp parallel for
+    for (int64_t c = 0; c < cellN; ++c) {
+        cursor[c].store(0, std::memory_order_relaxed);
+    }
+
+    // count the particles per cell
+    const uint32_t *dim = this->gridDim;
+    const float invSize = 1.0f / cellSize;
+#pragma omp parallel for
+    for (int64_t i = 0; i < n; ++i) {
+        uint32_t idx[3];
+        for (int c = 0; c < 3; ++c) {
+            const float f = (pos[i * 4 + c] - minP[c]) * invSize;
+            idx[c] = std::min(static_cast<uint32_t>(std::max(f, 0.0f)), dim[c] - 1);
+        }
+        const uint32_t cell = (idx[2] * dim[1] + idx[1]) * dim[0] + idx[0];
+        this->cellOf[i] = cell;
+        cursor[cell].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t sum = 0;
+    for (size_t c = 0; c < cellCnt; ++c) {
+        const uint32_t cc = cursor[c].load(std::memory_order_relaxed);
+        this->cellStart[c] = sum;
+        cursor[c].store(sum, std::memory_order_relaxed);
+        sum += cc;
+    }
+    this->cellStart[cellCnt] = sum;
+
+#pragma omp parallel for
+    for (int64_t i = 0; i < n; ++i) {
+        this->order[cursor[this->cellOf[i]].fetch_add(1, std::memory_order_relaxed)]
+            = static_cast<uint32_t>(i);
+    }
+
+    // The order within the cells depends on the scheduling of the threads,
+    // sorting it makes the result reproducible.
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int64_t c = 0; c < cellN; ++c) {
+        const uint32_t b = this->cellStart[c];
+        const uint32_t e = this->cellStart[c + 1];
+        if (e - b > 1) std::sort(this->order.begin() + b, this->order.begin() + e);
+    }
+
+    float *dst = this->sorted.data();
+#pragma omp parallel for
+    for (int64_t k = 0; k < n; ++k) {
+        ::memcpy(dst + k * 4, pos + static_cast<size_t>(this->order[k]) * 4, sizeof(float) * 4);
+    }
+}
+
+
+/*
+ * datatools::ParticleRelaxationModule::scatterSorted
+ */
+void datatools::ParticleRelaxationModule::scatterSorted(float *pos, int64_t cnt) const {
+    const float *src = this->sorted.data();
+#pragma omp parallel for
+    for (int64_t k = 0; k < cnt; ++k) {
+        const size_t i = this->order[k];
+        pos[i * 4 + 0] = src[k * 4 + 0];
+        pos[i * 4 + 1] = src[k * 4 + 1];
+        pos[i * 4 + 2] = src[k * 4 + 2];
+    }
+}
+
+
+/*
+ * datatools::ParticleRelaxationModule::relax
+ */
+void datatools::ParticleRelaxationModule::relax(float *pos, uint64_t cnt) {
+    using vislib::sys::Log;
+    typedef std::chrono::steady_clock Clock;
+
+    const int maxIterations = this->iterationsSlot.Param<core::param::IntParam>()->Value();
+    const float factor = this->relaxationFactorSlot.Param<core::param::FloatParam>()->Value();
+    const float tolerance = this->toleranceSlot.Param<core::param::FloatParam>()->Value();
+    const int timeBudget = this->timeBudgetSlot.Param<core::param::IntParam>()->Value();
+    const auto startTime = Clock::now();
+
+    if ((cnt == 0) || (maxIterations <= 0)) return;
+    if (cnt > static_cast<uint64_t>(std::numeric_limits<uint32_t>::max())) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_WARN,
+            "ParticleRelaxationModule: %llu particles are too many to be relaxed",
+            static_cast<unsigned long long>(cnt));
+        return;
+    }
+    const int64_t n = static_cast<int64_t>(cnt);
+
+    float maxRad = 0.0f;
+    double sumRad = 0.0;
+#pragma omp parallel
+    {
+        float lMax = 0.0f;
+#pragma omp for reduction(+ : sumRad)
+        for (int64_t i = 0; i < n; ++i) {
+            lMax = std::max(lMax, pos[i * 4 + 3]);
+            sumRad += pos[i * 4 + 3];
+        }
+#pragma omp critical
+        { maxRad = std::max(maxRad, lMax); }
+    }
+    if (maxRad <= 0.0f) return;
+    const float threshold = tolerance * static_cast<float>(sumRad / static_cast<double>(n));
+
+    // The particles stay in the order of the grid between the iterations.
+    // The grid is only rebuilt once they might have moved far enough for
+    // overlapping particles not to be in neighbouring cells any more, i.e.
+    // when their accumulated movement exceeds the part of the cells not
+    // needed for the largest particles.
+    bool hasGrid = false;
+    float skin = 0.0f;
+    float moved = 0.0f;
+    int iteration = 0;
+    float maxOverlap = 0.0f;
+    while (iteration < maxIterations) {
+        if (!hasGrid || (2.0f * moved >= skin)) {
+            if (hasGrid) this->scatterSorted(pos, n);
+            this->buildGrid(pos, static_cast<uint32_t>(cnt), 2.5f * maxRad);
+            hasGrid = true;
+            skin = this->gridCellSize - 2.0f * maxRad;
+            moved = 0.0f;
+        }
+        ++iteration;
+
+        const uint32_t *dim = this->gridDim;
+        const uint32_t *cellStart = this->cellStart.data();
+        const uint32_t *order = this->order.data();
+        const float *sp = this->sorted.data();
+        float *np = this->sortedNext.data();
+        const int64_t cellN = static_cast<int64_t>(this->cellStart.size() - 1);
+        maxOverlap = 0.0f;
+        float maxMove = 0.0f;
+
+        // Every particle reads the positions of the last step from 'sorted'
+        // and writes only its own position to 'sortedNext', hence no cell
+        // needs to wait for its neighbours.
+#pragma omp parallel
+        {
+            float lMaxOverlap = 0.0f;
+            float lMaxMove = 0.0f;
+#pragma omp for schedule(dynamic, 64)
+            for (int64_t cell = 0; cell < cellN; ++cell) {
+                const uint32_t b = cellStart[cell];
+                const uint32_t e = cellStart[cell + 1];
+                if (b == e) continue;
+                const int64_t cx = cell % dim[0];
+                const int64_t cy = (cell / dim[0]) % dim[1];
+                const int64_t cz = cell / (static_cast<int64_t>(dim[0]) * dim[1]);
+                const int64_t x0 = std::max<int64_t>(cx - 1, 0), x1 = std::min<int64_t>(cx + 1, dim[0] - 1);
+                const int64_t y0 = std::max<int64_t>(cy - 1, 0), y1 = std::min<int64_t>(cy + 1, dim[1] - 1);
+                const int64_t z0 = std::max<int64_t>(cz - 1, 0), z1 = std::min<int64_t>(cz + 1, dim[2] - 1);
+
+                for (size_t k = b; k < e; ++k) {
+                    const float px = sp[k * 4 + 0], py = sp[k * 4 + 1], pz = sp[k * 4 + 2], pr = sp[k * 4 + 3];
+                    const size_t pi = order[k];
+                    float dx = 0.0f, dy = 0.0f, dz = 0.0f;
+
+                    for (int64_t z = z0; z <= z1; ++z) {
+                        for (int64_t y = y0; y <= y1; ++y) {
+                            const int64_t row = (z * dim[1] + y) * dim[0];
+                            const uint32_t jb = cellStart[row + x0];
+                            const uint32_t je = cellStart[row + x1 + 1];
+                            for (size_t j = jb; j < je; ++j) {
+                                if (j == k) continue;
+                                float vx = px - sp[j * 4 + 0];
+                                float vy = py - sp[j * 4 + 1];
+                                float vz = pz - sp[j * 4 + 2];
+                                const float rs = pr + sp[j * 4 + 3];
+                                const float d2 = vx * vx + vy * vy + vz * vz;
+                                if (d2 >= rs * rs) continue;
+                                const float d = std::sqrt(d2);
+                                const float o = rs - d;
+                                lMaxOverlap = std::max(lMaxOverlap, o);
+                                if (d > 0.0f) {
+                                    const float s = 0.5f * o / d;
+                                    dx += vx * s;
+                                    dy += vy * s;
+                                    dz += vz * s;
+                                } else {
+                                    // Coincident particles are separated along a
+                                    // direction derived from both their indices,
+                                    // pointing the opposite way for each of them.
+                                    const size_t pj = order[j];
+                                    const uint32_t h = static_cast<uint32_t>((std::min(pi, pj) * 73856093u) ^ (std::max(pi, pj) * 19349663u));
+                                    vx = static_cast<float>(h & 0x3FF) - 511.5f;
+                                    vy = static_cast<float>((h >> 10) & 0x3FF) - 511.5f;
+                                    vz = static_cast<float>((h >> 20) & 0x3FF) - 511.5f;
+                                    const float s = ((pi < pj) ? 0.5f : -0.5f) * o
+                                        / std::sqrt(vx * vx + vy * vy + vz * vz);
+                                    dx += vx * s;
+                                    dy += vy * s;
+                                    dz += vz * s;
+                                }
+                            }
+                        }
+                    }
+
+                    // Particles squeezed from many sides must not jump past
+                    // their neighbours.
+                    dx *= factor;
+                    dy *= factor;
+                    dz *= factor;
+                    float len = std::sqrt(dx * dx + dy * dy + dz * dz);
+                    if (len > pr) {
+                        const float s = pr / len;
+                        dx *= s;
+                        dy *= s;
+                        dz *= s;
+                        len = pr;
+                    }
+                    lMaxMove = std::max(lMaxMove, len);
+                    np[k * 4 + 0] = px + dx;
+                    np[k * 4 + 1] = py + dy;
+                    np[k * 4 + 2] = pz + dz;
+                    np[k * 4 + 3] = pr;
+                }
+            }
+#pragma omp critical
+            {
+                maxOverlap = std::max(maxOverlap, lMaxOverlap);
+                maxMove = std::max(maxMove, lMaxMove);
+            }
+        }
+        this->sorted.swap(this->sortedNext);
+        moved += maxMove;
+
+        if (maxOverlap <= threshold) break;
+        if ((timeBudget > 0)
+                && (std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTime).count()
+                    >= timeBudget)) {
+            break;
+        }
+    }
+
+    if (hasGrid) this->scatterSorted(pos, n);
+
+    Log::DefaultLog.WriteMsg(Log::LEVEL_INFO + 1000,
+        "ParticleRelaxationModule: %d iterations, largest overlap %f before the last one",
+        iteration, maxOverlap);
+}
@@ -13,6 +13,10 @@
 
 #include "mmstd_datatools/AbstractParticleManipulator.h"
 #include "mmcore/param/ParamSlot.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 
 namespace megamol {
@@ -20,7 +24,22 @@ namespace stdplugin {
 namespace datatools {
 
     /**
-     * Module overriding global attributes of particles
+     * Module moving particles apart until their spheres do not overlap any
+     * more.
+     *
+     * The relaxation is iterative. The particles are sorted into a uniform
+     * grid with cells slightly larger than the largest particle diameter.
+     * Each iteration pushes every particle away from all overlapping
+     * neighbours in the surrounding 27 cells. All particles are updated at
+     * once from the positions of the previous iteration, such that the cells
+     * can be processed in parallel without synchronisation. The grid is only
+     * rebuilt after the particles moved by more than the slack of the cells.
+     * The relaxation stops once the largest overlap is below the tolerance or
+     * the budget of iterations or time is used up.
+     *
+     * If the number of particles does not change, the displacements of the
+     * previous frame are applied before the first iteration, which usually
+     * leaves little to do for time-coherent data.
      */
     class ParticleRelaxationModule : public AbstractParticleManipulator {
     public:
@@ -74,6 +93,80 @@ namespace datatools {
 
     private:
 
+        /**
+         * Sorts the particles into the grid 'cellStart'/'order' with cells of
+         * at least the given size.
+         *
+         * @param pos      The particles as x, y, z, r.
+         * @param cnt      The number of particles.
+         * @param cellSize The minimum edge length of the cells.
+         */
+        void buildGrid(const float *pos, uint32_t cnt, float cellSize);
+
+        /**
+         * Copies the positions from 'sorted' back to the particles.
+         *
+         * @param pos The particles as x, y, z, r.
+         * @param cnt The number of particles.
+         */
+        void scatterSorted(float *pos, int64_t cnt) const;
+
+        /**
+         * Runs the relaxation on the given particles.
+         *
+         * @param pos The particles as x, y, z, r, which are moved in place.
+         * @param cnt The number of particles.
+         */
+        void relax(float *pos, uint64_t cnt);
+
+        /** The maximum number of iterations per frame */
+        core::param::ParamSlot iterationsSlot;
+
+        /** The fraction of the overlap removed per iteration */
+        core::param::ParamSlot relaxationFactorSlot;
+
+        /** The remaining overlap relative to the mean radius that is accepted */
+        core::param::ParamSlot toleranceSlot;
+
+        /** The maximum time per frame in milliseconds */
+        core::param::ParamSlot timeBudgetSlot;
+
+        /** Flag whether to start from the displacements of the last frame */
+        core::param::ParamSlot warmStartSlot;
+
+        /** The first sorted particle of each cell, followed by the end */
+        std::vector<uint32_t> cellStart;
+
+        /** The number of cells of the grid in x, y and z */
+        uint32_t gridDim[3];
+
+        /** The origin of the grid */
+        float gridOrigin[3];
+
+        /** The edge length of the grid cells */
+        float gridCellSize;
+
+        /** The cell of each particle */
+        std::vector<uint32_t> cellOf;
+
+        /** The particles sorted by their cells */
+        std::vector<uint32_t> order;
+
+        /** The positions and radii of the particles in the order of 'order' */
+        std::vector<float> sorted;
+
+        /** The positions resulting from the current iteration */
+        std::vector<float> sortedNext;
+
+        /** The insertion position into each cell while sorting */
+        std::unique_ptr<std::atomic<uint32_t>[]> cellCursor;
+
+        /** The number of elements of 'cellCursor' */
+        size_t cellCursorSize;
+
+        /** The displacements of the particles by the last relaxation */
+        std::vector<float> displacement;
+
         /** The hash id of the data stored */
         size_t dataHash;
 
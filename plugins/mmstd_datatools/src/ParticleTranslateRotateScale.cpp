@@ -184,16 +184,15 @@ bool datatools::ParticleTranslateRotateScale::manipulateData(
         }
 
         auto const& parStore = p.GetParticleStore();
-        auto const& xAcc = parStore.GetXAcc();
-        auto const& yAcc = parStore.GetYAcc();
-        auto const& zAcc = parStore.GetZAcc();
+        std::vector<float> xs(cnt), ys(cnt), zs(cnt);
+        parStore.GetVertexData<float>(0, cnt, xs.data(), ys.data(), zs.data());
 
         finalData[i] = new float[cnt * 7];
         for (size_t loop = 0; loop < cnt; loop++) {
 
-            pos.SetX(xAcc->Get_f(loop));
-            pos.SetY(yAcc->Get_f(loop));
-            pos.SetZ(zAcc->Get_f(loop));
+            pos.SetX(xs[loop]);
+            pos.SetY(ys[loop]);
+            pos.SetZ(zs[loop]);
             pos.SetW(1.0f);
 
             pos = totMX * pos;
@@ -234,12 +233,9 @@ void datatools::ParticleTranslateRotateScale::colorTransferGray(core::moldyn::Mu
     float const* transferTable, unsigned int tableSize, std::vector<float>& rgbaArray) {
 
     auto const& parStore = p.GetParticleStore();
-    auto const& iAcc = parStore.GetCRAcc();
 
     std::vector<float> grayArray(p.GetCount());
-    for (size_t i = 0; i < p.GetCount(); i++) {
-        grayArray[i] = iAcc->Get_f(i);
-    }
+    parStore.GetColourData<float>(0, grayArray.size(), grayArray.data());
     
     float gray_max = *std::max_element(grayArray.begin(), grayArray.end());
     float gray_min = *std::min_element(grayArray.begin(), grayArray.end());
@@ -39,6 +39,8 @@
 #include "OverrideMultiParticleListGlobalColors.h"
 #include "OverrideParticleBBox.h"
 #include "OverrideParticleGlobals.h"
+#include "ParticleBenchmarkJob.h"
+#include "ParticleBenchmarkProbe.h"
 #include "ParticleBoxFilter.h"
 #include "ParticleBoxGeneratorDataSource.h"
 #include "ParticleColorChannelSelect.h"
@@ -237,6 +239,8 @@ public:
         this->module_descriptions.RegisterAutoDescription<megamol::stdplugin::datatools::SyncedMMPLDProvider>();
         this->module_descriptions.RegisterAutoDescription<megamol::stdplugin::datatools::table::TableManipulator>();
         this->module_descriptions.RegisterAutoDescription<megamol::stdplugin::datatools::io::CPERAWDataSource>();
+        this->module_descriptions.RegisterAutoDescription<megamol::stdplugin::datatools::ParticleBenchmarkJob>();
+        this->module_descriptions.RegisterAutoDescription<megamol::stdplugin::datatools::ParticleBenchmarkProbe>();
 
         // register calls here:
         this->call_descriptions.RegisterAutoDescription<megamol::stdplugin::datatools::table::TableDataCall>();
@@ -0,0 +1,845 @@
+/*
+ * TableExpression.cpp
+ *
+ * Copyright (C) 2020 by VISUS (University of Stuttgart)
+ * Alle Rechte vorbehalten.
+ */
+
+#include "stdafx.h"
+#include "TableExpression.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+using namespace megamol::stdplugin::datatools::table;
+
+const size_t TableExpression::BlockSize = 1024;
+
+namespace {
+
+template <class F> inline void unary(float* out, const float* a, const size_t n, F f) {
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i) out[i] = f(a[i]);
+}
+
+template <class F> inline void binary(float* out, const float* a, const float* b, const size_t n, F f) {
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i) out[i] = f(a[i], b[i]);
+}
+
+template <class F> inline void ternary(float* out, const float* a, const float* b, const float* c, const size_t n, F f) {
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i) out[i] = f(a[i], b[i], c[i]);
+}
+
+inline float toBool(const bool b) { return b ? 1.0f : 0.0f; }
+
+} // namespace
+
+
+/*
+ * TableExpression::Program
+ */
+struct TableExpression::Program {
+
+    /** The operations of a compiled expression. */
+    enum class Op {
+        CONSTANT, COLUMN, ROW, ROWS, AGGREGATE,
+        NEG, NOT, ABS, SQRT, EXP, LOG, LOG10, SIN, COS, TAN, ASIN, ACOS, ATAN, FLOOR, CEIL, ROUND,
+        ADD, SUB, MUL, DIV, MOD, POW, ATAN2, MIN, MAX,
+        LT, LE, GT, GE, EQ, NE, AND, OR,
+        SELECT, CLAMP
+    };
+
+    /** The kinds of aggregates over all rows. */
+    enum class AggregateKind { SUM, MEAN, MIN, MAX, STD };
+
+    /**
+     * A single operation. The result of the i-th instruction of a program is
+     * stored in the i-th register.
+     */
+    struct Instruction {
+        Op op;
+        uint32_t args[3];
+        float value;
+        size_t index;
+    };
+
+    /** The table an expression is evaluated on. */
+    struct Table {
+        const float* data;
+        size_t rows;
+        size_t columns;
+    };
+
+    /** An aggregate over the results of another program. */
+    struct Aggregate {
+        AggregateKind kind;
+        std::unique_ptr<Program> argument;
+    };
+
+    /**
+     * Compute the values of all aggregates used by the program.
+     *
+     * @param table The table to compute the aggregates for.
+     *
+     * @return The values of the aggregates.
+     */
+    std::vector<float> ComputeAggregates(const Table& table) const;
+
+    /**
+     * Fill the registers that are the same for all blocks.
+     *
+     * @param regs       The registers of the calling thread.
+     * @param aggregates The values of the aggregates.
+     * @param rows       The number of rows of the table.
+     */
+    void InitRegisters(float* regs, const std::vector<float>& aggregates, const size_t rows) const;
+
+    /**
+     * Run the program for a block of rows.
+     *
+     * @param regs  The registers of the calling thread.
+     * @param table The table.
+     * @param first The first row of the block.
+     * @param count The number of rows in the block.
+     *
+     * @return The register holding the results.
+     */
+    const float* RunBlock(float* regs, const Table& table, const size_t first, const size_t count) const;
+
+    /** The instructions. */
+    std::vector<Instruction> code;
+
+    /** The aggregates referenced by AGGREGATE instructions. */
+    std::vector<Aggregate> aggregates;
+
+    /** The register holding the result. */
+    uint32_t result = 0;
+
+    /** The type of the result. */
+    ValueType type = ValueType::NUMBER;
+};
+
+
+/*
+ * TableExpression::Program::ComputeAggregates
+ */
+std::vector<float> TableExpression::Program::ComputeAggregates(const Table& table) const {
+    std::vector<float> retval(this->aggregates.size());
+    const auto blocks = static_cast<int64_t>((table.rows + BlockSize - 1) / BlockSize);
+
+    for (size_t a = 0; a < this->aggregates.size(); ++a) {
+        const auto& prog = *this->aggregates[a].argument;
+        const auto inner = prog.ComputeAggregates(table);
+        double sum = 0.0;
+        double sumSq = 0.0;
+        float minVal = std::numeric_limits<float>::max();
+        float maxVal = std::numeric_limits<float>::lowest();
+
+#pragma omp parallel
+        {
+            std::vector<float> regs(prog.code.size() * BlockSize);
+            prog.InitRegisters(regs.data(), inner, table.rows);
+            double lsum = 0.0;
+            double lsumSq = 0.0;
+            float lmin = std::numeric_limits<float>::max();
+            float lmax = std::numeric_limits<float>::lowest();
+
+#pragma omp for schedule(static)
+            for (int64_t b = 0; b < blocks; ++b) {
+                const size_t first = static_cast<size_t>(b) * BlockSize;
+                const size_t count = (std::min)(BlockSize, table.rows - first);
+                const float* r = prog.RunBlock(regs.data(), table, first, count);
+                for (size_t i = 0; i < count; ++i) {
+                    lsum += r[i];
+                    lsumSq += static_cast<double>(r[i]) * r[i];
+                    lmin = (std::min)(lmin, r[i]);
+                    lmax = (std::max)(lmax, r[i]);
+                }
+            }
+
+#pragma omp critical
+            {
+                sum += lsum;
+                sumSq += lsumSq;
+                minVal = (std::min)(minVal, lmin);
+                maxVal = (std::max)(maxVal, lmax);
+            }
+        }
+
+        const double n = static_cast<double>(table.rows);
+        const double mean = (table.rows > 0) ? sum / n : std::numeric_limits<double>::quiet_NaN();
+        switch (this->aggregates[a].kind) {
+        case AggregateKind::SUM: retval[a] = static_cast<float>(sum); break;
+        case AggregateKind::MEAN: retval[a] = static_cast<float>(mean); break;
+        case AggregateKind::MIN: retval[a] = minVal; break;
+        case AggregateKind::MAX: retval[a] = maxVal; break;
+        case AggregateKind::STD:
+            retval[a] = static_cast<float>(std::sqrt((std::max)(0.0, sumSq / n - mean * mean)));
+            break;
+        }
+    }
+
+    return retval;
+}
+
+
+/*
+ * TableExpression::Program::InitRegisters
+ */
+void TableExpression::Program::InitRegisters(
+    float* regs, const std::vector<float>& aggregates, const size_t rows) const {
+    for (size_t i = 0; i < this->code.size(); ++i) {
+        const auto& in = this->code[i];
+        float* o = regs + i * BlockSize;
+        switch (in.op) {
+        case Op::CONSTANT: std::fill(o, o + BlockSize, in.value); break;
+        case Op::ROWS: std::fill(o, o + BlockSize, static_cast<float>(rows)); break;
+        case Op::AGGREGATE: std::fill(o, o + BlockSize, aggregates[in.index]); break;
+        default: break;
+        }
+    }
+}
+
+
+/*
+ * TableExpression::Program::RunBlock
+ */
+const float* TableExpression::Program::RunBlock(
+    float* regs, const Table& table, const size_t first, const size_t count) const {
+    const size_t n = count;
+
+    for (size_t i = 0; i < this->code.size(); ++i) {
+        const auto& in = this->code[i];
+        float* o = regs + i * BlockSize;
+        const float* a = regs + in.args[0] * BlockSize;
+        const float* b = regs + in.args[1] * BlockSize;
+        const float* c = regs + in.args[2] * BlockSize;
+
+        switch (in.op) {
+        case Op::CONSTANT:
+        case Op::ROWS:
+        case Op::AGGREGATE:
+            /* Filled by InitRegisters. */
+            break;
+
+        case Op::COLUMN: {
+            const float* src = table.data + first * table.columns + in.index;
+            const size_t stride = table.columns;
+            for (size_t j = 0; j < n; ++j) o[j] = src[j * stride];
+        } break;
+        case Op::ROW:
+            for (size_t j = 0; j < n; ++j) o[j] = static_cast<float>(first + j);
+            break;
+
+        case Op::NEG: unary(o, a, n, [](float x) { return -x; }); break;
+        case Op::NOT: unary(o, a, n, [](float x) { return toBool(x == 0.0f); }); break;
+        case Op::ABS: unary(o, a, n, [](float x) { return std::fabs(x); }); break;
+        case Op::SQRT: unary(o, a, n, [](float x) { return std::sqrt(x); }); break;
+        case Op::EXP: unary(o, a, n, [](float x) { return std::exp(x); }); break;
+        case Op::LOG: unary(o, a, n, [](float x) { return std::log(x); }); break;
+        case Op::LOG10: unary(o, a, n, [](float x) { return std::log10(x); }); break;
+        case Op::SIN: unary(o, a, n, [](float x) { return std::sin(x); }); break;
+        case Op::COS: unary(o, a, n, [](float x) { return std::cos(x); }); break;
+        case Op::TAN: unary(o, a, n, [](float x) { return std::tan(x); }); break;
+        case Op::ASIN: unary(o, a, n, [](float x) { return std::asin(x); }); break;
+        case Op::ACOS: unary(o, a, n, [](float x) { return std::acos(x); }); break;
+        case Op::ATAN: unary(o, a, n, [](float x) { return std::atan(x); }); break;
+        case Op::FLOOR: unary(o, a, n, [](float x) { return std::floor(x); }); break;
+        case Op::CEIL: unary(o, a, n, [](float x) { return std::ceil(x); }); break;
+        case Op::ROUND: unary(o, a, n, [](float x) { return std::round(x); }); break;
+
+        case Op::ADD: binary(o, a, b, n, [](float x, float y) { return x + y; }); break;
+        case Op::SUB: binary(o, a, b, n, [](float x, float y) { return x - y; }); break;
+        case Op::MUL: binary(o, a, b, n, [](float x, float y) { return x * y; }); break;
+        case Op::DIV: binary(o, a, b, n, [](float x, float y) { return x / y; }); break;
+        case Op::MOD: binary(o, a, b, n, [](float x, float y) { return std::fmod(x, y); }); break;
+        case Op::POW: binary(o, a, b, n, [](float x, float y) { return std::pow(x, y); }); break;
+        case Op::ATAN2: binary(o, a, b, n, [](float x, float y) { return std::atan2(x, y); }); break;
+        case Op::MIN: binary(o, a, b, n, [](float x, float y) { return (y < x) ? y : x; }); break;
+        case Op::MAX: binary(o, a, b, n, [](float x, float y) { return (x < y) ? y : x; }); break;
+
+        case Op::LT: binary(o, a, b, n, [](float x, float y) { return toBool(x < y); }); break;
+        case Op::LE: binary(o, a, b, n, [](float x, float y) { return toBool(x <= y); }); break;
+        case Op::GT: binary(o, a, b, n, [](float x, float y) { return toBool(x > y); }); break;
+        case Op::GE: binary(o, a, b, n, [](float x, float y) { return toBool(x >= y); }); break;
+        case Op::EQ: binary(o, a, b, n, [](float x, float y) { return toBool(x == y); }); break;
+        case Op::NE: binary(o, a, b, n, [](float x, float y) { return toBool(x != y); }); break;
+        case Op::AND:
+            binary(o, a, b, n, [](float x, float y) { return toBool((x != 0.0f) && (y != 0.0f)); });
+            break;
+        case Op::OR:
+            binary(o, a, b, n, [](float x, float y) { return toBool((x != 0.0f) || (y != 0.0f)); });
+            break;
+
+        case Op::SELECT:
+            ternary(o, a, b, c, n, [](float x, float y, float z) { return (x != 0.0f) ? y : z; });
+            break;
+        case Op::CLAMP:
+            ternary(o, a, b, c, n, [](float x, float lo, float hi) { return (x < lo) ? lo : ((hi < x) ? hi : x); });
+            break;
+        }
+    }
+
+    return regs + this->result * BlockSize;
+}
+
+
+/*
+ * TableExpression::Parser
+ */
+class TableExpression::Parser {
+public:
+    typedef Program::AggregateKind AggregateKind;
+    typedef Program::Instruction Instruction;
+    typedef Program::Op Op;
+
+    Parser(const std::string& source, const TableDataCall::ColumnInfo* columns, const size_t columnCount)
+        : source(source), pos(0), columns(columns), columnCount(columnCount), program(nullptr) {}
+
+    /**
+     * Parse the whole source.
+     *
+     * @return The compiled program.
+     *
+     * @throws std::runtime_error If the source is not a valid expression.
+     */
+    std::unique_ptr<Program> Parse(void) {
+        std::unique_ptr<Program> retval(new Program());
+        this->program = retval.get();
+        const auto v = this->parseConditional();
+        this->skipSpace();
+        if (this->pos < this->source.size()) {
+            this->fail("unexpected '" + this->source.substr(this->pos, 1) + "'");
+        }
+        retval->result = v.reg;
+        retval->type = v.type;
+        return retval;
+    }
+
+private:
+    /** A value in a register. */
+    struct Value {
+        uint32_t reg;
+        ValueType type;
+    };
+
+    bool accept(const char* token) {
+        this->skipSpace();
+        const size_t len = ::strlen(token);
+        if (this->source.compare(this->pos, len, token) == 0) {
+            this->pos += len;
+            return true;
+        }
+        return false;
+    }
+
+    Value emit(const Op op, const ValueType type, const Value a = {0, ValueType::NUMBER},
+        const Value b = {0, ValueType::NUMBER}, const Value c = {0, ValueType::NUMBER}) {
+        Instruction in;
+        in.op = op;
+        in.args[0] = a.reg;
+        in.args[1] = b.reg;
+        in.args[2] = c.reg;
+        in.value = 0.0f;
+        in.index = 0;
+        this->fold(in);
+        this->program->code.push_back(in);
+        return Value{static_cast<uint32_t>(this->program->code.size() - 1), type};
+    }
+
+    Value emitConstant(const float value, const ValueType type) {
+        auto retval = this->emit(Op::CONSTANT, type);
+        this->program->code.back().value = value;
+        return retval;
+    }
+
+    Value emitColumn(const size_t column) {
+        auto it = this->columnRegs.find(std::make_pair(this->program, column));
+        if (it != this->columnRegs.end()) return Value{it->second, ValueType::NUMBER};
+        auto retval = this->emit(Op::COLUMN, ValueType::NUMBER);
+        this->program->code.back().index = column;
+        this->columnRegs[std::make_pair(this->program, column)] = retval.reg;
+        return retval;
+    }
+
+    void expect(const char* token) {
+        if (!this->accept(token)) this->fail(std::string("expected '") + token + "'");
+    }
+
+    void fail(const std::string& msg) const {
+        throw std::runtime_error(msg + " at position " + std::to_string(this->pos + 1));
+    }
+
+    /**
+     * Replace an operation whose operands are all constant by its result.
+     *
+     * @param in The instruction, which is changed into a CONSTANT if
+     *           possible.
+     */
+    void fold(Instruction& in) const {
+        size_t arity = 0;
+        if ((in.op >= Op::NEG) && (in.op <= Op::ROUND)) {
+            arity = 1;
+        } else if ((in.op >= Op::ADD) && (in.op <= Op::OR)) {
+            arity = 2;
+        } else if ((in.op == Op::SELECT) || (in.op == Op::CLAMP)) {
+            arity = 3;
+        } else {
+            return;
+        }
+
+        for (size_t i = 0; i < arity; ++i) {
+            if (this->program->code[in.args[i]].op != Op::CONSTANT) return;
+        }
+
+        /* Only remap the operands once 'in' is known to be folded. */
+        Program tmp;
+        for (size_t i = 0; i < arity; ++i) {
+            tmp.code.push_back(this->program->code[in.args[i]]);
+            in.args[i] = static_cast<uint32_t>(i);
+        }
+        tmp.code.push_back(in);
+        tmp.result = static_cast<uint32_t>(arity);
+
+        std::vector<float> regs(tmp.code.size() * BlockSize);
+        tmp.InitRegisters(regs.data(), std::vector<float>(), 0);
+        const float value = *tmp.RunBlock(regs.data(), Program::Table{nullptr, 0, 0}, 0, 1);
+
+        in.op = Op::CONSTANT;
+        in.args[0] = in.args[1] = in.args[2] = 0;
+        in.value = value;
+    }
+
+    bool isIdentStart(const char c) const { return (std::isalpha(static_cast<unsigned char>(c)) != 0) || (c == '_'); }
+
+    bool isIdentPart(const char c) const {
+        return (std::isalnum(static_cast<unsigned char>(c)) != 0) || (c == '_') || (c == '.');
+    }
+
+    Value parseConditional(void) {
+        auto cond = this->parseOr();
+        if (this->accept("?")) {
+            this->require(cond, ValueType::BOOLEAN, "the condition of '?'");
+            auto a = this->parseConditional();
+            this->expect(":");
+            auto b = this->parseConditional();
+            if (a.type != b.type) this->fail("both alternatives of '?' must have the same type");
+            return this->emit(Op::SELECT, a.type, cond, a, b);
+        }
+        return cond;
+    }
+
+    Value parseOr(void) {
+        auto l = this->parseAnd();
+        while (this->accept("||")) {
+            auto r = this->parseAnd();
+            this->require(l, ValueType::BOOLEAN, "'||'");
+            this->require(r, ValueType::BOOLEAN, "'||'");
+            l = this->emit(Op::OR, ValueType::BOOLEAN, l, r);
+        }
+        return l;
+    }
+
+    Value parseAnd(void) {
+        auto l = this->parseComparison();
+        while (this->accept("&&")) {
+            auto r = this->parseComparison();
+            this->require(l, ValueType::BOOLEAN, "'&&'");
+            this->require(r, ValueType::BOOLEAN, "'&&'");
+            l = this->emit(Op::AND, ValueType::BOOLEAN, l, r);
+        }
+        return l;
+    }
+
+    Value parseComparison(void) {
+        static const struct {
+            const char* token;
+            Op op;
+        } ops[] = {{"<=", Op::LE}, {">=", Op::GE}, {"==", Op::EQ}, {"!=", Op::NE}, {"<", Op::LT}, {">", Op::GT}};
+        auto l = this->parseSum();
+        for (const auto& o : ops) {
+            if (this->accept(o.token)) {
+                auto r = this->parseSum();
+                if ((o.op == Op::EQ) || (o.op == Op::NE)) {
+                    if (l.type != r.type) this->fail(std::string("the operands of '") + o.token + "' differ in type");
+                } else {
+                    this->require(l, ValueType::NUMBER, o.token);
+                    this->require(r, ValueType::NUMBER, o.token);
+                }
+                return this->emit(o.op, ValueType::BOOLEAN, l, r);
+            }
+        }
+        return l;
+    }
+
+    Value parseSum(void) {
+        auto l = this->parseProduct();
+        while (true) {
+            Op op;
+            if (this->accept("+")) {
+                op = Op::ADD;
+            } else if (this->accept("-")) {
+                op = Op::SUB;
+            } else {
+                return l;
+            }
+            auto r = this->parseProduct();
+            this->require(l, ValueType::NUMBER, (op == Op::ADD) ? "'+'" : "'-'");
+            this->require(r, ValueType::NUMBER, (op == Op::ADD) ? "'+'" : "'-'");
+            l = this->emit(op, ValueType::NUMBER, l, r);
+        }
+    }
+
+    Value parseProduct(void) {
+        auto l = this->parseUnary();
+        while (true) {
+            Op op;
+            if (this->accept("*")) {
+                op = Op::MUL;
+            } else if (this->accept("/")) {
+                op = Op::DIV;
+            } else if (this->accept("%")) {
+                op = Op::MOD;
+            } else {
+                return l;
+            }
+            auto r = this->parseUnary();
+            this->require(l, ValueType::NUMBER, "arithmetic");
+            this->require(r, ValueType::NUMBER, "arithmetic");
+            l = this->emit(op, ValueType::NUMBER, l, r);
+        }
+    }
+
+    Value parseUnary(void) {
+        if (this->accept("-")) {
+            auto v = this->parseUnary();
+            this->require(v, ValueType::NUMBER, "'-'");
+            return this->emit(Op::NEG, ValueType::NUMBER, v);
+        }
+        if (this->accept("!")) {
+            auto v = this->parseUnary();
+            this->require(v, ValueType::BOOLEAN, "'!'");
+            return this->emit(Op::NOT, ValueType::BOOLEAN, v);
+        }
+        return this->parsePower();
+    }
+
+    Value parsePower(void) {
+        auto l = this->parseAtom();
+        if (this->accept("^")) {
+            auto r = this->parseUnary();
+            this->require(l, ValueType::NUMBER, "'^'");
+            this->require(r, ValueType::NUMBER, "'^'");
+            return this->emit(Op::POW, ValueType::NUMBER, l, r);
+        }
+        return l;
+    }
+
+    Value parseAtom(void) {
+        this->skipSpace();
+        if (this->pos >= this->source.size()) this->fail("unexpected end of expression");
+
+        const char c = this->source[this->pos];
+        if (this->accept("(")) {
+            auto v = this->parseConditional();
+            this->expect(")");
+            return v;
+        }
+
+        if ((std::isdigit(static_cast<unsigned char>(c)) != 0) || (c == '.')) {
+            const char* begin = this->source.c_str() + this->pos;
+            char* end = nullptr;
+            const double value = std::strtod(begin, &end);
+            if (end == begin) this->fail("invalid number");
+            this->pos += end - begin;
+            return this->emitConstant(static_cast<float>(value), ValueType::NUMBER);
+        }
+
+        if (c == '"') {
+            const auto end = this->source.find('"', this->pos + 1);
+            if (end == std::string::npos) this->fail("unterminated column name");
+            const auto name = this->source.substr(this->pos + 1, end - this->pos - 1);
+            this->pos = end + 1;
+            return this->emitColumn(this->findColumn(name));
+        }
+
+        if (c == '$') {
+            ++this->pos;
+            const char* begin = this->source.c_str() + this->pos;
+            char* end = nullptr;
+            const auto idx = std::strtoul(begin, &end, 10);
+            if (end == begin) this->fail("expected a column index");
+            if (idx >= this->columnCount) this->fail("column index " + std::to_string(idx) + " out of range");
+            this->pos += end - begin;
+            return this->emitColumn(idx);
+        }
+
+        if (this->isIdentStart(c)) {
+            const size_t begin = this->pos;
+            while ((this->pos < this->source.size()) && this->isIdentPart(this->source[this->pos])) ++this->pos;
+            const auto name = this->source.substr(begin, this->pos - begin);
+
+            if (this->accept("(")) {
+                return this->parseCall(name);
+            }
+            if (name == "true") return this->emitConstant(1.0f, ValueType::BOOLEAN);
+            if (name == "false") return this->emitConstant(0.0f, ValueType::BOOLEAN);
+            if (name == "pi") return this->emitConstant(3.14159265358979323846f, ValueType::NUMBER);
+            if (name == "row") return this->emit(Op::ROW, ValueType::NUMBER);
+            if (name == "rows") return this->emit(Op::ROWS, ValueType::NUMBER);
+            return this->emitColumn(this->findColumn(name));
+        }
+
+        this->fail("unexpected '" + std::string(1, c) + "'");
+        return Value{0, ValueType::NUMBER};
+    }
+
+    Value parseCall(const std::string& name) {
+        static const std::unordered_map<std::string, Op> unaryFuncs = {{"abs", Op::ABS}, {"sqrt", Op::SQRT},
+            {"exp", Op::EXP}, {"log", Op::LOG}, {"log10", Op::LOG10}, {"sin", Op::SIN}, {"cos", Op::COS},
+            {"tan", Op::TAN}, {"asin", Op::ASIN}, {"acos", Op::ACOS}, {"atan", Op::ATAN}, {"floor", Op::FLOOR},
+            {"ceil", Op::CEIL}, {"round", Op::ROUND}};
+        static const std::unordered_map<std::string, Op> binaryFuncs = {
+            {"atan2", Op::ATAN2}, {"pow", Op::POW}, {"min", Op::MIN}, {"max", Op::MAX}};
+        static const std::unordered_map<std::string, AggregateKind> aggregateFuncs = {{"colsum", AggregateKind::SUM},
+            {"colmean", AggregateKind::MEAN}, {"colmin", AggregateKind::MIN}, {"colmax", AggregateKind::MAX},
+            {"colstd", AggregateKind::STD}};
+
+        auto ui = unaryFuncs.find(name);
+        if (ui != unaryFuncs.end()) {
+            auto a = this->parseConditional();
+            this->expect(")");
+            this->require(a, ValueType::NUMBER, name.c_str());
+            return this->emit(ui->second, ValueType::NUMBER, a);
+        }
+
+        auto bi = binaryFuncs.find(name);
+        if (bi != binaryFuncs.end()) {
+            auto a = this->parseConditional();
+            this->expect(",");
+            auto b = this->parseConditional();
+            this->expect(")");
+            this->require(a, ValueType::NUMBER, name.c_str());
+            this->require(b, ValueType::NUMBER, name.c_str());
+            return this->emit(bi->second, ValueType::NUMBER, a, b);
+        }
+
+        if (name == "clamp") {
+            auto x = this->parseConditional();
+            this->expect(",");
+            auto lo = this->parseConditional();
+            this->expect(",");
+            auto hi = this->parseConditional();
+            this->expect(")");
+            this->require(x, ValueType::NUMBER, "clamp");
+            this->require(lo, ValueType::NUMBER, "clamp");
+            this->require(hi, ValueType::NUMBER, "clamp");
+            return this->emit(Op::CLAMP, ValueType::NUMBER, x, lo, hi);
+        }
+
+        if (name == "if") {
+            auto cond = this->parseConditional();
+            this->expect(",");
+            auto a = this->parseConditional();
+            this->expect(",");
+            auto b = this->parseConditional();
+            this->expect(")");
+            this->require(cond, ValueType::BOOLEAN, "the condition of 'if'");
+            if (a.type != b.type) this->fail("both alternatives of 'if' must have the same type");
+            return this->emit(Op::SELECT, a.type, cond, a, b);
+        }
+
+        auto ai = aggregateFuncs.find(name);
+        if (ai != aggregateFuncs.end()) {
+            // The argument is compiled into a program of its own, which is
+            // evaluated over all rows before the enclosing one.
+            std::unique_ptr<Program> argument(new Program());
+            auto outer = this->program;
+            this->program = argument.get();
+            auto a = this->parseConditional();
+            this->expect(")");
+            argument->result = a.reg;
+            argument->type = a.type;
+            this->program = outer;
+
+            this->program->aggregates.push_back(Program::Aggregate{ai->second, std::move(argument)});
+            auto retval = this->emit(Op::AGGREGATE, ValueType::NUMBER);
+            this->program->code.back().index = this->program->aggregates.size() - 1;
+            return retval;
+        }
+
+        this->fail("unknown function '" + name + "'");
+        return Value{0, ValueType::NUMBER};
+    }
+
+    size_t findColumn(const std::string& name) const {
+        for (size_t i = 0; i < this->columnCount; ++i) {
+            if (this->columns[i].Name() == name) return i;
+        }
+        this->fail("unknown column '" + name + "'");
+        return 0;
+    }
+
+    void require(const Value& v, const ValueType type, const char* what) const {
+        if (v.type != type) {
+            this->fail(std::string(what) + " requires " + ((type == ValueType::NUMBER) ? "numbers" : "booleans"));
+        }
+    }
+
+    void skipSpace(void) {
+        while ((this->pos < this->source.size()) && (std::isspace(static_cast<unsigned char>(this->source[this->pos])) != 0)) {
+            ++this->pos;
+        }
+    }
+
+    /** Hashes the key of 'columnRegs'. */
+    struct ColumnKeyHash {
+        size_t operator()(const std::pair<Program*, size_t>& k) const {
+            return std::hash<Program*>()(k.first) ^ (std::hash<size_t>()(k.second) << 1);
+        }
+    };
+
+    const std::string& source;
+    size_t pos;
+    const TableDataCall::ColumnInfo* columns;
+    size_t columnCount;
+
+    /** The program the parser currently emits to. */
+    Program* program;
+
+    /** The registers of the columns already loaded by a program. */
+    std::unordered_map<std::pair<Program*, size_t>, uint32_t, ColumnKeyHash> columnRegs;
+};
+
+
+/*
+ * TableExpression::TableExpression
+ */
+TableExpression::TableExpression(void) : program() {}
+
+
+/*
+ * TableExpression::~TableExpression
+ */
+TableExpression::~TableExpression(void) {}
+
+
+/*
+ * TableExpression::Compile
+ */
+bool TableExpression::Compile(const std::string& source, const TableDataCall::ColumnInfo* columns,
+    const size_t columnCount, std::string& outError) {
+#ifndef NDEBUG
+    static const bool foldingChecked = TableExpression::checkFolding();
+    assert(foldingChecked);
+#endif /* NDEBUG */
+    this->program.reset();
+    try {
+        Parser parser(source, columns, columnCount);
+        this->program = parser.Parse();
+        return true;
+    } catch (std::runtime_error& ex) {
+        outError = ex.what();
+        return false;
+    }
+}
+
+
+/*
+ * TableExpression::Evaluate
+ */
+void TableExpression::Evaluate(const float* data, const size_t rows, const size_t columns, float* dst,
+    const size_t dstStride, float& outMin, float& outMax) const {
+    float minVal = std::numeric_limits<float>::max();
+    float maxVal = std::numeric_limits<float>::lowest();
+
+    if (this->program) {
+        const Program::Table table{data, rows, columns};
+        const auto& prog = *this->program;
+        const auto aggregates = prog.ComputeAggregates(table);
+        const auto blocks = static_cast<int64_t>((rows + BlockSize - 1) / BlockSize);
+
+#pragma omp parallel
+        {
+            std::vector<float> regs(prog.code.size() * BlockSize);
+            prog.InitRegisters(regs.data(), aggregates, rows);
+            float lmin = std::numeric_limits<float>::max();
+            float lmax = std::numeric_limits<float>::lowest();
+
+#pragma omp for schedule(static)
+            for (int64_t b = 0; b < blocks; ++b) {
+                const size_t first = static_cast<size_t>(b) * BlockSize;
+                const size_t count = (std::min)(BlockSize, rows - first);
+                const float* r = prog.RunBlock(regs.data(), table, first, count);
+                float* d = dst + first * dstStride;
+                for (size_t i = 0; i < count; ++i) {
+                    d[i * dstStride] = r[i];
+                    lmin = (std::min)(lmin, r[i]);
+                    lmax = (std::max)(lmax, r[i]);
+                }
+            }
+
+#pragma omp critical
+            {
+                minVal = (std::min)(minVal, lmin);
+                maxVal = (std::max)(maxVal, lmax);
+            }
+        }
+    }
+
+    if (minVal > maxVal) {
+        /* No rows or only NaNs. */
+        minVal = maxVal = 0.0f;
+    }
+    outMin = minVal;
+    outMax = maxVal;
+}
+
+
+/*
+ * TableExpression::GetType
+ */
+TableExpression::ValueType TableExpression::GetType(void) const {
+    return this->program ? this->program->type : ValueType::NUMBER;
+}
+
+
+#ifndef NDEBUG
+/*
+ * TableExpression::checkFolding
+ */
+bool TableExpression::checkFolding(void) {
+    TableDataCall::ColumnInfo columns[2];
+    columns[0].SetName("x");
+    columns[1].SetName("y");
+    const float data[] = {3.0f, 5.0f, 5.0f, 11.0f};
+    const std::string sources[] = {"x + 2 * y", "x + (1 + 2) * y", "x + min(7, y)"};
+    const float expected[][2] = {{13.0f, 27.0f}, {18.0f, 38.0f}, {8.0f, 12.0f}};
+
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); ++i) {
+        TableExpression expr;
+        float result[2], minVal, maxVal;
+        try {
+            Parser parser(sources[i], columns, 2);
+            expr.program = parser.Parse();
+        } catch (std::runtime_error&) {
+            return false;
+        }
+        expr.Evaluate(data, 2, 2, result, 1, minVal, maxVal);
+        if ((result[0] != expected[i][0]) || (result[1] != expected[i][1])) return false;
+    }
+    return true;
+}
+#endif /* NDEBUG */
@@ -0,0 +1,131 @@
+/*
+ * TableExpression.h
+ *
+ * Copyright (C) 2020 by VISUS (University of Stuttgart)
+ * Alle Rechte vorbehalten.
+ */
+
+#ifndef MEGAMOL_DATATOOLS_TABLE_TABLEEXPRESSION_H_INCLUDED
+#define MEGAMOL_DATATOOLS_TABLE_TABLEEXPRESSION_H_INCLUDED
+
+#include <memory>
+#include <string>
+
+#include "mmstd_datatools/table/TableDataCall.h"
+
+namespace megamol {
+namespace stdplugin {
+namespace datatools {
+namespace table {
+
+/**
+ * A typed expression over the columns of a table, which is evaluated for all
+ * rows at once.
+ *
+ * The expression is compiled into a flat list of column-wise operations.
+ * Evaluation processes the table in blocks of rows that fit into the cache,
+ * running each operation over the whole block before the next one, and
+ * distributes the blocks over all OpenMP threads.
+ *
+ * Syntax, by increasing precedence:
+ *   c ? a : b               conditional (c must be boolean)
+ *   a || b, a && b, !a      logical operators on booleans
+ *   < <= > >= == !=         comparisons, yielding booleans
+ *   a + b, a - b            arithmetic on numbers
+ *   a * b, a / b, a % b
+ *   -a, a ^ b               negation, power (right-associative)
+ *
+ * Operands are numbers, 'true', 'false', 'pi', 'row' (the index of the row),
+ * 'rows' (the number of rows) and column references. Columns are referenced
+ * by their name if it is a valid identifier, by their name in double quotes
+ * or by their index as in '$3'.
+ *
+ * Functions: abs, sqrt, exp, log, log10, sin, cos, tan, asin, acos, atan,
+ * floor, ceil, round, atan2(y, x), pow(a, b), min(a, b), max(a, b),
+ * clamp(x, lo, hi) and if(c, a, b).
+ *
+ * Aggregates over all rows, whose argument may be any expression: colsum,
+ * colmean, colmin, colmax and colstd (population standard deviation).
+ */
+class TableExpression {
+public:
+    /** The types of values. */
+    enum class ValueType { NUMBER, BOOLEAN };
+
+    /** Ctor. */
+    TableExpression(void);
+
+    /** Dtor. */
+    ~TableExpression(void);
+
+    /**
+     * Compile an expression.
+     *
+     * @param source      The expression.
+     * @param columns     The columns the expression can reference.
+     * @param columnCount The number of elements in 'columns'.
+     * @param outError    Receives a description of the problem if the
+     *                    expression is invalid.
+     *
+     * @return true on success, false if the expression is invalid.
+     */
+    bool Compile(const std::string& source, const TableDataCall::ColumnInfo* columns, const size_t columnCount,
+        std::string& outError);
+
+    /**
+     * Evaluate the compiled expression for all rows of a table. Booleans are
+     * written as 0 and 1.
+     *
+     * The rows being evaluated are read completely before the results are
+     * written, so 'dst' may point into 'data'.
+     *
+     * @param data      The table in row-major order.
+     * @param rows      The number of rows in 'data'.
+     * @param columns   The number of columns in 'data'.
+     * @param dst       Receives the results.
+     * @param dstStride The distance between two results in 'dst' in floats.
+     * @param outMin    Receives the smallest result.
+     * @param outMax    Receives the largest result.
+     */
+    void Evaluate(const float* data, const size_t rows, const size_t columns, float* dst, const size_t dstStride,
+        float& outMin, float& outMax) const;
+
+    /**
+     * Answer the type of the result of the expression.
+     *
+     * @return The type of the result.
+     */
+    ValueType GetType(void) const;
+
+    /**
+     * Answer whether an expression has been compiled successfully.
+     *
+     * @return true if the expression can be evaluated.
+     */
+    inline bool IsValid(void) const { return static_cast<bool>(this->program); }
+
+    /** The number of rows processed at once by a thread. */
+    static const size_t BlockSize;
+
+private:
+    class Parser;
+    struct Program;
+
+    /**
+     * Check that folding constants keeps the registers of the other
+     * operands, e.g. in 'x + 2 * y'. Only defined in debug builds.
+     *
+     * @return true if the checked expressions yield the expected results.
+     */
+    static bool checkFolding(void);
+
+    /** The compiled expression. */
+    std::unique_ptr<Program> program;
+};
+
+} /* end namespace table */
+} /* end namespace datatools */
+} /* end namespace stdplugin */
+} /* end namespace megamol */
+
+#endif /* MEGAMOL_DATATOOLS_TABLE_TABLEEXPRESSION_H_INCLUDED */
@@ -8,8 +8,11 @@
 #include "stdafx.h"
 #include "TableManipulator.h"
 
+#include "mmcore/param/EnumParam.h"
 #include "mmcore/param/StringParam.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
 #include "vislib/StringTokeniser.h"
 #include "vislib/sys/Log.h"
@@ -27,6 +30,9 @@ TableManipulator::TableManipulator(void)
     , dataOutSlot("dataOut", "Output")
     , dataInSlot("dataIn", "Input")
     , scriptSlot("script", "script to execute on incoming table data")
+    , expressionsSlot("expressions", "column expressions applied to the incoming table data, one 'name = expression' "
+                                     "per line, replacing the column 'name' or adding it")
+    , modeSlot("mode", "whether the table is manipulated by the script or the expressions")
     , frameID(-1)
     , in_datahash(std::numeric_limits<unsigned long>::max())
     , out_datahash(0)
@@ -88,6 +94,18 @@ TableManipulator::TableManipulator(void)
         "    mmSetOutputColumnRange(c, mins[c], maxes[c])\n"
         "end\n");
     this->MakeSlotAvailable(&this->scriptSlot);
+
+    this->expressionsSlot << new core::param::StringParam(
+        "# one column per line, later lines can use the columns defined before\n"
+        "# speed = sqrt(vx^2 + vy^2 + vz^2)\n"
+        "# fast = speed > colmean(speed) + 2 * colstd(speed) ? 1 : 0\n");
+    this->MakeSlotAvailable(&this->expressionsSlot);
+
+    auto* ep = new core::param::EnumParam(static_cast<int>(Mode::LUA));
+    ep->SetTypePair(static_cast<int>(Mode::LUA), "Lua script");
+    ep->SetTypePair(static_cast<int>(Mode::EXPRESSIONS), "Expressions");
+    this->modeSlot << ep;
+    this->MakeSlotAvailable(&this->modeSlot);
 }
 
 TableManipulator::~TableManipulator(void) { this->Release(); }
@@ -111,12 +129,108 @@ bool TableManipulator::create(void) {
         "mmGetCellValue", "(int row, int col)\n\treturns value in cell (row, col) in the input data");
     theLua.RegisterCallback<TableManipulator, &TableManipulator::setCellValue>(
         "mmSetCellValue", "(int row, int col, float val)\n\tset cell (row, col) in the output data to val");
+    theLua.RegisterCallback<TableManipulator, &TableManipulator::evaluateColumn>("mmEvaluateColumn",
+        "(int col, string expression)\n\tsets column col of all output rows to the expression evaluated over the "
+        "input data and returns min, max of the result. The output needs as many rows as the input.");
 
     return true;
 }
 
 void TableManipulator::release(void) {}
 
+bool TableManipulator::applyExpressions(void) {
+    struct Definition {
+        std::string name;
+        std::string expression;
+        size_t column;
+    };
+
+    const auto trim = [](const std::string& str) {
+        const auto first = str.find_first_not_of(" \t\r");
+        if (first == std::string::npos) return std::string();
+        const auto last = str.find_last_not_of(" \t\r");
+        return str.substr(first, last - first + 1);
+    };
+
+    /* Split the definitions at line breaks and semicolons. */
+    const std::string source = std::string(this->expressionsSlot.Param<core::param::StringParam>()->Value());
+    std::vector<Definition> defs;
+    size_t begin = 0;
+    while (begin <= source.size()) {
+        auto end = source.find_first_of("\n;", begin);
+        if (end == std::string::npos) end = source.size();
+        const auto line = trim(source.substr(begin, end - begin));
+        begin = end + 1;
+        if (line.empty() || (line[0] == '#') || (line.compare(0, 2, "--") == 0)) continue;
+
+        // The assignment is the first '=' that is not part of a comparison.
+        size_t eq = line.find('=');
+        while ((eq != std::string::npos) &&
+               (((eq + 1 < line.size()) && (line[eq + 1] == '=')) ||
+                   ((eq > 0) && (std::string("<>!=").find(line[eq - 1]) != std::string::npos)))) {
+            eq = line.find('=', (line[eq + 1] == '=') ? eq + 2 : eq + 1);
+        }
+        if (eq == std::string::npos) {
+            vislib::sys::Log::DefaultLog.WriteError(
+                "TableManipulator: '%s' is not of the form 'name = expression'", line.c_str());
+            return false;
+        }
+
+        Definition def;
+        def.name = trim(line.substr(0, eq));
+        if ((def.name.size() >= 2) && (def.name.front() == '"') && (def.name.back() == '"')) {
+            def.name = def.name.substr(1, def.name.size() - 2);
+        }
+        def.expression = line.substr(eq + 1);
+        defs.push_back(def);
+    }
+
+    /* Replace existing columns or append new ones in the order of definition. */
+    this->info.assign(column_infos, column_infos + column_count);
+    for (auto& def : defs) {
+        auto it = std::find_if(this->info.begin(), this->info.end(),
+            [&def](const TableDataCall::ColumnInfo& ci) { return ci.Name() == def.name; });
+        def.column = static_cast<size_t>(it - this->info.begin());
+        if (it == this->info.end()) {
+            this->info.emplace_back();
+            this->info.back().SetName(def.name);
+        }
+        this->info[def.column].SetType(TableDataCall::ColumnType::QUANTITATIVE);
+    }
+
+    const size_t outCols = this->info.size();
+    this->data.resize(row_count * outCols);
+    const auto rows = static_cast<int64_t>(row_count);
+#pragma omp parallel for
+    for (int64_t r = 0; r < rows; ++r) {
+        std::copy(in_data + r * column_count, in_data + (r + 1) * column_count, this->data.data() + r * outCols);
+    }
+
+    /*
+     * Evaluate on the output table, such that each expression can use the
+     * columns defined before, but not the ones defined after it.
+     */
+    size_t visible = column_count;
+    for (const auto& def : defs) {
+        TableExpression expression;
+        std::string error;
+        if (!expression.Compile(def.expression, this->info.data(), visible, error)) {
+            vislib::sys::Log::DefaultLog.WriteError(
+                "TableManipulator: invalid expression for column '%s': %s", def.name.c_str(), error.c_str());
+            return false;
+        }
+
+        float minVal, maxVal;
+        expression.Evaluate(
+            this->data.data(), row_count, outCols, this->data.data() + def.column, outCols, minVal, maxVal);
+        this->info[def.column].SetMinimumValue(minVal);
+        this->info[def.column].SetMaximumValue(maxVal);
+        visible = (std::max)(visible, def.column + 1);
+    }
+
+    return true;
+}
+
 bool TableManipulator::processData(core::Call& c) {
     try {
         TableDataCall* outCall = dynamic_cast<TableDataCall*>(&c);
@@ -128,10 +242,13 @@ bool TableManipulator::processData(core::Call& c) {
         inCall->SetFrameID(outCall->GetFrameID());
         if (!(*inCall)()) return false;
 
-        if (this->in_datahash != inCall->DataHash() || this->frameID != inCall->GetFrameID() || this->scriptSlot.IsDirty()) {
+        if (this->in_datahash != inCall->DataHash() || this->frameID != inCall->GetFrameID() || this->scriptSlot.IsDirty() ||
+            this->expressionsSlot.IsDirty() || this->modeSlot.IsDirty()) {
             this->in_datahash = inCall->DataHash();
             this->frameID = inCall->GetFrameID();
             this->scriptSlot.ResetDirty();
+            this->expressionsSlot.ResetDirty();
+            this->modeSlot.ResetDirty();
             this->out_datahash++;
 
             column_count = inCall->GetColumnsCount();
@@ -139,18 +256,26 @@ bool TableManipulator::processData(core::Call& c) {
             row_count = inCall->GetRowsCount();
             in_data = inCall->GetData();
 
-            const std::string scriptString = std::string(this->scriptSlot.Param<core::param::StringParam>()->Value());
-
             this->info.clear();
             this->info.reserve(column_count);
             this->data.clear();
-            this->data.reserve(column_count * row_count);
 
-            std::string res;
-            const bool ok = theLua.RunString(scriptString, res);
+            if (static_cast<Mode>(this->modeSlot.Param<core::param::EnumParam>()->Value()) == Mode::EXPRESSIONS) {
+                if (!this->applyExpressions()) {
+                    this->info.clear();
+                    this->data.clear();
+                }
+            } else {
+                const std::string scriptString = std::string(this->scriptSlot.Param<core::param::StringParam>()->Value());
+
+                this->data.reserve(column_count * row_count);
 
-            if (!ok) {
-                vislib::sys::Log::DefaultLog.WriteError("TableManipulator: Lua execution is NOT OK and returned '%s'", res.c_str());
+                std::string res;
+                const bool ok = theLua.RunString(scriptString, res);
+
+                if (!ok) {
+                    vislib::sys::Log::DefaultLog.WriteError("TableManipulator: Lua execution is NOT OK and returned '%s'", res.c_str());
+                }
             }
         }
 
@@ -312,3 +437,41 @@ int TableManipulator::setCellValue(lua_State* L) {
         return 0;
     }
 }
+
+int TableManipulator::evaluateColumn(lua_State* L) {
+    const auto col = luaL_checkinteger(L, 1);
+    const auto expr = luaL_checkstring(L, 2);
+
+    if (col < 0 || col >= static_cast<lua_Integer>(info.size())) {
+        lua_pushstring(L, "column index out of range");
+        lua_error(L);
+        return 0;
+    }
+    if (data.size() != row_count * info.size()) {
+        lua_pushstring(L, "the output data need as many rows as the input data");
+        lua_error(L);
+        return 0;
+    }
+
+    bool ok = false;
+    {
+        // Keep the C++ objects out of the scope of lua_error.
+        TableExpression expression;
+        std::string error;
+        ok = expression.Compile(expr, column_infos, column_count, error);
+        if (ok) {
+            float minVal, maxVal;
+            expression.Evaluate(in_data, row_count, column_count, data.data() + col, info.size(), minVal, maxVal);
+            lua_pushnumber(L, minVal);
+            lua_pushnumber(L, maxVal);
+        } else {
+            lua_pushstring(L, ("invalid expression: " + error).c_str());
+        }
+    }
+
+    if (!ok) {
+        lua_error(L);
+        return 0;
+    }
+    return 2;
+}
@@ -18,13 +18,16 @@
 
 #include "mmstd_datatools/table/TableDataCall.h"
 
+#include "TableExpression.h"
+
 namespace megamol {
 namespace stdplugin {
 namespace datatools {
 namespace table {
 
 /*
- * Module to manipulate table (copy) via a LUA script.
+ * Module to manipulate table (copy) via a LUA script or a list of column
+ * expressions (see TableExpression).
  */
 class TableManipulator : public core::Module {
 public:
@@ -35,7 +38,7 @@ public:
     static const char* ClassName(void) { return ModuleName.c_str(); }
 
     /** Return module class description */
-    static const char* Description(void) { return "manipulate table (copy) via a LUA script"; }
+    static const char* Description(void) { return "manipulate table (copy) via a LUA script or column expressions"; }
 
     /** Module is always available */
     static bool IsAvailable(void) { return true; }
@@ -83,8 +86,22 @@ protected:
     /** (row, col, value) sets value in that cell */
     int setCellValue(lua_State* L);
 
+    /** (col, expression) sets column col of all output rows to the expression over the input */
+    int evaluateColumn(lua_State* L);
+
     
 private:
+    /** The ways of manipulating the table */
+    enum class Mode { LUA = 0, EXPRESSIONS = 1 };
+
+    /**
+     * Copies the input and adds or replaces the columns defined in
+     * 'expressionsSlot'.
+     *
+     * @return true on success, false if an expression is invalid.
+     */
+    bool applyExpressions(void);
+
     /** Data callback */
     bool processData(core::Call& c);
 
@@ -99,6 +116,12 @@ private:
     /** Parameter slot for column selection */
     core::param::ParamSlot scriptSlot;
 
+    /** Parameter slot for the column expressions, one 'name = expression' per line */
+    core::param::ParamSlot expressionsSlot;
+
+    /** Parameter slot selecting between the script and the expressions */
+    core::param::ParamSlot modeSlot;
+
     /** ID of the current frame */
     int frameID;
 
@@ -252,6 +252,67 @@ namespace volumetrics {
         //class Surface *enclosingCandidate;
     };
 
+    /**
+     * Chunked bump allocator for the per-cell scratch data of a voxelizer.
+     * Allocations stay valid until the next Reset(), which rewinds the arena
+     * but keeps its memory for the next sub-volume, so a voxelizer reused for
+     * many sub-volumes does not hit the heap once per cell.
+     */
+    template<class T>
+    class ScratchArena {
+    public:
+        /** Number of elements in a single chunk. */
+        static const SIZE_T CHUNK_SIZE = 64 * 1024;
+
+        inline ScratchArena(void) : chunkIdx(0), chunkUsed(0) {}
+
+        inline ~ScratchArena(void) {
+            for (SIZE_T i = 0; i < this->chunks.Count(); i++) {
+                delete[] this->chunks[i];
+            }
+        }
+
+        /**
+         * Answer a block of 'cnt' consecutive elements.
+         *
+         * @param cnt the number of elements, must not exceed CHUNK_SIZE
+         *
+         * @return pointer to uninitialised memory for 'cnt' elements
+         */
+        inline T *Allocate(SIZE_T cnt) {
+            ASSERT(cnt <= CHUNK_SIZE);
+            if (this->chunkIdx < this->chunks.Count() && this->chunkUsed + cnt > CHUNK_SIZE) {
+                this->chunkIdx++;
+                this->chunkUsed = 0;
+            }
+            if (this->chunkIdx == this->chunks.Count()) {
+                this->chunks.Add(new T[CHUNK_SIZE]);
+                this->chunkUsed = 0;
+            }
+            T *retval = this->chunks[this->chunkIdx] + this->chunkUsed;
+            this->chunkUsed += cnt;
+            return retval;
+        }
+
+        /**
+         * Rewind the arena. All blocks handed out before become invalid.
+         */
+        inline void Reset(void) {
+            this->chunkIdx = 0;
+            this->chunkUsed = 0;
+        }
+
+    private:
+        /** the memory chunks, each holding CHUNK_SIZE elements */
+        vislib::Array<T*> chunks;
+
+        /** the chunk currently allocated from */
+        SIZE_T chunkIdx;
+
+        /** the number of elements used in the current chunk */
+        SIZE_T chunkUsed;
+    };
+
     /**
      * we introduced this class to detect enclosed surfaces
      * thomasbm: we need that to avoid carrying an initialized-flag for
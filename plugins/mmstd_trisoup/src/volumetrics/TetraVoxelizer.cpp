@@ -86,12 +86,13 @@ void TetraVoxelizer::debugPrintTriangle(vislib::math::ShallowShallowTriangle<dou
         tri.PeekCoordinates()[2][0], tri.PeekCoordinates()[2][1], tri.PeekCoordinates()[2][2]);
 }
 
-TetraVoxelizer::TetraVoxelizer(void) : terminate(false), sjd(NULL) {
+TetraVoxelizer::TetraVoxelizer(void) : terminate(false), sjd(NULL), volume(NULL), volumeCapacity(0) {
     //triangleSoup.SetCapacityIncrement(90); // AKA 10 triangles?
 }
 
 
 TetraVoxelizer::~TetraVoxelizer(void) {
+    ARY_SAFE_DELETE(this->volume);
 }
 
 bool TetraVoxelizer::CellHasNoGeometry(FatVoxel *theVolume, unsigned x, unsigned y, unsigned z) {
@@ -562,9 +563,9 @@ void TetraVoxelizer::MarchCell(FatVoxel *theVolume, unsigned int x, unsigned int
         }
     }
 
-    currVoxel.triangles = new VoxelizerFloat[currVoxel.numTriangles * 3 * 3];
-    currVoxel.volumes = new VoxelizerFloat[currVoxel.numTriangles];
-	currVoxel.corners = new unsigned char[currVoxel.numTriangles];
+    currVoxel.triangles = this->floatArena.Allocate(currVoxel.numTriangles * 3 * 3);
+    currVoxel.volumes = this->floatArena.Allocate(currVoxel.numTriangles);
+    currVoxel.corners = this->cornerArena.Allocate(currVoxel.numTriangles);
     vislib::math::ShallowShallowTriangle<VoxelizerFloat, 3> tri(currVoxel.triangles);
     vislib::math::ShallowShallowTriangle<VoxelizerFloat, 3> tri2(currVoxel.triangles);
     vislib::math::Point<VoxelizerFloat, 3> temp;
@@ -961,7 +962,16 @@ DWORD TetraVoxelizer::Run(void *userData) {
 //#endif
 
     unsigned int fifoEnd = 0, fifoCur = 0;
-    FatVoxel *volume = new FatVoxel[sjd->resX * sjd->resY * sjd->resZ];
+    // the scratch memory is kept across the sub-volumes processed by this voxelizer
+    SIZE_T volumeSize = static_cast<SIZE_T>(sjd->resX * sjd->resY * sjd->resZ);
+    if (volumeSize > this->volumeCapacity) {
+        ARY_SAFE_DELETE(this->volume);
+        this->volume = new FatVoxel[volumeSize];
+        this->volumeCapacity = volumeSize;
+    }
+    this->floatArena.Reset();
+    this->cornerArena.Reset();
+    FatVoxel *volume = this->volume;
     // we can do that when using structs ... - its safer doing memzero (in case new members get added to the FatVoxel struct)
     memset(volume, 0, sizeof(FatVoxel)*(sjd->resX * sjd->resY * sjd->resZ));
     for (SIZE_T i = 0; i < static_cast<SIZE_T>(sjd->resX * sjd->resY * sjd->resZ); i++) {
@@ -1197,22 +1207,8 @@ DWORD TetraVoxelizer::Run(void *userData) {
         }
     }
 
-    // dealloc stuff in volume
-    // dealloc volume as a whole etc.
-    for (int x = 0; x < static_cast<int>(sjd->resX) - 1; x++) {
-        for (int y = 0; y < static_cast<int>(sjd->resY) - 1; y++) {
-            for (int z = 0; z < static_cast<int>(sjd->resZ) - 1; z++) {
-                if (MarchingCubeTables::a2ucTriangleConnectionCount[volume[sjd->cellIndex(x, y, z)].mcCase] > 0) {
-                    ARY_SAFE_DELETE(volume[sjd->cellIndex(x, y, z)].triangles);
-                    ARY_SAFE_DELETE(volume[sjd->cellIndex(x, y, z)].volumes);
-                    ARY_SAFE_DELETE(volume[sjd->cellIndex(x, y, z)].corners);
-                    // do NOT delete!
-                    volume[sjd->cellIndex(x, y, z)].borderVoxel = NULL;
-                }
-            }
-        }
-    }
-    ARY_SAFE_DELETE(volume);
+    // the per-cell geometry lives in the arenas and the volume is kept for the next
+    // sub-volume, the border voxels must NOT be deleted since they are owned by the surfaces.
 
 #ifdef ULTRADEBUG
     vislib::sys::Log::DefaultLog.WriteInfo("job done: (%u,%u,%u)", sjd->gridX, sjd->gridY, sjd->gridZ);
@@ -88,6 +88,21 @@ namespace volumetrics {
 
         SubJobData *sjd;
 
+        /**
+         * Scratch volume reused for all sub-volumes processed by this voxelizer,
+         * holding at least volumeCapacity FatVoxels.
+         */
+        FatVoxel *volume;
+
+        /** The number of FatVoxels 'volume' can hold */
+        SIZE_T volumeCapacity;
+
+        /** Arena for the per-cell triangles and volumes */
+        ScratchArena<VoxelizerFloat> floatArena;
+
+        /** Arena for the per-cell tet corners */
+        ScratchArena<unsigned char> cornerArena;
+
         vislib::SingleLinkedList<vislib::math::Point<unsigned int, 4> > cellFIFO;
 };
 
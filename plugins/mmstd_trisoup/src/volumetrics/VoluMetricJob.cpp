@@ -16,7 +16,7 @@
 #include "vislib/math/Vector.h"
 #include "vislib/graphics/NamedColours.h"
 #include "vislib/sys/Thread.h"
-#include "vislib/sys/ThreadPool.h"
+#include "vislib/sys/WorkStealingThreadPool.h"
 #include "MarchingCubeTables.h"
 #include "TetraVoxelizer.h"
 #include "vislib/sys/sysfunctions.h"
@@ -102,6 +102,10 @@ VoluMetricJob::VoluMetricJob(void) : core::job::AbstractThreadedJob(), core::Mod
  */
 VoluMetricJob::~VoluMetricJob(void) {
     this->Release();
+    while (this->voxelizerList.Count() > 0) {
+        delete this->voxelizerList.Last();
+        this->voxelizerList.RemoveLast();
+    }
 }
 
 
@@ -154,15 +158,17 @@ DWORD VoluMetricJob::Run(void *userData) {
         }
     }
 
-    vislib::Array<TetraVoxelizer*> voxelizerList;
-
-    voxelizerList.SetCapacityIncrement(16);
+    // one voxelizer per worker, they keep their scratch memory across sub-volumes, frames and runs and are freed
+    // by the destructor
+    SIZE_T threadCount = vislib::sys::SystemInformation::ProcessorCount();
+    while (this->voxelizerList.Count() < threadCount) {
+        this->voxelizerList.Add(new TetraVoxelizer());
+    }
     SubJobDataList.SetCapacityIncrement(16);
 
     for (unsigned int frameI = 0; frameI < frameCnt; frameI++) {
 
-        vislib::sys::ThreadPool pool;
-        //pool.SetThreadCount(static_cast<SIZE_T>(vislib::sys::SystemInformation::ProcessorCount() * 1.5));
+        vislib::sys::WorkStealingThreadPool pool;
 
         datacall->SetFrameID(frameI, true);
         do {
@@ -175,10 +181,6 @@ DWORD VoluMetricJob::Run(void *userData) {
         this->MaxGlobalID = 0;
 
         // clear submitted stuff, dealloc.
-        while (voxelizerList.Count() > 0) {
-            delete voxelizerList[0];
-            voxelizerList.RemoveAt(0);
-        }
         while (SubJobDataList.Count() > 0) {
             delete SubJobDataList[0];
             SubJobDataList.RemoveAt(0);
@@ -279,6 +281,9 @@ DWORD VoluMetricJob::Run(void *userData) {
         bool storeVolume = //storeMesh; // debug for now ...
             (this->outVolDataSlot.GetStatus() == megamol::core::AbstractSlot::STATUS_CONNECTED);
 
+        vislib::Array<double> costs;
+        this->estimateSubJobCosts(datacall, b, subVolCells * cellSize, RadMult, costs);
+
         vislib::sys::ConsoleProgressBar pb;
         pb.Start("Computing Frame", divX * divY * divZ);
 
@@ -325,16 +330,16 @@ DWORD VoluMetricJob::Run(void *userData) {
                     sjd->storeMesh = storeMesh;
                     sjd->storeVolume = storeVolume;
                     SubJobDataList.Add(sjd);
-                    TetraVoxelizer *v = new TetraVoxelizer();
-                    voxelizerList.Add(v);
 
                     //if (z == 0 && y == 0) {
-                        pool.QueueUserWorkItem(v, sjd);
+                        pool.QueueUserWorkItem(&VoluMetricJob::runSubJob, sjd, costs[(x * divY + y) * divZ + z]);
                     //}
                 }
             }
         }
         //}
+        // the sub-volumes are distributed by cost once all of them are known
+        pool.Start(this->voxelizerList.Count());
         this->debugLines[backBufferIndex][0].Set(
                 static_cast<unsigned int>(idxNumOffset * 2),
                 this->bboxIdxData[backBufferIndex].As<unsigned int>(), this->bboxVertData[backBufferIndex].As<VoxelizerFloat>(),
@@ -350,21 +355,29 @@ DWORD VoluMetricJob::Run(void *userData) {
         vislib::Array<VoxelizerFloat> volPerID;
         vislib::Array<VoxelizerFloat> voidVolPerID;
 
-        SIZE_T lastCount = pool.CountUserWorkItems();
+        SIZE_T lastCount = 0;
+        int lastPercent = 0;
         while(1) {
             if (pool.Wait(500) && pool.CountUserWorkItems() == 0) {
                         // we are done
                         break;
             }
-            if (lastCount != pool.CountUserWorkItems()) {
-                pb.Set(static_cast<vislib::sys::ConsoleProgressBar::Size>(
-                    divX * divY * divZ - pool.CountUserWorkItems()));
+            SIZE_T doneCount = pool.CountCompletedUserWorkItems();
+            if (lastCount != doneCount) {
+                pb.Set(static_cast<vislib::sys::ConsoleProgressBar::Size>(doneCount));
+                // the sub-volume count says little about the remaining time, the costs do
+                int percent = static_cast<int>(pool.GetProgress() * 100.0);
+                if (percent / 10 > lastPercent / 10) {
+                    Log::DefaultLog.WriteInfo("Frame %u: %u of %u sub-volumes done, %d%% of the estimated work",
+                        frameI, static_cast<unsigned int>(doneCount), divX * divY * divZ, percent);
+                    lastPercent = percent;
+                }
                 generateStatistics(uniqueIDs, countPerID, surfPerID, volPerID, voidVolPerID);
                 if (storeMesh)
                     copyMeshesToBackbuffer(uniqueIDs);
                 if (storeVolume)
                     copyVolumesToBackBuffer();
-                lastCount = pool.CountUserWorkItems();
+                lastCount = doneCount;
             }
         }
         generateStatistics(uniqueIDs, countPerID, surfPerID, volPerID, voidVolPerID);
@@ -393,6 +406,69 @@ DWORD VoluMetricJob::Run(void *userData) {
     return 0;
 }
 
+
+/*
+ * VoluMetricJob::runSubJob
+ */
+DWORD VoluMetricJob::runSubJob(void *userData) {
+    SubJobData *sjd = static_cast<SubJobData*>(userData);
+    SIZE_T worker = vislib::sys::WorkStealingThreadPool::CurrentWorkerIndex();
+    ASSERT(worker < sjd->parent->voxelizerList.Count());
+    return sjd->parent->voxelizerList[worker]->Run(sjd);
+}
+
+
+/*
+ * VoluMetricJob::estimateSubJobCosts
+ */
+void VoluMetricJob::estimateSubJobCosts(core::moldyn::MultiParticleDataCall *datacall,
+        const vislib::math::Cuboid<VoxelizerFloat> &b, VoxelizerFloat subVolSize,
+        VoxelizerFloat RadMult, vislib::Array<double> &costs) {
+    // every sub-volume has some fixed cost for sampling and marching its cells
+    costs.SetCount(divX * divY * divZ);
+    for (SIZE_T i = 0; i < costs.Count(); i++) {
+        costs[i] = 1.0;
+    }
+
+    const VoxelizerFloat origin[3] = {b.Left(), b.Bottom(), b.Back()};
+    const int div[3] = {divX, divY, divZ};
+    for (unsigned int partListI = 0; partListI < datacall->GetParticleListCount(); partListI++) {
+        core::moldyn::MultiParticleDataCall::Particles &ps = datacall->AccessParticles(partListI);
+        unsigned int vertSize;
+        switch (ps.GetVertexDataType()) {
+            case core::moldyn::MultiParticleDataCall::Particles::VERTDATA_FLOAT_XYZ:
+                vertSize = 3 * sizeof(float);
+                break;
+            case core::moldyn::MultiParticleDataCall::Particles::VERTDATA_FLOAT_XYZR:
+                vertSize = 4 * sizeof(float);
+                break;
+            default:
+                continue;
+        }
+        unsigned int stride = (ps.GetVertexDataStride() == 0) ? vertSize : ps.GetVertexDataStride();
+        const unsigned char *vertexData = static_cast<const unsigned char*>(ps.GetVertexData());
+        bool hasRadius = (ps.GetVertexDataType() == core::moldyn::MultiParticleDataCall::Particles::VERTDATA_FLOAT_XYZR);
+
+        for (UINT64 l = 0; l < ps.GetCount(); l++) {
+            const float *p = reinterpret_cast<const float*>(vertexData + stride * l);
+            VoxelizerFloat r = (hasRadius ? p[3] : ps.GetGlobalRadius()) * RadMult;
+            // all sub-volumes the bounding box of the particle overlaps
+            int minIdx[3], maxIdx[3];
+            for (int d = 0; d < 3; d++) {
+                minIdx[d] = vislib::math::Max(0, static_cast<int>((p[d] - r - origin[d]) / subVolSize));
+                maxIdx[d] = vislib::math::Min(div[d] - 1, static_cast<int>((p[d] + r - origin[d]) / subVolSize));
+            }
+            for (int x = minIdx[0]; x <= maxIdx[0]; x++) {
+                for (int y = minIdx[1]; y <= maxIdx[1]; y++) {
+                    for (int z = minIdx[2]; z <= maxIdx[2]; z++) {
+                        costs[(x * divY + y) * divZ + z] += 1.0;
+                    }
+                }
+            }
+        }
+    }
+}
+
 bool VoluMetricJob::getLineDataCallback(core::Call &caller) {
     megamol::geocalls::LinesDataCall *ldc = dynamic_cast<megamol::geocalls::LinesDataCall*>(&caller);
     if (ldc == NULL) return false;
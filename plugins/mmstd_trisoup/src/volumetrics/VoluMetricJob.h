@@ -28,6 +28,9 @@ namespace megamol {
 namespace trisoup {
 namespace volumetrics {
 
+    /** forward declaration */
+    class TetraVoxelizer;
+
     /**
      * Megamol job that computes metrics about the volume occupied by a number
      * of (spherical) glyphs. Several threaded jobs are generated for a number of
@@ -114,6 +117,31 @@ namespace volumetrics {
 
     private:
 
+        /**
+         * Work item entry point for a sub-volume. Runs the TetraVoxelizer of the
+         * calling pool worker on the sub-volume, so the scratch memory of the
+         * voxelizer is reused for all sub-volumes processed by that worker.
+         *
+         * @param userData the SubJobData of the sub-volume
+         *
+         * @return the exit code of the voxelizer
+         */
+        static DWORD runSubJob(void *userData);
+
+        /**
+         * Estimates the relative cost of each sub-volume from the number of particles
+         * touching it. Empty sub-volumes are trivial, dense ones are expensive.
+         *
+         * @param datacall the particle data
+         * @param b the bounding box of the whole grid
+         * @param subVolSize the edge length of a sub-volume
+         * @param RadMult the radius multiplier
+         * @param costs receives divX * divY * divZ costs, indexed (x * divY + y) * divZ + z
+         */
+        void estimateSubJobCosts(core::moldyn::MultiParticleDataCall *datacall,
+            const vislib::math::Cuboid<VoxelizerFloat> &b, VoxelizerFloat subVolSize,
+            VoxelizerFloat RadMult, vislib::Array<double> &costs);
+
         /**
          * Answer whether two BorderVoxel arrays touch at least in one place.
          *
@@ -278,6 +306,9 @@ namespace volumetrics {
         vislib::RawStorage bboxIdxData[2];
 
         vislib::Array<CallVolumetricData::Volume> debugVolumes;
+
+        /** one voxelizer per pool worker, indexed by the worker index */
+        vislib::Array<TetraVoxelizer*> voxelizerList;
     };
 
 } /* end namespace volumetrics */
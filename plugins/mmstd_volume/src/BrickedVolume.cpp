@@ -0,0 +1,600 @@
+/*
+ * BrickedVolume.cpp
+ *
+ * Copyright (C) 2020 by VISUS (Universitaet Stuttgart).
+ * Alle Rechte vorbehalten.
+ */
+
+#include "stdafx.h"
+#include "BrickedVolume.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+#include "datRaw.h"
+
+#include "mmcore/misc/VolumetricDataCall.h"
+
+#include "vislib/assert.h"
+#include "vislib/Exception.h"
+#include "vislib/FormatException.h"
+#include "vislib/sys/Log.h"
+
+
+namespace {
+
+/**
+ * Invoke 'func' with a value of the C++ type matching the scalars described
+ * by 'header'.
+ */
+template<class F>
+void dispatchScalar(const megamol::stdplugin::volume::BrickedVolume::Header& header, F&& func) {
+    using megamol::core::misc::ScalarType_t;
+
+    switch (header.ScalarType) {
+    case ScalarType_t::SIGNED_INTEGER:
+        switch (header.ScalarLength) {
+        case 1:
+            func(std::int8_t());
+            return;
+        case 2:
+            func(std::int16_t());
+            return;
+        case 4:
+            func(std::int32_t());
+            return;
+        case 8:
+            func(std::int64_t());
+            return;
+        }
+        break;
+
+    case ScalarType_t::UNSIGNED_INTEGER:
+        switch (header.ScalarLength) {
+        case 1:
+            func(std::uint8_t());
+            return;
+        case 2:
+            func(std::uint16_t());
+            return;
+        case 4:
+            func(std::uint32_t());
+            return;
+        case 8:
+            func(std::uint64_t());
+            return;
+        }
+        break;
+
+    case ScalarType_t::FLOATING_POINT:
+        switch (header.ScalarLength) {
+        case 4:
+            func(float());
+            return;
+        case 8:
+            func(double());
+            return;
+        }
+        break;
+    }
+
+    throw vislib::Exception("The scalar type of the volume is not supported for bricking.", __FILE__, __LINE__);
+}
+
+
+/**
+ * Reduce the slices [dstZ0, dstZ1[ of the level described by 'dstRes' from
+ * the slices [srcZ0, srcZ1[ of its predecessor using a box filter.
+ */
+template<class T>
+void downsample(const std::uint8_t* src, const std::size_t srcRes[3], const std::size_t srcZ0, std::uint8_t* dst,
+    const std::size_t dstRes[3], const std::size_t dstZ0, const std::size_t dstZ1, const std::size_t components) {
+    auto s = reinterpret_cast<const T*>(src);
+    auto d = reinterpret_cast<T*>(dst);
+
+    for (std::size_t z = dstZ0; z < dstZ1; ++z) {
+        std::size_t sz[2] = {2 * z, std::min(2 * z + 1, srcRes[2] - 1)};
+        for (std::size_t y = 0; y < dstRes[1]; ++y) {
+            std::size_t sy[2] = {2 * y, std::min(2 * y + 1, srcRes[1] - 1)};
+            for (std::size_t x = 0; x < dstRes[0]; ++x) {
+                std::size_t sx[2] = {2 * x, std::min(2 * x + 1, srcRes[0] - 1)};
+                for (std::size_t c = 0; c < components; ++c) {
+                    double sum = 0.0;
+                    for (int k = 0; k < 8; ++k) {
+                        auto i = ((sz[(k >> 2) & 1] - srcZ0) * srcRes[1] + sy[(k >> 1) & 1]) * srcRes[0] + sx[k & 1];
+                        sum += static_cast<double>(s[i * components + c]);
+                    }
+                    sum /= 8.0;
+                    if (std::is_integral<T>::value) {
+                        sum = std::floor(sum + 0.5);
+                    }
+                    auto i = ((z - dstZ0) * dstRes[1] + y) * dstRes[0] + x;
+                    d[i * components + c] = static_cast<T>(sum);
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * Update the per-component range with 'cnt' voxels from 'data'.
+ */
+template<class T>
+void updateRange(const std::uint8_t* data, const std::size_t cnt, const std::size_t components,
+    std::vector<double>& mins, std::vector<double>& maxs) {
+    auto d = reinterpret_cast<const T*>(data);
+    for (std::size_t i = 0; i < cnt; ++i) {
+        for (std::size_t c = 0; c < components; ++c) {
+            auto v = static_cast<double>(d[i * components + c]);
+            if (v < mins[c]) mins[c] = v;
+            if (v > maxs[c]) maxs[c] = v;
+        }
+    }
+}
+
+} // namespace
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::MAGIC
+ */
+const char megamol::stdplugin::volume::BrickedVolume::MAGIC[8] = {'M', 'M', 'B', 'R', 'I', 'C', 'K', 'V'};
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::VERSION
+ */
+const std::uint32_t megamol::stdplugin::volume::BrickedVolume::VERSION = 1;
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::Convert
+ */
+void megamol::stdplugin::volume::BrickedVolume::Convert(
+    const std::string& datFile, const std::string& outFile, const std::size_t brickSize) {
+    using core::misc::ScalarType_t;
+    using vislib::sys::Log;
+
+    static_assert(sizeof(Header) == 88, "The header of bricked volumes has no padding.");
+
+    if (brickSize < 2) {
+        throw vislib::Exception("The brick size must be at least 2.", __FILE__, __LINE__);
+    }
+
+    /* Read and check the dat file. */
+    DatRawFileInfo info;
+    ::memset(&info, 0, sizeof(info));
+    if (::datRaw_readHeader(datFile.c_str(), &info, nullptr) == 0) {
+        throw vislib::Exception(("Failed to read the dat file \"" + datFile + "\".").c_str(), __FILE__, __LINE__);
+    }
+    std::shared_ptr<DatRawFileInfo> infoGuard(&info, [](DatRawFileInfo* i) { ::datRaw_freeInfo(i); });
+
+    if ((info.dimensions != 3) || (info.gridType != DR_GRID_CARTESIAN)) {
+        throw vislib::Exception("Only three-dimensional cartesian grids can be bricked.", __FILE__, __LINE__);
+    }
+    {
+        std::uint16_t word = 0x0001;
+        auto isLittleEndian = (*reinterpret_cast<std::uint8_t*>(&word) != 0);
+        if (info.byteOrder != (isLittleEndian ? DR_LITTLE_ENDIAN : DR_BIG_ENDIAN)) {
+            throw vislib::Exception(
+                "The byte order of the raw file does not match the one of this machine.", __FILE__, __LINE__);
+        }
+    }
+
+    /* Build the header of the output. */
+    BrickedVolume layout;
+    auto& header = layout.header;
+    ::memcpy(header.Magic, BrickedVolume::MAGIC, sizeof(header.Magic));
+    header.Version = BrickedVolume::VERSION;
+    header.Components = static_cast<std::uint32_t>(info.numComponents);
+    header.ScalarLength = static_cast<std::uint32_t>(::datRaw_getFormatSize(info.dataFormat));
+    switch (info.dataFormat) {
+    case DR_FORMAT_CHAR:
+    case DR_FORMAT_SHORT:
+    case DR_FORMAT_INT:
+    case DR_FORMAT_LONG:
+        header.ScalarType = ScalarType_t::SIGNED_INTEGER;
+        break;
+
+    case DR_FORMAT_UCHAR:
+    case DR_FORMAT_USHORT:
+    case DR_FORMAT_UINT:
+    case DR_FORMAT_ULONG:
+        header.ScalarType = ScalarType_t::UNSIGNED_INTEGER;
+        break;
+
+    case DR_FORMAT_FLOAT:
+    case DR_FORMAT_DOUBLE:
+        header.ScalarType = ScalarType_t::FLOATING_POINT;
+        break;
+
+    default:
+        throw vislib::Exception("The scalar type of the volume is not supported for bricking.", __FILE__, __LINE__);
+    }
+    for (int i = 0; i < 3; ++i) {
+        header.Resolution[i] = static_cast<std::uint64_t>(info.resolution[i]);
+        header.Origin[i] = (info.origin != nullptr) ? info.origin[i] : 0.0f;
+        header.SliceDists[i] = info.sliceDist[i];
+    }
+    header.BrickSize = static_cast<std::uint32_t>(brickSize);
+    header.Frames = static_cast<std::uint64_t>(info.timeSteps);
+
+    /* Add levels until the coarsest one fits into a single brick. */
+    {
+        std::uint64_t res[3] = {header.Resolution[0], header.Resolution[1], header.Resolution[2]};
+        header.Levels = 1;
+        while ((res[0] > brickSize + 1) || (res[1] > brickSize + 1) || (res[2] > brickSize + 1)) {
+            for (int i = 0; i < 3; ++i) {
+                res[i] = (res[i] + 1) / 2;
+            }
+            ++header.Levels;
+        }
+    }
+    layout.updateLayout();
+
+    const auto voxelSize = layout.GetVoxelSize();
+    const auto frameSize = ::datRaw_getBufferSize(&info, info.dataFormat);
+    const auto cntBricks = layout.CountBricks();
+    layout.minValues.assign(header.Components, (std::numeric_limits<double>::max)());
+    layout.maxValues.assign(header.Components, std::numeric_limits<double>::lowest());
+    layout.offsets.assign(cntBricks * header.Frames, 0);
+
+    /* Write the header and reserve space for the tables. */
+    std::fstream out(outFile, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw vislib::Exception(("Failed to create \"" + outFile + "\".").c_str(), __FILE__, __LINE__);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const auto rangePos = static_cast<std::streamoff>(out.tellp());
+    out.write(reinterpret_cast<const char*>(layout.minValues.data()), header.Components * sizeof(double));
+    out.write(reinterpret_cast<const char*>(layout.maxValues.data()), header.Components * sizeof(double));
+    out.write(reinterpret_cast<const char*>(layout.offsets.data()), layout.offsets.size() * sizeof(std::uint64_t));
+
+    /* Appends the bricks of row 'bz' taken from 'slab' starting at 'slabZ0'. */
+    auto writeBricks = [&](const unsigned int frame, const unsigned int level, const std::size_t bz,
+                           const std::vector<std::uint8_t>& slab, const std::size_t slabZ0) {
+        std::size_t res[3], grid[3], off[3], bres[3];
+        std::vector<std::uint8_t> brick;
+        layout.GetLevelResolution(level, res);
+        layout.GetBrickGrid(level, grid);
+
+        out.seekp(0, std::ios::end);
+        for (std::size_t by = 0; by < grid[1]; ++by) {
+            for (std::size_t bx = 0; bx < grid[0]; ++bx) {
+                std::size_t idx[3] = {bx, by, bz};
+                layout.GetBrickExtents(level, idx, off, bres);
+                brick.resize(bres[0] * bres[1] * bres[2] * voxelSize);
+
+                for (std::size_t z = 0; z < bres[2]; ++z) {
+                    for (std::size_t y = 0; y < bres[1]; ++y) {
+                        auto s = ((off[2] + z - slabZ0) * res[1] + off[1] + y) * res[0] + off[0];
+                        auto d = (z * bres[1] + y) * bres[0];
+                        ::memcpy(brick.data() + d * voxelSize, slab.data() + s * voxelSize, bres[0] * voxelSize);
+                    }
+                }
+
+                layout.offsets[frame * cntBricks + layout.GetBrickID(level, idx)] =
+                    static_cast<std::uint64_t>(out.tellp());
+                out.write(reinterpret_cast<const char*>(brick.data()), brick.size());
+            }
+        }
+
+        if (!out) {
+            throw vislib::Exception(("Failed to write to \"" + outFile + "\".").c_str(), __FILE__, __LINE__);
+        }
+    };
+
+    /* Reads the slices [z0, z1[ of a level written before into 'slab'. */
+    auto readSlices = [&](const unsigned int frame, const unsigned int level, const std::size_t z0,
+                          const std::size_t z1, std::vector<std::uint8_t>& slab) {
+        std::size_t res[3], grid[3], off[3], bres[3];
+        std::vector<std::uint8_t> brick;
+        layout.GetLevelResolution(level, res);
+        layout.GetBrickGrid(level, grid);
+        slab.resize(res[0] * res[1] * (z1 - z0) * voxelSize);
+
+        auto bzEnd = std::min((z1 - 1) / brickSize + 1, grid[2]);
+        for (std::size_t bz = z0 / brickSize; bz < bzEnd; ++bz) {
+            for (std::size_t by = 0; by < grid[1]; ++by) {
+                for (std::size_t bx = 0; bx < grid[0]; ++bx) {
+                    std::size_t idx[3] = {bx, by, bz};
+                    layout.GetBrickExtents(level, idx, off, bres);
+                    brick.resize(bres[0] * bres[1] * bres[2] * voxelSize);
+                    out.seekg(layout.offsets[frame * cntBricks + layout.GetBrickID(level, idx)]);
+                    out.read(reinterpret_cast<char*>(brick.data()), brick.size());
+
+                    auto zBegin = std::max(off[2], z0);
+                    auto zEnd = std::min(off[2] + bres[2], z1);
+                    for (auto z = zBegin; z < zEnd; ++z) {
+                        for (std::size_t y = 0; y < bres[1]; ++y) {
+                            auto s = ((z - off[2]) * bres[1] + y) * bres[0];
+                            auto d = ((z - z0) * res[1] + off[1] + y) * res[0] + off[0];
+                            ::memcpy(slab.data() + d * voxelSize, brick.data() + s * voxelSize, bres[0] * voxelSize);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!out) {
+            throw vislib::Exception(("Failed to read back from \"" + outFile + "\".").c_str(), __FILE__, __LINE__);
+        }
+    };
+
+    std::vector<std::uint8_t> src, dst;
+    for (unsigned int f = 0; f < header.Frames; ++f) {
+        Log::DefaultLog.WriteInfo("Bricking frame %u of %u ...", f + 1, static_cast<unsigned int>(header.Frames));
+
+        /* Open the raw data of the frame. */
+        std::string rawFile;
+        std::streamoff rawOffset = info.dataOffset;
+        if (info.multiDataFiles) {
+            auto fileName = ::getMultifileFilename(&info, static_cast<int>(f));
+            if (fileName == nullptr) {
+                throw vislib::Exception("Failed to determine the raw file of a frame.", __FILE__, __LINE__);
+            }
+            rawFile = fileName;
+            ::free(fileName);
+        } else {
+            rawFile = info.dataFileName;
+            rawOffset += static_cast<std::streamoff>(f) * frameSize;
+        }
+
+        std::ifstream raw(rawFile, std::ios::binary);
+        if (!raw.is_open()) {
+            throw vislib::Exception(("Failed to open \"" + rawFile + "\".").c_str(), __FILE__, __LINE__);
+        }
+        {
+            unsigned char magic[2] = {0, 0};
+            raw.read(reinterpret_cast<char*>(magic), sizeof(magic));
+            if ((magic[0] == 0x1f) && (magic[1] == 0x8b)) {
+                throw vislib::Exception(
+                    "Compressed raw files must be decompressed before bricking.", __FILE__, __LINE__);
+            }
+        }
+
+        /* Level 0: read slabs of brickSize + 1 slices from the raw file. */
+        {
+            std::size_t res[3], grid[3];
+            layout.GetLevelResolution(0, res);
+            layout.GetBrickGrid(0, grid);
+            const auto sliceSize = res[0] * res[1] * voxelSize;
+
+            for (std::size_t bz = 0; bz < grid[2]; ++bz) {
+                auto z0 = bz * brickSize;
+                auto z1 = std::min(z0 + brickSize + 1, res[2]);
+                src.resize((z1 - z0) * sliceSize);
+                raw.clear();
+                raw.seekg(rawOffset + static_cast<std::streamoff>(z0 * sliceSize));
+                raw.read(reinterpret_cast<char*>(src.data()), src.size());
+                if (!raw) {
+                    throw vislib::Exception(("Failed to read from \"" + rawFile + "\".").c_str(), __FILE__, __LINE__);
+                }
+
+                dispatchScalar(header, [&](auto tag) {
+                    updateRange<decltype(tag)>(src.data(), src.size() / voxelSize, header.Components,
+                        layout.minValues, layout.maxValues);
+                });
+                writeBricks(f, 0, bz, src, z0);
+            }
+        }
+
+        /* Coarser levels: reduce the slices of the previous level. */
+        for (unsigned int l = 1; l < header.Levels; ++l) {
+            std::size_t srcRes[3], res[3], grid[3];
+            layout.GetLevelResolution(l - 1, srcRes);
+            layout.GetLevelResolution(l, res);
+            layout.GetBrickGrid(l, grid);
+
+            for (std::size_t bz = 0; bz < grid[2]; ++bz) {
+                auto z0 = bz * brickSize;
+                auto z1 = std::min(z0 + brickSize + 1, res[2]);
+                auto srcZ0 = 2 * z0;
+                auto srcZ1 = std::min(2 * z1, srcRes[2]);
+                readSlices(f, l - 1, srcZ0, srcZ1, src);
+
+                dst.resize(res[0] * res[1] * (z1 - z0) * voxelSize);
+                dispatchScalar(header, [&](auto tag) {
+                    downsample<decltype(tag)>(
+                        src.data(), srcRes, srcZ0, dst.data(), res, z0, z1, header.Components);
+                });
+                writeBricks(f, l, bz, dst, z0);
+            }
+        }
+    }
+
+    /* Write the final tables. */
+    out.seekp(rangePos);
+    out.write(reinterpret_cast<const char*>(layout.minValues.data()), header.Components * sizeof(double));
+    out.write(reinterpret_cast<const char*>(layout.maxValues.data()), header.Components * sizeof(double));
+    out.write(reinterpret_cast<const char*>(layout.offsets.data()), layout.offsets.size() * sizeof(std::uint64_t));
+    out.close();
+    if (out.fail()) {
+        throw vislib::Exception(("Failed to write to \"" + outFile + "\".").c_str(), __FILE__, __LINE__);
+    }
+
+    Log::DefaultLog.WriteInfo("Wrote %u levels of %u bricks per frame to \"%s\".", header.Levels,
+        static_cast<unsigned int>(cntBricks), outFile.c_str());
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::IsBrickedVolume
+ */
+bool megamol::stdplugin::volume::BrickedVolume::IsBrickedVolume(const std::string& path) {
+    char magic[sizeof(MAGIC)];
+    std::ifstream file(path, std::ios::binary);
+    file.read(magic, sizeof(magic));
+    return file && (::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0);
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::BrickedVolume
+ */
+megamol::stdplugin::volume::BrickedVolume::BrickedVolume(void) {
+    ::memset(&this->header, 0, sizeof(this->header));
+    this->updateLayout();
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::~BrickedVolume
+ */
+megamol::stdplugin::volume::BrickedVolume::~BrickedVolume(void) { this->Close(); }
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::Close
+ */
+void megamol::stdplugin::volume::BrickedVolume::Close(void) {
+    std::lock_guard<std::mutex> l(this->lock);
+    if (this->file.is_open()) {
+        this->file.close();
+    }
+    ::memset(&this->header, 0, sizeof(this->header));
+    this->maxValues.clear();
+    this->minValues.clear();
+    this->offsets.clear();
+    this->updateLayout();
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::GetBrickGrid
+ */
+void megamol::stdplugin::volume::BrickedVolume::GetBrickGrid(const unsigned int level, std::size_t outGrid[3]) const {
+    this->GetLevelResolution(level, outGrid);
+    for (int i = 0; i < 3; ++i) {
+        // Bricks overlap by one voxel, so the last voxel needs no extra brick.
+        outGrid[i] = (outGrid[i] > 1) ? (outGrid[i] - 2) / this->header.BrickSize + 1 : 1;
+    }
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::GetBrickExtents
+ */
+void megamol::stdplugin::volume::BrickedVolume::GetBrickExtents(const unsigned int level,
+    const std::size_t index[3], std::size_t outOffset[3], std::size_t outResolution[3]) const {
+    std::size_t res[3];
+    this->GetLevelResolution(level, res);
+    for (int i = 0; i < 3; ++i) {
+        outOffset[i] = index[i] * this->header.BrickSize;
+        outResolution[i] = std::min<std::size_t>(this->header.BrickSize + 1, res[i] - outOffset[i]);
+    }
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::GetBrickID
+ */
+std::size_t megamol::stdplugin::volume::BrickedVolume::GetBrickID(
+    const unsigned int level, const std::size_t index[3]) const {
+    std::size_t grid[3];
+    this->GetBrickGrid(level, grid);
+    return this->firstBrick[level] + (index[2] * grid[1] + index[1]) * grid[0] + index[0];
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::GetBrickSize
+ */
+std::size_t megamol::stdplugin::volume::BrickedVolume::GetBrickSize(
+    const unsigned int level, const std::size_t index[3]) const {
+    std::size_t off[3], res[3];
+    this->GetBrickExtents(level, index, off, res);
+    return res[0] * res[1] * res[2] * this->GetVoxelSize();
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::GetLevelResolution
+ */
+void megamol::stdplugin::volume::BrickedVolume::GetLevelResolution(
+    const unsigned int level, std::size_t outResolution[3]) const {
+    for (int i = 0; i < 3; ++i) {
+        outResolution[i] = static_cast<std::size_t>(this->header.Resolution[i]);
+        for (unsigned int l = 0; l < level; ++l) {
+            outResolution[i] = (outResolution[i] + 1) / 2;
+        }
+    }
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::Open
+ */
+void megamol::stdplugin::volume::BrickedVolume::Open(const std::string& path) {
+    this->Close();
+
+    std::lock_guard<std::mutex> l(this->lock);
+    this->file.open(path, std::ios::binary);
+    if (!this->file.is_open()) {
+        throw vislib::Exception(("Failed to open \"" + path + "\".").c_str(), __FILE__, __LINE__);
+    }
+
+    this->file.read(reinterpret_cast<char*>(&this->header), sizeof(this->header));
+    if (!this->file || (::memcmp(this->header.Magic, MAGIC, sizeof(MAGIC)) != 0)) {
+        this->file.close();
+        throw vislib::FormatException(
+            ("\"" + path + "\" is not a bricked volume file.").c_str(), __FILE__, __LINE__);
+    }
+    if ((this->header.Version != VERSION) || (this->header.BrickSize < 2) || (this->header.Levels < 1)) {
+        this->file.close();
+        throw vislib::FormatException(
+            ("\"" + path + "\" has an unsupported version or layout.").c_str(), __FILE__, __LINE__);
+    }
+    this->updateLayout();
+
+    this->minValues.resize(this->header.Components);
+    this->maxValues.resize(this->header.Components);
+    this->offsets.resize(this->CountBricks() * this->header.Frames);
+    this->file.read(reinterpret_cast<char*>(this->minValues.data()), this->minValues.size() * sizeof(double));
+    this->file.read(reinterpret_cast<char*>(this->maxValues.data()), this->maxValues.size() * sizeof(double));
+    this->file.read(
+        reinterpret_cast<char*>(this->offsets.data()), this->offsets.size() * sizeof(std::uint64_t));
+    if (!this->file) {
+        this->file.close();
+        throw vislib::FormatException(("The brick table of \"" + path + "\" is truncated.").c_str(), __FILE__, __LINE__);
+    }
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::ReadBrick
+ */
+void megamol::stdplugin::volume::BrickedVolume::ReadBrick(
+    const unsigned int frame, const unsigned int level, const std::size_t index[3], void* dst) {
+    ASSERT(dst != nullptr);
+    auto size = this->GetBrickSize(level, index);
+    auto offset = this->offsets.at(frame * this->CountBricks() + this->GetBrickID(level, index));
+
+    std::lock_guard<std::mutex> l(this->lock);
+    this->file.clear();
+    this->file.seekg(offset);
+    this->file.read(static_cast<char*>(dst), size);
+    if (!this->file) {
+        throw vislib::Exception("Reading a brick from the bricked volume failed.", __FILE__, __LINE__);
+    }
+}
+
+
+/*
+ * megamol::stdplugin::volume::BrickedVolume::updateLayout
+ */
+void megamol::stdplugin::volume::BrickedVolume::updateLayout(void) {
+    this->firstBrick.assign(1, 0);
+    if (this->header.BrickSize > 0) {
+        for (unsigned int l = 0; l < this->header.Levels; ++l) {
+            std::size_t grid[3];
+            this->GetBrickGrid(l, grid);
+            this->firstBrick.push_back(this->firstBrick.back() + grid[0] * grid[1] * grid[2]);
+        }
+    }
+}
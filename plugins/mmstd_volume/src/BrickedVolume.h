@@ -0,0 +1,254 @@
+/*
+ * BrickedVolume.h
+ *
+ * Copyright (C) 2020 by VISUS (Universitaet Stuttgart).
+ * Alle Rechte vorbehalten.
+ */
+
+#ifndef MEGAMOL_MMSTD_VOLUME_BRICKEDVOLUME_H_INCLUDED
+#define MEGAMOL_MMSTD_VOLUME_BRICKEDVOLUME_H_INCLUDED
+#if (defined(_MSC_VER) && (_MSC_VER > 1000))
+#    pragma once
+#endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace megamol {
+namespace stdplugin {
+namespace volume {
+
+/**
+ * Provides access to a bricked, multi-resolution volume file.
+ *
+ * The file stores each frame of a volume as a pyramid of levels of detail.
+ * Level 0 has the full resolution, every following level halves the
+ * resolution of its predecessor using a box filter until the whole level
+ * fits into a single brick. Each level is split into cubic bricks of
+ * BrickSize voxels, which additionally overlap their upper neighbours by one
+ * voxel such that every brick can be interpolated on its own.
+ *
+ * The file starts with a Header, followed by the minimum and maximum values
+ * of each component over all frames, the file offsets of all bricks (frame
+ * by frame, level by level and brick by brick, x running fastest) and
+ * finally the uncompressed brick data. All values are stored in the byte
+ * order of the machine that wrote the file, which must be the same as the
+ * one of the reader.
+ */
+class BrickedVolume {
+
+public:
+    /** The header at the beginning of a bricked volume file. */
+    typedef struct Header_t {
+        char Magic[8];
+        std::uint32_t Version;
+        std::uint32_t Components;
+        std::uint32_t ScalarType;
+        std::uint32_t ScalarLength;
+        std::uint64_t Resolution[3];
+        float Origin[3];
+        float SliceDists[3];
+        std::uint32_t BrickSize;
+        std::uint32_t Levels;
+        std::uint64_t Frames;
+    } Header;
+
+    /** The magic number identifying a bricked volume file. */
+    static const char MAGIC[8];
+
+    /** The file format version written by Convert(). */
+    static const std::uint32_t VERSION;
+
+    /**
+     * Converts a dat/raw data set into a bricked volume file.
+     *
+     * The raw data are read slab by slab and the coarser levels are computed
+     * from the bricks already written to the output file. Therefore, only a
+     * few slabs of brickSize + 1 slices must fit into memory at any time,
+     * not the whole frame.
+     *
+     * Only uncompressed, three-dimensional data on cartesian grids in the
+     * byte order of the converting machine are supported.
+     *
+     * @param datFile   The path to the dat file of the source data set.
+     * @param outFile   The path of the bricked volume file to be written.
+     * @param brickSize The edge length of a brick in voxels.
+     *
+     * @throws vislib::Exception If the source cannot be read, is not
+     *                           supported or if the output cannot be written.
+     */
+    static void Convert(const std::string& datFile, const std::string& outFile, const std::size_t brickSize);
+
+    /**
+     * Answer whether the given file starts with the magic number of a bricked
+     * volume file.
+     *
+     * @param path The path to the file to be tested.
+     *
+     * @return true if the file is a bricked volume, false otherwise.
+     */
+    static bool IsBrickedVolume(const std::string& path);
+
+    /** Ctor. */
+    BrickedVolume(void);
+
+    /** Dtor. */
+    ~BrickedVolume(void);
+
+    /**
+     * Close the file if it is open.
+     */
+    void Close(void);
+
+    /**
+     * Answer the total number of bricks in a single frame.
+     *
+     * @return The number of bricks in all levels of a frame.
+     */
+    inline std::size_t CountBricks(void) const { return this->firstBrick.back(); }
+
+    /**
+     * Answer the grid of bricks of the given level.
+     *
+     * @param level The level of detail.
+     * @param outGrid Receives the number of bricks in x, y and z.
+     */
+    void GetBrickGrid(const unsigned int level, std::size_t outGrid[3]) const;
+
+    /**
+     * Answer the voxel range of the given brick in the coordinates of its
+     * level.
+     *
+     * @param level         The level of detail.
+     * @param index         The position of the brick in the brick grid.
+     * @param outOffset     Receives the first voxel of the brick.
+     * @param outResolution Receives the number of voxels of the brick.
+     */
+    void GetBrickExtents(const unsigned int level, const std::size_t index[3], std::size_t outOffset[3],
+        std::size_t outResolution[3]) const;
+
+    /**
+     * Answer the unique number of a brick within a frame.
+     *
+     * @param level The level of detail.
+     * @param index The position of the brick in the brick grid.
+     *
+     * @return The number of the brick.
+     */
+    std::size_t GetBrickID(const unsigned int level, const std::size_t index[3]) const;
+
+    /**
+     * Answer the size of the given brick in bytes.
+     *
+     * @param level The level of detail.
+     * @param index The position of the brick in the brick grid.
+     *
+     * @return The size of the brick in bytes.
+     */
+    std::size_t GetBrickSize(const unsigned int level, const std::size_t index[3]) const;
+
+    /**
+     * Answer the header of the open file.
+     *
+     * @return The header.
+     */
+    inline const Header& GetHeader(void) const { return this->header; }
+
+    /**
+     * Answer the resolution of the given level.
+     *
+     * @param level The level of detail.
+     * @param outResolution Receives the number of voxels in x, y and z.
+     */
+    void GetLevelResolution(const unsigned int level, std::size_t outResolution[3]) const;
+
+    /**
+     * Answer the maximum value of each component over all frames.
+     *
+     * @return The maximum values.
+     */
+    inline const std::vector<double>& GetMaxValues(void) const { return this->maxValues; }
+
+    /**
+     * Answer the minimum value of each component over all frames.
+     *
+     * @return The minimum values.
+     */
+    inline const std::vector<double>& GetMinValues(void) const { return this->minValues; }
+
+    /**
+     * Answer the size of a single voxel in bytes.
+     *
+     * @return The size of a voxel.
+     */
+    inline std::size_t GetVoxelSize(void) const {
+        return static_cast<std::size_t>(this->header.Components) * this->header.ScalarLength;
+    }
+
+    /**
+     * Answer whether a file is open.
+     *
+     * @return true if a file is open.
+     */
+    inline bool IsOpen(void) const { return this->file.is_open(); }
+
+    /**
+     * Open the given bricked volume file and read its header and brick
+     * table. Any previously opened file is closed.
+     *
+     * @param path The path to the file.
+     *
+     * @throws vislib::Exception If the file cannot be opened or is not a
+     *                           valid bricked volume file.
+     */
+    void Open(const std::string& path);
+
+    /**
+     * Read a brick from the file. This method is thread-safe.
+     *
+     * @param frame The frame to read the brick from.
+     * @param level The level of detail.
+     * @param index The position of the brick in the brick grid.
+     * @param dst   Receives the voxels of the brick. This must be able to
+     *              hold at least GetBrickSize(level, index) bytes.
+     *
+     * @throws vislib::Exception If the brick cannot be read.
+     */
+    void ReadBrick(const unsigned int frame, const unsigned int level, const std::size_t index[3], void* dst);
+
+private:
+    /**
+     * Compute the brick layout of all levels from 'header'.
+     */
+    void updateLayout(void);
+
+    /** The prefix sum of the number of bricks in the levels. */
+    std::vector<std::size_t> firstBrick;
+
+    /** The open file. */
+    std::ifstream file;
+
+    /** The header of the open file. */
+    Header header;
+
+    /** Serialises seeking and reading in 'file'. */
+    std::mutex lock;
+
+    /** The maximum value of each component. */
+    std::vector<double> maxValues;
+
+    /** The minimum value of each component. */
+    std::vector<double> minValues;
+
+    /** The file offsets of all bricks of all frames. */
+    std::vector<std::uint64_t> offsets;
+};
+
+} // namespace volume
+} // namespace stdplugin
+} // namespace megamol
+
+#endif /* MEGAMOL_MMSTD_VOLUME_BRICKEDVOLUME_H_INCLUDED */
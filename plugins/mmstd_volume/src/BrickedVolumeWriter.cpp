@@ -0,0 +1,89 @@
+/*
+ * BrickedVolumeWriter.cpp
+ *
+ * Copyright (C) 2020 by VISUS (Universitaet Stuttgart).
+ * Alle Rechte vorbehalten.
+ */
+#include "stdafx.h"
+#include "BrickedVolumeWriter.h"
+
+#include "BrickedVolume.h"
+
+#include "mmcore/param/FilePathParam.h"
+#include "mmcore/param/IntParam.h"
+#include "vislib/Exception.h"
+#include "vislib/sys/Log.h"
+#include <string>
+
+using namespace megamol;
+using namespace megamol::core;
+using namespace megamol::stdplugin::volume;
+
+/*
+ * BrickedVolumeWriter::BrickedVolumeWriter
+ */
+BrickedVolumeWriter::BrickedVolumeWriter(void)
+    : AbstractDataWriter()
+    , brickSizeSlot("brickSize", "The edge length of a brick in voxels")
+    , datFileSlot("datFile", "The path to the dat file of the data set to be converted")
+    , filenameSlot("filename", "The path to the bricked volume file to be written") {
+
+    this->brickSizeSlot.SetParameter(new param::IntParam(64, 2));
+    this->MakeSlotAvailable(&this->brickSizeSlot);
+
+    this->datFileSlot.SetParameter(new param::FilePathParam(""));
+    this->MakeSlotAvailable(&this->datFileSlot);
+
+    this->filenameSlot.SetParameter(new param::FilePathParam(""));
+    this->MakeSlotAvailable(&this->filenameSlot);
+}
+
+/*
+ * BrickedVolumeWriter::~BrickedVolumeWriter
+ */
+BrickedVolumeWriter::~BrickedVolumeWriter(void) { this->Release(); }
+
+/*
+ * BrickedVolumeWriter::create
+ */
+bool BrickedVolumeWriter::create(void) { return true; }
+
+/*
+ * BrickedVolumeWriter::release
+ */
+void BrickedVolumeWriter::release(void) {}
+
+/*
+ * BrickedVolumeWriter::run
+ */
+bool BrickedVolumeWriter::run(void) {
+    using vislib::sys::Log;
+    std::string datFile(vislib::StringA(this->datFileSlot.Param<param::FilePathParam>()->Value()).PeekBuffer());
+    std::string filename(vislib::StringA(this->filenameSlot.Param<param::FilePathParam>()->Value()).PeekBuffer());
+    if (datFile.empty()) {
+        Log::DefaultLog.WriteError("No dat file specified. Abort.");
+        return false;
+    }
+    if (filename.empty()) {
+        Log::DefaultLog.WriteError("No file path specified. Abort.");
+        return false;
+    }
+
+    try {
+        auto brickSize = static_cast<std::size_t>(this->brickSizeSlot.Param<param::IntParam>()->Value());
+        BrickedVolume::Convert(datFile, filename, brickSize);
+        Log::DefaultLog.WriteInfo("Bricked volume successfully written to \"%s\"", filename.c_str());
+        return true;
+    } catch (vislib::Exception& e) {
+        Log::DefaultLog.WriteError("Converting \"%s\" failed: %s", datFile.c_str(), e.GetMsgA());
+        return false;
+    }
+}
+
+/*
+ * BrickedVolumeWriter::getCapabilities
+ */
+bool BrickedVolumeWriter::getCapabilities(DataWriterCtrlCall& call) {
+    call.SetAbortable(false);
+    return true;
+}
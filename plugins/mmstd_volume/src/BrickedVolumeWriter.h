@@ -0,0 +1,106 @@
+/*
+ * BrickedVolumeWriter.h
+ *
+ * Copyright (C) 2020 by VISUS (Universitaet Stuttgart).
+ * Alle Rechte vorbehalten.
+ */
+
+#ifndef MEGAMOL_MMSTD_VOLUME_BRICKEDVOLUMEWRITER_H_INCLUDED
+#define MEGAMOL_MMSTD_VOLUME_BRICKEDVOLUMEWRITER_H_INCLUDED
+#if (defined(_MSC_VER) && (_MSC_VER > 1000))
+#    pragma once
+#endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
+
+#include "mmcore/AbstractDataWriter.h"
+#include "mmcore/DataWriterCtrlCall.h"
+#include "mmcore/param/ParamSlot.h"
+
+namespace megamol {
+namespace stdplugin {
+namespace volume {
+
+/*
+ * Converts a dat/raw data set into a bricked multi-resolution volume file,
+ * which VolumetricDataSource can stream brick by brick.
+ */
+class BrickedVolumeWriter : public megamol::core::AbstractDataWriter {
+public:
+    /**
+     * Answer the name of this module.
+     *
+     * @return The name of this module.
+     */
+    static const char* ClassName(void) { return "BrickedVolumeWriter"; }
+
+    /**
+     * Answer a human readable description of this module.
+     *
+     * @return A human readable description of this module.
+     */
+    static const char* Description(void) { return "Converts dat/raw files into bricked multi-resolution volumes"; }
+
+    /**
+     * Answers whether this module is available on the current system.
+     *
+     * @return 'true' if the module is available, 'false' otherwise.
+     */
+    static bool IsAvailable(void) { return true; }
+
+    /**
+     * Disallow usage in quickstarts
+     *
+     * @return false
+     */
+    static bool SupportQuickstart(void) { return false; }
+
+    /** Ctor. */
+    BrickedVolumeWriter(void);
+
+    /** Dtor. */
+    virtual ~BrickedVolumeWriter(void);
+
+protected:
+    /**
+     * Implementation of 'Create'.
+     *
+     * @return 'true' on success, 'false' otherwise.
+     */
+    virtual bool create(void);
+
+    /**
+     * Implementation of 'Release'.
+     */
+    virtual void release(void);
+
+    /**
+     * The main function
+     *
+     * @return True on success
+     */
+    virtual bool run(void);
+
+    /**
+     * Function querying the writers capabilities
+     *
+     * @param call The call to receive the capabilities
+     *
+     * @return True on success
+     */
+    virtual bool getCapabilities(core::DataWriterCtrlCall& call);
+
+private:
+    /** The edge length of the bricks in voxels */
+    core::param::ParamSlot brickSizeSlot;
+
+    /** The dat file of the data set to be converted */
+    core::param::ParamSlot datFileSlot;
+
+    /** The file name of the file to be written */
+    core::param::ParamSlot filenameSlot;
+};
+
+} // namespace volume
+} // namespace stdplugin
+} // namespace megamol
+
+#endif /* MEGAMOL_MMSTD_VOLUME_BRICKEDVOLUMEWRITER_H_INCLUDED */
@@ -17,8 +17,12 @@
 #include "mmcore/param/IntParam.h"
 #include "mmcore/param/StringParam.h"
 
+#include "vislib/IllegalParamException.h"
 #include "vislib/sys/Log.h"
 
+#include <algorithm>
+#include <cstring>
+
 
 #define STATIC_ARRAY_COUNT(ary) (sizeof(ary) / sizeof(*(ary)))
 
@@ -38,11 +42,13 @@
  */
 megamol::stdplugin::volume::VolumetricDataSource::VolumetricDataSource(void)
     : Base()
+    , brickCacheBytes(0)
     , dataHash(0)
     , fileInfo(nullptr)
     , loaderThread(VolumetricDataSource::loadAsync)
     , paramAsyncSleep("AsyncSleep", "The time in milliseconds that the loader sleeps between two frames.")
     , paramAsyncWake("AsyncWake", "The time in milliseconds after that the loader wakes itself.")
+    , paramBrickCacheSize("BrickCacheSize", "The maximum memory in MB for caching bricks of bricked volumes.")
     , paramBuffers("Buffers", "The number of buffers for loading frames asynchronously.")
     , paramFileName("FileName", "The path to the dat file to be loaded.")
     , paramOutputDataSize("OutputDataSize", "Forces the scalar type to the specified size.")
@@ -60,6 +66,9 @@ megamol::stdplugin::volume::VolumetricDataSource::VolumetricDataSource(void)
     this->paramAsyncWake.SetParameter(new core::param::IntParam(0, 0));
     this->MakeSlotAvailable(&this->paramAsyncWake);
 
+    this->paramBrickCacheSize.SetParameter(new core::param::IntParam(1024, 1));
+    this->MakeSlotAvailable(&this->paramBrickCacheSize);
+
     this->paramBuffers.SetParameter(new core::param::IntParam(2, 2));
     this->MakeSlotAvailable(&this->paramBuffers);
 
@@ -111,6 +120,7 @@ megamol::stdplugin::volume::VolumetricDataSource::VolumetricDataSource(void)
 megamol::stdplugin::volume::VolumetricDataSource::~VolumetricDataSource(void) {
     this->Release();
     ASSERT(this->fileInfo == nullptr);
+    ASSERT(this->bricked == nullptr);
 }
 
 
@@ -233,9 +243,17 @@ bool megamol::stdplugin::volume::VolumetricDataSource::onFileNameChanged(core::p
                                   _T("in preparation for changing the data set."));
     }
 
+    /* Drop all bricks of a previous bricked volume. */
+    this->closeBricked();
+
     /* Read the header. */
     vislib::StringA fileName(this->paramFileName.Param<core::param::FilePathParam>()->Value());
-    if (::datRaw_readHeader(fileName.PeekBuffer(), this->fileInfo, nullptr) != FALSE) {
+    if (BrickedVolume::IsBrickedVolume(fileName.PeekBuffer())) {
+        // The dat/raw header is not used for bricked volumes.
+        SAFE_DELETE(this->fileInfo);
+        this->openBricked(fileName.PeekBuffer());
+
+    } else if (::datRaw_readHeader(fileName.PeekBuffer(), this->fileInfo, nullptr) != FALSE) {
         Log::DefaultLog.WriteInfo(_T("Successfully loaded dat file %hs."), fileName.PeekBuffer());
 
         static_assert(STATIC_ARRAY_COUNT(this->metadata.SliceDists) == STATIC_ARRAY_COUNT(this->metadata.Resolution),
@@ -367,6 +385,9 @@ bool megamol::stdplugin::volume::VolumetricDataSource::onFileNameChanged(core::p
         this->metadata.NumberOfFrames = this->fileInfo->timeSteps;
         Log::DefaultLog.WriteInfo(_T("The data set comprises %u frames."), this->metadata.NumberOfFrames);
 
+        this->metadata.BrickSize = 0;
+        this->metadata.Levels = 1;
+
         /* Compute extents. */
         ::ZeroMemory(this->metadata.Extents, sizeof(this->metadata.Extents));
         for (int d = 0; (d < STATIC_ARRAY_COUNT(this->metadata.Extents)) && (d < this->fileInfo->dimensions); ++d) {
@@ -416,6 +437,173 @@ bool megamol::stdplugin::volume::VolumetricDataSource::onFileNameChanged(core::p
 }
 
 
+/*
+ * megamol::stdplugin::volume::VolumetricDataSource::onGetBricks
+ */
+bool megamol::stdplugin::volume::VolumetricDataSource::onGetBricks(core::Call& call, const bool isTry) {
+    using core::misc::VolumetricDataCall;
+    using core::param::BoolParam;
+    using vislib::sys::Log;
+
+    ASSERT(this->bricked != nullptr);
+
+    try {
+        VolumetricDataCall& c = dynamic_cast<VolumetricDataCall&>(call);
+        c.SetDataHash(this->dataHash);
+
+        bool isAsync = this->paramLoadAsync.Param<BoolParam>()->Value();
+        if (isAsync && this->loaderStatus != LOADER_STATUS_RUNNING) {
+            this->startAsyncLoad();
+        }
+
+        const auto& header = this->bricked->GetHeader();
+        if (c.FrameID() >= header.Frames) {
+            throw vislib::IllegalParamException(_T("The requested frame ")
+                                                _T("does not exist in the bricked volume."),
+                __FILE__, __LINE__);
+        }
+
+        /* Without a brick request, deliver the whole coarsest level. */
+        VolumetricDataCall::BrickRequest request;
+        if (c.IsBrickRequest()) {
+            request = c.GetBrickRequest();
+        } else {
+            request.Level = header.Levels - 1;
+            for (int i = 0; i < 3; ++i) {
+                request.Max[i] = static_cast<size_t>(header.Resolution[i]);
+            }
+        }
+        auto level = (std::min)(request.Level, header.Levels - 1);
+
+        /* Determine the range of bricks overlapping the requested region. */
+        size_t res[3], grid[3], first[3], last[3];
+        size_t cntRequested = 0;
+        bool isEmpty = false;
+        this->bricked->GetLevelResolution(level, res);
+        this->bricked->GetBrickGrid(level, grid);
+        for (int i = 0; i < 3; ++i) {
+            auto lo = request.Min[i] >> level;
+            auto hi = (std::min)((request.Max[i] + (static_cast<size_t>(1) << level) - 1) >> level, res[i]);
+            if (lo >= hi) {
+                isEmpty = true;
+                break;
+            }
+            first[i] = (std::min)(lo / header.BrickSize, grid[i] - 1);
+            last[i] = (std::min)((hi - 1) / header.BrickSize, grid[i] - 1);
+        }
+        if (!isEmpty) {
+            cntRequested = (last[0] - first[0] + 1) * (last[1] - first[1] + 1) * (last[2] - first[2] + 1);
+        }
+
+        /* Look up or create the bricks and pin them. */
+        std::vector<std::shared_ptr<BrickSlot>> slots;
+        bool isQueued = false;
+        if (!isEmpty) {
+            std::lock_guard<std::mutex> l(this->lockBricks);
+            for (size_t z = first[2]; z <= last[2]; ++z) {
+                for (size_t y = first[1]; y <= last[1]; ++y) {
+                    for (size_t x = first[0]; x <= last[0]; ++x) {
+                        size_t index[3] = {x, y, z};
+                        auto key = static_cast<std::uint64_t>(c.FrameID()) * this->bricked->CountBricks() +
+                                   this->bricked->GetBrickID(level, index);
+
+                        std::shared_ptr<BrickSlot> slot;
+                        auto it = this->brickIndex.find(key);
+                        if (it != this->brickIndex.end()) {
+                            // Mark the brick as being most recently used.
+                            this->brickCache.splice(this->brickCache.begin(), this->brickCache, it->second);
+                            slot = *it->second;
+                        } else if (!isTry || isAsync) {
+                            slot = std::make_shared<BrickSlot>();
+                            slot->FrameID = c.FrameID();
+                            slot->Level = level;
+                            ::memcpy(slot->Index, index, sizeof(index));
+                            slot->pins.store(0);
+                            slot->status.store(BUFFER_STATUS_UNUSED);
+                            this->brickCache.push_front(slot);
+                            this->brickIndex[key] = this->brickCache.begin();
+                            this->brickCacheBytes += this->bricked->GetBrickSize(level, index);
+                        } else {
+                            continue;
+                        }
+
+                        if (isAsync && (slot->status.load() == BUFFER_STATUS_UNUSED)) {
+                            slot->status.store(BUFFER_STATUS_PENDING);
+                            this->brickQueue.push_back(slot);
+                            isQueued = true;
+                        }
+
+                        ++slot->pins;
+                        slots.push_back(slot);
+                    }
+                }
+            }
+
+            this->evictBricksUnsafe();
+        } /* end if (!isEmpty) */
+
+        if (isQueued) {
+            this->evtStartLoading.Set();
+        }
+
+        /* Complete the bricks unless the caller only asks for available ones. */
+        if (!isTry) {
+            if (isAsync) {
+                // Stop waiting if the loader is suspended or stopped, because it
+                // will not load the pending bricks. It completes a brick it is
+                // already loading, though.
+                std::unique_lock<std::mutex> l(this->lockBricks);
+                this->cvBrickLoaded.wait(l, [this, &slots](void) {
+                    auto isRunning = (this->loaderStatus.load() == LOADER_STATUS_RUNNING);
+                    return std::all_of(slots.begin(), slots.end(), [isRunning](const std::shared_ptr<BrickSlot>& s) {
+                        auto status = s->status.load();
+                        return (status != BUFFER_STATUS_LOADING) && (!isRunning || (status != BUFFER_STATUS_PENDING));
+                    });
+                });
+            }
+
+            // Load whatever the loader thread has not loaded.
+            for (auto& s : slots) {
+                int expecteds[] = {BUFFER_STATUS_UNUSED, BUFFER_STATUS_PENDING};
+                if (VolumetricDataSource::spinExchange(
+                        s->status, BUFFER_STATUS_LOADING, expecteds, STATIC_ARRAY_COUNT(expecteds), true)) {
+                    this->loadBrick(*s);
+                }
+            }
+        } /* end if (!isTry) */
+
+        /* Pass all bricks which are ready and unpin the others. */
+        auto unlocker = new BrickSlotUnlocker();
+        for (auto& s : slots) {
+            if (s->status.load() == BUFFER_STATUS_READY) {
+                VolumetricDataCall::Brick brick;
+                brick.Level = s->Level;
+                ::memcpy(brick.Index, s->Index, sizeof(brick.Index));
+                this->bricked->GetBrickExtents(s->Level, s->Index, brick.Offset, brick.Resolution);
+                brick.Data = s->Buffer.data();
+                unlocker->AddBrick(s, brick);
+            } else {
+                --s->pins;
+            }
+        }
+
+        c.SetData(nullptr, 0);
+        c.SetBricks(unlocker->GetBricks().data(), unlocker->GetBricks().size(),
+            unlocker->GetBricks().size() == cntRequested);
+        c.SetUnlocker(unlocker);
+        return true;
+
+    } catch (vislib::Exception& e) {
+        Log::DefaultLog.WriteError(1, e.GetMsg());
+        return false;
+    } catch (...) {
+        Log::DefaultLog.WriteError(1, _T("Unexpected exception in callback ")
+                                      _T("onGetBricks (please check the call)."));
+        return false;
+    }
+}
+
+
 /*
  * megamol::stdplugin::volume::VolumetricDataSource::onGetData
  */
@@ -428,6 +616,10 @@ bool megamol::stdplugin::volume::VolumetricDataSource::onGetData(core::Call& cal
     int expected = 0;
     bool retval = false;
 
+    if (this->bricked != nullptr) {
+        return this->onGetBricks(call, false);
+    }
+
     try {
         /* Evaluate parameter changes. */
         bool isAsync = this->paramLoadAsync.Param<BoolParam>()->Value();
@@ -729,7 +921,7 @@ bool megamol::stdplugin::volume::VolumetricDataSource::onGetExtents(core::Call&
         c.SetDataHash(this->dataHash);
 
         /* Sanity check. */
-        if (this->fileInfo == nullptr) {
+        if ((this->fileInfo == nullptr) && (this->bricked == nullptr)) {
             throw vislib::IllegalStateException(_T("A valid dat file must be ")
                                                 _T("loaded before the extents can be retrieved."),
                 __FILE__, __LINE__);
@@ -773,7 +965,7 @@ bool megamol::stdplugin::volume::VolumetricDataSource::onGetMetadata(core::Call&
         c.SetDataHash(this->dataHash);
 
         /* Sanity check. */
-        if (this->fileInfo == nullptr) {
+        if ((this->fileInfo == nullptr) && (this->bricked == nullptr)) {
             throw vislib::IllegalStateException(_T("A valid dat file must be ")
                                                 _T("loaded before the meta data can be retrieved."),
                 __FILE__, __LINE__);
@@ -807,6 +999,10 @@ bool megamol::stdplugin::volume::VolumetricDataSource::onTryGetData(core::Call&
     int expected = 0;
     bool retval = true;
 
+    if (this->bricked != nullptr) {
+        return this->onGetBricks(call, true);
+    }
+
     try {
         VolumetricDataCall& c = dynamic_cast<VolumetricDataCall&>(call);
         c.SetDataHash(this->dataHash);
@@ -1015,6 +1211,8 @@ void megamol::stdplugin::volume::VolumetricDataSource::release(void) {
                                       _T("stopping volume loader thread during release of data source."));
     }
 
+    this->closeBricked();
+
     if (this->fileInfo != nullptr) {
         Log::DefaultLog.WriteInfo(10, _T("Releasing dat file..."));
         ::datRaw_close(this->fileInfo);
@@ -1066,6 +1264,7 @@ void megamol::stdplugin::volume::VolumetricDataSource::stopAsyncLoad(const bool
         Log::DefaultLog.WriteInfo(_T("Stopping volume loader thread..."));
         this->loaderStatus.store(LOADER_STATUS_STOPPING);
         this->evtStartLoading.Set();
+        this->notifyBrickWaiters();
         if (this->loaderThread.IsRunning() && isWait) {
             this->loaderThread.Join();
             ASSERT(this->loaderStatus.load() == LOADER_STATUS_STOPPED);
@@ -1090,6 +1289,7 @@ bool megamol::stdplugin::volume::VolumetricDataSource::suspendAsyncLoad(const bo
     if (this->loaderStatus.compare_exchange_strong(expected, LOADER_STATUS_PAUSING)) {
         ASSERT(this->loaderThread.IsRunning());
         this->evtStartLoading.Set();
+        this->notifyBrickWaiters();
         if (isWait) {
             while (this->loaderStatus.load() != LOADER_STATUS_PAUSED) {
                 Thread::Reschedule();
@@ -1103,6 +1303,25 @@ bool megamol::stdplugin::volume::VolumetricDataSource::suspendAsyncLoad(const bo
 }
 
 
+/*
+ * megamol::stdplugin::volume::VolumetricDataSource::BrickSlotUnlocker::~BrickSlotUnlocker
+ */
+megamol::stdplugin::volume::VolumetricDataSource::BrickSlotUnlocker::~BrickSlotUnlocker(void) { this->Unlock(); }
+
+
+/*
+ * megamol::stdplugin::volume::VolumetricDataSource::BrickSlotUnlocker::Unlock
+ */
+void megamol::stdplugin::volume::VolumetricDataSource::BrickSlotUnlocker::Unlock(void) {
+    for (auto& s : this->slots) {
+        ASSERT(s->pins.load() > 0);
+        --s->pins;
+    }
+    this->slots.clear();
+    this->bricks.clear();
+}
+
+
 /*
  * megamol::stdplugin::volume::VolumetricDataSource::BufferSlotUnlocker::~BufferSlotUnlocker
  */
@@ -1175,6 +1394,26 @@ DWORD megamol::stdplugin::volume::VolumetricDataSource::loadAsync(void* userData
                 } /* end if (that->buffers[i]->status. ... */
             }     /* end for (size_t i = 0; (i < that->buffers.Count()) ... */
 
+            /* Read the bricks that have been requested in the meantime. */
+            while (that->loaderStatus.load() == LOADER_STATUS_RUNNING) {
+                std::shared_ptr<BrickSlot> slot;
+                {
+                    std::lock_guard<std::mutex> l(that->lockBricks);
+                    if (that->brickQueue.empty()) {
+                        break;
+                    }
+                    slot = that->brickQueue.front();
+                    that->brickQueue.pop_front();
+                }
+
+                // Bricks evicted while being queued have been reset.
+                expected = BUFFER_STATUS_PENDING;
+                if (slot->status.compare_exchange_strong(expected, BUFFER_STATUS_LOADING)) {
+                    that->loadBrick(*slot);
+                    that->notifyBrickWaiters();
+                }
+            }
+
             /*
              * Confirm that we are not loading if the UI requested the loader
              * to suspend loading.
@@ -1323,3 +1562,140 @@ int megamol::stdplugin::volume::VolumetricDataSource::bufferForFrameIDUnsafe(con
 
     return -1;
 }
+
+
+/*
+ * megamol::stdplugin::volume::VolumetricDataSource::closeBricked
+ */
+void megamol::stdplugin::volume::VolumetricDataSource::closeBricked(void) {
+    std::lock_guard<std::mutex> l(this->lockBricks);
+    // Bricks still pinned by a call are kept alive by their unlocker.
+    this->brickQueue.clear();
+    this->brickIndex.clear();
+    this->brickCache.clear();
+    this->brickCacheBytes = 0;
+    this->bricked.reset();
+}
+
+
+/*
+ * megamol::stdplugin::volume::VolumetricDataSource::evictBricksUnsafe
+ */
+void megamol::stdplugin::volume::VolumetricDataSource::evictBricksUnsafe(void) {
+    ASSERT(this->bricked != nullptr);
+    auto budget = static_cast<size_t>(this->paramBrickCacheSize.Param<core::param::IntParam>()->Value()) << 20;
+
+    auto it = this->brickCache.end();
+    while ((this->brickCacheBytes > budget) && (it != this->brickCache.begin())) {
+        --it;
+        auto& s = *it;
+        int status = s->status.load();
+        if ((s->pins.load() == 0) && (status != BUFFER_STATUS_LOADING)) {
+            // A pending brick is still queued, so prevent it from being read.
+            if ((status != BUFFER_STATUS_PENDING) ||
+                s->status.compare_exchange_strong(status, BUFFER_STATUS_DELETING)) {
+                auto key = static_cast<std::uint64_t>(s->FrameID) * this->bricked->CountBricks() +
+                           this->bricked->GetBrickID(s->Level, s->Index);
+                this->brickCacheBytes -= this->bricked->GetBrickSize(s->Level, s->Index);
+                this->brickIndex.erase(key);
+                it = this->brickCache.erase(it);
+            }
+        }
+    }
+}
+
+
+/*
+ * megamol::stdplugin::volume::VolumetricDataSource::loadBrick
+ */
+void megamol::stdplugin::volume::VolumetricDataSource::loadBrick(BrickSlot& slot) {
+    using vislib::sys::Log;
+    ASSERT(slot.status.load() == BUFFER_STATUS_LOADING);
+
+    try {
+        slot.Buffer.resize(this->bricked->GetBrickSize(slot.Level, slot.Index));
+        this->bricked->ReadBrick(slot.FrameID, slot.Level, slot.Index, slot.Buffer.data());
+        slot.status.store(BUFFER_STATUS_READY);
+    } catch (vislib::Exception& e) {
+        Log::DefaultLog.WriteError(_T("Loading brick (%u, %u, %u) of level %u in frame %u failed: %hs"),
+            static_cast<unsigned int>(slot.Index[0]), static_cast<unsigned int>(slot.Index[1]),
+            static_cast<unsigned int>(slot.Index[2]), slot.Level, slot.FrameID, e.GetMsgA());
+        slot.Buffer.clear();
+        slot.status.store(BUFFER_STATUS_UNUSED);
+    } catch (...) {
+        Log::DefaultLog.WriteError(_T("Unexpected exception while loading a brick. Most likely, there is not ")
+                                   _T("enough memory available for the brick cache."));
+        slot.Buffer.clear();
+        slot.status.store(BUFFER_STATUS_UNUSED);
+    }
+}
+
+
+/*
+ * megamol::stdplugin::volume::VolumetricDataSource::notifyBrickWaiters
+ */
+void megamol::stdplugin::volume::VolumetricDataSource::notifyBrickWaiters(void) {
+    {
+        // Waiters test their condition while holding the lock, so acquiring it
+        // here ensures that none misses the notification.
+        std::lock_guard<std::mutex> l(this->lockBricks);
+    }
+    this->cvBrickLoaded.notify_all();
+}
+
+
+/*
+ * megamol::stdplugin::volume::VolumetricDataSource::openBricked
+ */
+bool megamol::stdplugin::volume::VolumetricDataSource::openBricked(const char* path) {
+    using core::misc::VolumetricDataCall;
+    using vislib::sys::Log;
+
+    try {
+        std::unique_ptr<BrickedVolume> volume(new BrickedVolume());
+        volume->Open(path);
+        const auto& header = volume->GetHeader();
+
+        this->metadata.GridType = VolumetricDataCall::GridType::CARTESIAN;
+        this->metadata.ScalarType = static_cast<VolumetricDataCall::ScalarType>(header.ScalarType);
+        this->metadata.ScalarLength = header.ScalarLength;
+        this->metadata.Components = header.Components;
+        this->metadata.NumberOfFrames = static_cast<size_t>(header.Frames);
+        this->metadata.BrickSize = header.BrickSize;
+        this->metadata.Levels = header.Levels;
+        for (int i = 0; i < 3; ++i) {
+            this->brickedSliceDists[i] = header.SliceDists[i];
+            this->metadata.SliceDists[i] = this->brickedSliceDists + i;
+            this->metadata.IsUniform[i] = true;
+            this->metadata.Resolution[i] = static_cast<size_t>(header.Resolution[i]);
+            this->metadata.Origin[i] = header.Origin[i];
+            this->metadata.Extents[i] =
+                header.SliceDists[i] * static_cast<float>(this->metadata.Resolution[i] - 1);
+        }
+
+        this->mins = volume->GetMinValues();
+        this->maxes = volume->GetMaxValues();
+        this->metadata.MinValues = this->mins.data();
+        this->metadata.MaxValues = this->maxes.data();
+
+        Log::DefaultLog.WriteInfo(_T("Successfully opened bricked volume %hs with a resolution of %u x %u x %u, ")
+                                  _T("%u frames, %u levels and bricks of %u voxels."),
+            path, static_cast<unsigned int>(header.Resolution[0]), static_cast<unsigned int>(header.Resolution[1]),
+            static_cast<unsigned int>(header.Resolution[2]), static_cast<unsigned int>(header.Frames), header.Levels,
+            header.BrickSize);
+
+        /* Frames requested from the previous data set are obsolete now. */
+        for (size_t i = 0; i < this->buffers.Count(); ++i) {
+            int expected = BUFFER_STATUS_PENDING;
+            this->buffers[i]->status.compare_exchange_strong(expected, BUFFER_STATUS_UNUSED);
+        }
+
+        std::lock_guard<std::mutex> l(this->lockBricks);
+        this->bricked = std::move(volume);
+        return true;
+
+    } catch (vislib::Exception& e) {
+        Log::DefaultLog.WriteError(1, _T("Failed to open bricked volume %hs: %hs"), path, e.GetMsgA());
+        return false;
+    }
+}
@@ -12,11 +12,19 @@
 #endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
 
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "datRaw.h"
 
+#include "BrickedVolume.h"
+
 #include "mmcore/misc/VolumetricDataCall.h"
 
 #include "mmcore/param/ParamSlot.h"
@@ -34,6 +42,12 @@ namespace stdplugin {
 namespace volume {
 /**
  * Reads volumetric data from a dat/raw data source.
+ *
+ * If the file is a bricked volume written by BrickedVolumeWriter, the data
+ * source serves the bricks requested via VolumetricDataCall::SetBrickRequest
+ * instead of whole frames. Loaded bricks are kept in an LRU cache, and if
+ * asynchronous loading is enabled, missing bricks are read by the loader
+ * thread.
  */
 class VolumetricDataSource : public core::Module {
 
@@ -114,6 +128,18 @@ protected:
      */
     bool onGetData(core::Call& call);
 
+    /**
+     * Serves a brick request (or a request for the coarsest level if the
+     * call has no brick request) from the bricked volume.
+     *
+     * @param call  The calling call.
+     * @param isTry If true, only the bricks which are already available are
+     *              delivered and the caller does not wait for any loading.
+     *
+     * @return 'true' on success, 'false' on failure.
+     */
+    bool onGetBricks(core::Call& call, const bool isTry);
+
     /**
      * Gets the data extents.
      *
@@ -251,6 +277,66 @@ private:
         vislib::Array<BufferSlot*> buffers;
     };
 
+    /** Holds a single brick of a bricked volume. */
+    typedef struct BrickSlot_t {
+        std::vector<std::uint8_t> Buffer;
+        unsigned int FrameID;
+        unsigned int Level;
+        size_t Index[3];
+        std::atomic_int pins;
+        std::atomic_int status;
+    } BrickSlot;
+
+    /**
+     * Class for unpinning the bricks delivered to a call after they have
+     * been rendered.
+     */
+    class BrickSlotUnlocker : public core::AbstractGetDataCall::Unlocker {
+
+    public:
+        /** Initialises a new instance. */
+        inline BrickSlotUnlocker(void) : Base() {}
+
+        /** Dtor. */
+        virtual ~BrickSlotUnlocker(void);
+
+        /**
+         * Add a pinned brick and its description.
+         *
+         * @param slot  The brick, which must have been pinned.
+         * @param brick The description of the brick passed to the call.
+         */
+        inline void AddBrick(std::shared_ptr<BrickSlot> slot, const core::misc::VolumetricDataCall::Brick& brick) {
+            this->slots.push_back(slot);
+            this->bricks.push_back(brick);
+        }
+
+        /**
+         * Answer the descriptions of the bricks.
+         *
+         * @return The descriptions of all bricks added.
+         */
+        inline const std::vector<core::misc::VolumetricDataCall::Brick>& GetBricks(void) const {
+            return this->bricks;
+        }
+
+        /** Unpins the bricks */
+        virtual void Unlock(void);
+
+    private:
+        /** Base class. */
+        typedef core::AbstractGetDataCall::Unlocker Base;
+
+        /** The descriptions of the bricks passed to the call. */
+        std::vector<core::misc::VolumetricDataCall::Brick> bricks;
+
+        /** The pinned bricks. */
+        std::vector<std::shared_ptr<BrickSlot> > slots;
+    };
+
+    /** The list of cached bricks, the most recently used one first. */
+    typedef std::list<std::shared_ptr<BrickSlot> > BrickList;
+
     /** Indicates that a buffer is about to be deleted by the UI thread. */
     static const int BUFFER_STATUS_DELETING;
 
@@ -323,6 +409,42 @@ private:
      */
     size_t assertBuffersUnsafe(size_t cntFrames = 0, bool doNotFree = false);
 
+    /**
+     * Close the bricked volume if any and drop all cached bricks.
+     */
+    void closeBricked(void);
+
+    /**
+     * Evict the least recently used bricks which are not pinned until the
+     * cache fits into the configured budget. The caller must hold
+     * 'lockBricks'.
+     */
+    void evictBricksUnsafe(void);
+
+    /**
+     * Read the given brick from the bricked volume and update its status.
+     *
+     * @param slot The brick to be loaded, which must be in status
+     *             BUFFER_STATUS_LOADING.
+     */
+    void loadBrick(BrickSlot& slot);
+
+    /**
+     * Wake all threads waiting on 'cvBrickLoaded' after a brick has been
+     * loaded or the loader thread has been asked to pause or stop. The
+     * caller must not hold 'lockBricks'.
+     */
+    void notifyBrickWaiters(void);
+
+    /**
+     * Open the given bricked volume and update the metadata from its header.
+     *
+     * @param path The path to the bricked volume file.
+     *
+     * @return true on success, false otherwise.
+     */
+    bool openBricked(const char* path);
+
     /**
      * Search 'buffers' for a slot with the specified frame ID without
      * locking 'lockBuffers'. If no such buffer exists, return a negative
@@ -332,9 +454,30 @@ private:
      */
     int bufferForFrameIDUnsafe(const unsigned int frameID) const;
 
+    /** The number of bytes of all bricks in 'brickCache'. */
+    size_t brickCacheBytes;
+
+    /** The cached bricks, the most recently used one first. */
+    BrickList brickCache;
+
+    /** Maps the frame and number of a brick to its entry in 'brickCache'. */
+    std::unordered_map<std::uint64_t, BrickList::iterator> brickIndex;
+
+    /** The bricks to be read by the loader thread. */
+    std::deque<std::shared_ptr<BrickSlot> > brickQueue;
+
+    /** The bricked volume if such a file is open, nullptr otherwise. */
+    std::unique_ptr<BrickedVolume> bricked;
+
+    /** The slice distances of the bricked volume passed via 'metadata'. */
+    float brickedSliceDists[3];
+
     /** The buffers that volume data can be loaded to. */
     vislib::PtrArray<BufferSlot> buffers;
 
+    /** Signalled whenever the loader thread finished a brick. */
+    std::condition_variable cvBrickLoaded;
+
     /** Hash for the data set. */
     unsigned int dataHash;
 
@@ -347,6 +490,9 @@ private:
     /** The status of the asynchronous loading thread. */
     std::atomic_int loaderStatus;
 
+    /** Protects the brick cache, the brick index and the brick queue. */
+    std::mutex lockBricks;
+
     /** The thread handling asynchronous loading requests. */
     vislib::sys::Thread loaderThread;
 
@@ -369,6 +515,9 @@ private:
      */
     core::param::ParamSlot paramAsyncWake;
 
+    /** The maximum size of the brick cache in megabytes. */
+    core::param::ParamSlot paramBrickCacheSize;
+
     /**
      * The number of buffers that should be allocated for (pre-) loading
      * frames.
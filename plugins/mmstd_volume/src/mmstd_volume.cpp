@@ -13,6 +13,7 @@
 #include "mmcore/versioninfo.h"
 #include "vislib/vislibversion.h"
 
+#include "BrickedVolumeWriter.h"
 #include "BuckyBall.h"
 #include "DatRawWriter.h"
 #include "RaycastVolumeRenderer.h"
@@ -43,6 +44,7 @@ public:
     virtual void registerClasses(void) {
 
         // register modules here:
+        this->module_descriptions.RegisterAutoDescription<megamol::stdplugin::volume::BrickedVolumeWriter>();
         this->module_descriptions.RegisterAutoDescription<megamol::stdplugin::volume::BuckyBall>();
         this->module_descriptions.RegisterAutoDescription<megamol::stdplugin::volume::DatRawWriter>();
         this->module_descriptions.RegisterAutoDescription<megamol::stdplugin::volume::RaycastVolumeRenderer>();
@@ -73,6 +73,7 @@ MapGenerator::MapGenerator(void) : Renderer3DModule(),
 		store_png_button("screenshot::Store Map To PNG", "Stores the molecular surface map to a PNG image file"),
 		store_png_font(vislib::graphics::gl::FontInfo_Verdana),
 		store_png_path("screenshot::Filename for map(PNG)", "Filename of the PNG image file to which the map will be stored"),
+		voronoiIncrementalParam("voronoiIncremental", "Update the Voronoi diagram only around moved atoms for new frames"),
 		zeBindingSiteSlot("bindingSite", "The input binding site data") {
 	this->aoActive.SetParameter(new param::BoolParam(false));
 	this->MakeSlotAvailable(&this->aoActive);
@@ -286,6 +287,9 @@ MapGenerator::MapGenerator(void) : Renderer3DModule(),
 	this->vertices_rebuild = std::vector<float>(0);
 	this->vertices_sphere = std::vector<float>(0);
 
+	this->voronoiIncrementalParam.SetParameter(new param::BoolParam(false));
+	this->MakeSlotAvailable(&this->voronoiIncrementalParam);
+
 	this->voronoiNeeded = false;
 
 	this->zeBindingSiteSlot.SetCompatibleCall<protein_calls::BindingSiteCallDescription>();
@@ -3804,7 +3808,8 @@ bool MapGenerator::Render(Call& call) {
 					std::vector<VoronoiVertex> new_voronoi_vertices;
 					std::vector<VoronoiEdge> new_voronoi_edges;
 					if (!this->voronoiCalc.Update(mdc, new_voronoi_vertices, new_voronoi_edges, 
-							this->probeRadiusSlot.Param<param::FloatParam>()->Value())) {
+							this->probeRadiusSlot.Param<param::FloatParam>()->Value(),
+							this->voronoiIncrementalParam.Param<param::BoolParam>()->Value())) {
 						vislib::sys::Log::DefaultLog.WriteMsg(vislib::sys::Log::LEVEL_ERROR, 
 							"Unable to compute/update the Voronoi Diagram!"
 							"\nPlease contact the developer to fix this.\n");
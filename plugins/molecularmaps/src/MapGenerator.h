@@ -910,6 +910,9 @@ namespace molecularmaps {
 		/** Calculator for the voronoi protein channels */
 		VoronoiChannelCalculator voronoiCalc;
 
+		/** Parameter to update the voronoi diagram incrementally for new frames of the same protein */
+		core::param::ParamSlot voronoiIncrementalParam;
+
 		/** A flag determining whether the voronoi diagram was needed or not */
 		bool voronoiNeeded;
 
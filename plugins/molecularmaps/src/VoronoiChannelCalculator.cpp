@@ -11,6 +11,76 @@ using namespace megamol::core;
 using namespace megamol::molecularmaps;
 using namespace megamol::protein_calls;
 
+namespace {
+
+	/** Atoms moving less than this distance are treated as unmoved by incremental updates. */
+	const double MOVE_EPSILON = 1.0e-4;
+
+	/** Tolerance for sphere intersections when validating updated Voronoi vertices. */
+	const double INTERSECTION_EPSILON = 1.0e-3;
+
+	/**
+	 * Uniform hashed bins of a subset of the atoms, used to find atoms intersecting a sphere.
+	 */
+	class SphereBins {
+	public:
+		SphereBins(const std::vector<vec4d>& p_atoms, const std::vector<uint>& p_ids, const double p_cell_size)
+				: atoms(p_atoms), cell_size(p_cell_size), max_radius(0.0) {
+			for (auto id : p_ids) {
+				this->cells[this->key(this->coord(p_atoms[id].GetX()), this->coord(p_atoms[id].GetY()),
+					this->coord(p_atoms[id].GetZ()))].push_back(id);
+				this->max_radius = std::max(this->max_radius, p_atoms[id].GetW());
+			}
+		}
+
+		/**
+		 * Answer whether any binned atom other than the four defining ones intersects the sphere.
+		 */
+		bool Intersects(const vec4d& p_sphere, const vec4ui& p_ignore) const {
+			if (this->cells.empty()) return false;
+			double reach = p_sphere.GetW() + this->max_radius;
+			int x0 = this->coord(p_sphere.GetX() - reach), x1 = this->coord(p_sphere.GetX() + reach);
+			int y0 = this->coord(p_sphere.GetY() - reach), y1 = this->coord(p_sphere.GetY() + reach);
+			int z0 = this->coord(p_sphere.GetZ() - reach), z1 = this->coord(p_sphere.GetZ() + reach);
+			for (int z = z0; z <= z1; z++) {
+				for (int y = y0; y <= y1; y++) {
+					for (int x = x0; x <= x1; x++) {
+						auto it = this->cells.find(this->key(x, y, z));
+						if (it == this->cells.end()) continue;
+						for (auto id : it->second) {
+							if (id == p_ignore.GetX() || id == p_ignore.GetY() || 
+									id == p_ignore.GetZ() || id == p_ignore.GetW()) continue;
+							const auto& a = this->atoms[id];
+							double dx = a.GetX() - p_sphere.GetX();
+							double dy = a.GetY() - p_sphere.GetY();
+							double dz = a.GetZ() - p_sphere.GetZ();
+							double dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+							if (dist < p_sphere.GetW() + a.GetW() - INTERSECTION_EPSILON) return true;
+						}
+					}
+				}
+			}
+			return false;
+		}
+
+	private:
+		int coord(const double p_value) const {
+			return static_cast<int>(std::floor(p_value / this->cell_size));
+		}
+
+		int64_t key(const int p_x, const int p_y, const int p_z) const {
+			return (static_cast<int64_t>(p_x & 0x1FFFFF) << 42) | (static_cast<int64_t>(p_y & 0x1FFFFF) << 21) |
+				static_cast<int64_t>(p_z & 0x1FFFFF);
+		}
+
+		const std::vector<vec4d>& atoms;
+		double cell_size;
+		double max_radius;
+		std::unordered_map<int64_t, std::vector<uint>> cells;
+	};
+
+} /* end anonymous namespace */
+
 /*
  * VoronoiChannelCalculator::~VoronoiChannelCalculator
  */
@@ -22,7 +92,8 @@ VoronoiChannelCalculator::~VoronoiChannelCalculator(void) {
 /*
  * VoronoiChannelCalculator::VoronoiChannelCalculator
  */
-VoronoiChannelCalculator::VoronoiChannelCalculator(void) : AbstractLocalRenderer(), resultAvailable(false) {
+VoronoiChannelCalculator::VoronoiChannelCalculator(void) : AbstractLocalRenderer(), resultAvailable(false),
+		voronoi_id(0), pending_gates(0) {
 }
 
 /*
@@ -41,7 +112,7 @@ void VoronoiChannelCalculator::checkVertexAndGateValidity(MolecularDataCall* mdc
 	// Loop over all vertices.
 	for (auto it = this->voronoi_vertices.begin(); it != this->voronoi_vertices.end(); it++) {
 		// A vertex is valid if its radius is greater than the probe radius and if it is no infinity vertex.
-		this->vertexValidFlags[i] = ((this->vertices[i].GetW() >= this->probeRadius) && !(it->second.infinity_count > 2));
+		this->vertexValidFlags[i] = ((this->vertices[i].GetW() >= this->probeRadius) && !(it->infinity_count > 2));
 		if (this->vertexValidFlags[i]) {
 			valid_vertices.emplace_back(std::make_pair(i, this->vertices[i]));
 		}
@@ -52,7 +123,7 @@ void VoronoiChannelCalculator::checkVertexAndGateValidity(MolecularDataCall* mdc
 		}
 
 		// Check if the vertex is at infinity, i.e. from that vertex no other vertices could be reached.
-		if (it->second.infinity_count > 2) {
+		if (it->infinity_count > 2) {
 			filtered_inf_vertices++;
 		}
 		i++;
@@ -228,6 +299,9 @@ bool VoronoiChannelCalculator::constructVoronoiDiagram(MolecularDataCall* mdc) {
 			mdc->AtomTypes()[mdc->AtomTypeIndices()[i]].Radius());
 	}
 
+	// Remember the atoms for incremental updates of the diagram.
+	this->diagram_atoms = atomData;
+
 	// Add the four start vertices to the atom list. They will be removed later on.
 	atomData.push_back(start1);
 	atomData.push_back(start2);
@@ -321,47 +395,59 @@ bool VoronoiChannelCalculator::constructVoronoiDiagram(MolecularDataCall* mdc) {
 	g4.first = this->initVertex;
 	g4.second = { s1Idx, s2Idx, s4Idx, s3Idx, 0 };
 
-	// Put the gate in the active queue.
-	this->active_gates = 0;
-	this->gatesToTest_one.push_back(g4);
-	this->gatesToTest_one.push_back(g3);
-	this->gatesToTest_one.push_back(g2);
-	this->gatesToTest_one.push_back(g1);
-
-	// Initialise the list of Voronoi vertices and edges.
-	this->voronoi_edges.reserve(20 * this->searchGrid.GetAtoms().size());
-	this->vertices.reserve(20 * this->searchGrid.GetAtoms().size());
+	// Distribute the gates of the start vertex over the worker queues.
+	this->stopThreads();
+	this->worker_queues.clear();
+	for (size_t i = 0; i < core_num; i++) {
+		this->worker_queues.emplace_back(new GateQueue());
+	}
+	this->worker_results = std::vector<WorkerResult>(core_num);
+	for (auto& shard : this->vertex_shards) {
+		shard.ids.clear();
+	}
+	std::array<Gate, 4> startGates{ g4, g3, g2, g1 };
+	for (size_t i = 0; i < startGates.size(); i++) {
+		this->worker_queues[i % core_num]->gates.push_back(startGates[i]);
+	}
+	this->pending_gates = startGates.size();
 
 	// Convert the intial Voronoi vertex to a Voronoi vertex and add it to the list.
 	this->voronoi_id = 0;
-	auto vertex = VoronoiVertex(initVertexBorder, this->voronoi_id++);
-	this->voronoi_vertices.insert(std::pair<uint64_t, VoronoiVertex>(vertex.vertex_hash, vertex));
-	this->vertices.push_back(this->initVertex);
+	uint initId = 0;
+	this->findOrInsertVertex(VoronoiVertex::ComputeHash(initVertexBorder), initId);
+	this->worker_results[0].vertices.emplace_back(VoronoiVertex(initVertexBorder, initId), this->initVertex);
 
-	// Use the threadpool to compute all Voronoi vertices.
-	this->stopThreads();
+	// Let the workers compute all Voronoi vertices. Each worker keeps the gates it creates
+	// and only steals from the others once its own queue is empty.
 	this->voronoi_threads = std::vector<std::thread>(core_num);
-	stop = 0;
-	while (stop != 2) {
-		// Compute the active gates and push the new gates to the inactive queue.
-		stop = 0;
-		for (size_t i = 0; i < this->voronoi_threads.size(); i++) {
-			this->voronoi_threads[i] = std::thread(std::bind(
-				&VoronoiChannelCalculator::nextVoronoiVertex, this));
-		}
-		
-		// Wait for all threads to finish and swap the active an inactive queue.
-		this->stopThreads();
-		this->active_gates = (this->active_gates + 1) % 2;
+	for (size_t i = 0; i < this->voronoi_threads.size(); i++) {
+		this->voronoi_threads[i] = std::thread(std::bind(
+			&VoronoiChannelCalculator::nextVoronoiVertex, this, i));
+	}
+	this->stopThreads();
 
-		// If both queues are empty we found all vertices.
-		if (this->gatesToTest_one.empty()) {
-			stop++;
+	// Merge the results of the workers, the vertex IDs are unique across all of them.
+	size_t edge_cnt = 0;
+	for (const auto& result : this->worker_results) {
+		edge_cnt += result.edges.size();
+	}
+	this->voronoi_vertices.resize(this->voronoi_id);
+	this->vertices.resize(this->voronoi_id);
+	this->voronoi_edges.reserve(edge_cnt);
+	for (auto& result : this->worker_results) {
+		for (const auto& vertex : result.vertices) {
+			this->voronoi_vertices[vertex.first.id] = vertex.first;
+			this->vertices[vertex.first.id] = vertex.second;
 		}
-		if (this->gatesToTest_two.empty()) {
-			stop++;
+		this->voronoi_edges.insert(this->voronoi_edges.end(), result.edges.begin(), result.edges.end());
+	}
+	for (const auto& result : this->worker_results) {
+		for (const auto id : result.infinity_hits) {
+			this->voronoi_vertices[id].infinity_count++;
 		}
 	}
+	this->worker_results.clear();
+	this->worker_queues.clear();
 
 	// Clear the search grid and free all used memory.
 	std::thread cleanup([&]() {
@@ -373,41 +459,174 @@ bool VoronoiChannelCalculator::constructVoronoiDiagram(MolecularDataCall* mdc) {
 }
 
 /*
- * VoronoiChannelCalculator::nextVoronoiVertex
+ * VoronoiChannelCalculator::updateVoronoiDiagram
  */
-void VoronoiChannelCalculator::nextVoronoiVertex() {
-	std::array<vec3d, 2> circles{ vec3d(), vec3d() };
-	std::pair<vec4d, std::array<uint, 5>> gate;
-	std::array<vec4d, 2> gateCenter{ vec4d(), vec4d() };
-	std::array<vec4d, 2> incircle{ vec4d(), vec4d() };
-	std::array<vec4d, 2> sphereVec{ vec4d(), vec4d() };
-	bool stop = false;
-	while (!stop) {
-		// Get the gate and remove it from the queue.
-		this->voronoi_mutex.lock();
-		if (this->active_gates == 0) {
-			// If the thread waited so long that the active queue is now empty we can stop it.
-			if (this->gatesToTest_one.empty()) {
-				this->voronoi_mutex.unlock();
-				break;
-			}
+bool VoronoiChannelCalculator::updateVoronoiDiagram(MolecularDataCall* mdc) {
+	// An update is only possible for an existing diagram of the same atoms.
+	if (this->voronoi_vertices.empty() || this->diagram_atoms.size() != mdc->AtomCount()) {
+		return false;
+	}
 
-			// Get the last element from the queue and process it.
-			gate = this->gatesToTest_one.back();
-			this->gatesToTest_one.pop_back();
+	// Find the atoms that moved since the diagram was computed.
+	std::vector<vec4d> atomData(mdc->AtomCount());
+	std::vector<bool> moved(mdc->AtomCount(), false);
+	std::vector<uint> movedIds, allIds(mdc->AtomCount());
+	auto ptr = mdc->AtomPositions();
+	double rMax = 0.0;
+	for (uint i = 0; i < mdc->AtomCount(); i++) {
+		atomData[i].Set(ptr[i * 3 + 0], ptr[i * 3 + 1], ptr[i * 3 + 2],
+			mdc->AtomTypes()[mdc->AtomTypeIndices()[i]].Radius());
+		const auto& old = this->diagram_atoms[i];
+		moved[i] = std::abs(atomData[i].GetX() - old.GetX()) > MOVE_EPSILON ||
+			std::abs(atomData[i].GetY() - old.GetY()) > MOVE_EPSILON ||
+			std::abs(atomData[i].GetZ() - old.GetZ()) > MOVE_EPSILON ||
+			std::abs(atomData[i].GetW() - old.GetW()) > MOVE_EPSILON;
+		if (moved[i]) {
+			movedIds.push_back(i);
+		}
+		allIds[i] = i;
+		rMax = std::max(rMax, atomData[i].GetW());
+	}
+	if (movedIds.empty()) {
+		return true;
+	}
 
-		} else {
-			// If the thread waited so long that the active queue is now empty we can stop it.
-			if (this->gatesToTest_two.empty()) {
-				this->voronoi_mutex.unlock();
-				break;
+	// Vertices defined by a moved atom get a new sphere that must not intersect any atom, all other
+	// vertices keep their sphere and only have to be checked against the moved atoms. If every vertex
+	// is still an empty tangent sphere no topological change happened and the diagram stays valid.
+	const double cellSize = std::max(2.0 * rMax, 1.0);
+	SphereBins allBins(atomData, allIds, cellSize);
+	SphereBins movedBins(atomData, movedIds, cellSize);
+	std::vector<vislib::math::Vector<float, 4>> newVertices(this->vertices);
+	std::atomic<bool> failed(false);
+
+	size_t core_num = Concurrency::details::_CurrentScheduler::_GetNumberOfVirtualProcessors();
+	size_t items_per_thread = this->voronoi_vertices.size() / core_num + 1;
+	this->stopThreads();
+	this->voronoi_threads = std::vector<std::thread>(core_num);
+	for (size_t t = 0; t < core_num; t++) {
+		size_t begin_index = std::min(t * items_per_thread, this->voronoi_vertices.size());
+		size_t end_index = std::min((t + 1) * items_per_thread, this->voronoi_vertices.size());
+		this->voronoi_threads[t] = std::thread([&, begin_index, end_index] {
+			std::array<vec4d, 2> sphereVec{ vec4d(), vec4d() };
+			for (size_t v = begin_index; v < end_index && !failed; v++) {
+				const auto& ids = this->voronoi_vertices[v].atoms;
+				vec4d sphere(this->vertices[v].GetX(), this->vertices[v].GetY(),
+					this->vertices[v].GetZ(), this->vertices[v].GetW());
+				if (moved[ids.GetX()] || moved[ids.GetY()] || moved[ids.GetZ()] || moved[ids.GetW()]) {
+					std::array<vec4d, 4> spheres{ atomData[ids.GetX()], atomData[ids.GetY()],
+						atomData[ids.GetZ()], atomData[ids.GetW()] };
+					auto cnt = Computations::ComputeVoronoiSphereR(spheres, sphereVec);
+					if (cnt == 0) {
+						failed = true;
+						break;
+					}
+					// Follow the solution that is closest to the previous vertex.
+					size_t best = 0;
+					if (cnt > 1) {
+						vec3d d0(sphereVec[0].GetX() - sphere.GetX(), sphereVec[0].GetY() - sphere.GetY(),
+							sphereVec[0].GetZ() - sphere.GetZ());
+						vec3d d1(sphereVec[1].GetX() - sphere.GetX(), sphereVec[1].GetY() - sphere.GetY(),
+							sphereVec[1].GetZ() - sphere.GetZ());
+						best = (d1.Length() < d0.Length()) ? 1 : 0;
+					}
+					sphere = sphereVec[best];
+					if (allBins.Intersects(sphere, ids)) {
+						failed = true;
+						break;
+					}
+					newVertices[v].Set(static_cast<float>(sphere.GetX()), static_cast<float>(sphere.GetY()),
+						static_cast<float>(sphere.GetZ()), static_cast<float>(sphere.GetW()));
+
+				} else if (movedBins.Intersects(sphere, ids)) {
+					failed = true;
+					break;
+				}
 			}
+		});
+	}
+	this->stopThreads();
 
-			// Get the last element from the queue and process it.
-			gate = this->gatesToTest_two.back();
-			this->gatesToTest_two.pop_back();
+	if (failed) {
+		vislib::sys::Log::DefaultLog.WriteMsg(vislib::sys::Log::LEVEL_INFO,
+			"The topology of the Voronoi diagram changed, rebuilding it.");
+		return false;
+	}
+
+	// Commit the new vertices, the gate sphere of each edge is the sphere of its start vertex.
+	this->vertices.swap(newVertices);
+	for (size_t v = 0; v < this->voronoi_vertices.size(); v++) {
+		const auto& s = this->vertices[v];
+		this->voronoi_vertices[v].vertex.Set(s.GetX(), s.GetY(), s.GetZ(), s.GetW());
+	}
+	for (auto& edge : this->voronoi_edges) {
+		const auto& v = this->vertices[edge.start_vertex];
+		edge.gate_sphere.Set(v.GetX(), v.GetY(), v.GetZ(), v.GetW());
+	}
+	this->diagram_atoms.swap(atomData);
+	return true;
+}
+
+/*
+ * VoronoiChannelCalculator::findOrInsertVertex
+ */
+bool VoronoiChannelCalculator::findOrInsertVertex(const uint64_t p_hash, uint& p_id) {
+	auto& shard = this->vertex_shards[p_hash % VERTEX_SHARD_CNT];
+	std::lock_guard<std::mutex> guard(shard.lock);
+	auto it = shard.ids.find(p_hash);
+	if (it != shard.ids.end()) {
+		p_id = it->second;
+		return false;
+	}
+	p_id = this->voronoi_id++;
+	shard.ids.emplace(p_hash, p_id);
+	return true;
+}
+
+/*
+ * VoronoiChannelCalculator::popGate
+ */
+bool VoronoiChannelCalculator::popGate(const size_t p_worker, Gate& p_gate) {
+	// Work on the own queue first, newest gates first to stay close in space.
+	{
+		auto& own = *this->worker_queues[p_worker];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.gates.empty()) {
+			p_gate = own.gates.back();
+			own.gates.pop_back();
+			return true;
+		}
+	}
+
+	// Steal the oldest gate of another worker.
+	for (size_t i = 1; i < this->worker_queues.size(); i++) {
+		auto& other = *this->worker_queues[(p_worker + i) % this->worker_queues.size()];
+		std::lock_guard<std::mutex> guard(other.lock);
+		if (!other.gates.empty()) {
+			p_gate = other.gates.front();
+			other.gates.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * VoronoiChannelCalculator::nextVoronoiVertex
+ */
+void VoronoiChannelCalculator::nextVoronoiVertex(const size_t p_worker) {
+	std::array<vec3d, 2> circles{ vec3d(), vec3d() };
+	Gate gate;
+	std::array<vec4d, 2> gateCenter{ vec4d(), vec4d() };
+	std::array<vec4d, 2> incircle{ vec4d(), vec4d() };
+	auto& result = this->worker_results[p_worker];
+	auto& queue = *this->worker_queues[p_worker];
+	while (this->pending_gates > 0) {
+		// Get the next gate, if there is none other workers are still creating new ones.
+		if (!this->popGate(p_worker, gate)) {
+			std::this_thread::yield();
+			continue;
 		}
-		this->voronoi_mutex.unlock();
 
 		// Create the vector that contains all three gate spheres.
 		std::array<vec4d, 4> gateVector{
@@ -431,64 +650,42 @@ void VoronoiChannelCalculator::nextVoronoiVertex() {
 		// Did we find a result for the currently processed gate?
 		if (minIdx >= 0) {
 			// Create the new Voronoi vertex and check if it already exists.
-			this->voronoi_mutex.lock();
-			VoronoiVertex possible_vertex = VoronoiVertex(vec4ui(gate.second[0], gate.second[1], gate.second[2], minIdx), 0);
-			auto it = this->voronoi_vertices.find(possible_vertex.vertex_hash);
-			if (it == this->voronoi_vertices.end()) {
+			vec4ui atoms(gate.second[0], gate.second[1], gate.second[2], minIdx);
+			uint id;
+			if (this->findOrInsertVertex(VoronoiVertex::ComputeHash(atoms), id)) {
 				// The vertex is new so add it to the list and create the edge between the vertex we came from and the
 				// new vertex.
-				possible_vertex.id = this->voronoi_id++;
-				this->voronoi_vertices.insert(std::pair<uint64_t, VoronoiVertex>(possible_vertex.vertex_hash, possible_vertex));
-				this->voronoi_edges.push_back(VoronoiEdge(possible_vertex.id, gate.first, gate.second[4]));
-				this->vertices.push_back(edgeEndResult);
-				this->voronoi_mutex.unlock();
-
-				// Create the three new gates.
-				std::pair<vec4d, std::array<uint, 5>> new1(edgeEndResult,
-					{ static_cast<uint>(minIdx), gate.second[0], gate.second[1], gate.second[2], possible_vertex.id });
-				std::pair<vec4d, std::array<uint, 5>> new2(edgeEndResult,
-					{ static_cast<uint>(minIdx), gate.second[1], gate.second[2], gate.second[0], possible_vertex.id });
-				std::pair<vec4d, std::array<uint, 5>> new3(edgeEndResult,
-					{ static_cast<uint>(minIdx), gate.second[0], gate.second[2], gate.second[1], possible_vertex.id });
-
-				// Add the new gates to the inactive queue.
-				this->voronoi_mutex.lock();
-				if (this->active_gates == 0) {
-					this->gatesToTest_two.push_back(new3);
-					this->gatesToTest_two.push_back(new2);
-					this->gatesToTest_two.push_back(new1);
-
-				} else {
-					this->gatesToTest_one.push_back(new3);
-					this->gatesToTest_one.push_back(new2);
-					this->gatesToTest_one.push_back(new1);
-				}
-				this->voronoi_mutex.unlock();
+				result.vertices.emplace_back(VoronoiVertex(atoms, id), edgeEndResult);
+				result.edges.push_back(VoronoiEdge(id, gate.first, gate.second[4]));
+
+				// Create the three new gates and add them to the own queue. They are counted before the current
+				// gate is marked as done, so the pending count cannot drop to zero in between.
+				this->pending_gates += 3;
+				std::lock_guard<std::mutex> guard(queue.lock);
+				queue.gates.emplace_back(edgeEndResult, std::array<uint, 5>{ static_cast<uint>(minIdx), 
+					gate.second[0], gate.second[2], gate.second[1], id });
+				queue.gates.emplace_back(edgeEndResult, std::array<uint, 5>{ static_cast<uint>(minIdx), 
+					gate.second[1], gate.second[2], gate.second[0], id });
+				queue.gates.emplace_back(edgeEndResult, std::array<uint, 5>{ static_cast<uint>(minIdx), 
+					gate.second[0], gate.second[1], gate.second[2], id });
 
 			} else {
 				// The vertex already exists so create the edge.
-				this->voronoi_edges.push_back(VoronoiEdge(it->second.id, gate.first, gate.second[4]));
-				this->voronoi_mutex.unlock();
+				result.edges.push_back(VoronoiEdge(id, gate.first, gate.second[4]));
 			}
 
 		} else {
-			// Compute the hash value of the voronoi vertex and increase the infinity counter.
-			this->voronoi_mutex.lock();
+			// Increase the infinity counter of the vertex the gate belongs to.
 			auto vertex_hash = VoronoiVertex::ComputeHash(vec4ui(gate.second[0], gate.second[1], gate.second[2], gate.second[3]));
-			auto it = this->voronoi_vertices.find(vertex_hash);
-			if (it != this->voronoi_vertices.end()) {
-				it->second.infinity_count++;
+			auto& shard = this->vertex_shards[vertex_hash % VERTEX_SHARD_CNT];
+			std::lock_guard<std::mutex> guard(shard.lock);
+			auto it = shard.ids.find(vertex_hash);
+			if (it != shard.ids.end()) {
+				result.infinity_hits.push_back(it->second);
 			}
-			this->voronoi_mutex.unlock();
 		}
 
-		// Check if we need to stop the thread because all gates have been processed.
-		if (this->active_gates == 0) {
-			stop = this->gatesToTest_one.empty();
-
-		} else {
-			stop = this->gatesToTest_two.empty();
-		}
+		this->pending_gates--;
 	}
 }
 
@@ -632,7 +829,7 @@ bool VoronoiChannelCalculator::Render(view::CallRender3D& call) {
  */
 bool VoronoiChannelCalculator::Update(MolecularDataCall* mdc, 
 		std::vector<VoronoiVertex>& p_voronoi_vertices,
-		std::vector<VoronoiEdge>& p_voronoi_edges, float probeRadius) {
+		std::vector<VoronoiEdge>& p_voronoi_edges, float probeRadius, bool incremental) {
 	// Sanity check.
 	if (mdc == nullptr) {
 		this->resultAvailable = false;
@@ -642,9 +839,14 @@ bool VoronoiChannelCalculator::Update(MolecularDataCall* mdc,
 	// If we have new data recompute the Voronoi diagram.
 	bool newDiagram = false;
 	if (mdc->DataHash() != this->lastDataHash) {
-		// Set the new data hash and compute the voronoi diagram.
+		// Set the new data hash and compute the voronoi diagram. If only atoms moved the existing
+		// diagram can be updated locally, if that fails it is rebuilt.
 		this->lastDataHash = mdc->DataHash();
-		newDiagram = this->constructVoronoiDiagram(mdc);
+		if (incremental && this->updateVoronoiDiagram(mdc)) {
+			newDiagram = true;
+		} else {
+			newDiagram = this->constructVoronoiDiagram(mdc);
+		}
 	}
 
 	// Check if the diagram is valid or the probe radius has been changed and
@@ -667,7 +869,7 @@ bool VoronoiChannelCalculator::Update(MolecularDataCall* mdc,
 		size_t i = 0;
 		for (auto it = this->voronoi_vertices.begin(); it != this->voronoi_vertices.end(); it++) {
 			if (this->vertexValidFlags[i]) {
-				p_voronoi_vertices.emplace_back((*it).second);
+				p_voronoi_vertices.emplace_back(*it);
 				p_voronoi_vertices.back().vertex = this->vertices[i];
 				vertex_offset[i] = new_id++;
 			}
@@ -20,6 +20,10 @@
 
 #include <Eigen/Dense>
 
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+
 namespace megamol {
 namespace molecularmaps {
 
@@ -45,9 +49,11 @@ namespace molecularmaps {
 		 * Update function for the local data to render.
 		 *
 		 * @param mdc The molecular data call containing the particle data
+		 * @param incremental If true, new data with the same atoms only updates the vertices
+		 * around moved atoms instead of rebuilding the whole diagram
 		 */
 		bool Update(protein_calls::MolecularDataCall* mdc, std::vector<VoronoiVertex>& p_voronoi_vertices, 
-			std::vector<VoronoiEdge>& p_voronoi_edges, float probeRadius = 1.5f);
+			std::vector<VoronoiEdge>& p_voronoi_edges, float probeRadius = 1.5f, bool incremental = false);
 
 	protected:
 
@@ -58,6 +64,37 @@ namespace molecularmaps {
 
 	private:
 
+		/** A gate: the start vertex sphere, three gate atoms, the opposite atom and the start vertex ID. */
+		typedef std::pair<vec4d, std::array<uint, 5>> Gate;
+
+		/**
+		 * The gate stack of one worker. The owner pushes and pops at the back, idle workers steal
+		 * from the front.
+		 */
+		struct GateQueue {
+			std::mutex lock;
+			std::deque<Gate> gates;
+		};
+
+		/**
+		 * One shard of the hash table mapping vertex hashes to vertex IDs. The shard is selected by
+		 * the vertex hash so concurrent lookups rarely contend for the same lock.
+		 */
+		struct VertexShard {
+			std::mutex lock;
+			std::unordered_map<uint64_t, uint> ids;
+		};
+
+		/** The results a single worker produced, merged after all workers finished. */
+		struct WorkerResult {
+			std::vector<std::pair<VoronoiVertex, vec4d>> vertices;
+			std::vector<VoronoiEdge> edges;
+			std::vector<uint> infinity_hits;
+		};
+
+		/** The number of vertex hash table shards. */
+		static const size_t VERTEX_SHARD_CNT = 64;
+
 		/**
 	     * Checks the validity for each vertex
 		 */
@@ -78,9 +115,42 @@ namespace molecularmaps {
 		void convexHullThread();
 
 		/**
-		 * Computes the next Voronoi vertices until the thread is stopped.
+		 * Computes Voronoi vertices from the gates in the worker's own queue and steals gates from
+		 * the other workers once it runs dry, until no gate is left anywhere.
+		 *
+		 * @param p_worker The index of the worker's queue and result
+		 */
+		void nextVoronoiVertex(const size_t p_worker);
+
+		/**
+		 * Takes the next gate for a worker, either from its own queue or stolen from another one.
+		 *
+		 * @param p_worker The index of the worker
+		 * @param p_gate Will contain the gate
+		 *
+		 * @return true if a gate was found, false if all queues are empty
 		 */
-		void nextVoronoiVertex();
+		bool popGate(const size_t p_worker, Gate& p_gate);
+
+		/**
+		 * Looks up the ID of a vertex and inserts it with a new ID if it does not exist yet.
+		 *
+		 * @param p_hash The hash of the vertex
+		 * @param p_id Will contain the ID of the vertex
+		 *
+		 * @return true if the vertex was inserted, false if it existed before
+		 */
+		bool findOrInsertVertex(const uint64_t p_hash, uint& p_id);
+
+		/**
+		 * Updates an existing diagram to moved atoms. Only vertices that are defined by a moved atom
+		 * are recomputed, and only the spheres close to moved atoms are checked for new intersections.
+		 *
+		 * @param mdc The molecular data call containing the protein data.
+		 *
+		 * @return true if the diagram could be updated, false if it has to be rebuilt
+		 */
+		bool updateVoronoiDiagram(protein_calls::MolecularDataCall* mdc);
 
 		/**
 		 * Computes the next Voronoi vertices until the thread is stopped.
@@ -139,7 +209,22 @@ namespace molecularmaps {
 		std::vector<VoronoiEdge> voronoi_edges;
 
 		/** The ID of the next voronoi vertex. */
-		uint voronoi_id;
+		std::atomic<uint> voronoi_id;
+
+		/** The gate queues of the workers. */
+		std::vector<std::unique_ptr<GateQueue>> worker_queues;
+
+		/** The results of the workers. */
+		std::vector<WorkerResult> worker_results;
+
+		/** The number of gates that are queued or being processed. */
+		std::atomic<size_t> pending_gates;
+
+		/** The sharded vertex hash table. */
+		std::array<VertexShard, VERTEX_SHARD_CNT> vertex_shards;
+
+		/** The atoms the current diagram has been computed for. */
+		std::vector<vec4d> diagram_atoms;
 
 		/** The mutex that locks access to the local variables for the threads. */
 		std::mutex voronoi_mutex;
@@ -147,8 +232,8 @@ namespace molecularmaps {
 		/** Thread pool that computes the voronoi edges. */
 		std::vector<std::thread> voronoi_threads;
 
-		/** List of all voronoi vertices. */
-		std::map<uint64_t, VoronoiVertex> voronoi_vertices;
+		/** List of all voronoi vertices, indexed by their ID. */
+		std::vector<VoronoiVertex> voronoi_vertices;
 	};
 
 } /* end namespace molecularmaps */
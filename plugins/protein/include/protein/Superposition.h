@@ -0,0 +1,68 @@
+
+#ifndef MMPROTEIN_SUPERPOSITION_H_INCLUDED
+#define MMPROTEIN_SUPERPOSITION_H_INCLUDED
+
+#if (defined(_MSC_VER) && (_MSC_VER > 1000))
+#pragma once
+#endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
+
+#include "protein/Protein.h"
+
+namespace megamol {
+namespace protein {
+
+	/**
+	 * Computes the rigid motion superposing 'mobile' onto 'reference' with the
+	 * least (weighted) RMSD.
+	 *
+	 * The optimal rotation is found with the quaternion characteristic
+	 * polynomial (QCP) method: the largest eigenvalue of the 4x4 key matrix
+	 * is found by Newton iterations on its characteristic polynomial, and the
+	 * rotation is derived from the corresponding eigenvector. The superposed
+	 * position of a point p of 'mobile' is rotation * p + translation.
+	 *
+	 * @param n           The number of positions (xyz) in both sets.
+	 * @param reference   The positions which are not moved.
+	 * @param mobile      The positions to be superposed onto 'reference'.
+	 * @param weights     n weights of the positions, or NULL for equal weights.
+	 * @param rotation    Receives the rotation matrix (row-major).
+	 * @param translation Receives the translation applied after the rotation.
+	 * @return The RMSD of the superposed positions.
+	 */
+	PROTEIN_API float superpose(unsigned int n, const float *reference, const float *mobile, const float *weights,
+		float rotation[3][3], float translation[3]);
+
+	/**
+	 * Superposes all frames of a trajectory onto a reference. The frames are
+	 * processed in parallel.
+	 *
+	 * @param n          The number of positions (xyz) per frame.
+	 * @param reference  The positions of the reference.
+	 * @param frames     'frameCount' frames of n positions each, which are
+	 *                   moved in place.
+	 * @param frameCount The number of frames.
+	 * @param outRMSD    Receives the RMSD of each frame after the
+	 *                   superposition, may be NULL.
+	 */
+	PROTEIN_API void superposeFrames(unsigned int n, const float *reference, float *frames, unsigned int frameCount,
+		float *outRMSD);
+
+	/**
+	 * Computes the RMSD after optimal superposition of all pairs of frames.
+	 *
+	 * The centred frames are stored as separate x, y and z arrays, and the
+	 * matrix is computed in tiles of frames small enough to stay in the
+	 * cache. The tiles are distributed over all threads.
+	 *
+	 * @param n          The number of positions (xyz) per frame.
+	 * @param frames     'frameCount' frames of n positions each.
+	 * @param frameCount The number of frames.
+	 * @param outMatrix  Receives the symmetric frameCount x frameCount
+	 *                   matrix in row-major order.
+	 */
+	PROTEIN_API void computeRMSDMatrix(unsigned int n, const float *frames, unsigned int frameCount,
+		float *outMatrix);
+}
+}
+
+#endif // MMPROTEIN_SUPERPOSITION_H_INCLUDED
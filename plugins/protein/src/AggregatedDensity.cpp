@@ -13,9 +13,17 @@
 #include <cmath>
 #include <math.h>
 #include "mmcore/CallVolumeData.h"
+#include "mmcore/param/FilePathParam.h"
+#include "mmcore/param/IntParam.h"
+#include "vislib/sys/Log.h"
 #include <omp.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <float.h>
+#include <thread>
 
 #define _USE_MATH_DEFINES 1
 /*
@@ -26,7 +34,15 @@ megamol::protein::AggregatedDensity::AggregatedDensity(void) :
    getZvelocitySlot("sendAggregatedZvelocity", "Sends the aggrated velocity data"), 
    is_aggregated(false),
    framecounter(0),
-   molDataCallerSlot ("getMolecularData", "Connects the aggregation with molecule data storage")
+   molDataCallerSlot ("getMolecularData", "Connects the aggregation with molecule data storage"),
+   batchSizeSlot("batchSize", "The number of frames loaded and aggregated at once"),
+   checkpointFileSlot("checkpointFile", "The file to save the partial result to (empty to disable checkpoints)"),
+   checkpointIntervalSlot("checkpointInterval", "The number of frames between two checkpoints"),
+   vol(NULL),
+   sourceHash(0),
+   sourceFingerprint(0),
+   resumeChecked(false),
+   dataHash(1)
 {
 
     this->getDensitySlot.SetCallback("CallVolumeData", "getData", &AggregatedDensity::getDensityCallback);
@@ -41,6 +57,15 @@ megamol::protein::AggregatedDensity::AggregatedDensity(void) :
 	this->molDataCallerSlot.SetCompatibleCall<megamol::protein_calls::MolecularDataCallDescription>();
     this->MakeSlotAvailable (&this->molDataCallerSlot);
 
+    this->batchSizeSlot.SetParameter(new megamol::core::param::IntParam(32, 1));
+    this->MakeSlotAvailable(&this->batchSizeSlot);
+
+    this->checkpointFileSlot.SetParameter(new megamol::core::param::FilePathParam(""));
+    this->MakeSlotAvailable(&this->checkpointFileSlot);
+
+    this->checkpointIntervalSlot.SetParameter(new megamol::core::param::IntParam(10000, 1));
+    this->MakeSlotAvailable(&this->checkpointIntervalSlot);
+
 	pdbfilename="K.pdb";
 	xtcfilenames.push_back("K.xtc");
 
@@ -63,7 +88,8 @@ megamol::protein::AggregatedDensity::AggregatedDensity(void) :
 	velocity = new float[3*xbins*ybins*zbins];
     memset(density, 0, xbins*ybins*zbins*sizeof(float));
     memset(velocity, 0, 3*xbins*ybins*zbins*sizeof(float));
-    
+    sumDensity.assign(xbins*ybins*zbins, 0.0);
+    sumVelocity.assign(3*xbins*ybins*zbins, 0.0);
 }
 
 
@@ -71,6 +97,9 @@ megamol::protein::AggregatedDensity::AggregatedDensity(void) :
  * megamol::protein::AggregatedDensity::~AggregatedDensity
  */
 megamol::protein::AggregatedDensity::~AggregatedDensity(void) {
+    this->Release();
+    delete[] density;
+    delete[] velocity;
 }
 
 
@@ -97,13 +126,11 @@ bool megamol::protein::AggregatedDensity::getDensityCallback(megamol::core::Call
     megamol::core::CallVolumeData *cvd = dynamic_cast<megamol::core::CallVolumeData*>(&caller);
     if (cvd == NULL) return false;
     
-	if (!this->is_aggregated)
-		if (!this->aggregate())
-			return false;
-//#pragma omp parallel for
+	if (!this->aggregate() && !this->is_aggregated)
+		return false;
 
     cvd->SetAttributeCount(1);
-    cvd->SetDataHash(1);
+    cvd->SetDataHash(this->dataHash);
     cvd->SetFrameID(0);
     cvd->SetSize(xbins, ybins, zbins);
     //cvd->SetSize(this->volRes, this->volRes, this->volRes);
@@ -122,13 +149,11 @@ bool megamol::protein::AggregatedDensity::getZvelocityCallback(megamol::core::Ca
     megamol::core::CallVolumeData *cvd = dynamic_cast<megamol::core::CallVolumeData*>(&caller);
     if (cvd == NULL) return false;
     
-	if (!this->is_aggregated)
-		if (!this->aggregate())
-			return false;
-//#pragma omp parallel for
+	if (!this->aggregate() && !this->is_aggregated)
+		return false;
 
     cvd->SetAttributeCount(1);
-    cvd->SetDataHash(1);
+    cvd->SetDataHash(this->dataHash);
     cvd->SetFrameID(0);
     cvd->SetSize(xbins, ybins, zbins);
     //cvd->SetSize(this->volRes, this->volRes, this->volRes);
@@ -149,156 +174,337 @@ bool megamol::protein::AggregatedDensity::getExtentCallback(megamol::core::Call&
 
 	cvd->AccessBoundingBoxes().Clear();
     cvd->AccessBoundingBoxes().SetObjectSpaceBBox(origin_x,origin_y, origin_z, origin_x+box_x, origin_y+box_y, origin_z+box_z);
-    cvd->SetDataHash(1);
+    cvd->SetDataHash(this->dataHash);
     cvd->SetFrameCount(1);
 
     return true;
 }
 
+/*
+ * megamol::protein::AggregatedDensity::aggregate
+ */
 bool megamol::protein::AggregatedDensity::aggregate() {
+    using vislib::sys::Log;
+
 	megamol::protein_calls::MolecularDataCall *mol = this->molDataCallerSlot.CallAs<megamol::protein_calls::MolecularDataCall>();
     if(!mol) {
         return false;
-    }   
-	
-	// set call time
-    mol->SetCalltime(0);
-    // set frame ID and call data
-    mol->SetFrameID(0);
-
-	if (!(*mol)(megamol::protein_calls::MolecularDataCall::CallForGetData)) return false;
-
-// this number must remain constant!
-	unsigned int n_atoms = mol->AtomCount();
-
-	float * pos0 = new float[mol->AtomCount() * 3];
-	float * vel  = new float[mol->AtomCount() * 3];
-	memcpy( pos0, mol->AtomPositions(), mol->AtomCount() * 3 * sizeof( float));
-
-	for (unsigned int frame=0; frame < mol->FrameCount(); frame++) {
-		mol->SetFrameID(frame);
-		if (!(*mol)(megamol::protein_calls::MolecularDataCall::CallForGetData)) return false;
-		if (mol->AtomCount()!=n_atoms) {
-			delete[] pos0, vel;
-			return false;
-		}
-    	const float* pos_new = mol->AtomPositions();
+    }
+    if (!(*mol)(megamol::protein_calls::MolecularDataCall::CallForGetExtent)) return false;
+    const unsigned int frameCount = mol->FrameCount();
+
+    // start over for a different trajectory, continue for a longer one
+    if (mol->DataHash() != this->sourceHash) {
+        this->sourceHash = mol->DataHash();
+        this->sourceFingerprint = 0;
+        this->framecounter = 0;
+        this->lastPos.clear();
+        std::fill(this->sumDensity.begin(), this->sumDensity.end(), 0.0);
+        std::fill(this->sumVelocity.begin(), this->sumVelocity.end(), 0.0);
+    }
+    const std::string checkpointPath(T2A(this->checkpointFileSlot.Param<megamol::core::param::FilePathParam>()->Value()));
+    if (!checkpointPath.empty() && (this->sourceFingerprint == 0)) {
+        this->sourceFingerprint = this->fingerprintSource(mol);
+    }
+    // a checkpoint is only resumed by the first aggregation, later data
+    // belongs to a different run
+    if (!this->resumeChecked && (this->framecounter == 0) && !checkpointPath.empty()
+            && this->loadCheckpoint(checkpointPath, frameCount)) {
+        Log::DefaultLog.WriteInfo("%s: Resuming from frame %u of checkpoint \"%s\"", this->ClassName(),
+            this->framecounter, checkpointPath.c_str());
+    }
+    this->resumeChecked = true;
+    if (this->framecounter >= frameCount) {
+        if (!this->is_aggregated) {
+            this->normalise();
+        }
+        return true;
+    }
+
+    const unsigned int batchSize = static_cast<unsigned int>(this->batchSizeSlot.Param<megamol::core::param::IntParam>()->Value());
+    const unsigned int checkpointInterval = static_cast<unsigned int>(
+        this->checkpointIntervalSlot.Param<megamol::core::param::IntParam>()->Value());
+    const size_t cells = static_cast<size_t>(xbins) * ybins * zbins;
+    const int threads = omp_get_max_threads();
+    this->partialDensity.resize(threads);
+    this->partialVelocity.resize(threads);
+    for (int t = 0; t < threads; t++) {
+        this->partialDensity[t].assign(cells, 0.0);
+        this->partialVelocity[t].assign(3 * cells, 0.0);
+    }
+
+    // The threads splat one batch while the next one is being loaded. The
+    // call is only ever used by this thread.
+    std::vector<float> batches[2];
+    unsigned int first = this->framecounter;
+    unsigned int count = std::min(batchSize, frameCount - first);
+    unsigned int lastCheckpoint = this->framecounter;
+    bool ok = this->loadBatch(mol, first, count, batches[0]);
+    int cur = 0;
+    while (ok && (count > 0)) {
+        const unsigned int nextFirst = first + count;
+        const unsigned int nextCount = std::min(batchSize, frameCount - nextFirst);
+        std::thread worker(&AggregatedDensity::splatBatch, this, std::cref(batches[cur]), count);
+        if (nextCount > 0) {
+            ok = this->loadBatch(mol, nextFirst, nextCount, batches[1 - cur]);
+        }
+        worker.join();
+
+        const size_t n = this->lastPos.size();
+        std::copy(batches[cur].begin() + (count - 1) * n, batches[cur].begin() + count * n, this->lastPos.begin());
+        this->framecounter += count;
+        if (!checkpointPath.empty() && (this->framecounter - lastCheckpoint >= checkpointInterval)) {
+            this->reducePartials();
+            this->saveCheckpoint(checkpointPath);
+            lastCheckpoint = this->framecounter;
+        }
+
+        first = nextFirst;
+        count = nextCount;
+        cur = 1 - cur;
+    }
+
+    this->reducePartials();
+    this->partialDensity.clear();
+    this->partialVelocity.clear();
+    if (this->framecounter == 0) {
+        return false;
+    }
+    if (!checkpointPath.empty() && (this->framecounter != lastCheckpoint)) {
+        this->saveCheckpoint(checkpointPath);
+    }
+    this->normalise();
+    Log::DefaultLog.WriteInfo("%s: Aggregated %u of %u frames", this->ClassName(), this->framecounter, frameCount);
+    return ok;
+}
 
-		for (unsigned int i = 0; i<3*n_atoms; i++) {
-			vel[i] =  pos_new[i] - pos0[i];
-		}
-		memcpy( pos0, mol->AtomPositions(), mol->AtomCount() * 3 * sizeof( float));
-        this->aggregate_frame(pos0, vel, n_atoms);
-        framecounter++;
-	}
 
-	delete[] pos0, vel;
+/*
+ * megamol::protein::AggregatedDensity::loadBatch
+ */
+bool megamol::protein::AggregatedDensity::loadBatch(megamol::protein_calls::MolecularDataCall *mol,
+        unsigned int first, unsigned int count, std::vector<float>& batch) {
+    for (unsigned int i = 0; i < count; i++) {
+        mol->SetCalltime(static_cast<float>(first + i));
+        mol->SetFrameID(first + i, true);
+        if (!(*mol)(megamol::protein_calls::MolecularDataCall::CallForGetData)) return false;
+
+        // this number must remain constant!
+        const size_t n = static_cast<size_t>(mol->AtomCount()) * 3;
+        if (this->lastPos.empty()) {
+            // the first frame has no predecessor and thus no velocity
+            this->lastPos.assign(mol->AtomPositions(), mol->AtomPositions() + n);
+        }
+        if (n != this->lastPos.size()) {
+            vislib::sys::Log::DefaultLog.WriteError("%s: Frame %u has %u atoms instead of %u", this->ClassName(),
+                first + i, mol->AtomCount(), static_cast<unsigned int>(this->lastPos.size() / 3));
+            mol->Unlock();
+            return false;
+        }
+        batch.resize(count * n);
+        memcpy(batch.data() + i * n, mol->AtomPositions(), n * sizeof(float));
+        mol->Unlock();
+    }
+    return true;
+}
+
+
+/*
+ * megamol::protein::AggregatedDensity::splatBatch
+ */
+void megamol::protein::AggregatedDensity::splatBatch(const std::vector<float>& batch, unsigned int count) {
+    const unsigned int n_atoms = static_cast<unsigned int>(this->lastPos.size() / 3);
+    const size_t n = this->lastPos.size();
+    const int threads = static_cast<int>(this->partialDensity.size());
+
+    // every thread splats whole frames into its own grids
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+    for (int f = 0; f < static_cast<int>(count); f++) {
+        const int t = omp_get_thread_num();
+        const float *pos = batch.data() + f * n;
+        const float *prevPos = (f == 0) ? this->lastPos.data() : (pos - n);
+        this->aggregate_frame(pos, prevPos, n_atoms, this->partialDensity[t].data(), this->partialVelocity[t].data());
+    }
+}
+
+
+/*
+ * megamol::protein::AggregatedDensity::reducePartials
+ */
+void megamol::protein::AggregatedDensity::reducePartials(void) {
+    const int cells = static_cast<int>(this->sumDensity.size());
+#pragma omp parallel for
+    for (int c = 0; c < cells; c++) {
+        for (size_t t = 0; t < this->partialDensity.size(); t++) {
+            this->sumDensity[c] += this->partialDensity[t][c];
+            this->partialDensity[t][c] = 0.0;
+            for (int k = 0; k < 3; k++) {
+                this->sumVelocity[3 * c + k] += this->partialVelocity[t][3 * c + k];
+                this->partialVelocity[t][3 * c + k] = 0.0;
+            }
+        }
+    }
+}
+
+
+/*
+ * megamol::protein::AggregatedDensity::normalise
+ */
+void megamol::protein::AggregatedDensity::normalise(void) {
     is_aggregated = true;
+    this->dataHash++;
     float maxdensity=0;
     float minvelocity=FLT_MAX;
-    float maxvelocity=FLT_MIN;
+    float maxvelocity=-FLT_MAX;
     for (unsigned int i = 0; i<xbins*ybins*zbins; i++) {
-        density[i]*=1.0f/framecounter/res/res/res*1000.0f;
-        if (density[i] > 0) {
-            velocity[i]*=1.0f/density[i]/framecounter;
-        } else {
-            velocity[i]=0;
+        density[i]=static_cast<float>(sumDensity[i]/framecounter/res/res/res*1000.0f);
+        for (unsigned int k = 0; k < 3; k++) {
+            if (density[i] > 0) {
+                velocity[3*i+k]=static_cast<float>(sumVelocity[3*i+k]/density[i]/framecounter);
+            } else {
+                velocity[3*i+k]=0;
+            }
+            maxvelocity= vislib::math::Max(velocity[3*i+k], maxvelocity);
+            minvelocity= vislib::math::Min(velocity[3*i+k], minvelocity);
         }
         maxdensity = vislib::math::Max(density[i], maxdensity);
-        maxvelocity= vislib::math::Max(velocity[i], maxvelocity);
-        minvelocity= vislib::math::Min(velocity[i], minvelocity);
-        
     }
     std::cout << "The max is " << maxdensity << std::endl;
     std::cout << "The max vel is " << maxvelocity << std::endl;
     std::cout << "The min vel is " << minvelocity << std::endl;
+}
+
+
+/*
+ * megamol::protein::AggregatedDensity::fingerprintSource
+ */
+UINT64 megamol::protein::AggregatedDensity::fingerprintSource(megamol::protein_calls::MolecularDataCall *mol) const {
+    mol->SetCalltime(0.0f);
+    mol->SetFrameID(0, true);
+    if (!(*mol)(megamol::protein_calls::MolecularDataCall::CallForGetData)) return 0;
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(mol->AtomPositions());
+    const size_t size = static_cast<size_t>(mol->AtomCount()) * 3 * sizeof(float);
+    UINT64 hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    hash = (hash ^ mol->AtomCount()) * 1099511628211ULL;
+    mol->Unlock();
+    return hash;
+}
+
+
+/*
+ * megamol::protein::AggregatedDensity::loadCheckpoint
+ */
+bool megamol::protein::AggregatedDensity::loadCheckpoint(const std::string& path, unsigned int frameCount) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    char magic[8];
+    unsigned int header[5];
+    float grid[7];
+    UINT64 source[2];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    in.read(reinterpret_cast<char*>(grid), sizeof(grid));
+    in.read(reinterpret_cast<char*>(source), sizeof(source));
+    if (!in || (memcmp(magic, "MMAGGD2", 8) != 0)) return false;
+    const float expected[7] = { origin_x, origin_y, origin_z, box_x, box_y, box_z, res };
+    if ((header[0] != xbins) || (header[1] != ybins) || (header[2] != zbins) || (header[4] > frameCount)
+            || (memcmp(grid, expected, sizeof(grid)) != 0)) {
+        return false;
+    }
+    // the checkpoint must have been written for the same trajectory
+    megamol::protein_calls::MolecularDataCall *mol = this->molDataCallerSlot.CallAs<megamol::protein_calls::MolecularDataCall>();
+    if ((mol == NULL) || (header[3] != mol->AtomCount()) || (source[0] != this->sourceHash)
+            || (this->sourceFingerprint == 0) || (source[1] != this->sourceFingerprint)) {
+        vislib::sys::Log::DefaultLog.WriteWarn("%s: Ignoring checkpoint \"%s\" of different data", this->ClassName(),
+            path.c_str());
+        return false;
+    }
+
+    std::vector<float> pos(static_cast<size_t>(header[3]) * 3);
+    std::vector<double> dens(this->sumDensity.size());
+    std::vector<double> vel(this->sumVelocity.size());
+    in.read(reinterpret_cast<char*>(pos.data()), pos.size() * sizeof(float));
+    in.read(reinterpret_cast<char*>(dens.data()), dens.size() * sizeof(double));
+    in.read(reinterpret_cast<char*>(vel.data()), vel.size() * sizeof(double));
+    if (!in) return false;
+
+    this->lastPos.swap(pos);
+    this->sumDensity.swap(dens);
+    this->sumVelocity.swap(vel);
+    this->framecounter = header[4];
     return true;
 }
 
-bool megamol::protein::AggregatedDensity::aggregate_frame(float* pos, float* vel, unsigned int n_atoms) {
+
+/*
+ * megamol::protein::AggregatedDensity::saveCheckpoint
+ */
+bool megamol::protein::AggregatedDensity::saveCheckpoint(const std::string& path) const {
+    // write a new file first, so an interruption does not destroy the last
+    // checkpoint
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        const unsigned int header[5] = { xbins, ybins, zbins, static_cast<unsigned int>(lastPos.size() / 3), framecounter };
+        const float grid[7] = { origin_x, origin_y, origin_z, box_x, box_y, box_z, res };
+        const UINT64 source[2] = { static_cast<UINT64>(sourceHash), sourceFingerprint };
+        out.write("MMAGGD2", 8);
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(grid), sizeof(grid));
+        out.write(reinterpret_cast<const char*>(source), sizeof(source));
+        out.write(reinterpret_cast<const char*>(lastPos.data()), lastPos.size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(sumDensity.data()), sumDensity.size() * sizeof(double));
+        out.write(reinterpret_cast<const char*>(sumVelocity.data()), sumVelocity.size() * sizeof(double));
+        if (!out) {
+            vislib::sys::Log::DefaultLog.WriteError("%s: Unable to write checkpoint \"%s\"", this->ClassName(),
+                tmpPath.c_str());
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    return (std::rename(tmpPath.c_str(), path.c_str()) == 0);
+}
+
+
+/*
+ * megamol::protein::AggregatedDensity::aggregate_frame
+ */
+void megamol::protein::AggregatedDensity::aggregate_frame(const float* pos, const float* prevPos,
+        unsigned int n_atoms, double* dens, double* vel_grid) const {
 	float x, y, z, dx, dy, dz;
 	unsigned int X,Y,Z;
 	float weight;
+	float vel[3];
 	unsigned int linear_index;
-	for (unsigned int i = 0; i<3*n_atoms; i++) {
+	for (unsigned int i = 0; i<n_atoms; i++) {
 		x=(pos[3*i+0]-origin_x)/res; // in lattice constants
+		y=(pos[3*i+1]-origin_y)/res; // in lattice constants
+		z=(pos[3*i+2]-origin_z)/res; // in lattice constants
+		if (!(x >= 1.0f && y >= 1.0f && z >= 1.0f)) continue;
 		X=static_cast<unsigned int>(floor(x));
 		dx=x-X;
-		y=(pos[3*i+1]-origin_y)/res; // in lattice constants
 		Y=static_cast<unsigned int>(floor(y));
 		dy=y-Y;
-		z=(pos[3*i+2]-origin_z)/res; // in lattice constants
 		Z=static_cast<unsigned int>(floor(z));
 		dz=z-Z;
+		vel[0]=pos[3*i+0]-prevPos[3*i+0];
+		vel[1]=pos[3*i+1]-prevPos[3*i+1];
+		vel[2]=pos[3*i+2]-prevPos[3*i+2];
 
 		if (X>0 && X<xbins-1 && Y>0 && Y<ybins-1 && Z>0 && Z<zbins-1  ) {
-          //weight=1;
-          //density[X+xbins*Y+xbins*ybins*Z]+=weight;
-  		  weight=(1-dx)*(1-dy)*(1-dz);
-          linear_index = (X+0) + (Y+0)*xbins + (Z+0)*xbins*ybins;
-		  density[linear_index]+=weight;
-		  velocity[3*linear_index+0]+=weight*vel[3*i+0];
-		  velocity[3*linear_index+1]+=weight*vel[3*i+1];
-		  velocity[3*linear_index+2]+=weight*vel[3*i+2];
-
-		  weight=(1-dx)*(1-dy)*(dz);
-          linear_index = (X+0) + (Y+0)*xbins + (Z+1)*xbins*ybins;
-		  		  density[linear_index]+=weight;
-		  velocity[3*linear_index+0]+=weight*vel[3*i+0];
-		  velocity[3*linear_index+1]+=weight*vel[3*i+1];
-		  velocity[3*linear_index+2]+=weight*vel[3*i+2];
-		  
-		  weight=(1-dx)*(dy)*(1-dz);
-          linear_index = (X+0) + (Y+1)*xbins + (Z+0)*xbins*ybins;
-		  density[linear_index]+=weight;
-		  velocity[3*linear_index+0]+=weight*vel[3*i+0];
-		  velocity[3*linear_index+1]+=weight*vel[3*i+1];
-		  velocity[3*linear_index+2]+=weight*vel[3*i+2];
-
-		  weight=(1-dx)*(dy)*(dz);
-          linear_index = (X+0) + (Y+1)*xbins + (Z+1)*xbins*ybins;
-		  density[linear_index]+=weight;
-		  velocity[3*linear_index+0]+=weight*vel[3*i+0];
-		  velocity[3*linear_index+1]+=weight*vel[3*i+1];
-		  velocity[3*linear_index+2]+=weight*vel[3*i+2];
-
-		  weight=(dx)*(1-dy)*(1-dz);
-          linear_index = (X+1) + (Y+0)*xbins + (Z+0)*xbins*ybins;
-		  density[linear_index]+=weight;
-		  velocity[3*linear_index+0]+=weight*vel[3*i+0];
-		  velocity[3*linear_index+1]+=weight*vel[3*i+1];
-		  velocity[3*linear_index+2]+=weight*vel[3*i+2];
-
-		  weight=(dx)*(1-dy)*(dz);
-          linear_index = (X+1) + (Y+0)*xbins + (Z+1)*xbins*ybins;
-		  density[linear_index]+=weight;
-		  velocity[3*linear_index+0]+=weight*vel[3*i+0];
-		  velocity[3*linear_index+1]+=weight*vel[3*i+1];
-		  velocity[3*linear_index+2]+=weight*vel[3*i+2];
-		  
-		  weight=(dx)*(dy)*(1-dz);
-          linear_index = (X+1) + (Y+1)*xbins + (Z+0)*xbins*ybins;
-		  density[linear_index]+=weight;
-		  velocity[3*linear_index+0]+=weight*vel[3*i+0];
-		  velocity[3*linear_index+1]+=weight*vel[3*i+1];
-		  velocity[3*linear_index+2]+=weight*vel[3*i+2];
-
-		  weight=(dx)*(dy)*(dz);
-          linear_index = (X+1) + (Y+1)*xbins + (Z+1)*xbins*ybins;
-		  density[linear_index]+=weight;
-		  velocity[3*linear_index+0]+=weight*vel[3*i+0];
-		  velocity[3*linear_index+1]+=weight*vel[3*i+1];
-		  velocity[3*linear_index+2]+=weight*vel[3*i+2];
-
-
-
+			for (unsigned int corner = 0; corner < 8; corner++) {
+				const unsigned int cx = corner & 1, cy = (corner >> 1) & 1, cz = (corner >> 2) & 1;
+				weight=(cx ? dx : 1-dx)*(cy ? dy : 1-dy)*(cz ? dz : 1-dz);
+				linear_index = (X+cx) + (Y+cy)*xbins + (Z+cz)*xbins*ybins;
+				dens[linear_index]+=weight;
+				vel_grid[3*linear_index+0]+=weight*vel[0];
+				vel_grid[3*linear_index+1]+=weight*vel[1];
+				vel_grid[3*linear_index+2]+=weight*vel[2];
+			}
 		}
-
-
-
-
 	}
-	return true;
 }
-
-
@@ -15,13 +15,23 @@
 #include "mmcore/CalleeSlot.h"
 #include "mmcore/CallerSlot.h"
 #include "mmcore/Module.h"
+#include "mmcore/param/ParamSlot.h"
+#include <string>
+#include <vector>
 
 namespace megamol { 
 	namespace protein {
 
 		
     /**
-     * Class generation buck ball informations
+     * Aggregates the density and the velocity of the atoms over all frames of
+     * a trajectory.
+     *
+     * The frames are loaded in batches. While the threads splat one batch
+     * into partial grids of their own, the next batch is loaded. Frames that
+     * are appended to the trajectory later on are aggregated incrementally,
+     * and the partial result can be saved to a checkpoint file to resume an
+     * interrupted aggregation.
      */
 class AggregatedDensity : public megamol::core::Module {
     public:
@@ -62,7 +72,65 @@ class AggregatedDensity : public megamol::core::Module {
     protected:
 
 		bool aggregate();
-		bool aggregate_frame(float* pos, float* vel, unsigned int n_atoms);
+
+		/**
+		 * Splats the atoms of one frame into a density and a velocity grid.
+		 *
+		 * @param pos     The atom positions of the frame.
+		 * @param prevPos The atom positions of the previous frame.
+		 * @param n_atoms The number of atoms.
+		 * @param dens    The density grid.
+		 * @param vel     The velocity grid, three values per cell.
+		 */
+		void aggregate_frame(const float* pos, const float* prevPos, unsigned int n_atoms,
+			double* dens, double* vel) const;
+
+		/**
+		 * Loads consecutive frames into 'batch'.
+		 *
+		 * @return 'true' on success, 'false' if a frame could not be loaded or
+		 *         has a different number of atoms.
+		 */
+		bool loadBatch(megamol::protein_calls::MolecularDataCall *mol, unsigned int first,
+			unsigned int count, std::vector<float>& batch);
+
+		/**
+		 * Splats 'count' frames of 'batch' into the partial grids of the
+		 * threads. The first frame is preceded by 'lastPos'.
+		 */
+		void splatBatch(const std::vector<float>& batch, unsigned int count);
+
+		/**
+		 * Adds the partial grids of the threads to the sums and clears them.
+		 */
+		void reducePartials(void);
+
+		/**
+		 * Computes 'density' and 'velocity' from the sums.
+		 */
+		void normalise(void);
+
+		/**
+		 * Identifies the trajectory by the positions of its first frame.
+		 *
+		 * @return The hash of the first frame, 0 if it cannot be loaded.
+		 */
+		UINT64 fingerprintSource(megamol::protein_calls::MolecularDataCall *mol) const;
+
+		/**
+		 * Loads the partial result from the checkpoint file if it matches the
+		 * grid and the data.
+		 *
+		 * @return 'true' if the checkpoint has been loaded.
+		 */
+		bool loadCheckpoint(const std::string& path, unsigned int frameCount);
+
+		/**
+		 * Saves the partial result to the checkpoint file.
+		 *
+		 * @return 'true' on success.
+		 */
+		bool saveCheckpoint(const std::string& path) const;
 
         /**
          * Implementation of 'Create'.
@@ -106,6 +174,15 @@ class AggregatedDensity : public megamol::core::Module {
 		 /** MolecularDataCall caller slot */
         megamol::core::CallerSlot molDataCallerSlot;
 
+        /** The number of frames loaded and splatted at once */
+        megamol::core::param::ParamSlot batchSizeSlot;
+
+        /** The file to save the partial result to */
+        megamol::core::param::ParamSlot checkpointFileSlot;
+
+        /** The number of frames between two checkpoints */
+        megamol::core::param::ParamSlot checkpointIntervalSlot;
+
         /** The distance volume resolution */
         unsigned int volRes;
 
@@ -129,6 +206,33 @@ class AggregatedDensity : public megamol::core::Module {
         bool is_aggregated;
         unsigned int framecounter;
 
+        /** The summed up density weights of all aggregated frames */
+        std::vector<double> sumDensity;
+
+        /** The summed up weighted velocities of all aggregated frames */
+        std::vector<double> sumVelocity;
+
+        /** The partial density grids of the threads */
+        std::vector<std::vector<double> > partialDensity;
+
+        /** The partial velocity grids of the threads */
+        std::vector<std::vector<double> > partialVelocity;
+
+        /** The atom positions of the last aggregated frame */
+        std::vector<float> lastPos;
+
+        /** The data hash of the aggregated trajectory */
+        SIZE_T sourceHash;
+
+        /** The hash of the first frame of the aggregated trajectory */
+        UINT64 sourceFingerprint;
+
+        /** Whether the checkpoint file has been considered for resuming */
+        bool resumeChecked;
+
+        /** The data hash of the aggregated grids */
+        SIZE_T dataHash;
+
         
     };
 
@@ -128,7 +128,7 @@ bool protein::CCP4VolumeData::tryLoadFile(void) {
 
     // get length of file:
     fin.seekg( 0, std::ios::end);
-    unsigned int fileLength = static_cast<unsigned int>(fin.tellg());
+    UINT64 fileLength = static_cast<UINT64>(fin.tellg());
     fin.seekg( 0, std::ios::beg);
 
 #define WORD 4
@@ -137,7 +137,8 @@ bool protein::CCP4VolumeData::tryLoadFile(void) {
     fin.read( (char*)&header, sizeof(header));
 
     // compute the number of bytes for the map
-    unsigned int volBytes = header.volDim[0] * header.volDim[1] * header.volDim[2] * WORD;
+    const UINT64 volCount = static_cast<UINT64>(header.volDim[0]) * header.volDim[1] * header.volDim[2];
+    const UINT64 volBytes = volCount * WORD;
 
     // read symmetry records and map
     if( this->header.mode == 2 ) {
@@ -147,7 +148,7 @@ bool protein::CCP4VolumeData::tryLoadFile(void) {
                 "%s: File is too large, assuming incorrectly set number of symmetry records.", 
                 this->ClassName() );
             // compute correct number of bytes for symmetry records
-            this->header.nsymbyte = fileLength - ( sizeof( this->header) + volBytes);
+            this->header.nsymbyte = static_cast<int>(fileLength - ( sizeof( this->header) + volBytes));
             // resize symmetry record array
             if( this->symmetry )
                 delete[] this->symmetry;
@@ -167,9 +168,32 @@ bool protein::CCP4VolumeData::tryLoadFile(void) {
         // resize map
         if( this->map )
             delete[] this->map;
-        this->map = new float[volBytes];
-        // read map
-        fin.read( (char*)map, volBytes);
+        this->map = new float[static_cast<SIZE_T>(volCount)];
+        // read map in parallel chunks, each thread using its own stream
+        const std::streamoff mapOffset = fin.tellg();
+        const UINT64 chunkBytes = 16 * 1024 * 1024;
+        const int chunkCount = static_cast<int>((volBytes + chunkBytes - 1) / chunkBytes);
+        int failedChunks = 0;
+#pragma omp parallel reduction(+ : failedChunks)
+        {
+            std::ifstream chunkIn( fn, std::ios::binary | std::ios::in );
+#pragma omp for schedule(dynamic, 1)
+            for( int c = 0; c < chunkCount; c++ ) {
+                const UINT64 first = static_cast<UINT64>(c) * chunkBytes;
+                const UINT64 bytes = vislib::math::Min( chunkBytes, volBytes - first);
+                chunkIn.seekg( mapOffset + static_cast<std::streamoff>(first), std::ios::beg);
+                chunkIn.read( reinterpret_cast<char*>(this->map) + first, static_cast<std::streamsize>(bytes));
+                if( !chunkIn ) {
+                    chunkIn.clear();
+                    failedChunks++;
+                }
+            }
+        }
+        if( failedChunks > 0 ) {
+            Log::DefaultLog.WriteMsg( Log::LEVEL_ERROR,
+                "%s: Unable to read the map of \"%s\"", this->ClassName(), fn );
+            return false;
+        }
     } else {
         Log::DefaultLog.WriteMsg( Log::LEVEL_ERROR,
             "%s: Mode %i not supported.", this->ClassName(), this->header.mode );
@@ -13,6 +13,7 @@
 #endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
 
 #include "stdafx.h"
+#include "vislib/Array.h"
 #include "vislib/ArrayAllocator.h"
 #include "vislib/sys/Log.h"
 #include "vislib/math/mathfunctions.h"
@@ -21,11 +22,16 @@
 #include "vislib/math/ShallowPoint.h"
 #include "vislib/math/Cuboid.h"
 #include <ctime>
+#include <vector>
 
 using namespace megamol;
 
 /**
  * Simple nearest-neighbour-search implementation which uses a regular grid to speed up search queries.
+ *
+ * The queries do not modify the grid and may be issued from several threads at once. For point sets that
+ * only move a little, e.g. the frames of a trajectory, 'UpdatePointData' moves the points that left their cell
+ * instead of sorting all of them into the grid again.
  */
 namespace megamol {
 namespace protein {
@@ -34,7 +40,7 @@ namespace protein {
 		typedef vislib::math::Point<T,3> Point;
 
 	public:
-		GridNeighbourFinder() : elementGrid(0), elementCount(0), elementPositions(0) {}
+		GridNeighbourFinder() : elementPositions(0), elementCount(0), elementGrid(0), gridSize(0), searchDistance(0) {}
 
 		~GridNeighbourFinder() {
 			delete [] elementGrid;
@@ -47,64 +53,74 @@ namespace protein {
 		void SetPointData( const T *pointData, unsigned int pointCount, vislib::math::Cuboid<T> boundingBox, T searchDistance, int *filter=0) {
 			this->elementPositions = pointData;
 			this->elementCount = pointCount;
+			this->searchDistance = searchDistance;
 
 			// does the new BBox fit into the old one?
-			if( !elementGrid || !(this->elementBBox.Contains(boundingBox.GetLeftBottomBack(),-1) && this->elementBBox.Contains(boundingBox.GetRightTopFront(),-1)) ) {
-				/* resize bounding-box and grid structure */
-				vislib::math::Dimension<T, 3> dim = boundingBox.GetSize();
-				for(int i = 0; i < 3; i++)
-					this->gridResolution[i] =  (unsigned int)floor(dim[i] / (2*searchDistance) + 1.0);
-				this->gridSize = this->gridResolution[0] * this->gridResolution[1] * this->gridResolution[2];
-				this->elementBBox = boundingBox;
-
-				// initialize element grid
-				if (elementGrid)
-					delete [] elementGrid;
-				this->elementGrid = new vislib::Array<const T *>[gridSize];
-				for (unsigned int i = 0; i < gridSize; i++) {
-					elementGrid[i].Resize( 100);
-					elementGrid[i].SetCapacityIncrement( 100);
-				}
+			if( !elementGrid || !fitsIntoGrid(boundingBox) ) {
+				resizeGrid(boundingBox);
 			} else {
 				for (unsigned int i = 0; i < gridSize; i++ )
 					elementGrid[i].Clear();
 			}
 
-			this->elementOrigin = this->elementBBox.GetOrigin();
-
-			/** fill the internal grid structure */
-			vislib::math::Dimension<T, 3> bBoxDimension = this->elementBBox.GetSize();
-			for(int i = 0 ; i < 3; i++) {
-				this->gridResolutionFactors[i] = (T)this->gridResolution[i] / bBoxDimension[i];
-				this->cellSize[i] = (T)bBoxDimension[i] / this->gridResolution[i]; //(T)1.0) / gridResolutionFactors[i];
-			}
 			// sort the element positions into the grid ...
+			this->elementCell.assign(this->elementCount, NoCell);
+			this->elementSlot.assign(this->elementCount, 0);
 			for(unsigned int i = 0; i < this->elementCount; i++) {
-				// we can skip this assert becaus another ASSERT in 'insertPointIntoGrid'
-				//ASSERT( elementBBox.Contains(vislib::math::ShallowPoint<T,3>(const_cast<T*>(&elementPositions[i*3]))) );
 				if (!filter || filter[i] != -1)
-					insertPointIntoGrid(&this->elementPositions[i*3]);
+					insertPointIntoGrid(i, cellIndexOf(&this->elementPositions[i*3]));
+			}
+		}
+
+		/**
+		 * Replace the positions of the points set by the last call to 'SetPointData' (the number of points and
+		 * the filter stay the same). Only the points that left their cell are moved to their new cell, unless
+		 * the points do not fit into the grid any more. In that case, the grid is rebuilt with some room to spare.
+		 *
+		 * @param pointData   The new positions, 'xyz' for each point.
+		 * @param boundingBox The bounding box of the new positions.
+		 *
+		 * @return The number of points that changed their cell.
+		 */
+		unsigned int UpdatePointData(const T *pointData, vislib::math::Cuboid<T> boundingBox) {
+			this->elementPositions = pointData;
+			if (!elementGrid)
+				return 0;
+
+			if (!fitsIntoGrid(boundingBox)) {
+				// leave some room for the points to move further
+				boundingBox.Grow(this->searchDistance);
+				resizeGrid(boundingBox);
+				for (unsigned int i = 0; i < this->elementCount; i++) {
+					if (this->elementCell[i] != NoCell)
+						insertPointIntoGrid(i, cellIndexOf(&this->elementPositions[i*3]));
+				}
+				return this->elementCount;
+			}
+
+			// finding the new cells is independent for each point, moving them is not
+			this->newCell.resize(this->elementCount);
+			const int cnt = static_cast<int>(this->elementCount);
+#pragma omp parallel for
+			for (int i = 0; i < cnt; i++) {
+				this->newCell[i] = (this->elementCell[i] == NoCell) ? NoCell : cellIndexOf(&this->elementPositions[i*3]);
+			}
+			unsigned int moved = 0;
+			for (unsigned int i = 0; i < this->elementCount; i++) {
+				if (this->newCell[i] != this->elementCell[i]) {
+					removePointFromGrid(i);
+					insertPointIntoGrid(i, this->newCell[i]);
+					moved++;
+				}
 			}
+			return moved;
 		}
 
 	public:
 		//template<typename T>
 		void FindNeighboursInRange(const T *point, T distance, vislib::Array<unsigned int>& resIdx) const {
-			//Point relPos = sub(point, elementOrigin);
-			T relPos[3] = {point[0] - elementOrigin[0],
-				point[1] - elementOrigin[1],
-				point[2] - elementOrigin[2]};
-
-			// calculate range in the grid ...
 			int min[3], max[3];
-			for(unsigned int i = 0; i < 3; i++) {
-				min[i] = (int)floor((relPos[i]-distance)*gridResolutionFactors[i]);
-				if (min[i] < 0)
-					min[i] = 0;
-				max[i] = (int)ceil((relPos[i]+distance)*gridResolutionFactors[i]);
-				if (max[i] >= (int)gridResolution[i])
-					max[i] = (int)gridResolution[i]-1;
-			}
+			cellRange(point, distance, min, max);
 
 			// loop over all cells inside the sphere (point, distance)
 	/*		for(float x = relPos[0]-distance; x <= relPos[0]+distance+cellSize[0]; x += cellSize[0]) {
@@ -125,21 +141,106 @@ namespace protein {
 			}
 		}
 
+		/**
+		 * Answer whether there is any point within 'distance' of 'point'. Stops at the first point found.
+		 */
+		bool HasNeighbourInRange(const T *point, T distance) const {
+			int min[3], max[3];
+			cellRange(point, distance, min, max);
+			const T distSq = distance * distance;
+			for(int indexX = min[0]; indexX <= max[0]; indexX++) {
+				for(int indexY = min[1]; indexY <= max[1]; indexY++) {
+					for(int indexZ = min[2]; indexZ <= max[2]; indexZ++) {
+						const vislib::Array<unsigned int>& cell = elementGrid[cellIndex(indexX, indexY, indexZ)];
+						const unsigned int *idx = cell.PeekElements();
+						for (SIZE_T i = 0; i < cell.Count(); i++)
+							if ( distSquared(&elementPositions[idx[i]*3], point) <= distSq )
+								return true;
+					}
+				}
+			}
+			return false;
+		}
+
 	private:
-		VISLIB_FORCEINLINE void insertPointIntoGrid(const T *point) {
-			//Point relPos = sub(point, elementOrigin);
-			unsigned int indexX = (unsigned int)(/*relPos.X()*/(point[0] - elementOrigin[0]) * gridResolutionFactors[0]); // floor()?
-			unsigned int indexY = (unsigned int)(/*relPos.Y()*/(point[1] - elementOrigin[1]) * gridResolutionFactors[1]);
-			unsigned int indexZ = (unsigned int)(/*relPos.Z()*/(point[2] - elementOrigin[2]) * gridResolutionFactors[2]);
-			ASSERT(indexX < gridResolution[0] && indexY < gridResolution[1] && indexZ < gridResolution[2]);
-			vislib::Array<const T *>& cell = elementGrid[cellIndex(indexX, indexY, indexZ)];
-			cell.Add(point);
+		/** marks points which are not part of the grid */
+		static const unsigned int NoCell = 0xFFFFFFFFu;
+
+		bool fitsIntoGrid(const vislib::math::Cuboid<T>& boundingBox) const {
+			return this->elementBBox.Contains(boundingBox.GetLeftBottomBack(),-1) && this->elementBBox.Contains(boundingBox.GetRightTopFront(),-1);
+		}
+
+		void resizeGrid(const vislib::math::Cuboid<T>& boundingBox) {
+			/* resize bounding-box and grid structure */
+			vislib::math::Dimension<T, 3> dim = boundingBox.GetSize();
+			for(int i = 0; i < 3; i++)
+				this->gridResolution[i] =  (unsigned int)floor(dim[i] / (2*searchDistance) + 1.0);
+			this->gridSize = this->gridResolution[0] * this->gridResolution[1] * this->gridResolution[2];
+			this->elementBBox = boundingBox;
+
+			// initialize element grid
+			if (elementGrid)
+				delete [] elementGrid;
+			this->elementGrid = new vislib::Array<unsigned int>[gridSize];
+			for (unsigned int i = 0; i < gridSize; i++) {
+				elementGrid[i].Resize( 100);
+				elementGrid[i].SetCapacityIncrement( 100);
+			}
+
+			this->elementOrigin = this->elementBBox.GetOrigin();
+			vislib::math::Dimension<T, 3> bBoxDimension = this->elementBBox.GetSize();
+			for(int i = 0 ; i < 3; i++) {
+				this->gridResolutionFactors[i] = (T)this->gridResolution[i] / bBoxDimension[i];
+				this->cellSize[i] = (T)bBoxDimension[i] / this->gridResolution[i]; //(T)1.0) / gridResolutionFactors[i];
+			}
+		}
+
+		/** calculates the range of cells that may contain points within 'distance' of 'point' */
+		VISLIB_FORCEINLINE void cellRange(const T *point, T distance, int min[3], int max[3]) const {
+			T relPos[3] = {point[0] - elementOrigin[0],
+				point[1] - elementOrigin[1],
+				point[2] - elementOrigin[2]};
+			for(unsigned int i = 0; i < 3; i++) {
+				min[i] = (int)floor((relPos[i]-distance)*gridResolutionFactors[i]);
+				if (min[i] < 0)
+					min[i] = 0;
+				max[i] = (int)ceil((relPos[i]+distance)*gridResolutionFactors[i]);
+				if (max[i] >= (int)gridResolution[i])
+					max[i] = (int)gridResolution[i]-1;
+			}
+		}
+
+		/** the cell containing 'point', points outside the grid are clamped to the border cells */
+		VISLIB_FORCEINLINE unsigned int cellIndexOf(const T *point) const {
+			unsigned int index[3];
+			for (int i = 0; i < 3; i++) {
+				T f = (point[i] - elementOrigin[i]) * gridResolutionFactors[i];
+				index[i] = (f <= 0) ? 0 : vislib::math::Min((unsigned int)f, gridResolution[i] - 1);
+			}
+			return cellIndex(index[0], index[1], index[2]);
+		}
+
+		VISLIB_FORCEINLINE void insertPointIntoGrid(unsigned int pointIdx, unsigned int cellIdx) {
+			vislib::Array<unsigned int>& cell = elementGrid[cellIdx];
+			this->elementCell[pointIdx] = cellIdx;
+			this->elementSlot[pointIdx] = static_cast<unsigned int>(cell.Count());
+			cell.Add(pointIdx);
+		}
+
+		VISLIB_FORCEINLINE void removePointFromGrid(unsigned int pointIdx) {
+			// the last point of the cell takes over the slot of the removed one
+			vislib::Array<unsigned int>& cell = elementGrid[this->elementCell[pointIdx]];
+			unsigned int last = cell.Last();
+			cell[this->elementSlot[pointIdx]] = last;
+			this->elementSlot[last] = this->elementSlot[pointIdx];
+			cell.RemoveLast();
+			this->elementCell[pointIdx] = NoCell;
 		}
 
-		VISLIB_FORCEINLINE void findNeighboursInCell(const vislib::Array<const T *>& cell, const T* point, T distance, vislib::Array<unsigned int>& resIdx) const {
+		VISLIB_FORCEINLINE void findNeighboursInCell(const vislib::Array<unsigned int>& cell, const T* point, T distance, vislib::Array<unsigned int>& resIdx) const {
 			for (int i = 0; i < (int)cell.Count(); i++)
-				if ( dist(cell[i],point) <= distance )
-					resIdx.Add((unsigned int)((cell[i]-elementPositions)/3)); // store atom index
+				if ( dist(&elementPositions[cell[i]*3],point) <= distance )
+					resIdx.Add(cell[i]); // store atom index
 		}
 
 		inline unsigned int cellIndex(unsigned int x, unsigned int y, unsigned int z) const {
@@ -153,13 +254,24 @@ namespace protein {
 			return sqrt(x*x + y*y + z*z);
 		}
 
+		inline static T distSquared(const T *a, const T *b) {
+			T x = a[0]-b[0]; T y = a[1]-b[1]; T z = a[2]-b[2];
+			return x*x + y*y + z*z;
+		}
+
 	private:
 		/** pointer to points/positions stored in triples (xyzxyz...) */
 		const T *elementPositions;
 		/** number of points of 'elementPositions' */
 		unsigned int elementCount;
-		/** array of position-pointers for each cell of the regular element grid */
-		vislib::Array<const T *> *elementGrid;
+		/** array of point indices for each cell of the regular element grid */
+		vislib::Array<unsigned int> *elementGrid;
+		/** the cell of each point, or 'NoCell' if the point is filtered */
+		std::vector<unsigned int> elementCell;
+		/** the position of each point in the array of its cell */
+		std::vector<unsigned int> elementSlot;
+		/** scratch space for the new cells in 'UpdatePointData' */
+		std::vector<unsigned int> newCell;
 		/** bounding box of all positions/points */
 		vislib::math::Cuboid<T> elementBBox;
 		/** origin of 'elementBBox' */
@@ -172,7 +284,11 @@ namespace protein {
 		T cellSize[3];
 		/** short for gridResolution[0]*gridResolution[1]*gridResolution[2] */
 		unsigned int gridSize;
+		/** the search distance the grid resolution is based on */
+		T searchDistance;
 	};
+
+	template<class T> const unsigned int GridNeighbourFinder<T>::NoCell;
 } //namespace megamol
 } //namespace protein
 
@@ -8,11 +8,13 @@
 
 #include "stdafx.h"
 #include "ProteinAligner.h"
-#include "RMS.h"
+#include "protein/Superposition.h"
 
-#include <glm/glm.hpp>
-#include <glm/gtc/type_ptr.hpp>
+#include <fstream>
 #include "mmcore/param/BoolParam.h"
+#include "mmcore/param/ButtonParam.h"
+#include "mmcore/param/FilePathParam.h"
+#include "vislib/sys/Log.h"
 
 using namespace megamol;
 using namespace megamol::protein;
@@ -26,7 +28,12 @@ ProteinAligner::ProteinAligner(void)
     , dataOutSlot("dataOut", "Output protein slot")
     , inputProteinSlot("inputProtein", "Input protein that will be moved and rotated to match the reference")
     , referenceProteinSlot("referenceProtein", "Reference protein slot")
-    , isActiveSlot("isActive", "Activates and deactivates the effect of this module") {
+    , isActiveSlot("isActive", "Activates and deactivates the effect of this module")
+    , rmsdMatrixFileSlot("rmsdMatrixFile", "CSV file receiving the c alpha RMSD of all pairs of input frames")
+    , computeRMSDMatrixSlot("computeRMSDMatrix", "Computes the RMSD matrix of all input frames and writes it")
+    , frameRMSDFileSlot("frameRMSDFile", "CSV file receiving the c alpha RMSD of each input frame to the reference")
+    , computeFrameRMSDSlot(
+          "computeFrameRMSD", "Aligns all input frames onto the reference and writes their RMSD") {
 
     // callee slot
     this->dataOutSlot.SetCallback(
@@ -45,6 +52,20 @@ ProteinAligner::ProteinAligner(void)
     // param slots
     this->isActiveSlot.SetParameter(new core::param::BoolParam(true));
     this->MakeSlotAvailable(&this->isActiveSlot);
+
+    this->rmsdMatrixFileSlot.SetParameter(new core::param::FilePathParam(""));
+    this->MakeSlotAvailable(&this->rmsdMatrixFileSlot);
+
+    this->computeRMSDMatrixSlot.SetParameter(new core::param::ButtonParam());
+    this->computeRMSDMatrixSlot.SetUpdateCallback(&ProteinAligner::onComputeRMSDMatrix);
+    this->MakeSlotAvailable(&this->computeRMSDMatrixSlot);
+
+    this->frameRMSDFileSlot.SetParameter(new core::param::FilePathParam(""));
+    this->MakeSlotAvailable(&this->frameRMSDFileSlot);
+
+    this->computeFrameRMSDSlot.SetParameter(new core::param::ButtonParam());
+    this->computeFrameRMSDSlot.SetUpdateCallback(&ProteinAligner::onComputeFrameRMSD);
+    this->MakeSlotAvailable(&this->computeFrameRMSDSlot);
 }
 
 /*
@@ -126,49 +147,23 @@ bool ProteinAligner::alignPositions(const MolecularDataCall& input, const Molecu
     this->getCAlphaPosList(ref, refCAlphas);
     auto atomCount = std::min(inputCAlphas.size() / 3, refCAlphas.size() / 3);
 
-    std::vector<float> mass(atomCount, 1.0f);
-    std::vector<int> mask(atomCount, 1);
     float rotation[3][3], translation[3];
-    auto result = CalculateRMS(static_cast<unsigned int>(atomCount), true, 2, mass.data(), mask.data(),
-        inputCAlphas.data(), refCAlphas.data(), rotation, translation);
+    superpose(static_cast<unsigned int>(atomCount), refCAlphas.data(), inputCAlphas.data(), nullptr, rotation,
+        translation);
 
     this->alignedPositions.resize(static_cast<size_t>(input.AtomCount()) * 3);
-    std::memcpy(this->alignedPositions.data(), input.AtomPositions(), this->alignedPositions.size() * sizeof(float));
-
-    glm::mat3 rotmat = glm::mat3(glm::make_vec3(rotation[0]), glm::make_vec3(rotation[1]), glm::make_vec3(rotation[2]));
-    glm::vec3 trans = glm::make_vec3(translation);
-
-    // the rotation and translation has to be performed in a two step process as there are some problems with the values
-    // we have now
-
-    // the rotation matrix is fixed by transposing it:
-    rotmat = glm::transpose(rotmat);
-
+    const float* pos = input.AtomPositions();
     for (size_t i = 0; i < input.AtomCount(); ++i) {
-        glm::vec3 pos = glm::make_vec3(&this->alignedPositions[3 * i]);
-        pos = rotmat * pos;
-        std::memcpy(&this->alignedPositions[3 * i], &pos.x, sizeof(float) * 3);
-    }
-
-    // as the resulting transpose vector of the CalculateRMS-method is complete and utter bullcrap, we calculate the
-    // midpoint of each of the two proteins and move the onto each other
-    glm::vec3 inputCenter(0.0f, 0.0f, 0.0f), refCenter(0.0f, 0.0f, 0.0f);
-    for (size_t i = 0; i < input.AtomCount(); ++i) {
-        glm::vec3 pos = glm::make_vec3(&alignedPositions[3 * i]);
-        inputCenter += pos;
-    }
-    for (size_t i = 0; i < ref.AtomCount(); ++i) {
-        glm::vec3 pos = glm::make_vec3(&ref.AtomPositions()[3 * i]);
-        refCenter += pos;
-    }
-    inputCenter /= static_cast<float>(input.AtomCount());
-    refCenter /= static_cast<float>(ref.AtomCount());
-    this->boundingBox.Set(refCenter.x, refCenter.y, refCenter.z, refCenter.x, refCenter.y, refCenter.z);
-    for (size_t i = 0; i < input.AtomCount(); ++i) {
-        glm::vec3 pos = glm::make_vec3(&this->alignedPositions[3 * i]);
-        pos += refCenter - inputCenter;
-        std::memcpy(&this->alignedPositions[3 * i], &pos.x, sizeof(float) * 3);
-        this->boundingBox.GrowToPoint(vislib::math::Point<float, 3>(pos.x, pos.y, pos.z));
+        for (int a = 0; a < 3; ++a) {
+            this->alignedPositions[3 * i + a] = rotation[a][0] * pos[3 * i + 0] + rotation[a][1] * pos[3 * i + 1] +
+                                                rotation[a][2] * pos[3 * i + 2] + translation[a];
+        }
+        const float* p = &this->alignedPositions[3 * i];
+        if (i == 0) {
+            this->boundingBox.Set(p[0], p[1], p[2], p[0], p[1], p[2]);
+        } else {
+            this->boundingBox.GrowToPoint(vislib::math::Point<float, 3>(p[0], p[1], p[2]));
+        }
     }
     this->boundingBox.Grow(3.0f);
 
@@ -194,3 +189,139 @@ void ProteinAligner::getCAlphaPosList(const MolecularDataCall& input, std::vecto
         cAlphaPositions.push_back(input.AtomPositions()[3 * ca + 2]);
     }
 }
+
+/*
+ * ProteinAligner::onComputeRMSDMatrix
+ */
+bool ProteinAligner::onComputeRMSDMatrix(core::param::ParamSlot& slot) {
+    MolecularDataCall* input = this->inputProteinSlot.CallAs<MolecularDataCall>();
+    if (input == nullptr) return false;
+
+    const std::string path(T2A(this->rmsdMatrixFileSlot.Param<core::param::FilePathParam>()->Value()));
+    if (path.empty()) {
+        vislib::sys::Log::DefaultLog.WriteError("%s: No RMSD matrix file given", this->ClassName());
+        return false;
+    }
+    return this->writeRMSDMatrix(*input, path);
+}
+
+/*
+ * ProteinAligner::onComputeFrameRMSD
+ */
+bool ProteinAligner::onComputeFrameRMSD(core::param::ParamSlot& slot) {
+    MolecularDataCall* input = this->inputProteinSlot.CallAs<MolecularDataCall>();
+    if (input == nullptr) return false;
+
+    MolecularDataCall* ref = this->referenceProteinSlot.CallAs<MolecularDataCall>();
+    if (ref == nullptr) return false;
+
+    const std::string path(T2A(this->frameRMSDFileSlot.Param<core::param::FilePathParam>()->Value()));
+    if (path.empty()) {
+        vislib::sys::Log::DefaultLog.WriteError("%s: No frame RMSD file given", this->ClassName());
+        return false;
+    }
+    return this->writeFrameRMSD(*input, *ref, path);
+}
+
+/*
+ * ProteinAligner::getCAlphaFrames
+ */
+bool ProteinAligner::getCAlphaFrames(
+    MolecularDataCall& input, std::vector<float>& frames, unsigned int& frameCount, size_t& atomCount) {
+    if (!input(1)) return false;
+    frameCount = input.FrameCount();
+    const unsigned int oldFrame = input.FrameID();
+
+    // gather the c alpha positions of all frames in one block
+    std::vector<float> cAlphas;
+    atomCount = 0;
+    frames.clear();
+    for (unsigned int f = 0; f < frameCount; ++f) {
+        input.SetFrameID(f, true);
+        if (!input(1) || !input(0)) {
+            vislib::sys::Log::DefaultLog.WriteError("%s: Unable to load frame %u", this->ClassName(), f);
+            return false;
+        }
+        this->getCAlphaPosList(input, cAlphas);
+        input.Unlock();
+        if (f == 0) {
+            atomCount = cAlphas.size() / 3;
+            frames.resize(static_cast<size_t>(frameCount) * atomCount * 3);
+        } else if (cAlphas.size() / 3 != atomCount) {
+            vislib::sys::Log::DefaultLog.WriteError(
+                "%s: Frame %u has %u c alpha atoms instead of %u", this->ClassName(), f,
+                static_cast<unsigned int>(cAlphas.size() / 3), static_cast<unsigned int>(atomCount));
+            return false;
+        }
+        std::copy(cAlphas.begin(), cAlphas.end(), frames.begin() + static_cast<size_t>(f) * atomCount * 3);
+    }
+    input.SetFrameID(oldFrame);
+    return true;
+}
+
+/*
+ * ProteinAligner::writeFrameRMSD
+ */
+bool ProteinAligner::writeFrameRMSD(MolecularDataCall& input, MolecularDataCall& ref, const std::string& path) {
+    std::vector<float> frames, refCAlphas;
+    unsigned int frameCount = 0;
+    size_t atomCount = 0;
+    if (!this->getCAlphaFrames(input, frames, frameCount, atomCount)) return false;
+
+    if (!ref(1) || !ref(0)) {
+        vislib::sys::Log::DefaultLog.WriteError("%s: Unable to load the reference", this->ClassName());
+        return false;
+    }
+    this->getCAlphaPosList(ref, refCAlphas);
+    ref.Unlock();
+    if (refCAlphas.size() / 3 != atomCount) {
+        vislib::sys::Log::DefaultLog.WriteError("%s: The reference has %u c alpha atoms instead of %u",
+            this->ClassName(), static_cast<unsigned int>(refCAlphas.size() / 3), static_cast<unsigned int>(atomCount));
+        return false;
+    }
+
+    std::vector<float> rmsd(frameCount);
+    superposeFrames(static_cast<unsigned int>(atomCount), refCAlphas.data(), frames.data(), frameCount, rmsd.data());
+
+    std::ofstream out(path, std::ios::trunc);
+    out << "frame,rmsd\n";
+    for (unsigned int f = 0; f < frameCount; ++f) {
+        out << f << ',' << rmsd[f] << '\n';
+    }
+    if (!out) {
+        vislib::sys::Log::DefaultLog.WriteError("%s: Unable to write \"%s\"", this->ClassName(), path.c_str());
+        return false;
+    }
+    vislib::sys::Log::DefaultLog.WriteInfo("%s: Wrote the RMSD of %u aligned frames to \"%s\"", this->ClassName(),
+        frameCount, path.c_str());
+    return true;
+}
+
+/*
+ * ProteinAligner::writeRMSDMatrix
+ */
+bool ProteinAligner::writeRMSDMatrix(MolecularDataCall& input, const std::string& path) {
+    std::vector<float> frames;
+    unsigned int frameCount = 0;
+    size_t atomCount = 0;
+    if (!this->getCAlphaFrames(input, frames, frameCount, atomCount)) return false;
+
+    std::vector<float> matrix(static_cast<size_t>(frameCount) * frameCount);
+    computeRMSDMatrix(static_cast<unsigned int>(atomCount), frames.data(), frameCount, matrix.data());
+
+    std::ofstream out(path, std::ios::trunc);
+    for (unsigned int i = 0; i < frameCount; ++i) {
+        for (unsigned int j = 0; j < frameCount; ++j) {
+            if (j > 0) out << ',';
+            out << matrix[static_cast<size_t>(i) * frameCount + j];
+        }
+        out << '\n';
+    }
+    if (!out) {
+        vislib::sys::Log::DefaultLog.WriteError("%s: Unable to write \"%s\"", this->ClassName(), path.c_str());
+        return false;
+    }
+    vislib::sys::Log::DefaultLog.WriteInfo("%s: Wrote the RMSD matrix of %u frames to \"%s\"", this->ClassName(),
+        frameCount, path.c_str());
+    return true;
+}
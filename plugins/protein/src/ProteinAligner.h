@@ -94,6 +94,61 @@ private:
      */
     void getCAlphaPosList(const protein_calls::MolecularDataCall& input, std::vector<float>& cAlphaPositions);
 
+    /**
+     * Callback of the button computing the RMSD matrix of all frames of the
+     * input protein.
+     *
+     * @param slot The button slot.
+     * @return 'true' on success, 'false' otherwise.
+     */
+    bool onComputeRMSDMatrix(core::param::ParamSlot& slot);
+
+    /**
+     * Computes the RMSD of the c alpha atoms of all pairs of frames of the
+     * input protein and writes the matrix as CSV to 'path'.
+     *
+     * @param input The input protein call
+     * @param path The path of the output file
+     * @return 'true' on success, 'false' otherwise.
+     */
+    bool writeRMSDMatrix(protein_calls::MolecularDataCall& input, const std::string& path);
+
+    /**
+     * Callback of the button aligning all frames of the input protein onto
+     * the reference protein.
+     *
+     * @param slot The button slot.
+     * @return 'true' on success, 'false' otherwise.
+     */
+    bool onComputeFrameRMSD(core::param::ParamSlot& slot);
+
+    /**
+     * Gathers the c alpha positions of all frames of the input protein in
+     * one block, frame after frame.
+     *
+     * @param input The input protein call
+     * @param frames Will contain the c alpha positions of all frames
+     * @param frameCount Will contain the number of frames
+     * @param atomCount Will contain the number of c alpha atoms per frame
+     * @return 'true' on success, 'false' if a frame could not be loaded or
+     *         the frames differ in their number of c alpha atoms.
+     */
+    bool getCAlphaFrames(protein_calls::MolecularDataCall& input, std::vector<float>& frames,
+        unsigned int& frameCount, size_t& atomCount);
+
+    /**
+     * Superposes the c alpha atoms of all frames of the input protein onto
+     * the reference protein in parallel and writes the RMSD of each frame as
+     * CSV to 'path'.
+     *
+     * @param input The input protein call
+     * @param ref The reference protein call
+     * @param path The path of the output file
+     * @return 'true' on success, 'false' otherwise.
+     */
+    bool writeFrameRMSD(protein_calls::MolecularDataCall& input, protein_calls::MolecularDataCall& ref,
+        const std::string& path);
+
     /** Output slot for the moved and rotated protein */
     core::CalleeSlot dataOutSlot;
 
@@ -106,6 +161,18 @@ private:
     /** Slot that enables or disables the alignment of this module */
     core::param::ParamSlot isActiveSlot;
 
+    /** Slot for the path of the CSV file receiving the frame RMSD matrix */
+    core::param::ParamSlot rmsdMatrixFileSlot;
+
+    /** Slot triggering the computation of the frame RMSD matrix */
+    core::param::ParamSlot computeRMSDMatrixSlot;
+
+    /** Slot for the path of the CSV file receiving the RMSD of each frame */
+    core::param::ParamSlot frameRMSDFileSlot;
+
+    /** Slot triggering the alignment of all frames onto the reference */
+    core::param::ParamSlot computeFrameRMSDSlot;
+
     /** vector containing the aligned atom position data */
     std::vector<float> alignedPositions;
 
@@ -17,14 +17,25 @@
 #include "vislib/SingleLinkedList.h"
 #include "vislib/String.h"
 #include "vislib/math/Vector.h"
+#include <sys/stat.h>
+#include <algorithm>
 #include <cfloat>
 #include <climits>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 
 using namespace megamol::core;
 using namespace megamol::protein;
 
 
+const SIZE_T SolPathDataSource::recordSize = 16;
+
+const SIZE_T SolPathDataSource::chunkSize = 64 * 1024 * 1024;
+
+
 /*
  * SolPathDataSource::SolPathDataSource
  */
@@ -35,7 +46,8 @@ SolPathDataSource::SolPathDataSource(void) : core::Module(),
         smoothValueSlot("smoothValue", "Value for the smooth filter"),
         smoothExpSlot("smoothExp", "The smoothing filter function exponent"),
         speedOfSmoothedSlot("speedOfSmoothed", "Flag whether or not to use the smoothed data for the speed calculation"),
-        clusterOfSmoothedSlot("clusterOfSmoothed", "Flag to cluster the smoothed or unsmoothed data") {
+        clusterOfSmoothedSlot("clusterOfSmoothed", "Flag to cluster the smoothed or unsmoothed data"),
+        cacheFileSlot("cacheFile", "The path of the binary cache of the processed pathlines (empty for none)") {
 
     this->getdataslot.SetCallback(SolPathDataCall::ClassName(), "GetData", &SolPathDataSource::getData);
     this->getdataslot.SetCallback(SolPathDataCall::ClassName(), "GetExtent", &SolPathDataSource::getExtent);
@@ -59,6 +71,9 @@ SolPathDataSource::SolPathDataSource(void) : core::Module(),
     this->clusterOfSmoothedSlot << new param::BoolParam(true);
     this->MakeSlotAvailable(&this->clusterOfSmoothedSlot);
 
+    this->cacheFileSlot << new param::FilePathParam("");
+    this->MakeSlotAvailable(&this->cacheFileSlot);
+
 }
 
 
@@ -101,7 +116,7 @@ bool SolPathDataSource::getData(megamol::core::Call &call) {
         this->loadData();
     }
 
-    spdc->Set(static_cast<unsigned int>(this->pathlines.Count()), this->pathlines.PeekElements(),
+    spdc->Set(static_cast<unsigned int>(this->pathlines.size()), this->pathlines.data(),
         this->minTime, this->maxTime, this->minSpeed, this->maxSpeed);
 
     return true;
@@ -137,8 +152,9 @@ void SolPathDataSource::clear(void) {
     this->maxTime = 0.0f;
     this->minSpeed = 0.0f;
     this->maxSpeed = 0.0f;
-    this->vertices.Clear();
-    this->pathlines.Clear();
+    // release the memory, the next data set may be much smaller
+    std::vector<SolPathDataCall::Vertex>().swap(this->vertices);
+    std::vector<SolPathDataCall::Pathline>().swap(this->pathlines);
 }
 
 
@@ -156,6 +172,7 @@ void SolPathDataSource::loadData(void) {
     this->smoothExpSlot.ResetDirty();
     this->speedOfSmoothedSlot.ResetDirty();
     this->clusterOfSmoothedSlot.ResetDirty();
+    this->cacheFileSlot.ResetDirty();
 
     this->clear();
 
@@ -228,186 +245,365 @@ void SolPathDataSource::loadData(void) {
             this->filenameslot.Param<param::FilePathParam>()->Value()).PeekBuffer());
         return;
     }
-    file.Seek(blockInfo->start, File::BEGIN);
-
-    // load data
-    unsigned int atomCount;
-    file.Read(&atomCount, 4);
-
-    this->pathlines.AssertCapacity(atomCount);
-
-    for (SIZE_T a = 0; a < atomCount; a++) {
-        unsigned int tmp, framesCount;
-        SolPathDataCall::Vertex vertex;
-        SolPathDataCall::Pathline path;
-        vertex.speed = 0.0f; // will be set later
-        vertex.clusterID = 0;
-        vertex.time = -2.0f;
-        path.length = 0;
-        path.data = NULL; // will be set later
-
-        file.Read(&tmp, 4);
-        path.id = tmp;
-        file.Read(&framesCount, 4);
-
-        this->vertices.AssertCapacity(this->vertices.Count() + framesCount);
-
-        for (SIZE_T e = 0; e < framesCount; e++) {
-            file.Read(&tmp, 4);
-            file.Read(&vertex.x, 12);
-
-            if (tmp != static_cast<unsigned int>(vertex.time) + 1) {
-                // start a new path
-                if (path.length > 0) {
-                    this->pathlines.Add(path);
-                }
-                path.length = 1;
-            } else {
-                // continue path
-                path.length++;
-            }
-            vertex.time = static_cast<float>(tmp);
 
-            this->vertices.Add(vertex);
-        }
-
-        if (path.length > 0) {
-            this->pathlines.Add(path);
+    // the weights of the smoothing filter
+    const bool smooth = this->smoothSlot.Param<param::BoolParam>()->Value();
+    const float smoothValue = this->smoothValueSlot.Param<param::FloatParam>()->Value();
+    const float smoothExp = this->smoothExpSlot.Param<param::FloatParam>()->Value();
+    const bool speedOfSmoothed = this->speedOfSmoothedSlot.Param<param::BoolParam>()->Value();
+    std::vector<float> filter;
+    if (smooth) {
+        filter.resize(1 + static_cast<unsigned int>(::ceil(smoothValue)), 0.0f);
+        filter[0] = 1.0f;
+        if (smoothValue > 0.00001f) {
+            for (SIZE_T i = 1; i < filter.size(); i++) {
+                filter[i] = ::pow(::cos(static_cast<float>(M_PI) * static_cast<float>(i) / (1.0f + smoothValue)), smoothExp);
+                filter[i] *= filter[i];
+            }
         }
     }
 
-    Log::DefaultLog.WriteMsg(Log::LEVEL_INFO + 1000, "Finished solpath file IO");
-
-    // calculate pointers, bounding data, and speed values
-    SIZE_T off = 0;
-    for (SIZE_T p = 0; p < this->pathlines.Count(); p++) {
-        off += this->pathlines[p].length;
+    // the cache is only valid for the same data file and filter settings
+    const std::string cachePath(T2A(this->cacheFileSlot.Param<param::FilePathParam>()->Value()));
+    const vislib::StringA filename(this->filenameslot.Param<param::FilePathParam>()->Value());
+    struct stat st;
+    const INT64 fileTime = (::stat(filename.PeekBuffer(), &st) == 0) ? static_cast<INT64>(st.st_mtime) : 0;
+    std::ostringstream key;
+    key << filename.PeekBuffer()
+        << '|' << file.GetSize() << '|' << fileTime << '|' << blockInfo->start << '|' << blockInfo->size
+        << '|' << smooth << '|' << smoothValue << '|' << smoothExp << '|' << speedOfSmoothed;
+
+    if (!cachePath.empty() && this->loadCache(cachePath, key.str())) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_INFO + 1000, "Loaded solpath data from cache %s", cachePath.c_str());
+        return;
     }
-    if (off < this->vertices.Count()) {
-        Log::DefaultLog.WriteMsg(Log::LEVEL_WARN,
-            "Path data inconsistent: too many vertices");
-    } else if (off > this->vertices.Count()) {
-        Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR,
-            "Path data inconsistent: too few vertices");
+
+    if (!this->readPathlines(file, *blockInfo, filter)) {
         this->clear();
         return;
     }
 
-    if (off <= 0) {
+    Log::DefaultLog.WriteMsg(Log::LEVEL_INFO + 1000, "Finished solpath file IO");
+
+    if (this->vertices.empty()) {
         // data is empty!
         return;
     }
 
-    off = 0;
-    this->maxTime = 0.0f;
+    this->bbox.EnforcePositiveSize();
+
+    // TODO: calculate clusters here (of the smoothed or unsmoothed data,
+    // depending on clusterOfSmoothedSlot)
+
+    if (!cachePath.empty() && !this->saveCache(cachePath, key.str())) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_WARN, "Unable to write solpath cache %s", cachePath.c_str());
+    }
+}
+
+
+/*
+ * SolPathDataSource::readPathlines
+ */
+bool SolPathDataSource::readPathlines(vislib::sys::File& file, const fileBlockInfo& block,
+        const std::vector<float>& filter) {
+    using vislib::sys::File;
+    using vislib::sys::Log;
+
+    // index the atoms first, so the vertices can be allocated at once
+    const File::FileOffset blockEnd = block.start + static_cast<File::FileOffset>(block.size);
+    file.Seek(block.start, File::BEGIN);
+    unsigned int atomCount = 0;
+    if (file.Read(&atomCount, 4) != 4) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Path data inconsistent: missing atom count");
+        return false;
+    }
+    std::vector<atomBlockInfo> atoms;
+    atoms.reserve(atomCount);
+    SIZE_T vertexCount = 0;
+    for (unsigned int a = 0; a < atomCount; a++) {
+        atomBlockInfo atom;
+        if ((file.Read(&atom.id, 4) != 4) || (file.Read(&atom.recordCount, 4) != 4)) {
+            Log::DefaultLog.WriteMsg(Log::LEVEL_WARN,
+                "Path data inconsistent: only %u of %u atoms present", a, atomCount);
+            break;
+        }
+        atom.start = static_cast<File::FileOffset>(file.Tell());
+        const File::FileOffset end = atom.start + static_cast<File::FileOffset>(atom.recordCount) * recordSize;
+        if (end > blockEnd) {
+            Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR,
+                "Path data inconsistent: too few vertices");
+            return false;
+        }
+        atom.firstVertex = vertexCount;
+        vertexCount += atom.recordCount;
+        atoms.push_back(atom);
+        file.Seek(end, File::BEGIN);
+    }
+
+    this->vertices.resize(vertexCount);
+    if (vertexCount == 0) return true;
+
+    this->maxTime = -FLT_MAX;
     this->minTime = FLT_MAX;
     this->maxSpeed = -FLT_MAX;
     this->minSpeed = FLT_MAX;
     this->bbox.Set(FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX);
-    for (SIZE_T p = 0; p < this->pathlines.Count(); p++) {
-        this->pathlines[p].data = this->vertices.PeekElements() + off;
+    const bool speedOfSmoothed = this->speedOfSmoothedSlot.Param<param::BoolParam>()->Value();
+
+    // the records of the atoms of a chunk are read at once and converted in
+    // parallel, the pathlines are appended in the order of the atoms
+    std::vector<char> buffer;
+    std::vector<std::vector<SolPathDataCall::Pathline> > chunkLines;
+    SIZE_T first = 0;
+    while (first < atoms.size()) {
+        SIZE_T last = first + 1;
+        SIZE_T bytes = atoms[first].recordCount * recordSize;
+        while ((last < atoms.size()) && (bytes + 8 + atoms[last].recordCount * recordSize <= chunkSize)) {
+            bytes = static_cast<SIZE_T>(atoms[last].start - atoms[first].start) + atoms[last].recordCount * recordSize;
+            last++;
+        }
+
+        buffer.resize(bytes);
+        file.Seek(atoms[first].start, File::BEGIN);
+        if (file.Read(buffer.data(), bytes) != bytes) {
+            Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "Unable to read path data");
+            return false;
+        }
 
-        for (SIZE_T v = 0; v < this->pathlines[p].length; v++) {
-            SolPathDataCall::Vertex &v1 = this->vertices[off + v];
+        chunkLines.resize(last - first);
+        const int chunkAtoms = static_cast<int>(last - first);
+#pragma omp parallel
+        {
+            std::vector<float> scratch;
+            float bounds[12], threadBounds[12];
+            for (int k = 0; k < 12; k += 2) {
+                threadBounds[k] = FLT_MAX;
+                threadBounds[k + 1] = -FLT_MAX;
+            }
 
-            if (v > 0) {
-                v1.speed = vislib::math::ShallowPoint<float, 3>(&v1.x)
-                    .Distance(vislib::math::ShallowPoint<float, 3>(&this->vertices[off + v - 1].x));
+#pragma omp for schedule(dynamic, 16)
+            for (int a = 0; a < chunkAtoms; a++) {
+                const atomBlockInfo& atom = atoms[first + a];
+                this->buildAtom(atom, buffer.data() + (atom.start - atoms[first].start), filter, speedOfSmoothed,
+                    scratch, chunkLines[a], bounds);
+                for (int k = 0; k < 12; k += 2) {
+                    threadBounds[k] = std::min(threadBounds[k], bounds[k]);
+                    threadBounds[k + 1] = std::max(threadBounds[k + 1], bounds[k + 1]);
+                }
             }
 
-            if (v1.time > this->maxTime) this->maxTime = v1.time;
-            if (v1.time < this->minTime) this->minTime = v1.time;
-            if (v1.speed > 0.01f) {
-                if (v1.speed > this->maxSpeed) this->maxSpeed = v1.speed;
-                if (v1.speed < this->minSpeed) this->minSpeed = v1.speed;
+#pragma omp critical
+            {
+                vislib::math::Cuboid<float>& bb = this->bbox;
+                bb.Set(std::min(bb.Left(), threadBounds[0]), std::min(bb.Bottom(), threadBounds[2]),
+                    std::min(bb.Back(), threadBounds[4]), std::max(bb.Right(), threadBounds[1]),
+                    std::max(bb.Top(), threadBounds[3]), std::max(bb.Front(), threadBounds[5]));
+                this->minTime = std::min(this->minTime, threadBounds[6]);
+                this->maxTime = std::max(this->maxTime, threadBounds[7]);
+                this->minSpeed = std::min(this->minSpeed, threadBounds[8]);
+                this->maxSpeed = std::max(this->maxSpeed, threadBounds[9]);
             }
-            if (this->bbox.Left() > v1.x) this->bbox.SetLeft(v1.x);
-            if (this->bbox.Right() < v1.x) this->bbox.SetRight(v1.x);
-            if (this->bbox.Bottom() > v1.y) this->bbox.SetBottom(v1.y);
-            if (this->bbox.Top() < v1.y) this->bbox.SetTop(v1.y);
-            if (this->bbox.Back() > v1.z) this->bbox.SetBack(v1.z);
-            if (this->bbox.Front() < v1.z) this->bbox.SetFront(v1.z);
-        }
-        if (this->pathlines[p].length > 2) {
-            this->vertices[off].speed = this->vertices[off + 1].speed;
         }
 
-        off += this->pathlines[p].length;
+        for (SIZE_T a = 0; a < chunkLines.size(); a++) {
+            this->pathlines.insert(this->pathlines.end(), chunkLines[a].begin(), chunkLines[a].end());
+            chunkLines[a].clear();
+        }
+        first = last;
     }
+    this->pathlines.shrink_to_fit();
 
-    this->bbox.EnforcePositiveSize();
-
-    if (!this->smoothSlot.Param<param::BoolParam>()->Value()
-            || !this->clusterOfSmoothedSlot.Param<param::BoolParam>()->Value()) {
+    return true;
+}
 
-        // TODO: calculate clusters here
 
+/*
+ * SolPathDataSource::buildAtom
+ */
+void SolPathDataSource::buildAtom(const atomBlockInfo& atom, const char *records,
+        const std::vector<float>& filter, bool speedOfSmoothed, std::vector<float>& scratch,
+        std::vector<SolPathDataCall::Pathline>& outLines, float bounds[12]) {
+    for (int k = 0; k < 12; k += 2) {
+        bounds[k] = FLT_MAX;
+        bounds[k + 1] = -FLT_MAX;
     }
-
-    if (this->smoothSlot.Param<param::BoolParam>()->Value()) {
-
-        // smooth
-        float smoothValue = this->smoothValueSlot.Param<param::FloatParam>()->Value();
-        vislib::Array<float> filter(1 + static_cast<unsigned int>(::ceil(smoothValue)), 0.0f);
-        filter[0] = 1.0f;
-        if (smoothValue > 0.00001f) {
-            float exp = this->smoothExpSlot.Param<param::FloatParam>()->Value();
-            for (SIZE_T i = 1; i < filter.Count(); i++) {
-                filter[i] = ::pow(::cos(static_cast<float>(M_PI) * static_cast<float>(i) / (1.0f + smoothValue)), exp);
-                filter[i] *= filter[i];
+    SolPathDataCall::Vertex *vert = this->vertices.data() + atom.firstVertex;
+
+    // convert the records and split them at gaps in the frame numbers
+    SolPathDataCall::Pathline path;
+    path.id = atom.id;
+    path.length = 0;
+    path.data = vert;
+    unsigned int lastFrame = 0;
+    for (unsigned int e = 0; e < atom.recordCount; e++) {
+        unsigned int frame;
+        ::memcpy(&frame, records + e * recordSize, 4);
+        ::memcpy(&vert[e].x, records + e * recordSize + 4, 12);
+        vert[e].speed = 0.0f;
+        vert[e].time = static_cast<float>(frame);
+        vert[e].clusterID = 0.0f;
+
+        if ((e == 0) || (frame != lastFrame + 1)) {
+            // start a new path
+            if (path.length > 0) {
+                outLines.push_back(path);
             }
+            path.data = vert + e;
+            path.length = 1;
+        } else {
+            // continue path
+            path.length++;
         }
+        lastFrame = frame;
 
-        off = 0;
-        for (SIZE_T p = 0; p < this->pathlines.Count(); p++) {
-            for (SIZE_T v = 0; v < this->pathlines[p].length; v++) {
+        const float *p = &vert[e].x;
+        for (int k = 0; k < 3; k++) {
+            bounds[2 * k] = std::min(bounds[2 * k], p[k]);
+            bounds[2 * k + 1] = std::max(bounds[2 * k + 1], p[k]);
+        }
+        bounds[6] = std::min(bounds[6], vert[e].time);
+        bounds[7] = std::max(bounds[7], vert[e].time);
+    }
+    if (path.length > 0) {
+        outLines.push_back(path);
+    }
+
+    for (SIZE_T l = 0; l < outLines.size(); l++) {
+        SolPathDataCall::Vertex *v = const_cast<SolPathDataCall::Vertex *>(outLines[l].data);
+        const unsigned int len = outLines[l].length;
+
+        // keep the unsmoothed positions, the filter must not see its own
+        // results
+        const bool measureSmoothed = filter.empty() || speedOfSmoothed;
+        if (!filter.empty()) {
+            scratch.resize(3 * len);
+            for (unsigned int i = 0; i < len; i++) {
+                ::memcpy(&scratch[3 * i], &v[i].x, 12);
+            }
+            for (unsigned int i = 0; i < len; i++) {
+                float pos[3] = { scratch[3 * i], scratch[3 * i + 1], scratch[3 * i + 2] };
                 float fac = 1.0f;
-                vislib::math::ShallowVector<float, 3> pos(&this->vertices[off + v].x);
-                for (SIZE_T f = 1; f < filter.Count(); f++) {
-                    if (f <= v) {
-                        pos += vislib::math::ShallowVector<float, 3>(&this->vertices[off + v - f].x) * filter[f];
+                for (unsigned int f = 1; f < filter.size(); f++) {
+                    if (f <= i) {
+                        for (int k = 0; k < 3; k++) pos[k] += scratch[3 * (i - f) + k] * filter[f];
                         fac += filter[f];
                     }
-                    if (f + v < this->pathlines[p].length) {
-                        pos += vislib::math::ShallowVector<float, 3>(&this->vertices[off + v + f].x) * filter[f];
+                    if (f + i < len) {
+                        for (int k = 0; k < 3; k++) pos[k] += scratch[3 * (i + f) + k] * filter[f];
                         fac += filter[f];
                     }
                 }
-                pos /= fac;
+                v[i].x = pos[0] / fac;
+                v[i].y = pos[1] / fac;
+                v[i].z = pos[2] / fac;
             }
-            off += this->pathlines[p].length;
         }
 
         // Note: smoothing does change the positions, but will never leave the
         // original bounding box. Since everything is just an approximation we
         // keep the old bounding box.
 
-        if (this->speedOfSmoothedSlot.Param<param::BoolParam>()->Value()) {
-            // recalculate speed
-            off = 0;
-            this->maxSpeed = -FLT_MAX;
-            this->minSpeed = FLT_MAX;
-            for (SIZE_T p = 0; p < this->pathlines.Count(); p++) {
-                for (SIZE_T v = 1; v < this->pathlines[p].length; v++) {
-                    SolPathDataCall::Vertex &v1 = this->vertices[off + v];
-                    v1.speed = vislib::math::ShallowPoint<float, 3>(&v1.x)
-                        .Distance(vislib::math::ShallowPoint<float, 3>(&this->vertices[off + v - 1].x));
-                    if (v1.speed > 0.01f) {
-                        if (v1.speed > this->maxSpeed) this->maxSpeed = v1.speed;
-                        if (v1.speed < this->minSpeed) this->minSpeed = v1.speed;
-                    }
-                }
-                if (this->pathlines[p].length > 2) {
-                    this->vertices[off].speed = this->vertices[off + 1].speed;
-                }
-                off += this->pathlines[p].length;
+        for (unsigned int i = 1; i < len; i++) {
+            const float *p0 = measureSmoothed ? &v[i - 1].x : &scratch[3 * (i - 1)];
+            const float *p1 = measureSmoothed ? &v[i].x : &scratch[3 * i];
+            v[i].speed = vislib::math::ShallowPoint<float, 3>(const_cast<float *>(p1))
+                .Distance(vislib::math::ShallowPoint<float, 3>(const_cast<float *>(p0)));
+            if (v[i].speed > 0.01f) {
+                bounds[8] = std::min(bounds[8], v[i].speed);
+                bounds[9] = std::max(bounds[9], v[i].speed);
             }
         }
+        if (len > 2) {
+            v[0].speed = v[1].speed;
+        }
+    }
+}
+
+
+/*
+ * SolPathDataSource::loadCache
+ */
+bool SolPathDataSource::loadCache(const std::string& path, const std::string& key) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    char magic[8];
+    UINT64 keyLen = 0, vertexCount = 0, pathlineCount = 0;
+    in.read(magic, 8);
+    in.read(reinterpret_cast<char *>(&keyLen), sizeof(keyLen));
+    if (!in || (::memcmp(magic, "SPCACHE1", 8) != 0) || (keyLen != key.size())) return false;
+    std::string fileKey(static_cast<SIZE_T>(keyLen), '\0');
+    in.read(&fileKey[0], keyLen);
+    if (!in || (fileKey != key)) return false;
+
+    float bounds[10];
+    in.read(reinterpret_cast<char *>(bounds), sizeof(bounds));
+    in.read(reinterpret_cast<char *>(&vertexCount), sizeof(vertexCount));
+    in.read(reinterpret_cast<char *>(&pathlineCount), sizeof(pathlineCount));
+    if (!in) return false;
+
+    this->vertices.resize(static_cast<SIZE_T>(vertexCount));
+    in.read(reinterpret_cast<char *>(this->vertices.data()), vertexCount * sizeof(SolPathDataCall::Vertex));
+    std::vector<unsigned int> lines(static_cast<SIZE_T>(2 * pathlineCount));
+    in.read(reinterpret_cast<char *>(lines.data()), lines.size() * sizeof(unsigned int));
+    if (!in) {
+        this->clear();
+        return false;
+    }
 
-        if (this->clusterOfSmoothedSlot.Param<param::BoolParam>()->Value()) {
+    this->pathlines.resize(static_cast<SIZE_T>(pathlineCount));
+    SIZE_T off = 0;
+    for (SIZE_T p = 0; p < this->pathlines.size(); p++) {
+        this->pathlines[p].id = lines[2 * p];
+        this->pathlines[p].length = lines[2 * p + 1];
+        this->pathlines[p].data = this->vertices.data() + off;
+        off += this->pathlines[p].length;
+    }
+    if (off != this->vertices.size()) {
+        this->clear();
+        return false;
+    }
+
+    this->bbox.Set(bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]);
+    this->minTime = bounds[6];
+    this->maxTime = bounds[7];
+    this->minSpeed = bounds[8];
+    this->maxSpeed = bounds[9];
+    return true;
+}
 
-            // TODO: calculate clusters here
 
+/*
+ * SolPathDataSource::saveCache
+ */
+bool SolPathDataSource::saveCache(const std::string& path, const std::string& key) const {
+    // write a new file first, so an interruption does not leave a broken
+    // cache behind
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        const UINT64 keyLen = key.size();
+        const UINT64 vertexCount = this->vertices.size();
+        const UINT64 pathlineCount = this->pathlines.size();
+        const float bounds[10] = { this->bbox.Left(), this->bbox.Bottom(), this->bbox.Back(),
+            this->bbox.Right(), this->bbox.Top(), this->bbox.Front(),
+            this->minTime, this->maxTime, this->minSpeed, this->maxSpeed };
+        out.write("SPCACHE1", 8);
+        out.write(reinterpret_cast<const char *>(&keyLen), sizeof(keyLen));
+        out.write(key.data(), key.size());
+        out.write(reinterpret_cast<const char *>(bounds), sizeof(bounds));
+        out.write(reinterpret_cast<const char *>(&vertexCount), sizeof(vertexCount));
+        out.write(reinterpret_cast<const char *>(&pathlineCount), sizeof(pathlineCount));
+        out.write(reinterpret_cast<const char *>(this->vertices.data()),
+            this->vertices.size() * sizeof(SolPathDataCall::Vertex));
+        std::vector<unsigned int> lines(2 * this->pathlines.size());
+        for (SIZE_T p = 0; p < this->pathlines.size(); p++) {
+            lines[2 * p] = this->pathlines[p].id;
+            lines[2 * p + 1] = this->pathlines[p].length;
         }
+        out.write(reinterpret_cast<const char *>(lines.data()), lines.size() * sizeof(unsigned int));
+        if (!out) return false;
     }
+    std::remove(path.c_str());
+    return (std::rename(tmpPath.c_str(), path.c_str()) == 0);
 }
@@ -14,9 +14,10 @@
 #include "mmcore/param/ParamSlot.h"
 #include "mmcore/CalleeSlot.h"
 #include "SolPathDataCall.h"
-#include "vislib/Array.h"
 #include "vislib/math/Cuboid.h"
 #include "vislib/sys/File.h"
+#include <string>
+#include <vector>
 
 
 namespace megamol {
@@ -106,6 +107,31 @@ namespace protein {
 
         } fileBlockInfo;
 
+        /**
+         * The location of the records of one atom in the data file
+         */
+        typedef struct atomBlockInfo_t {
+
+            /** The id of the atom */
+            unsigned int id;
+
+            /** The number of records (frame number and position) */
+            unsigned int recordCount;
+
+            /** The offset of the first record in the file */
+            vislib::sys::File::FileOffset start;
+
+            /** The index of the first vertex of the atom */
+            SIZE_T firstVertex;
+
+        } atomBlockInfo;
+
+        /** The size of one record (frame number and position) in the file */
+        static const SIZE_T recordSize;
+
+        /** The maximum size of the records read at once */
+        static const SIZE_T chunkSize;
+
         /**
          * Answer whether any parameter slot is dirty.
          *
@@ -117,7 +143,8 @@ namespace protein {
                 || this->smoothValueSlot.IsDirty()
                 || this->smoothExpSlot.IsDirty()
                 || this->speedOfSmoothedSlot.IsDirty()
-                || this->clusterOfSmoothedSlot.IsDirty();
+                || this->clusterOfSmoothedSlot.IsDirty()
+                || this->cacheFileSlot.IsDirty();
         }
 
         /**
@@ -140,6 +167,64 @@ namespace protein {
          */
         void loadData(void);
 
+        /**
+         * Reads the pathline data block and builds the pathlines. The atoms
+         * are read in chunks, and the atoms of each chunk are converted,
+         * split into pathlines and filtered in parallel.
+         *
+         * @param file The data file
+         * @param block The pathline data block
+         * @param filter The weights of the smoothing filter, empty if the
+         *               data is not smoothed
+         *
+         * @return 'true' on success, 'false' otherwise.
+         */
+        bool readPathlines(vislib::sys::File& file, const fileBlockInfo& block,
+            const std::vector<float>& filter);
+
+        /**
+         * Converts the records of one atom into vertices, splits them into
+         * pathlines at gaps in the frame numbers and smoothes and measures
+         * each pathline.
+         *
+         * @param atom The atom
+         * @param records The records of the atom
+         * @param filter The weights of the smoothing filter, empty if the
+         *               data is not smoothed
+         * @param speedOfSmoothed Flag whether the speed is measured on the
+         *                        smoothed positions
+         * @param scratch Buffer for the unsmoothed positions of a pathline
+         * @param outLines Receives the pathlines of the atom
+         * @param bounds Receives the bounding data: minimum and maximum
+         *               x, y, z, time and speed, in this order
+         */
+        void buildAtom(const atomBlockInfo& atom, const char *records,
+            const std::vector<float>& filter, bool speedOfSmoothed,
+            std::vector<float>& scratch,
+            std::vector<SolPathDataCall::Pathline>& outLines,
+            float bounds[12]);
+
+        /**
+         * Loads the pathlines from the cache file, if it has been written
+         * for the current data file and filter settings.
+         *
+         * @param path The path of the cache file
+         * @param key The identification of the data file and settings
+         *
+         * @return 'true' if the pathlines have been loaded.
+         */
+        bool loadCache(const std::string& path, const std::string& key);
+
+        /**
+         * Writes the pathlines to the cache file.
+         *
+         * @param path The path of the cache file
+         * @param key The identification of the data file and settings
+         *
+         * @return 'true' on success, 'false' otherwise.
+         */
+        bool saveCache(const std::string& path, const std::string& key) const;
+
         /** The slot publishing the data */
         megamol::core::CalleeSlot getdataslot;
 
@@ -161,6 +246,9 @@ namespace protein {
         /** Flag to cluster the smoothed or unsmoothed data */
         megamol::core::param::ParamSlot clusterOfSmoothedSlot;
 
+        /** The path of the binary cache of the processed pathlines */
+        megamol::core::param::ParamSlot cacheFileSlot;
+
         /** The bbox */
         vislib::math::Cuboid<float> bbox;
 
@@ -176,11 +264,11 @@ namespace protein {
         /** The maximum speed */
         float maxSpeed;
 
-        /** The vertex data */
-        vislib::Array<SolPathDataCall::Vertex> vertices;
+        /** The vertex data of all pathlines, one after another */
+        std::vector<SolPathDataCall::Vertex> vertices;
 
-        /** The pathline data */
-        vislib::Array<SolPathDataCall::Pathline> pathlines;
+        /** The pathline data pointing into 'vertices' */
+        std::vector<SolPathDataCall::Pathline> pathlines;
 
     };
 
@@ -30,7 +30,7 @@ getDataSlot("getdata", "The slot publishing the loaded data"),
 molDataSlot("moldata", "The slot requesting molecular data"),
 solDataSlot("soldata", "The slot requesting solvent data"),
 radiusParam("radius", "The search radius for solvent molecules"),
-minValue(0.0f), midValue(0.0f), maxValue(0.0f) {
+minValue(0.0f), midValue(0.0f), maxValue(0.0f), datahash(0) {
     // the data out slot
     this->getDataSlot.SetCallback(PerAtomFloatCall::ClassName(), PerAtomFloatCall::FunctionName(PerAtomFloatCall::CallForGetFloat), &SolventCounter::getDataCallback);
     this->MakeSlotAvailable(&this->getDataSlot);
@@ -121,41 +121,67 @@ bool SolventCounter::getDataCallback(core::Call& call) {
     if (sol->FrameCount() != mol->FrameCount()) return false;
     unsigned int frameCount = mol->FrameCount();
     // only recompute everything if this is necessary
-    if (solvent.Count() != mol->AtomCount() || this->datahash != mol->DataHash()) {
+    if (solvent.Count() != mol->AtomCount() || this->datahash != mol->DataHash() || this->radiusParam.IsDirty()) {
+        this->radiusParam.ResetDirty();
+        const float radius = this->radiusParam.Param<param::FloatParam>()->Value();
         // load data once...
-        mol->SetFrameID(0);
+        mol->SetFrameID(0, true);
         if (!(*mol)(MolecularDataCall::CallForGetData)) return false;
-        sol->SetFrameID(0);
-        if (!(*sol)(MolecularDataCall::CallForGetData)) return false;
+        const unsigned int atomCount = mol->AtomCount();
+        mol->Unlock();
         vislib::sys::Log::DefaultLog.WriteInfo("Start recomputing solvent neighborhood information per atom...");
         this->solvent.Clear();
-        this->solvent.SetCount(mol->AtomCount());
+        this->solvent.SetCount(atomCount);
         // set all values to zero
-        for (unsigned int i = 0; i < mol->AtomCount(); i++) {
+        for (unsigned int i = 0; i < atomCount; i++) {
             this->solvent[i] = 0.0f;
         }
         this->minValue = FLT_MAX;
         this->maxValue = FLT_MIN;
         // loop over all frames
-        vislib::math::Vector<float, 3> molAtomPos, solAtomPos;
+        unsigned int gridAtomCount = 0;
         for (unsigned int fID = 0; fID < frameCount; fID++) {
             if ( fID % 100 == 0 )
                 vislib::sys::Log::DefaultLog.WriteInfo("Computing Frame %i", fID);
-            mol->SetFrameID(fID);
+            mol->SetFrameID(fID, true);
             if (!(*mol)(MolecularDataCall::CallForGetData)) return false;
-            sol->SetFrameID(fID);
-            if (!(*sol)(MolecularDataCall::CallForGetData)) return false;
-            // loop over all molecule atoms and check for neighboring solvent atoms
-            for (unsigned int i = 0; i < mol->AtomCount(); i++) {
-                molAtomPos.Set(mol->AtomPositions()[3 * i],
-                    mol->AtomPositions()[3 * i + 1], mol->AtomPositions()[3 * i + 2]);
-                for (unsigned int j = 0; j < sol->AtomCount(); j++) {
-                    solAtomPos.Set(sol->AtomPositions()[3 * j],
-                        sol->AtomPositions()[3 * j + 1], sol->AtomPositions()[3 * j + 2]);
-                    // increase counter if the current solvent atom is within the given radius
-                    if ((molAtomPos - solAtomPos).Length() <= this->radiusParam.Param<param::FloatParam>()->Value()) {
+            sol->SetFrameID(fID, true);
+            if (!(*sol)(MolecularDataCall::CallForGetData)) {
+                mol->Unlock();
+                return false;
+            }
+            if (mol->AtomCount() != atomCount) {
+                vislib::sys::Log::DefaultLog.WriteError("Frame %u has %u atoms instead of %u", fID, mol->AtomCount(), atomCount);
+                mol->Unlock();
+                sol->Unlock();
+                return false;
+            }
+
+            // sort the solvent atoms into the grid, after the first frame
+            // only the atoms that left their cell need to be moved
+            const float *solPos = sol->AtomPositions();
+            const unsigned int solCount = sol->AtomCount();
+            if (solCount > 0) {
+                vislib::math::Cuboid<float> solBBox(solPos[0], solPos[1], solPos[2], solPos[0], solPos[1], solPos[2]);
+                for (unsigned int j = 1; j < solCount; j++) {
+                    solBBox.GrowToPoint(solPos[3 * j], solPos[3 * j + 1], solPos[3 * j + 2]);
+                }
+                if ((fID == 0) || (solCount != gridAtomCount)) {
+                    // leave some room for the atoms to move
+                    solBBox.Grow(radius);
+                    this->solventGrid.SetPointData(solPos, solCount, solBBox, radius);
+                    gridAtomCount = solCount;
+                } else {
+                    this->solventGrid.UpdatePointData(solPos, solBBox);
+                }
+
+                // loop over all molecule atoms and check for neighboring solvent atoms
+                const float *molPos = mol->AtomPositions();
+#pragma omp parallel for
+                for (int i = 0; i < static_cast<int>(atomCount); i++) {
+                    // increase counter if any solvent atom is within the given radius
+                    if (this->solventGrid.HasNeighbourInRange(&molPos[3 * i], radius)) {
                         this->solvent[i] += 1.0f;
-                        break;
                     }
                 }
             }
@@ -164,7 +190,7 @@ bool SolventCounter::getDataCallback(core::Call& call) {
             sol->Unlock();
         }
         // normalize values
-        for (unsigned int i = 0; i < mol->AtomCount(); i++) {
+        for (unsigned int i = 0; i < atomCount; i++) {
             this->solvent[i] /= static_cast<float>(frameCount);
             this->minValue = vislib::math::Min(this->minValue, this->solvent[i]);
             this->maxValue = vislib::math::Max(this->maxValue, this->solvent[i]);
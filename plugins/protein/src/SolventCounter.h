@@ -18,6 +18,7 @@
 #include "mmcore/param/ParamSlot.h"
 #include "protein_calls/MolecularDataCall.h"
 #include "vislib/Array.h"
+#include "GridNeighbourFinder.h"
 
 
 namespace megamol {
@@ -106,6 +107,9 @@ namespace protein {
         /** The array that stores the solvent around each atom */
         vislib::Array<float> solvent;
 
+        /** The grid of the solvent atoms, which is reused for all frames */
+        GridNeighbourFinder<float> solventGrid;
+
         float minValue;
         float midValue;
         float maxValue;
@@ -25,8 +25,11 @@
 #include "vislib/sys/ASCIIFileBuffer.h"
 #include "vislib/math/ShallowPoint.h"
 #include "vislib/sys/PerformanceCounter.h"
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <thread>
 #include <omp.h>
 
 using namespace megamol;
@@ -42,7 +45,9 @@ megamol::protein::SolventHydroBondGenerator::SolventHydroBondGenerator() :
 		hBondDistance("hBondDistance", "distance for hydrogen bonds (angstroem?)"),
 		hBondDonorAcceptorDistance("hBondDonorAcceptorDistance", "distance between donor and acceptor of the hydrogen bonds"),
 		hBondDonorAcceptorAngle("hBondDonorAcceptorAngle", "angle between donor-acceptor and donor-hydrogen in degrees"),
-		showMiddlePositions("showMiddlePositions", "show the middle of all atom positions over time")
+		showMiddlePositions("showMiddlePositions", "show the middle of all atom positions over time"),
+		statisticsFile("statisticsFile", "file the hydrogen bond statistics are stored in, so they are computed only once"),
+		neighbourFinderDistance(-1.0f), statNeighbourFinders(NULL), hydrogenBondStatisticsValid(false), topologyAtomCount(0), topologyDataHash(0)
 {
 	this->molDataInputCallerSlot.SetCompatibleCall<MolecularDataCallDescription>();
 	this->MakeSlotAvailable( &this->molDataInputCallerSlot);
@@ -69,16 +74,21 @@ megamol::protein::SolventHydroBondGenerator::SolventHydroBondGenerator() :
 	this->showMiddlePositions.SetParameter(new param::BoolParam(false));
 	this->MakeSlotAvailable( &this->showMiddlePositions);
 
+	this->statisticsFile.SetParameter(new param::FilePathParam(""));
+	this->MakeSlotAvailable( &this->statisticsFile);
+
 	for(int i = 0; i < HYDROGEN_BOND_IN_CORE; i++)
 		curHBondFrame[i] = -1;
 
 	this->maxOMPThreads = omp_get_max_threads();
 	this->neighbourIndices = new vislib::Array<unsigned int>[this->maxOMPThreads];
+	this->statNeighbourFinders = new GridNeighbourFinder<float>[this->maxOMPThreads];
 	//this->neighbHydrogenIndices = new vislib::Array<unsigned int>[this->maxOMPThreads];
 }
 
 megamol::protein::SolventHydroBondGenerator::~SolventHydroBondGenerator() {
 	delete [] this->neighbourIndices;
+	delete [] this->statNeighbourFinders;
 	this->Release();
 }
 
@@ -225,312 +235,420 @@ public:
 #endif
 
 
-void megamol::protein::SolventHydroBondGenerator::calcHydroBondsForCurFrame(MolecularDataCall *data, const float *atomPositions, int *atomHydroBondsIndicesPtr) {
-	//const float *atomPositions = data->AtomPositions();
+void megamol::protein::SolventHydroBondGenerator::prepareTopology(MolecularDataCall *data) {
+	if ((this->topologyAtomCount == data->AtomCount()) && (this->topologyDataHash == data->DataHash()))
+		return;
+
 	const MolecularDataCall::AtomType *atomTypes = data->AtomTypes();
 	const unsigned int *atomTypeIndices = data->AtomTypeIndices();
-	const int *atomResidueIndices = data->AtomResidueIndices();
-
-    // set all entries to "not connected"
-	memset(atomHydroBondsIndicesPtr, -1, sizeof(int)*data->AtomCount());
-
-	if (reverseConnection.Count() < data->AtomCount())
-		reverseConnection.SetCount(data->AtomCount());
-	int *reverseConnectionPtr = &reverseConnection[0];
-	memset(reverseConnectionPtr, -1, reverseConnection.Count()*sizeof(int));
-
-	vislib::sys::PerformanceCounter timer(true);
-	//timer.SetMark();
-
-#if 0
-	float hbondDist = hBondDistance.Param<param::FloatParam>()->Value();
-	neighbourFinder.SetPointData(atomPositions, data->AtomCount(), data->AccessBoundingBoxes().ObjectSpaceBBox(), hbondDist);
 
-	// looping over residues may not be a good idea?! (index-traversal?) loop over all possible acceptors ...
-#pragma omp parallel for
-	for( int rIdx = 0; rIdx < data->ResidueCount(); rIdx++ ) {
-		const MolecularDataCall::Residue *residue = data->Residues()[rIdx];
+	/* create hydrogen connections */
+	this->hydrogenConnections.SetCount(data->AtomCount() * MAX_HYDROGENS_PER_ATOM);
+	memset(&this->hydrogenConnections[0], -1, this->hydrogenConnections.Count()*sizeof(int));
+	int count = data->ConnectionCount();
+	for(int i = 0; i < count; i++) {
+		int idx0 = data->Connection()[2*i];
+		int idx1 = data->Connection()[2*i+1];
+		char element0 = atomTypes[atomTypeIndices[idx0]].Name()[0];
+		char element1 = atomTypes[atomTypeIndices[idx1]].Name()[0];
+
+		/* make sure the hydrogen atom is 'idx1' */
+		if (element0 == 'H') {
+			vislib::math::Swap(idx0, idx1);
+			vislib::math::Swap(element0, element1);
+		}
 
-		// we're only interested in hydrogen bonds between polymer/protein molecule and surounding solvent
-		if (data->IsSolvent(residue))
+		// check if we have a possible donor/acceptor here ...
+		if (element0 != 'O' && element0 != 'N')
 			continue;
 
-		// find possible acceptor atoms in the current residuum (for now just O, N, C(?)
-
-		// vorerst nur Sauerstoff und Stickstoff als Akzeptor/Donator (N, O)
-		int lastAtomIdx = residue->FirstAtomIndex()+residue->AtomCount();
-		for(int aIdx = residue->FirstAtomIndex(); aIdx < lastAtomIdx; aIdx++) {
-			// is this atom already connected?
-			if (reverseConnectionPtr[aIdx] != -1)
-				continue;
-
-			const MolecularDataCall::AtomType& t = atomTypes[atomTypeIndices[aIdx]];
-			const vislib::StringA& name = t.Name();
-			char element = name[0];
+		// add hydrogen connection if present ...
+		if (element1 == 'H') {
+			int hydrogenConnIdx = idx0*MAX_HYDROGENS_PER_ATOM;
+			for(int j = 0; j < MAX_HYDROGENS_PER_ATOM; j++) {
+				if (hydrogenConnections[hydrogenConnIdx] == -1) {
+					hydrogenConnections[hydrogenConnIdx] = idx1;
+					break;
+				}
+				hydrogenConnIdx++;
+			}
+		}
+	}
 
 /*
 JW: ich fuerchte fuer eine allgemeine Deffinition der Wasserstoffbruecken muss man ueber die Bindungsenergien gehen und diese berechnen.
 Fuer meine Simulationen und alle Bio-Geschichten reicht die Annahme, dass Sauerstoff, Stickstoff und Fluor (was fast nie vorkommt)
 Wasserstoffbruecken bilden und dabei als Donor und Aktzeptor dienen koenne. Dabei ist der Wasserstoff am Donor gebunden und bildet die Bruecke zum Akzeptor.
 */
-			if (element=='N' || element=='O' /*|| element=='F' || element=='C'??*/) {
-				int ompThreadID = omp_get_thread_num();
-				neighbourIndices[ompThreadID].Clear(); // clear, keep capacity ...
-				neighbourIndices[ompThreadID].SetCapacityIncrement( 100); // set capacity increment
-				neighbourFinder.FindNeighboursInRange(&atomPositions[aIdx*3], hbondDist, neighbourIndices[ompThreadID]);
-				for(int nIdx = 0; nIdx<neighbourIndices[ompThreadID].Count(); nIdx++) {
-					int neighbIndex = neighbourIndices[ompThreadID][nIdx];
-					// atom from the current residue?
-					if (atomResidueIndices[neighbIndex]==rIdx)
-						continue;
-					// check if a H-atom is in range and add a h-bond...
-					if (atomTypes[atomTypeIndices[neighbIndex]].Name()[0]=='H') {
-						atomHydroBondsIndicesPtr[aIdx] = neighbIndex;
-						// avoid double checks - only one hydrogen bond per atom?!
-						reverseConnectionPtr[neighbIndex] = aIdx;
-						// TODO: maybe mark double time? or double with negative index?
-					}
+	this->donorAcceptors.SetCount(data->AtomCount());
+	memset(&this->donorAcceptors[0], -1, this->donorAcceptors.Count()*sizeof(int));
+	for(unsigned int i = 0; i < data->AtomCount(); i++) {
+		char element = atomTypes[atomTypeIndices[i]].Name()[0];
+		if (element == 'O' || element == 'N')
+			donorAcceptors[i] = 1;
+	}
+
+	// copy what is needed from the residues, so the hydrogen bonds can be computed without the call
+	this->atomResidueIdx.assign(data->AtomResidueIndices(), data->AtomResidueIndices() + data->AtomCount());
+	this->atomSolventSlot.assign(data->AtomCount(), NOT_SOLVENT);
+	this->polymerResidues.clear();
+	const int solvResCount = data->AtomSolventResidueCount();
+	const unsigned int *solventResidueIndices = data->SolventResidueIndices();
+	for (unsigned int rIdx = 0; rIdx < data->ResidueCount(); rIdx++) {
+		const MolecularDataCall::Residue *residue = data->Residues()[rIdx];
+		if (data->IsSolvent(residue)) {
+			int slot = UNKNOWN_SOLVENT;
+			for (int srIdx = 0; srIdx < solvResCount; srIdx++) {
+				if (solventResidueIndices[srIdx] == residue->Type()) {
+					slot = srIdx;
+					break;
 				}
-			} else if (element=='H') {
-				// TODO !?
 			}
+			for (unsigned int i = 0; i < residue->AtomCount(); i++)
+				this->atomSolventSlot[residue->FirstAtomIndex() + i] = slot;
+		} else {
+			this->polymerResidues.push_back(rIdx);
+			this->polymerResidues.push_back(residue->FirstAtomIndex());
+			this->polymerResidues.push_back(residue->AtomCount());
 		}
 	}
-#else
 
-	/* create hydrogen connections */
-	if (this->hydrogenConnections.Count() <= data->AtomCount() * MAX_HYDROGENS_PER_ATOM) {
-		this->hydrogenConnections.SetCount(data->AtomCount() * MAX_HYDROGENS_PER_ATOM);
-		memset(&this->hydrogenConnections[0], -1, this->hydrogenConnections.Count()*sizeof(int));
-		int count = data->ConnectionCount();
-		for(int i = 0; i < count; i++) {
-			int idx0 = data->Connection()[2*i];
-			int idx1 = data->Connection()[2*i+1];
-			char element0 = atomTypes[atomTypeIndices[idx0]].Name()[0];
-			char element1 = atomTypes[atomTypeIndices[idx1]].Name()[0];
-
-			/* make sure the hydrogen atom is 'idx1' */
-			if (element0 == 'H') {
-				vislib::math::Swap(idx0, idx1);
-				vislib::math::Swap(element0, element1);
-			}
+	this->topologyAtomCount = data->AtomCount();
+	this->topologyDataHash = data->DataHash();
+	this->neighbourFinderDistance = -1.0f;
+}
+
+
+void megamol::protein::SolventHydroBondGenerator::computeHydroBonds(const float *atomPositions,
+		const GridNeighbourFinder<float>& finder, vislib::Array<unsigned int> *neighbours, bool parallel,
+		int *atomHydroBondsIndicesPtr) const {
+	// set all entries to "not connected"
+	memset(atomHydroBondsIndicesPtr, -1, sizeof(int)*this->topologyAtomCount);
+
+	float hbondDonorAcceptorDist = hBondDonorAcceptorDistance.Param<param::FloatParam>()->Value();
+	float hbondDonorAcceptorAngle = hBondDonorAcceptorAngle.Param<param::FloatParam>()->Value() * static_cast<float>(vislib::math::PI_DOUBLE / 180.0);
+	const int *hydrogenConnectionsPtr = hydrogenConnections.PeekElements();
+	const int *atomResidueIndices = this->atomResidueIdx.data();
+
+	// we're only interested in hydrogen bonds between polymer/protein molecule and surounding solvent
+	// (poly->solv, solv->poly, poly->poly)
+	const int polymerResidueCount = static_cast<int>(this->polymerResidues.size() / 3);
+#pragma omp parallel for if (parallel)
+	for (int prIdx = 0; prIdx < polymerResidueCount; prIdx++) {
+		const int rIdx = static_cast<int>(this->polymerResidues[3 * prIdx]);
+		const unsigned int firstAtomIdx = this->polymerResidues[3 * prIdx + 1];
+		const unsigned int lastAtomIdx = firstAtomIdx + this->polymerResidues[3 * prIdx + 2];
+		// access a private array for this parallel thread ...
+		vislib::Array<unsigned int>& privateNeighbourIndices = neighbours[parallel ? omp_get_thread_num() : 0];
 
-			// check if we have a possible donor/acceptor here ...
-			if (element0 != 'O' && element0 != 'N')
+		// vorerst nur Sauerstoff und Stickstoff als Akzeptor/Donator (N, O)
+		for (unsigned int atomIndex = firstAtomIdx; atomIndex < lastAtomIdx; atomIndex++) {
+			// nitrogen and oxygen can be donors and acceptors here ...
+			if (donorAcceptors[atomIndex] == -1)
 				continue;
 
-			// add hydrogen connection if present ...
-			if (element1 == 'H') {
-				int hydrogenConnIdx = idx0*MAX_HYDROGENS_PER_ATOM;
+			privateNeighbourIndices.Clear(); // clear, keep capacity ...
+			privateNeighbourIndices.SetCapacityIncrement( 100); // set capacity increment
+			finder.FindNeighboursInRange(&atomPositions[atomIndex*3], hbondDonorAcceptorDist, privateNeighbourIndices);
+
+			for (int nIdx = 0; nIdx < (int)privateNeighbourIndices.Count(); nIdx++) {
+				int neighbIndex = privateNeighbourIndices[nIdx];
+
+				// atom from the current residue?
+				if (atomResidueIndices[neighbIndex]==rIdx)
+					continue;
+
+				// check for other acceptor/donor - all atoms inside 'finder' only consist of donor/acceptor atoms ..
+				// loop over hydrogen atoms from donor 'atomIndex'-  - 'neighbIndex' is the acceptor
+				int hydrogenConnIdx = atomIndex*MAX_HYDROGENS_PER_ATOM;
 				for(int j = 0; j < MAX_HYDROGENS_PER_ATOM; j++) {
-					if (hydrogenConnections[hydrogenConnIdx] == -1) {
-						hydrogenConnections[hydrogenConnIdx] = idx1;
+					int hydrogenAtomIdx = hydrogenConnectionsPtr[hydrogenConnIdx];
+					if (hydrogenAtomIdx != -1 && validHydrogenBond(atomIndex, hydrogenAtomIdx, neighbIndex, atomPositions, hbondDonorAcceptorAngle)) {
+						atomHydroBondsIndicesPtr[neighbIndex] = hydrogenAtomIdx;
+						// TODO: maybe mark double time? or double with negative index?
+						break;
+					}
+					hydrogenConnIdx++;
+				}
+				// loop over hydrogen atoms from donor 'neighbIndex' - 'atomIndex' is the acceptor
+				hydrogenConnIdx = neighbIndex*MAX_HYDROGENS_PER_ATOM;
+				for(int j = 0; j < MAX_HYDROGENS_PER_ATOM; j++) {
+					int hydrogenAtomIdx = hydrogenConnectionsPtr[hydrogenConnIdx];
+					if (hydrogenAtomIdx != -1 && validHydrogenBond(neighbIndex, hydrogenAtomIdx, atomIndex, atomPositions, hbondDonorAcceptorAngle)) {
+						atomHydroBondsIndicesPtr[atomIndex] = hydrogenAtomIdx;
+						// TODO: maybe mark double time? or double with negative index?
 						break;
 					}
 					hydrogenConnIdx++;
 				}
 			}
 		}
-
-		this->donorAcceptors.SetCount(data->AtomCount());
-		memset(&this->donorAcceptors[0], -1, this->donorAcceptors.Count()*sizeof(int));
-		for(unsigned int i = 0; i < data->AtomCount(); i++) {
-			char element = atomTypes[atomTypeIndices[i]].Name()[0];
-			if (element == 'O' || element == 'N')
-				donorAcceptors[i] = 1;
-		}
 	}
+}
 
-	// only fill in donors/acceptors into the neighbour finder grid ...
-	float hbondDonorAcceptorDist = hBondDonorAcceptorDistance.Param<param::FloatParam>()->Value();
-	float hbondDonorAcceptorAngle = hBondDonorAcceptorAngle.Param<param::FloatParam>()->Value() * static_cast<float>(vislib::math::PI_DOUBLE / 180.0);
-	neighbourFinder.SetPointData(atomPositions, data->AtomCount(), data->AccessBoundingBoxes().ObjectSpaceBBox(), hbondDonorAcceptorDist, &donorAcceptors[0] );
 
-	const int *hydrogenConnectionsPtr = hydrogenConnections.PeekElements();
+void megamol::protein::SolventHydroBondGenerator::calcHydroBondsForCurFrame(MolecularDataCall *data, const float *atomPositions, int *atomHydroBondsIndicesPtr) {
+	vislib::sys::PerformanceCounter timer(true);
 
-	// looping over residues may not be a good idea?! (index-traversal?) loop over all possible acceptors ...
-#pragma omp parallel for
-	for( int rIdx = 0; rIdx < static_cast<int>(data->ResidueCount()); rIdx++ ) {
-		const MolecularDataCall::Residue *residue = data->Residues()[rIdx];
+	this->prepareTopology(data);
 
-		// we're only interested in hydrogen bonds between polymer/protein molecule and surounding solvent
-//#error großes Problem: es werden so nicht alle Wasserstoffbrücken gefunden?!
-		if (data->IsSolvent(residue))
-			continue;
-
-		// find possible acceptor atoms in the current residuum (for now just O, N, C(?)
+	// only fill in donors/acceptors into the neighbour finder grid, the grid is reused from the last frame ...
+	float hbondDonorAcceptorDist = hBondDonorAcceptorDistance.Param<param::FloatParam>()->Value();
+	if (this->neighbourFinderDistance == hbondDonorAcceptorDist) {
+		neighbourFinder.UpdatePointData(atomPositions, data->AccessBoundingBoxes().ObjectSpaceBBox());
+	} else {
+		neighbourFinder.SetPointData(atomPositions, data->AtomCount(), data->AccessBoundingBoxes().ObjectSpaceBBox(), hbondDonorAcceptorDist, &donorAcceptors[0] );
+		this->neighbourFinderDistance = hbondDonorAcceptorDist;
+	}
 
-		// vorerst nur Sauerstoff und Stickstoff als Akzeptor/Donator (N, O)
-		unsigned int lastAtomIdx = residue->FirstAtomIndex()+residue->AtomCount();
-		for(unsigned int atomIndex = residue->FirstAtomIndex(); atomIndex < lastAtomIdx; atomIndex++) {
-			// is this atom already connected?
-			//if (reverseConnectionPtr[atomIndex] >= 0 continue;
+	this->computeHydroBonds(atomPositions, this->neighbourFinder, this->neighbourIndices, true, atomHydroBondsIndicesPtr);
 
-/*
-JW: ich fuerchte fuer eine allgemeine Deffinition der Wasserstoffbruecken muss man ueber die Bindungsenergien gehen und diese berechnen.
-Fuer meine Simulationen und alle Bio-Geschichten reicht die Annahme, dass Sauerstoff, Stickstoff und Fluor (was fast nie vorkommt)
-Wasserstoffbruecken bilden und dabei als Donor und Aktzeptor dienen koenne. Dabei ist der Wasserstoff am Donor gebunden und bildet die Bruecke zum Akzeptor.
-*/
+	std::cout << "Hydrogen bonds computed in " << std::fixed << timer.ToMillis(timer.Difference()) << " ms." << std::endl;
+}
 
-//#error poly->solv, solv->poly! und poly->poly! solv->solv auf keine fall auf der oberfläche! (zumindest unterscheiden)
 
-			// nitrogen and oxygen can be donors and acceptors here ...
-			if (donorAcceptors[atomIndex] != -1 /*element=='N' || element=='O'*/) {
-				// access a private array for this parallel thread ...
-				vislib::Array<unsigned int>& privateNeighbourIndices = neighbourIndices[omp_get_thread_num()];
-				privateNeighbourIndices.Clear(); // clear, keep capacity ...
-				privateNeighbourIndices.SetCapacityIncrement( 100); // set capacity increment
-				neighbourFinder.FindNeighboursInRange(&atomPositions[atomIndex*3], hbondDonorAcceptorDist, privateNeighbourIndices);
-
-				for (int nIdx = 0; nIdx < (int)privateNeighbourIndices.Count(); nIdx++) {
-					int neighbIndex = privateNeighbourIndices[nIdx];
-					//char elementNeighb = atomTypes[atomTypeIndices[neighbIndex]].Name()[0];
-
-					// atom from the current residue?
-					if (atomResidueIndices[neighbIndex]==rIdx)
-						continue;
-
-					//ASSERT(donorAcceptors[neighbIndex] != -1);
-					//if ( elementNeighb=='O' || elementNeighb=='N' ) { ... }
-
-
-					// DEBUG
-					//atomHydroBondsIndicesPtr[atomIndex] = neighbIndex;
-					//atomHydroBondsIndicesPtr[neighbIndex] = atomIndex;
-
-					// check for other acceptor/donor - all atoms inside 'neighbourFinder' only consist of donor/acceptor atoms ..
-					// loop over hydrogen atoms from donor 'atomIndex'-  - 'neighbIndex' is the acceptor
-					int hydrogenConnIdx = atomIndex*MAX_HYDROGENS_PER_ATOM;
-					for(int j = 0; j < MAX_HYDROGENS_PER_ATOM; j++) {
-						int hydrogenAtomIdx = hydrogenConnectionsPtr[hydrogenConnIdx];
-						if (hydrogenAtomIdx != -1 && validHydrogenBond(atomIndex, hydrogenAtomIdx, neighbIndex, atomPositions, hbondDonorAcceptorAngle)) {
-							atomHydroBondsIndicesPtr[neighbIndex] = hydrogenAtomIdx;
-							// mark this donor/acceptor pair as already connetected with a hydrogen bond
-							//reverseConnectionPtr[atomIndex] = neighbIndex;
-							// TODO: maybe mark double time? or double with negative index?
-							break;
-						}
-						hydrogenConnIdx++;
-					}
-					// loop over hydrogen atoms from donor 'neighbIndex' - 'atomIndex' is the acceptor
-					hydrogenConnIdx = neighbIndex*MAX_HYDROGENS_PER_ATOM;
-					for(int j = 0; j < MAX_HYDROGENS_PER_ATOM; j++) {
-						int hydrogenAtomIdx = hydrogenConnectionsPtr[hydrogenConnIdx];
-						if (hydrogenAtomIdx != -1 && validHydrogenBond(neighbIndex, hydrogenAtomIdx, atomIndex, atomPositions, hbondDonorAcceptorAngle)) {
-							atomHydroBondsIndicesPtr[atomIndex] = hydrogenAtomIdx;
-							// mark this donor/acceptor pair as already connetected with a hydrogen bond
-							//reverseConnectionPtr[neighbIndex] = atomIndex;
-							// TODO: maybe mark double time? or double with negative index?
-							break;
-						}
-						hydrogenConnIdx++;
-					}
-				}
-			}
+void megamol::protein::SolventHydroBondGenerator::accumulateStatistics(const int *hydrogenBonds,
+		const int *prevHydrogenBonds, unsigned int solvResCount, unsigned int *occupancy, unsigned int *starts) const {
+	for (unsigned int atomIndex = 0; atomIndex < this->topologyAtomCount; atomIndex++) {
+		int otherAtomIndex = hydrogenBonds[atomIndex];
+		if (otherAtomIndex == -1)
+			continue;
+		const int slot = this->atomSolventSlot[atomIndex];
+		const int otherSlot = this->atomSolventSlot[otherAtomIndex];
+		const bool isSolvent = (slot != NOT_SOLVENT);
+		const bool isOtherSolvent = (otherSlot != NOT_SOLVENT);
+
+		// only polymer/solvent HBonds are counted, for the polymer atom and the solvent residue type ...
+		size_t idx;
+		if (isSolvent == isOtherSolvent) {
+			continue;
+		} else if (!isSolvent) {
+			if (otherSlot == UNKNOWN_SOLVENT)
+				continue;
+			idx = static_cast<size_t>(solvResCount) * atomIndex + otherSlot;
+		} else {
+			if (slot == UNKNOWN_SOLVENT)
+				continue;
+			idx = static_cast<size_t>(solvResCount) * otherAtomIndex + slot;
 		}
+		occupancy[idx]++;
+		if (prevHydrogenBonds[atomIndex] != otherAtomIndex)
+			starts[idx]++;
 	}
-#endif
-
-	std::cout << "Hydrogen bonds computed in " << std::fixed << timer.ToMillis(timer.Difference()) << " ms." << std::endl;
 }
 
 
-#if 1
-bool megamol::protein::SolventHydroBondGenerator::calcHydrogenBondStatistics(MolecularDataCall *dataTarget, MolecularDataCall *dataSource) {
-	int savedSrcFrameId = dataSource->FrameID();
-	int savedTargetFrameId = dataTarget->FrameID();
+bool megamol::protein::SolventHydroBondGenerator::loadStatisticsBatch(MolecularDataCall *dataSource,
+		unsigned int first, unsigned int count, std::vector<float>& positions,
+		std::vector<vislib::math::Cuboid<float> >& bboxes) {
+	const size_t n = static_cast<size_t>(this->topologyAtomCount) * 3;
+	positions.resize(count * n);
+	bboxes.resize(count);
+	for (unsigned int i = 0; i < count; i++) {
+		dataSource->SetFrameID(first + i, true);
+		if (!(*dataSource)(MolecularDataCall::CallForGetData))
+			return false;
+		if (dataSource->AtomCount() != this->topologyAtomCount) {
+			vislib::sys::Log::DefaultLog.WriteError("%s: Frame %u has %u atoms instead of %u", this->ClassName(),
+				first + i, dataSource->AtomCount(), this->topologyAtomCount);
+			dataSource->Unlock();
+			return false;
+		}
+		memcpy(positions.data() + i * n, dataSource->AtomPositions(), n * sizeof(float));
+		bboxes[i] = dataSource->AccessBoundingBoxes().ObjectSpaceBBox();
+		dataSource->Unlock();
+	}
+	return true;
+}
 
-	int solvResCount = dataSource->AtomSolventResidueCount();
-	const unsigned int *solventResidueIndices = dataSource->SolventResidueIndices();
 
-	if (this->hydrogenBondStatistics.Count() < solvResCount*dataSource->AtomCount()) {
-		this->hydrogenBondStatistics.SetCount(solvResCount*dataSource->AtomCount());
-		memset(&this->hydrogenBondStatistics[0], 0, hydrogenBondStatistics.Count()*sizeof(unsigned int));
+void megamol::protein::SolventHydroBondGenerator::processStatisticsBatch(const std::vector<float> *positions,
+		const std::vector<vislib::math::Cuboid<float> > *bboxes, unsigned int count, unsigned int solvResCount) {
+	const unsigned int atomCount = this->topologyAtomCount;
+	const float hbondDonorAcceptorDist = hBondDonorAcceptorDistance.Param<param::FloatParam>()->Value();
+	const int frameCount = static_cast<int>(count);
+
+	// consecutive frames per thread, so each grid only has to be updated by the atoms that moved. The
+	// per-thread arrays only have maxOMPThreads elements, which this thread's team must not exceed.
+#pragma omp parallel for schedule(static) num_threads(this->maxOMPThreads)
+	for (int f = 0; f < frameCount; f++) {
+		const int t = omp_get_thread_num();
+		const float *pos = positions->data() + static_cast<size_t>(f) * 3 * atomCount;
+		GridNeighbourFinder<float>& finder = this->statNeighbourFinders[t];
+		if (this->statNeighbourFinderReady[t]) {
+			finder.UpdatePointData(pos, (*bboxes)[f]);
+		} else {
+			finder.SetPointData(pos, atomCount, (*bboxes)[f], hbondDonorAcceptorDist, &this->donorAcceptors[0]);
+			this->statNeighbourFinderReady[t] = 1;
+		}
+		this->computeHydroBonds(pos, finder, &this->neighbourIndices[t], false,
+			this->batchHydroBonds.data() + static_cast<size_t>(f) * atomCount);
 	}
-	unsigned int *hydrogenBondStatisticsPtr = &this->hydrogenBondStatistics[0];
 
-	unsigned int solventAtoms = 0;
-	unsigned int polymerAtoms = 0;
+	// every frame is compared to its predecessor to find the bonds formed
+#pragma omp parallel for schedule(static) num_threads(this->maxOMPThreads)
+	for (int f = 0; f < frameCount; f++) {
+		const int t = omp_get_thread_num();
+		const int *prev = (f == 0) ? this->lastHydroBonds.data()
+			: this->batchHydroBonds.data() + static_cast<size_t>(f - 1) * atomCount;
+		this->accumulateStatistics(this->batchHydroBonds.data() + static_cast<size_t>(f) * atomCount, prev,
+			solvResCount, this->partialOccupancy[t].data(), this->partialStarts[t].data());
+	}
 
-	for(unsigned int frameId = 0; frameId < dataSource->FrameCount(); frameId++) {
-		dataSource->SetFrameID(frameId);
-		dataTarget->SetFrameID(frameId);
-		if (!(*dataSource)(MolecularDataCall::CallForGetData))
-			return false;
-		if (!this->getHBonds(dataTarget, dataSource))
-			return false;
-		int atomCnt = dataTarget->AtomCount();
-		const int *hydrogenBonds = dataTarget->AtomHydrogenBondIndices();
-		const int *residueIndices = dataTarget->AtomResidueIndices();
-/*#pragma omp parallel for
-		for(int atomIdx = 0; atomIdx < atomCnt; atomIdx++) {
-			int residueIdx = residueIndices[atomIdx];
-			if (dataTarget->IsSolvent(dataTarget->Residues()[residueIdx]))
-				continue;
-		}*/
+	std::copy(this->batchHydroBonds.begin() + static_cast<size_t>(frameCount - 1) * atomCount,
+		this->batchHydroBonds.begin() + static_cast<size_t>(frameCount) * atomCount, this->lastHydroBonds.begin());
+}
 
-//#pragma omp parallel for
-		for(unsigned int rIdx = 0; rIdx < dataSource->ResidueCount(); rIdx++ ) {
-			const MolecularDataCall::Residue *residue = dataSource->Residues()[rIdx];
 
-			//if (dataSource->IsSolvent(residue)) continue;
-			bool isSolvent = dataSource->IsSolvent(residue);
+bool megamol::protein::SolventHydroBondGenerator::calcHydrogenBondStatistics(MolecularDataCall *dataSource) {
+	using vislib::sys::Log;
 
-			if (frameId==0) {
-				if (isSolvent)
-					solventAtoms += residue->AtomCount();
-				else
-					polymerAtoms += residue->AtomCount();
-			}
+	const unsigned int frameCount = dataSource->FrameCount();
+	if (frameCount == 0)
+		return false;
+	dataSource->SetFrameID(0, true);
+	if (!(*dataSource)(MolecularDataCall::CallForGetData))
+		return false;
+	this->prepareTopology(dataSource);
+	const unsigned int atomCount = this->topologyAtomCount;
+	const unsigned int solvResCount = dataSource->AtomSolventResidueCount();
+	const SIZE_T dataHash = dataSource->DataHash();
+	dataSource->Unlock();
+
+	const size_t statCount = static_cast<size_t>(solvResCount) * atomCount;
+	this->hydrogenBondStatistics.SetCount(statCount);
+	if (statCount > 0)
+		memset(&this->hydrogenBondStatistics[0], 0, statCount*sizeof(unsigned int));
+	this->hydrogenBondStarts.assign(statCount, 0);
+
+	// the statistics are only valid for the same data and parameters
+	const std::string statPath(T2A(this->statisticsFile.Param<param::FilePathParam>()->Value()));
+	std::ostringstream key;
+	key << atomCount << '|' << frameCount << '|' << solvResCount << '|' << dataHash
+		<< '|' << hBondDonorAcceptorDistance.Param<param::FloatParam>()->Value()
+		<< '|' << hBondDonorAcceptorAngle.Param<param::FloatParam>()->Value();
+	if (!statPath.empty() && this->loadStatistics(statPath, key.str())) {
+		Log::DefaultLog.WriteInfo("%s: Loaded hydrogen bond statistics from \"%s\"", this->ClassName(), statPath.c_str());
+		return true;
+	}
 
-			// vorerst nur Sauerstoff und Stickstoff als Akzeptor/Donator (N, O)
-			int lastAtomIdx = residue->FirstAtomIndex()+residue->AtomCount();
-			for(int atomIndex = residue->FirstAtomIndex(); atomIndex < lastAtomIdx; atomIndex++) {
-				if (hydrogenBonds[atomIndex] == -1)
-					continue;
-				int otherAtomIndex = hydrogenBonds[atomIndex];
-				int otherResidueIdx = residueIndices[otherAtomIndex];
-				const MolecularDataCall::Residue *otherResidue = dataSource->Residues()[otherResidueIdx];
-				bool isOtherSolvent = dataTarget->IsSolvent(otherResidue);
-#if 1
-
-				if(isSolvent != isOtherSolvent) {
-					// polymer/solvent HBond ...
-					if (!isSolvent) {
-						for(int srIdx = 0;srIdx < solvResCount; srIdx++) {
-							if (solventResidueIndices[srIdx]==otherResidue->Type())
-								hydrogenBondStatisticsPtr[solvResCount*atomIndex + srIdx]++;
-						}
-						//hydrogenBondStatisticsPtr[solvResCount*atomIndex + (rIdx%this->solvResCount)]++;
-					} else /*if (!isOtherSolvent)*/ {
-						for(int srIdx = 0;srIdx < solvResCount; srIdx++) {
-							if (solventResidueIndices[srIdx]==residue->Type())
-								hydrogenBondStatisticsPtr[solvResCount*otherAtomIndex + srIdx]++;
-						}
-						//hydrogenBondStatisticsPtr[solvResCount*otherAtomIndex + (otherResidueIdx%this->solvResCount)]++;
-					}
-				} else {
-					// both atoms solvent or both polymer?
-				}
-#else
-				if (!isSolvent)
-					hydrogenBondStatisticsPtr[atomIndex]++;
-				if (!isOtherSolvent)
-					hydrogenBondStatisticsPtr[otherAtomIndex]++;
-#endif
-			}
+	vislib::sys::PerformanceCounter timer(true);
+	const unsigned int batchSize = vislib::math::Max(8, 2 * this->maxOMPThreads);
+	this->statNeighbourFinderReady.assign(this->maxOMPThreads, 0);
+	this->partialOccupancy.resize(this->maxOMPThreads);
+	this->partialStarts.resize(this->maxOMPThreads);
+	for (int t = 0; t < this->maxOMPThreads; t++) {
+		this->partialOccupancy[t].assign(statCount, 0);
+		this->partialStarts[t].assign(statCount, 0);
+	}
+	this->batchHydroBonds.resize(static_cast<size_t>(batchSize) * atomCount);
+	this->lastHydroBonds.assign(atomCount, -1);
+
+	// The threads compute one batch while the next one is being loaded. The
+	// call is only ever used by this thread.
+	std::vector<float> positions[2];
+	std::vector<vislib::math::Cuboid<float> > bboxes[2];
+	unsigned int first = 0;
+	unsigned int count = vislib::math::Min(batchSize, frameCount);
+	bool ok = this->loadStatisticsBatch(dataSource, first, count, positions[0], bboxes[0]);
+	int cur = 0;
+	while (ok && (count > 0)) {
+		const unsigned int nextFirst = first + count;
+		const unsigned int nextCount = vislib::math::Min(batchSize, frameCount - nextFirst);
+		std::thread worker(&SolventHydroBondGenerator::processStatisticsBatch, this, &positions[cur], &bboxes[cur],
+			count, solvResCount);
+		if (nextCount > 0) {
+			ok = this->loadStatisticsBatch(dataSource, nextFirst, nextCount, positions[1 - cur], bboxes[1 - cur]);
 		}
+		worker.join();
+
+		first = nextFirst;
+		count = nextCount;
+		cur = 1 - cur;
 	}
 
-	/*dataSource*/dataTarget->SetAtomHydrogenBondStatistics(hydrogenBondStatisticsPtr/*, this->solvResCount*/);
-	dataSource->SetFrameID(savedSrcFrameId);
-	dataTarget->SetFrameID(savedTargetFrameId);
+	// merge the per-thread statistics
+	const int statCnt = static_cast<int>(statCount);
+	unsigned int *hydrogenBondStatisticsPtr = (statCount > 0) ? &this->hydrogenBondStatistics[0] : NULL;
+#pragma omp parallel for
+	for (int i = 0; i < statCnt; i++) {
+		for (int t = 0; t < this->maxOMPThreads; t++) {
+			hydrogenBondStatisticsPtr[i] += this->partialOccupancy[t][i];
+			this->hydrogenBondStarts[i] += this->partialStarts[t][i];
+		}
+	}
+	this->partialOccupancy.clear();
+	this->partialStarts.clear();
+	std::vector<int>().swap(this->batchHydroBonds);
+	std::vector<int>().swap(this->lastHydroBonds);
+	for (int t = 0; t < this->maxOMPThreads; t++)
+		this->statNeighbourFinderReady[t] = 0;
+
+	if (!ok) {
+		this->hydrogenBondStatistics.Clear();
+		this->hydrogenBondStarts.clear();
+		return false;
+	}
 
-	std::cout << "solvent atoms: " << solventAtoms << " polymer atoms: " << polymerAtoms << std::endl;
+	double occupancy = 0.0, starts = 0.0;
+	for (size_t i = 0; i < statCount; i++) {
+		occupancy += hydrogenBondStatisticsPtr[i];
+		starts += this->hydrogenBondStarts[i];
+	}
+	Log::DefaultLog.WriteInfo("%s: Hydrogen bond statistics of %u frames computed in %.1f ms, mean bond lifetime %.2f frames",
+		this->ClassName(), frameCount, timer.ToMillis(timer.Difference()), (starts > 0.0) ? (occupancy / starts) : 0.0);
 
+	if (!statPath.empty() && !this->saveStatistics(statPath, key.str())) {
+		Log::DefaultLog.WriteWarn("%s: Unable to write hydrogen bond statistics \"%s\"", this->ClassName(), statPath.c_str());
+	}
 	return true;
 }
-#endif
+
+
+bool megamol::protein::SolventHydroBondGenerator::loadStatistics(const std::string& path, const std::string& key) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+
+	char magic[8];
+	UINT64 keyLen = 0, statCount = 0;
+	in.read(magic, 8);
+	in.read(reinterpret_cast<char*>(&keyLen), sizeof(keyLen));
+	if (!in || (memcmp(magic, "MMHBST1", 8) != 0) || (keyLen != key.size()))
+		return false;
+	std::string fileKey(static_cast<size_t>(keyLen), '\0');
+	in.read(&fileKey[0], keyLen);
+	in.read(reinterpret_cast<char*>(&statCount), sizeof(statCount));
+	if (!in || (fileKey != key) || (statCount != this->hydrogenBondStarts.size()))
+		return false;
+
+	if (statCount > 0) {
+		in.read(reinterpret_cast<char*>(&this->hydrogenBondStatistics[0]), statCount * sizeof(unsigned int));
+		in.read(reinterpret_cast<char*>(this->hydrogenBondStarts.data()), statCount * sizeof(unsigned int));
+	}
+	return static_cast<bool>(in);
+}
+
+
+bool megamol::protein::SolventHydroBondGenerator::saveStatistics(const std::string& path, const std::string& key) const {
+	// write a new file first, so an interruption does not leave broken statistics behind
+	const std::string tmpPath = path + ".tmp";
+	{
+		std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+		const UINT64 keyLen = key.size();
+		const UINT64 statCount = this->hydrogenBondStarts.size();
+		out.write("MMHBST1", 8);
+		out.write(reinterpret_cast<const char*>(&keyLen), sizeof(keyLen));
+		out.write(key.data(), key.size());
+		out.write(reinterpret_cast<const char*>(&statCount), sizeof(statCount));
+		out.write(reinterpret_cast<const char*>(this->hydrogenBondStatistics.PeekElements()), statCount * sizeof(unsigned int));
+		out.write(reinterpret_cast<const char*>(this->hydrogenBondStarts.data()), statCount * sizeof(unsigned int));
+		if (!out)
+			return false;
+	}
+	std::remove(path.c_str());
+	return (std::rename(tmpPath.c_str(), path.c_str()) == 0);
+}
 
 bool megamol::protein::SolventHydroBondGenerator::getHBonds(MolecularDataCall *dataTarget, MolecularDataCall *dataSource) {
 	int reqFrame = dataTarget->FrameID();
@@ -637,19 +755,46 @@ bool megamol::protein::SolventHydroBondGenerator::getData(core::Call& call) {
 	if (!molDest || !molSource)
 		return false;
 
-	molSource->SetFrameID( molDest->FrameID() ); // forward frame request
+	const unsigned int reqFrame = molDest->FrameID();
+	molSource->SetFrameID( reqFrame ); // forward frame request
 	if( !(*molSource)(MolecularDataCall::CallForGetData))
 		return false;
 
-	*molDest = *molSource;
+	// reset all hbond data if this parameter changes ...
+	bool hBondParamsChanged = false;
+	if (this->hBondDistance.IsDirty() || this->hBondDonorAcceptorDistance.IsDirty() || this->hBondDonorAcceptorAngle.IsDirty()) {
+		this->hBondDistance.ResetDirty();
+		this->hBondDonorAcceptorDistance.ResetDirty();
+		this->hBondDonorAcceptorAngle.ResetDirty();
+		for(int i = 0; i < HYDROGEN_BOND_IN_CORE; i++)
+			this->curHBondFrame[i] = -1;
+		this->hydrogenBondStatisticsValid = false;
+		this->middleAtomPos.Clear();
+		hBondParamsChanged = true;
+	}
+	if (this->statisticsFile.IsDirty()) {
+		this->statisticsFile.ResetDirty();
+		this->hydrogenBondStatisticsValid = false;
+	}
 
 	// testing?
-	if (!this->hydrogenBondStatistics.Count()) {
-		this->calcHydrogenBondStatistics(molDest, molSource);
-	} else {
-		molDest->SetAtomHydrogenBondStatistics(this->hydrogenBondStatistics.PeekElements());
+	if (!this->hydrogenBondStatisticsValid) {
+		// do not retry on failure, this would load the whole trajectory for every frame
+		molSource->Unlock();
+		this->calcHydrogenBondStatistics(molSource);
+		this->hydrogenBondStatisticsValid = true;
+		// the statistics have loaded all other frames ...
+		molSource->SetFrameID( reqFrame );
+		if( !(*molSource)(MolecularDataCall::CallForGetData))
+			return false;
 	}
 
+	*molDest = *molSource;
+	if (this->hydrogenBondStatistics.Count())
+		molDest->SetAtomHydrogenBondStatistics(this->hydrogenBondStatistics.PeekElements());
+	if (hBondParamsChanged)
+		molDest->SetDataHash(molSource->DataHash()*666); // hacky ?
+
 	if (this->showMiddlePositions.Param<param::BoolParam>()->Value()) {
 		if (!middleAtomPos.Count()) {
 			calcSpatialProbabilities(molSource, molDest);
@@ -664,17 +809,6 @@ bool megamol::protein::SolventHydroBondGenerator::getData(core::Call& call) {
 		molDest->SetAtomHydrogenBondIndices(middleAtomPosHBonds.PeekElements());
 		molDest->SetDataHash(molSource->DataHash()*666);
 	} else {
-
-		// reset all hbond data if this parameter changes ...
-		if (this->hBondDistance.IsDirty() || this->hBondDonorAcceptorDistance.IsDirty() || this->hBondDonorAcceptorAngle.IsDirty()) {
-			this->hBondDistance.ResetDirty();
-			this->hBondDonorAcceptorDistance.ResetDirty();
-			this->hBondDonorAcceptorAngle.ResetDirty();
-			for(int i = 0; i < HYDROGEN_BOND_IN_CORE; i++)
-				this->curHBondFrame[i] = -1;
-			molDest->SetDataHash(molSource->DataHash()*666); // hacky ?
-		}
-
 		getHBonds(molDest, molSource);
 	}
 
@@ -22,6 +22,8 @@
 #include "Stride.h"
 #include "mmcore/view/AnimDataModule.h"
 #include <fstream>
+#include <string>
+#include <vector>
 
 namespace megamol {
 namespace protein {
@@ -112,8 +114,59 @@ namespace protein {
 
 		/**
 		 * create hydrogen-bond statistics for the polymer atoms ...
+		 *
+		 * The frames are loaded in batches. While the next batch is loaded, the hydrogen bonds of the frames of the
+		 * current batch are computed in parallel, one frame per thread, and counted in per-thread statistics.
+		 * Besides the number of frames a bond exists (occupancy), the number of bonds formed is counted, which
+		 * yields the mean lifetime of the bonds.
 		 */
-		bool calcHydrogenBondStatistics(megamol::protein_calls::MolecularDataCall *dataTarget, megamol::protein_calls::MolecularDataCall *dataSource);
+		bool calcHydrogenBondStatistics(megamol::protein_calls::MolecularDataCall *dataSource);
+
+		/**
+		 * Collects the topology needed for finding the hydrogen bonds (hydrogens of the donors, donor/acceptor
+		 * atoms, polymer residues) unless it is already known for the atom count and the data hash of 'data'.
+		 */
+		void prepareTopology(megamol::protein_calls::MolecularDataCall *data);
+
+		/**
+		 * Finds the hydrogen bonds for the given positions. 'finder' must contain the donors and acceptors at
+		 * these positions and 'prepareTopology' must have been called.
+		 *
+		 * @param parallel Flag whether the residues are processed in parallel, in which case 'neighbours'
+		 *                 must provide one array per thread.
+		 */
+		void computeHydroBonds(const float *atomPositions, const GridNeighbourFinder<float>& finder,
+			vislib::Array<unsigned int> *neighbours, bool parallel, int *atomHydroBondsIndicesPtr) const;
+
+		/**
+		 * Adds the polymer/solvent hydrogen bonds of one frame to the occupancy and counts the bonds which did not
+		 * exist in the previous frame in 'starts'.
+		 */
+		void accumulateStatistics(const int *hydrogenBonds, const int *prevHydrogenBonds, unsigned int solvResCount,
+			unsigned int *occupancy, unsigned int *starts) const;
+
+		/**
+		 * Loads the positions and bounding boxes of 'count' frames starting at 'first'.
+		 */
+		bool loadStatisticsBatch(megamol::protein_calls::MolecularDataCall *dataSource, unsigned int first,
+			unsigned int count, std::vector<float>& positions, std::vector<vislib::math::Cuboid<float> >& bboxes);
+
+		/**
+		 * Computes the hydrogen bonds of a batch of frames and counts them in the per-thread statistics. This is
+		 * the work of the background thread in 'calcHydrogenBondStatistics'.
+		 */
+		void processStatisticsBatch(const std::vector<float> *positions,
+			const std::vector<vislib::math::Cuboid<float> > *bboxes, unsigned int count, unsigned int solvResCount);
+
+		/**
+		 * Loads the statistics from 'path' if they have been computed for 'key'.
+		 */
+		bool loadStatistics(const std::string& path, const std::string& key);
+
+		/**
+		 * Writes the statistics to 'path'.
+		 */
+		bool saveStatistics(const std::string& path, const std::string& key) const;
 
 		/**
          * Implementation of 'Release'.
@@ -171,6 +224,8 @@ namespace protein {
 		megamol::core::param::ParamSlot hBondDonorAcceptorAngle;
 		//megamol::core::param::ParamSlot hBondDataFile;
 		megamol::core::param::ParamSlot showMiddlePositions;
+		/** file the hydrogen bond statistics are stored in, so they are computed only once */
+		megamol::core::param::ParamSlot statisticsFile;
 
 		/** temporary variable to store a set of atom positions */
 		vislib::Array<float> middleAtomPos;
@@ -178,6 +233,12 @@ namespace protein {
 
 		/** our grid based neighbour finder ... */
 		GridNeighbourFinder<float> neighbourFinder;
+		/** the search distance 'neighbourFinder' has been set up for, or negative if it has to be set up */
+		float neighbourFinderDistance;
+
+		/** one neighbour finder per thread for the statistics, and whether it has been set up already */
+		GridNeighbourFinder<float> *statNeighbourFinders;
+		std::vector<char> statNeighbourFinderReady;
 
 		/** temporary variable to store the neighbour indices for the hydrogen-bound search ...*/
 		vislib::Array<unsigned int> *neighbourIndices;
@@ -186,13 +247,33 @@ namespace protein {
 		vislib::Array<int> hydrogenConnections;
 		vislib::Array<int> donorAcceptors;
 		vislib::Array<unsigned int> hydrogenBondStatistics;
+		/** whether 'hydrogenBondStatistics' is up to date (it stays empty without solvent residue types) */
+		bool hydrogenBondStatisticsValid;
+		/** number of hydrogen bonds formed, with the same layout as 'hydrogenBondStatistics' */
+		std::vector<unsigned int> hydrogenBondStarts;
+
+		/** per-thread parts of 'hydrogenBondStatistics' and 'hydrogenBondStarts' */
+		std::vector<std::vector<unsigned int> > partialOccupancy;
+		std::vector<std::vector<unsigned int> > partialStarts;
+
+		/** the hydrogen bonds of the current statistics batch, and of the last frame of the previous one */
+		std::vector<int> batchHydroBonds;
+		std::vector<int> lastHydroBonds;
+
+		/** the atom count and the data hash the topology has been collected for */
+		unsigned int topologyAtomCount;
+		SIZE_T topologyDataHash;
+		/** copy of the residue index of each atom */
+		std::vector<int> atomResidueIdx;
+		/** residue index, first atom and atom count of each polymer residue */
+		std::vector<unsigned int> polymerResidues;
+		/** index of the solvent residue type of the residue of each atom, NOT_SOLVENT or UNKNOWN_SOLVENT */
+		std::vector<int> atomSolventSlot;
+		enum { NOT_SOLVENT = -2, UNKNOWN_SOLVENT = -1 };
 		enum { MAX_HYDROGENS_PER_ATOM = 4 };
 		//enum { DONOR_ACCEPTOR_TYPE_COUNT = 2 /* only 'O' and 'N' can be donor/acceptor*/};
 		int maxOMPThreads;
 
-		/** array to check atoms already connected ... */
-		vislib::Array<int> reverseConnection;
-
 		/* store 2 hydrogen bounds in core so interpolating between two frames can be done without file-access */
 		enum { HYDROGEN_BOND_IN_CORE = 3/*20*//*2*/ };
 
@@ -23,7 +23,7 @@ Stride::Stride( MolecularDataCall *mol) :
     HydroBondCnt = 0;
 
     ProteinChain = ( CHAIN  **)ckalloc( MAX_CHAIN*sizeof( CHAIN*));
-    HydroBond    = ( HBOND  **)ckalloc( MAXHYDRBOND*sizeof( HBOND*));
+    HydroBond    = NULL;
     StrideCmd    = ( COMMAND *)ckalloc( sizeof( COMMAND));
 
     // set default values for command variable
@@ -48,10 +48,7 @@ Stride::~Stride(void)
         FreeChain( ProteinChain[i] );
     free(ProteinChain);
 
-    for( i = 0; i < HydroBondCnt; ++i )
-        FreeHBond(HydroBond[i]);
-
-    free( HydroBond );
+    // the hydrogen bonds are owned by HydroBondStore
 
     free( StrideCmd );
 }
@@ -92,12 +89,6 @@ void Stride::FreeResidue(RESIDUE *r) {
     free(r);
 }
 
-void Stride::FreeHBond(HBOND *h) {
-//	free( h->Dnr); // TODO: free FreeChain(Dnr->Chain)?
-//	free( h->Acc); // TODO: free FreeChain(Dnr->Chain)?
-    free( h );
-}
-
 void Stride::GetChains(MolecularDataCall *mol) {
     int ChainCnt;
     int cntCha, cntRes, cntAtm, idx, cnt, chain;
@@ -213,7 +204,9 @@ bool Stride::ComputeSecondaryStructure() {
     for ( Cn = 0; Cn < ProteinChainCnt; ++Cn )
         PlaceHydrogens( ProteinChain[Cn] );
 
-    if( ( HydroBondCnt = FindHydrogenBonds( ProteinChain, Cn, HydroBond, StrideCmd) ) == 0 )
+    HydroBondCnt = FindHydrogenBonds( ProteinChain, Cn, StrideCmd);
+    HydroBond = HydroBondPtrs.data();
+    if( HydroBondCnt == 0 )
     {
         //die( "No hydrogen bonds found in %s\n", StrideCmd->InputFile );
         printf( "No hydrogen bonds found.\n" );
@@ -669,261 +662,342 @@ int Stride::PlaceHydrogens( CHAIN *Chain ) {
     return ( PlacedCnt );
 }
 
-int Stride::FindHydrogenBonds( CHAIN **Chain, int NChain, HBOND **HBond, COMMAND *Cmd ) {
-    DONOR **Dnr;
-    ACCEPTOR **Acc;
-    int NDnr=0, NAcc=0;
+int Stride::FindHydrogenBonds( CHAIN **Chain, int NChain, COMMAND *Cmd ) {
+    std::vector<DONOR *> Dnr;
+    std::vector<ACCEPTOR *> Acc;
+    int NDnr=0, NAcc=0, NRes=0;
     int dc, ac, ccd, cca, cc, hc=0, i;
 
-    Dnr = ( DONOR ** ) ckalloc ( MAXDONOR*sizeof ( DONOR * ) );
-    Acc = ( ACCEPTOR ** ) ckalloc ( MAXACCEPTOR*sizeof ( ACCEPTOR * ) );
+    /* at most four donors (ARG) and three acceptors (HIS) per residue */
+    for ( cc=0; cc<NChain; cc++ )
+        NRes += Chain[cc]->NRes;
+    Dnr.resize( std::max( MAXDONOR, 4*NRes ) );
+    Acc.resize( std::max( MAXACCEPTOR, 3*NRes ) );
 
     for ( cc=0; cc<NChain; cc++ )
     {
-        FindDnr ( Chain[cc],Dnr,&NDnr,Cmd );
-        FindAcc ( Chain[cc],Acc,&NAcc,Cmd );
+        FindDnr ( Chain[cc],Dnr.data(),&NDnr,Cmd );
+        FindAcc ( Chain[cc],Acc.data(),&NAcc,Cmd );
     }
 
-    BOOLEAN *BondedDonor, *BondedAcceptor;
-    BondedDonor    = ( BOOLEAN * ) ckalloc ( NDnr*sizeof ( BOOLEAN ) );
-    BondedAcceptor = ( BOOLEAN * ) ckalloc ( NAcc*sizeof ( BOOLEAN ) );
+    std::vector<BOOLEAN> BondedDonor( NDnr, STRIDE_NO ), BondedAcceptor( NAcc, STRIDE_NO );
 
-    for ( i=0; i<NDnr; i++ )
-        BondedDonor[i] = STRIDE_NO;
-    for ( i=0; i<NAcc; i++ )
-        BondedAcceptor[i] = STRIDE_NO;
+    /* Sort the acceptors into a uniform grid with the distance cut off as cell size, so each donor only has to
+       look at the acceptors in its 27 neighbouring cells instead of at all acceptors */
+    float GridMin[3] = { 0.0f, 0.0f, 0.0f }, GridMax[3] = { 0.0f, 0.0f, 0.0f };
+    const float CellSize = std::max( Cmd->DistCutOff, 1.0f );
+    for ( ac=0; ac<NAcc; ac++ )
+    {
+        float *Coord = Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At];
+        for ( i=0; i<3; i++ )
+        {
+            if ( ac == 0 || Coord[i] < GridMin[i] ) GridMin[i] = Coord[i];
+            if ( ac == 0 || Coord[i] > GridMax[i] ) GridMax[i] = Coord[i];
+        }
+    }
+    int GridDim[3];
+    for ( i=0; i<3; i++ )
+        GridDim[i] = std::max( 1, (int)( ( GridMax[i] - GridMin[i] ) / CellSize ) + 1 );
+    auto CellCoord = [&]( const float *Coord, int Axis ) {
+        return std::min( GridDim[Axis]-1, std::max( 0, (int)( ( Coord[Axis] - GridMin[Axis] ) / CellSize ) ) );
+    };
+    std::vector<int> CellStart( (size_t)GridDim[0]*GridDim[1]*GridDim[2] + 1, 0 );
+    std::vector<int> CellAcc( NAcc );
+    std::vector<size_t> AccCell( NAcc );
+    for ( ac=0; ac<NAcc; ac++ )
+    {
+        float *Coord = Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At];
+        AccCell[ac] = ( (size_t)CellCoord( Coord, 2 )*GridDim[1] + CellCoord( Coord, 1 ) )*GridDim[0] +
+                      CellCoord( Coord, 0 );
+        CellStart[AccCell[ac]+1]++;
+    }
+    for ( size_t c=1; c<CellStart.size(); c++ )
+        CellStart[c] += CellStart[c-1];
+    {
+        std::vector<int> Fill( CellStart.begin(), CellStart.end()-1 );
+        /* acceptors stay sorted by index within each cell */
+        for ( ac=0; ac<NAcc; ac++ )
+            CellAcc[Fill[AccCell[ac]]++] = ac;
+    }
 
+    /* Evaluate all donor/acceptor pairs within the cut off. Donors are independent, so this runs in parallel;
+       the found bonds are kept per donor in ascending acceptor order to reproduce the serial bond numbering. */
+    std::vector<std::vector<std::pair<int, HBOND>>> DnrBonds( NDnr );
+#pragma omp parallel for schedule( dynamic, 16 )
     for ( dc=0; dc<NDnr; dc++ )
     {
-
         if ( Dnr[dc]->Group != Peptide && !Cmd->SideChainHBond ) continue;
 
-        for ( ac=0; ac<NAcc; ac++ )
-        {
+        float *DCoord = Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->D_At];
+        int Cell[3];
+        for ( int d=0; d<3; d++ )
+            Cell[d] = CellCoord( DCoord, d );
 
-            if ( abs ( Acc[ac]->A_Res - Dnr[dc]->D_Res ) < 2 && Acc[ac]->Chain->Id == Dnr[dc]->Chain->Id )
+        std::vector<int> Candidates;
+        for ( int z=std::max( 0, Cell[2]-1 ); z<=std::min( GridDim[2]-1, Cell[2]+1 ); z++ )
+            for ( int y=std::max( 0, Cell[1]-1 ); y<=std::min( GridDim[1]-1, Cell[1]+1 ); y++ )
+                for ( int x=std::max( 0, Cell[0]-1 ); x<=std::min( GridDim[0]-1, Cell[0]+1 ); x++ )
+                {
+                    size_t c = ( (size_t)z*GridDim[1] + y )*GridDim[0] + x;
+                    for ( int k=CellStart[c]; k<CellStart[c+1]; k++ )
+                        Candidates.push_back( CellAcc[k] );
+                }
+        std::sort( Candidates.begin(), Candidates.end() );
+
+        for ( int a : Candidates )
+        {
+            if ( abs ( Acc[a]->A_Res - Dnr[dc]->D_Res ) < 2 && Acc[a]->Chain->Id == Dnr[dc]->Chain->Id )
                 continue;
 
-            if ( Acc[ac]->Group != Peptide && !Cmd->SideChainHBond ) continue;
+            if ( Acc[a]->Group != Peptide && !Cmd->SideChainHBond ) continue;
 
-            if ( hc == MAXHYDRBOND )
-                die ( "Number of hydrogen bonds exceeds current limit of %d in %s\n",
-                      MAXHYDRBOND,Chain[0]->File );
-            HBond[hc] = ( HBOND * ) ckalloc ( sizeof ( HBOND ) );
+            HBOND Bond;
+            memset( &Bond, 0, sizeof( HBOND ) );
+            if ( EvaluateHBond( Dnr[dc], Acc[a], Cmd, &Bond ) )
+                DnrBonds[dc].emplace_back( a, Bond );
+        }
+    }
 
-            HBond[hc]->ExistHydrBondRose = STRIDE_NO;
-            HBond[hc]->ExistHydrBondBaker = STRIDE_NO;
-            HBond[hc]->ExistPolarInter = STRIDE_NO;
+    int NBonds = 0;
+    for ( dc=0; dc<NDnr; dc++ )
+        NBonds += (int)DnrBonds[dc].size();
+    /* all bond records live in one contiguous block, there is no upper limit on their number anymore */
+    HydroBondStore.resize( NBonds );
+    HydroBondPtrs.resize( NBonds );
+    HBOND **HBond = HydroBondPtrs.data();
 
-            if ( ( HBond[hc]->AccDonDist =
-                        Dist ( Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->D_At],
-                               Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At] ) ) <=
-                    Cmd->DistCutOff )
+    for ( dc=0; dc<NDnr; dc++ )
+    {
+        for ( auto &Found : DnrBonds[dc] )
+        {
+            ac = Found.first;
+            HydroBondStore[hc] = Found.second;
+            HBond[hc] = &HydroBondStore[hc];
+
+            HBond[hc]->Dnr = Dnr[dc];
+            HBond[hc]->Acc = Acc[ac];
+            BondedDonor[dc] = STRIDE_YES;
+            BondedAcceptor[ac] = STRIDE_YES;
+            if ( ( ccd = FindChain ( Chain,NChain,Dnr[dc]->Chain->Id ) ) != ERR )
             {
-
-
-                if ( Cmd->MainChainPolarInt && Dnr[dc]->Group == Peptide &&
-                        Acc[ac]->Group == Peptide && Dnr[dc]->H != ERR )
+                if ( Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->NBondDnr < MAXRESDNR )
+                    Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->
+                    HBondDnr[Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->NBondDnr++] = hc;
+                else
+                    printf ( "Residue %s %s of chain %i is involved in more than %d hydrogen bonds (%d)\n",
+                             Chain[ccd]->Rsd[Dnr[dc]->D_Res]->ResType,
+                             Chain[ccd]->Rsd[Dnr[dc]->D_Res]->PDB_ResNumb,
+                             Chain[ccd]->ChainId,
+                             MAXRESDNR,Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->NBondDnr );
+            }
+            if ( ( cca  = FindChain ( Chain,NChain,Acc[ac]->Chain->Id ) ) != ERR )
+            {
+                if ( Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->NBondAcc < MAXRESACC )
+                    Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->
+                    HBondAcc[Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->NBondAcc++] = hc;
+                else
+                    printf ( "Residue %s %s of chain %i is involved in more than %d hydrogen bonds (%d)\n",
+                             Chain[cca]->Rsd[Acc[ac]->A_Res]->ResType,
+                             Chain[cca]->Rsd[Acc[ac]->A_Res]->PDB_ResNumb,
+                             Chain[cca]->ChainId,
+                             MAXRESDNR,Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->NBondAcc );
+            }
+            if ( ccd != cca && ccd != ERR )
+            {
+                Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->InterchainHBonds = STRIDE_YES;
+                Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->InterchainHBonds = STRIDE_YES;
+                if ( HBond[hc]->ExistHydrBondRose )
                 {
-                    GRID_Energy ( Acc[ac]->Chain->Rsd[Acc[ac]->AA2_Res]->Coord[Acc[ac]->AA2_At],
-                                  Acc[ac]->Chain->Rsd[Acc[ac]->AA_Res]->Coord[Acc[ac]->AA_At],
-                                  Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At],
-                                  Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->H],
-                                  Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->D_At],
-                                  Cmd,HBond[hc] );
-
-                    if ( HBond[hc]->Energy < -10.0 &&
-                            ( ( Cmd->EnergyType == 'G' && fabs ( HBond[hc]->Et ) > Eps &&
-                                fabs ( HBond[hc]->Ep ) > Eps ) || Cmd->EnergyType != 'G' ) )
-                        HBond[hc]->ExistPolarInter = STRIDE_YES;
+                    Chain[0]->NHydrBondInterchain++;
+                    Chain[0]->NHydrBondTotal++;
                 }
-
-                if ( Cmd->MainChainHBond &&
-                        ( HBond[hc]->OHDist =
-                              Dist ( Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->H],
-                                     Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At] ) ) <= 2.5 &&
-                        ( HBond[hc]->AngNHO =
-                              Ang ( Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->D_At],
-                                    Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->H],
-                                    Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At] ) ) >= 90.0 &&
-                        HBond[hc]->AngNHO <= 180.0 &&
-                        ( HBond[hc]->AngCOH =
-                              Ang ( Acc[ac]->Chain->Rsd[Acc[ac]->AA_Res]->Coord[Acc[ac]->AA_At],
-                                    Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At],
-                                    Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->H] ) ) >= 90.0 &&
-
-                        HBond[hc]->AngCOH <= 180.0 )
-                    HBond[hc]->ExistHydrBondBaker = STRIDE_YES;
-
-                if ( Cmd->MainChainHBond &&
-                        HBond[hc]->AccDonDist <= Dnr[dc]->HB_Radius+Acc[ac]->HB_Radius )
+            }
+            else
+                if ( ccd == cca && ccd != ERR && HBond[hc]->ExistHydrBondRose )
                 {
+                    Chain[ccd]->NHydrBond++;
+                    Chain[0]->NHydrBondTotal++;
+                }
+            hc++;
+        }
+    }
+    
+    for ( i=0; i<NDnr; i++ )
+        if ( !BondedDonor[i] )
+            free ( Dnr[i] );
+    for ( i=0; i<NAcc; i++ )
+        if ( !BondedAcceptor[i] )
+            free ( Acc[i] );
 
-                    HBond[hc]->AccAng =
-                        Ang ( Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->D_At],
-                              Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At],
-                              Acc[ac]->Chain->Rsd[Acc[ac]->AA_Res]->Coord[Acc[ac]->AA_At] );
-
-                    if ( ( ( Acc[ac]->Hybrid == Nsp2 || Acc[ac]->Hybrid == Osp2 ) &&
-                            ( HBond[hc]->AccAng >= MINACCANG_SP2 &&
-                              HBond[hc]->AccAng <= MAXACCANG_SP2 ) ) ||
-                            ( ( Acc[ac]->Hybrid == Ssp3 ||  Acc[ac]->Hybrid == Osp3 ) &&
-                              ( HBond[hc]->AccAng >= MINACCANG_SP3 &&
-                                HBond[hc]->AccAng <= MAXACCANG_SP3 ) ) )
-                    {
+    return ( hc );
+}
 
-                        HBond[hc]->DonAng =
-                            Ang ( Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At],
-                                  Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->D_At],
-                                  Dnr[dc]->Chain->Rsd[Dnr[dc]->DD_Res]->Coord[Dnr[dc]->DD_At] );
-
-                        if ( ( ( Dnr[dc]->Hybrid == Nsp2 || Dnr[dc]->Hybrid == Osp2 ) &&
-                                ( HBond[hc]->DonAng >= MINDONANG_SP2 &&
-                                  HBond[hc]->DonAng <= MAXDONANG_SP2 ) ) ||
-                                ( ( Dnr[dc]->Hybrid == Nsp3 || Dnr[dc]->Hybrid == Osp3 ) &&
-                                  ( HBond[hc]->DonAng >= MINDONANG_SP3 &&
-                                    HBond[hc]->DonAng <= MAXDONANG_SP3 ) ) )
-                        {
+Stride::BOOLEAN Stride::EvaluateHBond( DONOR *Dnr, ACCEPTOR *Acc, COMMAND *Cmd, HBOND *HBond ) {
 
-                            if ( Dnr[dc]->Hybrid == Nsp2 || Dnr[dc]->Hybrid == Osp2 )
-                            {
-                                HBond[hc]->AccDonAng =
-                                    fabs ( Torsion ( Dnr[dc]->Chain->Rsd[Dnr[dc]->DDI_Res]->Coord[Dnr[dc]->DDI_At],
-                                                     Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->D_At],
-                                                     Dnr[dc]->Chain->Rsd[Dnr[dc]->DD_Res]->Coord[Dnr[dc]->DD_At],
-                                                     Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At] ) );
+    HBond->ExistHydrBondRose = STRIDE_NO;
+    HBond->ExistHydrBondBaker = STRIDE_NO;
+    HBond->ExistPolarInter = STRIDE_NO;
 
-                                if ( HBond[hc]->AccDonAng > 90.0f && HBond[hc]->AccDonAng < 270.0f )
-                                    HBond[hc]->AccDonAng = fabs( 180.0f - HBond[hc]->AccDonAng );
+    if ( ( HBond->AccDonDist =
+                Dist ( Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->D_At],
+                       Acc->Chain->Rsd[Acc->A_Res]->Coord[Acc->A_At] ) ) <=
+            Cmd->DistCutOff )
+    {
 
-                            }
 
-                            if ( Acc[ac]->Hybrid == Nsp2 || Acc[ac]->Hybrid == Osp2 )
-                            {
-                                HBond[hc]->DonAccAng =
-                                    fabs ( Torsion ( Dnr[dc]->Chain->Rsd[Dnr[dc]->D_Res]->Coord[Dnr[dc]->D_At],
-                                                     Acc[ac]->Chain->Rsd[Acc[ac]->A_Res]->Coord[Acc[ac]->A_At],
-                                                     Acc[ac]->Chain->Rsd[Acc[ac]->AA_Res]->Coord[Acc[ac]->AA_At],
-                                                     Acc[ac]->Chain->Rsd[Acc[ac]->AA2_Res]->Coord[Acc[ac]->AA2_At] ) );
+        if ( Cmd->MainChainPolarInt && Dnr->Group == Peptide &&
+                Acc->Group == Peptide && Dnr->H != ERR )
+        {
+            GRID_Energy ( Acc->Chain->Rsd[Acc->AA2_Res]->Coord[Acc->AA2_At],
+                          Acc->Chain->Rsd[Acc->AA_Res]->Coord[Acc->AA_At],
+                          Acc->Chain->Rsd[Acc->A_Res]->Coord[Acc->A_At],
+                          Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->H],
+                          Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->D_At],
+                          Cmd,HBond );
+
+            if ( HBond->Energy < -10.0 &&
+                    ( ( Cmd->EnergyType == 'G' && fabs ( HBond->Et ) > Eps &&
+                        fabs ( HBond->Ep ) > Eps ) || Cmd->EnergyType != 'G' ) )
+                HBond->ExistPolarInter = STRIDE_YES;
+        }
+
+        if ( Cmd->MainChainHBond &&
+                ( HBond->OHDist =
+                      Dist ( Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->H],
+                             Acc->Chain->Rsd[Acc->A_Res]->Coord[Acc->A_At] ) ) <= 2.5 &&
+                ( HBond->AngNHO =
+                      Ang ( Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->D_At],
+                            Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->H],
+                            Acc->Chain->Rsd[Acc->A_Res]->Coord[Acc->A_At] ) ) >= 90.0 &&
+                HBond->AngNHO <= 180.0 &&
+                ( HBond->AngCOH =
+                      Ang ( Acc->Chain->Rsd[Acc->AA_Res]->Coord[Acc->AA_At],
+                            Acc->Chain->Rsd[Acc->A_Res]->Coord[Acc->A_At],
+                            Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->H] ) ) >= 90.0 &&
+
+                HBond->AngCOH <= 180.0 )
+            HBond->ExistHydrBondBaker = STRIDE_YES;
+
+        if ( Cmd->MainChainHBond &&
+                HBond->AccDonDist <= Dnr->HB_Radius+Acc->HB_Radius )
+        {
 
-                                if ( HBond[hc]->DonAccAng > 90.0f && HBond[hc]->DonAccAng < 270.0f )
-                                    HBond[hc]->DonAccAng = fabs( 180.0f - HBond[hc]->DonAccAng );
+            HBond->AccAng =
+                Ang ( Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->D_At],
+                      Acc->Chain->Rsd[Acc->A_Res]->Coord[Acc->A_At],
+                      Acc->Chain->Rsd[Acc->AA_Res]->Coord[Acc->AA_At] );
+
+            if ( ( ( Acc->Hybrid == Nsp2 || Acc->Hybrid == Osp2 ) &&
+                    ( HBond->AccAng >= MINACCANG_SP2 &&
+                      HBond->AccAng <= MAXACCANG_SP2 ) ) ||
+                    ( ( Acc->Hybrid == Ssp3 ||  Acc->Hybrid == Osp3 ) &&
+                      ( HBond->AccAng >= MINACCANG_SP3 &&
+                        HBond->AccAng <= MAXACCANG_SP3 ) ) )
+            {
 
-                            }
+                HBond->DonAng =
+                    Ang ( Acc->Chain->Rsd[Acc->A_Res]->Coord[Acc->A_At],
+                          Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->D_At],
+                          Dnr->Chain->Rsd[Dnr->DD_Res]->Coord[Dnr->DD_At] );
+
+                if ( ( ( Dnr->Hybrid == Nsp2 || Dnr->Hybrid == Osp2 ) &&
+                        ( HBond->DonAng >= MINDONANG_SP2 &&
+                          HBond->DonAng <= MAXDONANG_SP2 ) ) ||
+                        ( ( Dnr->Hybrid == Nsp3 || Dnr->Hybrid == Osp3 ) &&
+                          ( HBond->DonAng >= MINDONANG_SP3 &&
+                            HBond->DonAng <= MAXDONANG_SP3 ) ) )
+                {
 
-                            if ( ( Dnr[dc]->Hybrid != Nsp2 && Dnr[dc]->Hybrid != Osp2 &&
-                                    Acc[ac]->Hybrid != Nsp2 && Acc[ac]->Hybrid != Osp2 ) ||
-                                    ( Acc[ac]->Hybrid != Nsp2 && Acc[ac]->Hybrid != Osp2 &&
-                                      ( Dnr[dc]->Hybrid == Nsp2 || Dnr[dc]->Hybrid == Osp2 ) &&
-                                      HBond[hc]->AccDonAng <= ACCDONANG ) ||
-                                    ( Dnr[dc]->Hybrid != Nsp2 && Dnr[dc]->Hybrid != Osp2 &&
-                                      ( Acc[ac]->Hybrid == Nsp2 || Acc[ac]->Hybrid == Osp2 ) &&
-                                      HBond[hc]->DonAccAng <= DONACCANG ) ||
-                                    ( ( Dnr[dc]->Hybrid == Nsp2 || Dnr[dc]->Hybrid == Osp2 ) &&
-                                      ( Acc[ac]->Hybrid == Nsp2 || Acc[ac]->Hybrid == Osp2 ) &&
-                                      HBond[hc]->AccDonAng <= ACCDONANG &&
-                                      HBond[hc]->DonAccAng <= DONACCANG ) )
-                                HBond[hc]->ExistHydrBondRose = STRIDE_YES;
-                        }
-                    }
-                }
+                    if ( Dnr->Hybrid == Nsp2 || Dnr->Hybrid == Osp2 )
+                    {
+                        HBond->AccDonAng =
+                            fabs ( Torsion ( Dnr->Chain->Rsd[Dnr->DDI_Res]->Coord[Dnr->DDI_At],
+                                             Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->D_At],
+                                             Dnr->Chain->Rsd[Dnr->DD_Res]->Coord[Dnr->DD_At],
+                                             Acc->Chain->Rsd[Acc->A_Res]->Coord[Acc->A_At] ) );
 
-            }
+                        if ( HBond->AccDonAng > 90.0f && HBond->AccDonAng < 270.0f )
+                            HBond->AccDonAng = fabs( 180.0f - HBond->AccDonAng );
 
-            if ( ( HBond[hc]->ExistPolarInter && HBond[hc]->Energy < 0.0 )
-                    || HBond[hc]->ExistHydrBondRose || HBond[hc]->ExistHydrBondBaker )
-            {
-                HBond[hc]->Dnr = Dnr[dc];
-                HBond[hc]->Acc = Acc[ac];
-                BondedDonor[dc] = STRIDE_YES;
-                BondedAcceptor[ac] = STRIDE_YES;
-                if ( ( ccd = FindChain ( Chain,NChain,Dnr[dc]->Chain->Id ) ) != ERR )
-                {
-                    if ( Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->NBondDnr < MAXRESDNR )
-                        Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->
-                        HBondDnr[Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->NBondDnr++] = hc;
-                    else
-                        printf ( "Residue %s %s of chain %i is involved in more than %d hydrogen bonds (%d)\n",
-                                 Chain[ccd]->Rsd[Dnr[dc]->D_Res]->ResType,
-                                 Chain[ccd]->Rsd[Dnr[dc]->D_Res]->PDB_ResNumb,
-                                 Chain[ccd]->ChainId,
-                                 MAXRESDNR,Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->NBondDnr );
-                }
-                if ( ( cca  = FindChain ( Chain,NChain,Acc[ac]->Chain->Id ) ) != ERR )
-                {
-                    if ( Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->NBondAcc < MAXRESACC )
-                        Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->
-                        HBondAcc[Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->NBondAcc++] = hc;
-                    else
-                        printf ( "Residue %s %s of chain %i is involved in more than %d hydrogen bonds (%d)\n",
-                                 Chain[cca]->Rsd[Acc[ac]->A_Res]->ResType,
-                                 Chain[cca]->Rsd[Acc[ac]->A_Res]->PDB_ResNumb,
-                                 Chain[cca]->ChainId,
-                                 MAXRESDNR,Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->NBondAcc );
-                }
-                if ( ccd != cca && ccd != ERR )
-                {
-                    Chain[ccd]->Rsd[Dnr[dc]->D_Res]->Inv->InterchainHBonds = STRIDE_YES;
-                    Chain[cca]->Rsd[Acc[ac]->A_Res]->Inv->InterchainHBonds = STRIDE_YES;
-                    if ( HBond[hc]->ExistHydrBondRose )
-                    {
-                        Chain[0]->NHydrBondInterchain++;
-                        Chain[0]->NHydrBondTotal++;
                     }
-                }
-                else
-                    if ( ccd == cca && ccd != ERR && HBond[hc]->ExistHydrBondRose )
+
+                    if ( Acc->Hybrid == Nsp2 || Acc->Hybrid == Osp2 )
                     {
-                        Chain[ccd]->NHydrBond++;
-                        Chain[0]->NHydrBondTotal++;
+                        HBond->DonAccAng =
+                            fabs ( Torsion ( Dnr->Chain->Rsd[Dnr->D_Res]->Coord[Dnr->D_At],
+                                             Acc->Chain->Rsd[Acc->A_Res]->Coord[Acc->A_At],
+                                             Acc->Chain->Rsd[Acc->AA_Res]->Coord[Acc->AA_At],
+                                             Acc->Chain->Rsd[Acc->AA2_Res]->Coord[Acc->AA2_At] ) );
+
+                        if ( HBond->DonAccAng > 90.0f && HBond->DonAccAng < 270.0f )
+                            HBond->DonAccAng = fabs( 180.0f - HBond->DonAccAng );
+
                     }
-                hc++;
+
+                    if ( ( Dnr->Hybrid != Nsp2 && Dnr->Hybrid != Osp2 &&
+                            Acc->Hybrid != Nsp2 && Acc->Hybrid != Osp2 ) ||
+                            ( Acc->Hybrid != Nsp2 && Acc->Hybrid != Osp2 &&
+                              ( Dnr->Hybrid == Nsp2 || Dnr->Hybrid == Osp2 ) &&
+                              HBond->AccDonAng <= ACCDONANG ) ||
+                            ( Dnr->Hybrid != Nsp2 && Dnr->Hybrid != Osp2 &&
+                              ( Acc->Hybrid == Nsp2 || Acc->Hybrid == Osp2 ) &&
+                              HBond->DonAccAng <= DONACCANG ) ||
+                            ( ( Dnr->Hybrid == Nsp2 || Dnr->Hybrid == Osp2 ) &&
+                              ( Acc->Hybrid == Nsp2 || Acc->Hybrid == Osp2 ) &&
+                              HBond->AccDonAng <= ACCDONANG &&
+                              HBond->DonAccAng <= DONACCANG ) )
+                        HBond->ExistHydrBondRose = STRIDE_YES;
+                }
             }
-            else
-                free ( HBond[hc] );
         }
-    }
-    
-    for ( i=0; i<NDnr; i++ )
-        if ( !BondedDonor[i] )
-            free ( Dnr[i] );
-    for ( i=0; i<NAcc; i++ )
-        if ( !BondedAcceptor[i] )
-            free ( Acc[i] );
 
-//	if ( NDnr )
-        free ( BondedDonor );
-//	if ( NAcc )
-        free ( BondedAcceptor );
-
-    free(Dnr);
-    free(Acc);
+    }
 
-    return ( hc );
+    return ( ( HBond->ExistPolarInter && HBond->Energy < 0.0 )
+             || HBond->ExistHydrBondRose || HBond->ExistHydrBondBaker );
 }
 
 int Stride::NoDoubleHBond( HBOND **HBond, int NHBond ) {
 
     int i, j, NExcl=0;
 
-    for ( i=0; i<NHBond-1; i++ )
-        for ( j=i+1; j<NHBond; j++ )
-            if ( HBond[i]->Dnr->D_Res == HBond[j]->Dnr->D_Res &&
-                    HBond[i]->Dnr->Chain->Id == HBond[j]->Dnr->Chain->Id &&
-                    HBond[i]->ExistPolarInter && HBond[j]->ExistPolarInter )
+    /* Only bonds sharing the donor residue can exclude each other. Grouping them first (keeping the original
+       order within each group) visits the same pairs in the same order as the full quadratic loop. */
+    std::vector<int> Order( NHBond );
+    for ( i=0; i<NHBond; i++ )
+        Order[i] = i;
+    std::stable_sort( Order.begin(), Order.end(), [HBond]( int a, int b ) {
+        if ( HBond[a]->Dnr->Chain->Id != HBond[b]->Dnr->Chain->Id )
+            return HBond[a]->Dnr->Chain->Id < HBond[b]->Dnr->Chain->Id;
+        return HBond[a]->Dnr->D_Res < HBond[b]->Dnr->D_Res;
+    } );
+
+    for ( int gb=0, ge=0; gb<NHBond; gb=ge )
+    {
+        for ( ge=gb+1; ge<NHBond && HBond[Order[ge]]->Dnr->D_Res == HBond[Order[gb]]->Dnr->D_Res &&
+                HBond[Order[ge]]->Dnr->Chain->Id == HBond[Order[gb]]->Dnr->Chain->Id; ge++ );
+
+        for ( int gi=gb; gi<ge-1; gi++ )
+            for ( int gj=gi+1; gj<ge; gj++ )
             {
-                if ( HBond[i]->Energy < 5.0*HBond[j]->Energy )
+                i = Order[gi];
+                j = Order[gj];
+                if ( HBond[i]->ExistPolarInter && HBond[j]->ExistPolarInter )
                 {
-                    HBond[j]->ExistPolarInter = STRIDE_NO;
-                    NExcl++;
-                }
-                else
-                    if ( HBond[j]->Energy < 5.0*HBond[i]->Energy )
+                    if ( HBond[i]->Energy < 5.0*HBond[j]->Energy )
                     {
-                        HBond[i]->ExistPolarInter = STRIDE_NO;
+                        HBond[j]->ExistPolarInter = STRIDE_NO;
                         NExcl++;
                     }
+                    else
+                        if ( HBond[j]->Energy < 5.0*HBond[i]->Energy )
+                        {
+                            HBond[i]->ExistPolarInter = STRIDE_NO;
+                            NExcl++;
+                        }
+                }
             }
+    }
 
     return ( NExcl );
 }
@@ -1082,8 +1156,10 @@ void Stride::Sheet( CHAIN **Chain, int Cn1, int Cn2, HBOND **HBond, COMMAND *Cmd
     char *AntiPar1, *Par1, *AntiPar2, *Par2;
     int i;
 
-    PatN = ( PATTERN ** ) ckalloc ( MAXHYDRBOND*sizeof ( PATTERN * ) );
-    PatP = ( PATTERN ** ) ckalloc ( MAXHYDRBOND*sizeof ( PATTERN * ) );
+    /* each pattern links two existing bonds, and a bond takes part in at most four pattern types */
+    const int MaxPat = std::max( MAXHYDRBOND, 4*HydroBondCnt );
+    PatN = ( PATTERN ** ) ckalloc ( MaxPat*sizeof ( PATTERN * ) );
+    PatP = ( PATTERN ** ) ckalloc ( MaxPat*sizeof ( PATTERN * ) );
 
     AntiPar1  = ( char * ) ckalloc ( Chain[Cn1]->NRes*sizeof ( char ) ); /* Antiparallel strands */
     Par1      = ( char * ) ckalloc ( Chain[Cn1]->NRes*sizeof ( char ) ); /* Parallel strands */
@@ -81,7 +81,7 @@ namespace protein {
 #define OUTPUTWIDTH               80
 #define MAXCONDITIONS             20
 
-#define MAXHYDRBOND               30000
+#define MAXHYDRBOND               30000 // only a minimum size for pattern buffers, bonds are unlimited
 #define MAXDONOR                  MAX_RES
 #define MAXACCEPTOR               MAX_RES
 
@@ -307,7 +307,8 @@ protected:
 	float **DefaultHelixMap( COMMAND *Cmd);
 	float **DefaultSheetMap( COMMAND *Cmd);
 	int PlaceHydrogens( CHAIN *Chain );
-	int FindHydrogenBonds( CHAIN **Chain, int NChain, HBOND **HBond, COMMAND *Cmd );
+	int FindHydrogenBonds( CHAIN **Chain, int NChain, COMMAND *Cmd );
+	BOOLEAN EvaluateHBond( DONOR *Dnr, ACCEPTOR *Acc, COMMAND *Cmd, HBOND *HBond );
 	int NoDoubleHBond( HBOND **HBond, int NHBond );
 	void DiscrPhiPsi( CHAIN **Chain, int NChain, COMMAND *Cmd );
 	void Helix( CHAIN **Chain, int Cn, HBOND **HBond, COMMAND *Cmd, float **PhiPsiMap );
@@ -379,7 +380,6 @@ protected:
 	void InitChain( CHAIN **Chain );
 	void FreeChain(CHAIN *Chain);
 	void FreeResidue(RESIDUE *r);
-	void FreeHBond(HBOND *h);
 	int SplitString( char *Buffer, char **Fields, int MaxField );
 	void Project4_123( float *Coord1, float *Coord2, float *Coord3,
 						 float *Coord4, float *Coord_Proj4_123 );
@@ -395,6 +395,9 @@ private:
 	int ProteinChainCnt;
 	HBOND **HydroBond;
 	int HydroBondCnt;
+	// contiguous storage of all hydrogen bonds and the pointers handed to the STRIDE routines
+	std::vector<HBOND> HydroBondStore;
+	std::vector<HBOND *> HydroBondPtrs;
 	std::vector<unsigned int> ownHydroBonds;
 	
 	// was the computation successful?
@@ -0,0 +1,349 @@
+#include "stdafx.h"
+#include "protein/Superposition.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+using namespace megamol;
+using namespace megamol::protein;
+
+namespace {
+
+	/**
+	 * Moves the (weighted) centroid of the positions to the origin.
+	 *
+	 * @return The weighted sum of the squared distances to the centroid.
+	 */
+	double centre(unsigned int n, const float *pos, const float *weights, double *centred, double centroid[3]) {
+		double w = 0.0;
+		centroid[0] = centroid[1] = centroid[2] = 0.0;
+		for (unsigned int i = 0; i < n; i++) {
+			const double wi = (weights != NULL) ? weights[i] : 1.0;
+			for (int k = 0; k < 3; k++) {
+				centroid[k] += wi * pos[3 * i + k];
+			}
+			w += wi;
+		}
+		for (int k = 0; k < 3; k++) {
+			centroid[k] = (w > 0.0) ? (centroid[k] / w) : 0.0;
+		}
+		double g = 0.0;
+		for (unsigned int i = 0; i < n; i++) {
+			const double wi = (weights != NULL) ? weights[i] : 1.0;
+			for (int k = 0; k < 3; k++) {
+				centred[3 * i + k] = pos[3 * i + k] - centroid[k];
+				g += wi * centred[3 * i + k] * centred[3 * i + k];
+			}
+		}
+		return g;
+	}
+
+	/**
+	 * Computes the (weighted) correlation matrix S_ab = sum w * m_a * r_b of
+	 * the centred positions 'm' (mobile) and 'r' (reference).
+	 */
+	void correlate(unsigned int n, const double *m, const double *r, const float *weights, double S[9]) {
+		for (int k = 0; k < 9; k++) S[k] = 0.0;
+		for (unsigned int i = 0; i < n; i++) {
+			const double wi = (weights != NULL) ? weights[i] : 1.0;
+			for (int a = 0; a < 3; a++) {
+				for (int b = 0; b < 3; b++) {
+					S[3 * a + b] += wi * m[3 * i + a] * r[3 * i + b];
+				}
+			}
+		}
+	}
+
+	/** Sets up the symmetric 4x4 key matrix of S. */
+	void keyMatrix(const double S[9], double K[4][4]) {
+		const double Sxx = S[0], Sxy = S[1], Sxz = S[2];
+		const double Syx = S[3], Syy = S[4], Syz = S[5];
+		const double Szx = S[6], Szy = S[7], Szz = S[8];
+		K[0][0] = Sxx + Syy + Szz;
+		K[0][1] = K[1][0] = Syz - Szy;
+		K[0][2] = K[2][0] = Szx - Sxz;
+		K[0][3] = K[3][0] = Sxy - Syx;
+		K[1][1] = Sxx - Syy - Szz;
+		K[1][2] = K[2][1] = Sxy + Syx;
+		K[1][3] = K[3][1] = Szx + Sxz;
+		K[2][2] = -Sxx + Syy - Szz;
+		K[2][3] = K[3][2] = Syz + Szy;
+		K[3][3] = -Sxx - Syy + Szz;
+	}
+
+	/** The determinant of a 4x4 matrix. */
+	double det4(const double a[4][4]) {
+		const double s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+		const double s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+		const double s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+		const double s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+		const double s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+		const double s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+		const double c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+		const double c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+		const double c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+		const double c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+		const double c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+		const double c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+		return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	}
+
+	/**
+	 * Finds the largest eigenvalue of the key matrix of S by Newton
+	 * iterations on its characteristic polynomial
+	 * x^4 + c2 x^2 + c1 x + c0, starting from the upper bound (Ga + Gb) / 2.
+	 */
+	double maxEigenvalue(const double S[9], double E0) {
+		double K[4][4];
+		keyMatrix(S, K);
+
+		double c2 = 0.0;
+		for (int k = 0; k < 9; k++) c2 += S[k] * S[k];
+		c2 *= -2.0;
+		const double detS = S[0] * (S[4] * S[8] - S[5] * S[7])
+			- S[1] * (S[3] * S[8] - S[5] * S[6])
+			+ S[2] * (S[3] * S[7] - S[4] * S[6]);
+		const double c1 = -8.0 * detS;
+		const double c0 = det4(K);
+
+		double lambda = E0;
+		for (int i = 0; i < 50; i++) {
+			const double l2 = lambda * lambda;
+			const double b = (l2 + c2) * lambda;
+			const double a = b + c1;
+			const double p = a * lambda + c0;
+			const double dp = 2.0 * l2 * lambda + b + a;
+			if (dp == 0.0) break;
+			const double delta = p / dp;
+			lambda -= delta;
+			if (std::fabs(delta) <= 1.0e-11 * std::fabs(lambda)) break;
+		}
+		return lambda;
+	}
+
+	/**
+	 * Derives the rotation from the eigenvector of the key matrix of S for
+	 * the eigenvalue 'lambda', i.e. the largest column of the adjugate of
+	 * K - lambda I.
+	 */
+	void rotationFromEigenvalue(const double S[9], double lambda, float rotation[3][3]) {
+		double A[4][4];
+		keyMatrix(S, A);
+		for (int k = 0; k < 4; k++) A[k][k] -= lambda;
+
+		double best[4] = { 1.0, 0.0, 0.0, 0.0 };
+		double bestNorm = 0.0;
+		for (int col = 0; col < 4; col++) {
+			double q[4];
+			for (int row = 0; row < 4; row++) {
+				// cofactor of A without row 'col' and column 'row'
+				int r[3], c[3];
+				for (int k = 0, ri = 0, ci = 0; k < 4; k++) {
+					if (k != col) r[ri++] = k;
+					if (k != row) c[ci++] = k;
+				}
+				const double minor = A[r[0]][c[0]] * (A[r[1]][c[1]] * A[r[2]][c[2]] - A[r[1]][c[2]] * A[r[2]][c[1]])
+					- A[r[0]][c[1]] * (A[r[1]][c[0]] * A[r[2]][c[2]] - A[r[1]][c[2]] * A[r[2]][c[0]])
+					+ A[r[0]][c[2]] * (A[r[1]][c[0]] * A[r[2]][c[1]] - A[r[1]][c[1]] * A[r[2]][c[0]]);
+				q[row] = (((row + col) % 2) == 0) ? minor : -minor;
+			}
+			const double norm = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+			if (norm > bestNorm) {
+				bestNorm = norm;
+				std::copy(q, q + 4, best);
+			}
+		}
+
+		// a vanishing adjugate means that the eigenvalue is not simple, e.g.
+		// for degenerate positions, any rotation is as good as the identity
+		if (!(bestNorm > 1.0e-30)) {
+			best[0] = 1.0;
+			best[1] = best[2] = best[3] = 0.0;
+			bestNorm = 1.0;
+		}
+		const double len = std::sqrt(bestNorm);
+		const double w = best[0] / len, x = best[1] / len, y = best[2] / len, z = best[3] / len;
+
+		rotation[0][0] = static_cast<float>(w * w + x * x - y * y - z * z);
+		rotation[0][1] = static_cast<float>(2.0 * (x * y - w * z));
+		rotation[0][2] = static_cast<float>(2.0 * (x * z + w * y));
+		rotation[1][0] = static_cast<float>(2.0 * (x * y + w * z));
+		rotation[1][1] = static_cast<float>(w * w - x * x + y * y - z * z);
+		rotation[1][2] = static_cast<float>(2.0 * (y * z - w * x));
+		rotation[2][0] = static_cast<float>(2.0 * (x * z - w * y));
+		rotation[2][1] = static_cast<float>(2.0 * (y * z + w * x));
+		rotation[2][2] = static_cast<float>(w * w - x * x - y * y + z * z);
+	}
+
+	/**
+	 * Superposes centred positions.
+	 *
+	 * @return The RMSD after the superposition.
+	 */
+	float superposeCentred(unsigned int n, const double *ref, double gRef, const double refCentroid[3],
+			const double *mob, double gMob, const double mobCentroid[3], const float *weights,
+			float rotation[3][3], float translation[3]) {
+		double S[9];
+		correlate(n, mob, ref, weights, S);
+		const double lambda = maxEigenvalue(S, 0.5 * (gRef + gMob));
+		rotationFromEigenvalue(S, lambda, rotation);
+
+		for (int a = 0; a < 3; a++) {
+			translation[a] = static_cast<float>(refCentroid[a]
+				- (rotation[a][0] * mobCentroid[0] + rotation[a][1] * mobCentroid[1] + rotation[a][2] * mobCentroid[2]));
+		}
+
+		double w = n;
+		if (weights != NULL) {
+			w = 0.0;
+			for (unsigned int i = 0; i < n; i++) w += weights[i];
+		}
+		if (!(w > 0.0)) return 0.0f;
+		return static_cast<float>(std::sqrt(std::max(0.0, (gRef + gMob - 2.0 * lambda) / w)));
+	}
+
+} /* end anonymous namespace */
+
+
+/*
+ * megamol::protein::superpose
+ */
+PROTEIN_API float megamol::protein::superpose(unsigned int n, const float *reference, const float *mobile,
+		const float *weights, float rotation[3][3], float translation[3]) {
+	std::vector<double> ref(3 * static_cast<size_t>(n)), mob(3 * static_cast<size_t>(n));
+	double refCentroid[3], mobCentroid[3];
+	const double gRef = centre(n, reference, weights, ref.data(), refCentroid);
+	const double gMob = centre(n, mobile, weights, mob.data(), mobCentroid);
+	return superposeCentred(n, ref.data(), gRef, refCentroid, mob.data(), gMob, mobCentroid, weights,
+		rotation, translation);
+}
+
+
+/*
+ * megamol::protein::superposeFrames
+ */
+PROTEIN_API void megamol::protein::superposeFrames(unsigned int n, const float *reference, float *frames,
+		unsigned int frameCount, float *outRMSD) {
+	std::vector<double> ref(3 * static_cast<size_t>(n));
+	double refCentroid[3];
+	const double gRef = centre(n, reference, NULL, ref.data(), refCentroid);
+
+#pragma omp parallel
+	{
+		// each thread centres its frames in its own buffer
+		std::vector<double> mob(3 * static_cast<size_t>(n));
+#pragma omp for schedule(dynamic, 1)
+		for (int f = 0; f < static_cast<int>(frameCount); f++) {
+			float *pos = frames + static_cast<size_t>(f) * 3 * n;
+			double mobCentroid[3];
+			float rotation[3][3], translation[3];
+			const double gMob = centre(n, pos, NULL, mob.data(), mobCentroid);
+			const float rmsd = superposeCentred(n, ref.data(), gRef, refCentroid, mob.data(), gMob, mobCentroid,
+				NULL, rotation, translation);
+			for (unsigned int i = 0; i < n; i++) {
+				const float p[3] = { pos[3 * i + 0], pos[3 * i + 1], pos[3 * i + 2] };
+				for (int a = 0; a < 3; a++) {
+					pos[3 * i + a] = rotation[a][0] * p[0] + rotation[a][1] * p[1] + rotation[a][2] * p[2]
+						+ translation[a];
+				}
+			}
+			if (outRMSD != NULL) outRMSD[f] = rmsd;
+		}
+	}
+}
+
+
+/*
+ * megamol::protein::computeRMSDMatrix
+ */
+PROTEIN_API void megamol::protein::computeRMSDMatrix(unsigned int n, const float *frames, unsigned int frameCount,
+		float *outMatrix) {
+	if (frameCount == 0) return;
+
+	// centred frames as separate x, y and z arrays, padded with zeros, which
+	// do not contribute to any sum
+	const size_t stride = (static_cast<size_t>(n) + 7) & ~static_cast<size_t>(7);
+	std::vector<float> soa(static_cast<size_t>(frameCount) * 3 * stride, 0.0f);
+	std::vector<double> g(frameCount);
+#pragma omp parallel
+	{
+		std::vector<double> centred(3 * static_cast<size_t>(n));
+#pragma omp for
+		for (int f = 0; f < static_cast<int>(frameCount); f++) {
+			double centroid[3];
+			centre(n, frames + static_cast<size_t>(f) * 3 * n, NULL, centred.data(), centroid);
+			float *dst = soa.data() + static_cast<size_t>(f) * 3 * stride;
+			// the sum of squares must match the rounded positions, otherwise
+			// identical frames would not have an RMSD of zero
+			double gf = 0.0;
+			for (unsigned int i = 0; i < n; i++) {
+				for (int k = 0; k < 3; k++) {
+					const float c = static_cast<float>(centred[3 * i + k]);
+					dst[k * stride + i] = c;
+					gf += static_cast<double>(c) * c;
+				}
+			}
+			g[f] = gf;
+		}
+	}
+
+	// two tiles of frames should fit into 256 KiB
+	const size_t frameBytes = 3 * stride * sizeof(float);
+	const unsigned int tile = static_cast<unsigned int>(std::min<size_t>(64,
+		std::max<size_t>(4, (256 * 1024) / (2 * frameBytes))));
+	const unsigned int tiles = (frameCount + tile - 1) / tile;
+	std::vector<std::pair<unsigned int, unsigned int> > tilePairs;
+	tilePairs.reserve(static_cast<size_t>(tiles) * (tiles + 1) / 2);
+	for (unsigned int ti = 0; ti < tiles; ti++) {
+		for (unsigned int tj = ti; tj < tiles; tj++) {
+			tilePairs.push_back(std::make_pair(ti, tj));
+		}
+	}
+
+	// the diagonal is written once here, as several tile pairs share it
+	for (unsigned int i = 0; i < frameCount; i++) {
+		outMatrix[static_cast<size_t>(i) * frameCount + i] = 0.0f;
+	}
+
+	const int len = static_cast<int>(stride);
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int p = 0; p < static_cast<int>(tilePairs.size()); p++) {
+		const unsigned int iEnd = std::min(frameCount, (tilePairs[p].first + 1) * tile);
+		const unsigned int jEnd = std::min(frameCount, (tilePairs[p].second + 1) * tile);
+		for (unsigned int i = tilePairs[p].first * tile; i < iEnd; i++) {
+			const float *xi = soa.data() + static_cast<size_t>(i) * 3 * stride;
+			const float *yi = xi + stride;
+			const float *zi = yi + stride;
+			const unsigned int jBegin = std::max(i + 1, tilePairs[p].second * tile);
+			for (unsigned int j = jBegin; j < jEnd; j++) {
+				const float *xj = soa.data() + static_cast<size_t>(j) * 3 * stride;
+				const float *yj = xj + stride;
+				const float *zj = yj + stride;
+				double sxx = 0.0, sxy = 0.0, sxz = 0.0, syx = 0.0, syy = 0.0, syz = 0.0, szx = 0.0, szy = 0.0, szz = 0.0;
+#pragma omp simd reduction(+ : sxx, sxy, sxz, syx, syy, syz, szx, szy, szz)
+				for (int k = 0; k < len; k++) {
+					const double ax = xi[k], ay = yi[k], az = zi[k];
+					const double bx = xj[k], by = yj[k], bz = zj[k];
+					sxx += ax * bx;
+					sxy += ax * by;
+					sxz += ax * bz;
+					syx += ay * bx;
+					syy += ay * by;
+					syz += ay * bz;
+					szx += az * bx;
+					szy += az * by;
+					szz += az * bz;
+				}
+				const double S[9] = { sxx, sxy, sxz, syx, syy, syz, szx, szy, szz };
+				const double lambda = maxEigenvalue(S, 0.5 * (g[i] + g[j]));
+				const float rmsd = (n > 0)
+					? static_cast<float>(std::sqrt(std::max(0.0, (g[i] + g[j] - 2.0 * lambda) / n))) : 0.0f;
+				outMatrix[static_cast<size_t>(i) * frameCount + j] = rmsd;
+				outMatrix[static_cast<size_t>(j) * frameCount + i] = rmsd;
+			}
+		}
+	}
+}
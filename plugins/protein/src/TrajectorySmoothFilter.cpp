@@ -25,6 +25,8 @@
 #include <GL/glu.h>
 
 #include "TrajectorySmoothFilter.h"
+#include <algorithm>
+#include <cmath>
 
 using namespace megamol;
 using namespace megamol::core;
@@ -38,7 +40,9 @@ using namespace megamol::protein_calls;
 TrajectorySmoothFilter::TrajectorySmoothFilter(void) : core::Module(),
     molDataCallerSlot("getdata", "Connects the filter with molecule data storage"),
     dataOutSlot("dataout", "The slot providing the filtered data"),
-    nAvgFramesSlot("nAvgFrames", "Number of frames to average over") {
+    nAvgFramesSlot("nAvgFrames", "Number of frames to average over"),
+    kernelSlot("kernel", "The weighting of the frames to average over"),
+    windowFirst(0), windowAtomCnt(0), windowHash(0), windowValid(false) {
 
     // Enable caller slot
     this->molDataCallerSlot.SetCompatibleCall<MolecularDataCallDescription>();
@@ -57,6 +61,16 @@ TrajectorySmoothFilter::TrajectorySmoothFilter(void) : core::Module(),
     this->nAvgFrames = 10;
     this->nAvgFramesSlot.SetParameter(new param::IntParam(this->nAvgFrames, 1));
     this->MakeSlotAvailable(&this->nAvgFramesSlot);
+
+    // Set the weighting of the averaged frames
+    this->kernel = KERNEL_BOX;
+    param::EnumParam *kp = new param::EnumParam(this->kernel);
+    kp->SetTypePair(KERNEL_BOX, "Box");
+    kp->SetTypePair(KERNEL_GAUSS, "Gaussian");
+    this->kernelSlot.SetParameter(kp);
+    this->MakeSlotAvailable(&this->kernelSlot);
+
+    this->updateWeights();
 }
 
 
@@ -80,6 +94,9 @@ bool TrajectorySmoothFilter::create(void) {
  * TrajectorySmoothFilter::release
  */
 void TrajectorySmoothFilter::release(void) {
+    this->window.clear();
+    this->windowSum.clear();
+    this->windowValid = false;
 }
 
 
@@ -103,46 +120,111 @@ bool TrajectorySmoothFilter::getData(megamol::core::Call& call) {
         return false;
     }
 
+    this->updateParams(molIn);
     firstFrame = molIn->FrameID();
 
-    // Obtain number of atoms
-    molOut->SetFrameID(0, true); // Set 'force' flag
-    if (!(*molOut)(MolecularDataCall::CallForGetData)){
+    // Obtain number of frames
+    if (!(*molOut)(MolecularDataCall::CallForGetExtent)) {
         return false;
     }
-    molOut->Unlock();
-
-    if (molIn->FrameID() >= (molOut->FrameCount()-(this->nAvgFrames-1))) {
+    if ((molOut->FrameCount() < this->nAvgFrames) ||
+            (firstFrame >= (molOut->FrameCount()-(this->nAvgFrames-1)))) {
         return false;
     }
+    if (molOut->DataHash() != this->windowHash) {
+        this->windowValid = false;
+    }
+
+    // Only the frames entering the window need to be loaded. Their slots hold
+    // exactly the frames leaving the window, because both windows cover all
+    // residues modulo the window size.
+    bool backwards = this->windowValid && (firstFrame < this->windowFirst);
+    if (this->windowValid && ((firstFrame + this->nAvgFrames <= this->windowFirst) ||
+            (firstFrame >= this->windowFirst + this->nAvgFrames))) {
+        this->windowValid = false;
+    }
+    std::vector<uint> missing;
+    for (uint fr = firstFrame; fr < firstFrame + this->nAvgFrames; ++fr) {
+        if (!this->windowValid || (fr < this->windowFirst) ||
+                (fr >= this->windowFirst + this->nAvgFrames)) {
+            missing.push_back(fr);
+        }
+    }
+    if (backwards) {
+        std::reverse(missing.begin(), missing.end());
+    }
 
-    // (Re-)allocate memory and init with zero
-    this->atomPosSmoothed.Validate(molOut->AtomCount()*3);
-    memset(this->atomPosSmoothed.Peek(), 0, molOut->AtomCount()*3*sizeof(float));
+    // The frame loaded last stays locked to provide the remaining data of
+    // the call. It is the newest frame in the direction of playback, so the
+    // data source can already read ahead from there.
+    uint anchor = backwards ? firstFrame : (firstFrame + this->nAvgFrames - 1);
+    if (!missing.empty()) {
+        anchor = missing.back();
+    }
 
-    // Loop through all averaging frames
-    for (uint fr = 0; fr < this->nAvgFrames; ++fr) {
-        molOut->SetFrameID(molIn->FrameID()+fr, true); // Set 'force' flag
-        if (!(*molOut)(MolecularDataCall::CallForGetData)){
+    for (size_t i = 0; i < missing.size(); ++i) {
+        molOut->SetFrameID(missing[i], true); // Set 'force' flag
+        if (!(*molOut)(MolecularDataCall::CallForGetData)) {
+            this->windowValid = false;
             return false;
         }
-        molOut->Unlock();
 
-        // Add positions
-#pragma omp parallel for
-        for (int at = 0; at < static_cast<int>(molOut->AtomCount()); ++at) {
-            this->atomPosSmoothed.Peek()[3*at+0] += molOut->AtomPositions()[3*at+0];
-            this->atomPosSmoothed.Peek()[3*at+1] += molOut->AtomPositions()[3*at+1];
-            this->atomPosSmoothed.Peek()[3*at+2] += molOut->AtomPositions()[3*at+2];
+        if (!this->windowValid && (i == 0)) {
+            this->windowAtomCnt = molOut->AtomCount();
+            this->window.assign(static_cast<size_t>(this->windowAtomCnt) * 3 * this->nAvgFrames, 0.0f);
+            this->windowSum.assign(static_cast<size_t>(this->windowAtomCnt) * 3, 0.0);
+            this->windowHash = molOut->DataHash();
+        } else if (molOut->AtomCount() != this->windowAtomCnt) {
+            molOut->Unlock();
+            this->windowValid = false;
+            Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR,
+                "%s: Frame %u has %u atoms instead of %u", this->ClassName(),
+                missing[i], molOut->AtomCount(), this->windowAtomCnt);
+            return false;
+        }
+        this->storeFrame(*molOut, missing[i], this->windowValid);
+
+        if (missing[i] != anchor) {
+            molOut->Unlock();
+        }
+    }
+    this->windowFirst = firstFrame;
+    this->windowValid = true;
+
+    if (missing.empty()) {
+        molOut->SetFrameID(anchor, true); // Set 'force' flag
+        if (!(*molOut)(MolecularDataCall::CallForGetData)) {
+            return false;
+        }
+        if (molOut->AtomCount() != this->windowAtomCnt) {
+            molOut->Unlock();
+            this->windowValid = false;
+            return false;
         }
     }
 
-    // Normalize positions
+    // Compute the average
+    this->atomPosSmoothed.Validate(this->windowAtomCnt*3);
+    float *smoothed = this->atomPosSmoothed.Peek();
+    const int valCnt = static_cast<int>(this->windowAtomCnt*3);
+    if (this->kernel == KERNEL_BOX) {
+        const double *sum = this->windowSum.data();
+        const double n = static_cast<double>(this->nAvgFrames);
+#pragma omp parallel for
+        for (int i = 0; i < valCnt; ++i) {
+            smoothed[i] = static_cast<float>(sum[i] / n);
+        }
+    } else {
+        memset(smoothed, 0, valCnt*sizeof(float));
+        for (uint fr = 0; fr < this->nAvgFrames; ++fr) {
+            const float w = this->weights[fr];
+            const float *pos = this->window.data() +
+                static_cast<size_t>((firstFrame + fr) % this->nAvgFrames) * valCnt;
 #pragma omp parallel for
-    for (int at = 0; at < static_cast<int>(molOut->AtomCount()); ++at) {
-        this->atomPosSmoothed.Peek()[3*at+0] /= static_cast<float>(this->nAvgFrames);
-        this->atomPosSmoothed.Peek()[3*at+1] /= static_cast<float>(this->nAvgFrames);
-        this->atomPosSmoothed.Peek()[3*at+2] /= static_cast<float>(this->nAvgFrames);
+            for (int i = 0; i < valCnt; ++i) {
+                smoothed[i] += w * pos[i];
+            }
+        }
     }
 
     // Transfer data from outgoing to incoming data call
@@ -181,6 +263,8 @@ bool TrajectorySmoothFilter::getExtent(core::Call& call) {
         return false;
     }
 
+    this->updateParams(molIn);
+
     // Get extend
     if (!(*molOut)(MolecularDataCall::CallForGetExtent)) {
         return false;
@@ -202,8 +286,62 @@ bool TrajectorySmoothFilter::getExtent(core::Call& call) {
 void TrajectorySmoothFilter::updateParams(MolecularDataCall *mol) {
     // Parameter to determine number of averaging frames
     if (this->nAvgFramesSlot.IsDirty()) {
-        this->nAvgFrames = this->nAvgFramesSlot.Param<core::param::BoolParam>()->Value();
+        this->nAvgFrames = static_cast<uint>(this->nAvgFramesSlot.Param<core::param::IntParam>()->Value());
         this->nAvgFramesSlot.ResetDirty();
+        this->windowValid = false;
+        this->updateWeights();
+    }
+    // Parameter to determine the weighting of the frames
+    if (this->kernelSlot.IsDirty()) {
+        this->kernel = static_cast<Kernel>(this->kernelSlot.Param<core::param::EnumParam>()->Value());
+        this->kernelSlot.ResetDirty();
+        this->updateWeights();
+    }
+}
+
+
+/*
+ * TrajectorySmoothFilter::updateWeights
+ */
+void TrajectorySmoothFilter::updateWeights(void) {
+    this->weights.assign(this->nAvgFrames, 1.0f / static_cast<float>(this->nAvgFrames));
+    if ((this->kernel != KERNEL_GAUSS) || (this->nAvgFrames < 2)) {
+        return;
+    }
+
+    // The window covers three standard deviations on either side
+    const float center = 0.5f * static_cast<float>(this->nAvgFrames - 1);
+    const float sigma = static_cast<float>(this->nAvgFrames) / 6.0f;
+    float sum = 0.0f;
+    for (uint fr = 0; fr < this->nAvgFrames; ++fr) {
+        const float d = (static_cast<float>(fr) - center) / sigma;
+        this->weights[fr] = std::exp(-0.5f * d * d);
+        sum += this->weights[fr];
+    }
+    for (uint fr = 0; fr < this->nAvgFrames; ++fr) {
+        this->weights[fr] /= sum;
+    }
+}
+
+
+/*
+ * TrajectorySmoothFilter::storeFrame
+ */
+void TrajectorySmoothFilter::storeFrame(const MolecularDataCall& mol,
+        uint frame, bool replaces) {
+    const int valCnt = static_cast<int>(this->windowAtomCnt*3);
+    float *slot = this->window.data() +
+        static_cast<size_t>(frame % this->nAvgFrames) * valCnt;
+    const float *pos = mol.AtomPositions();
+    double *sum = this->windowSum.data();
+
+#pragma omp parallel for
+    for (int i = 0; i < valCnt; ++i) {
+        if (replaces) {
+            sum[i] -= slot[i];
+        }
+        sum[i] += pos[i];
+        slot[i] = pos[i];
     }
 }
 
@@ -22,6 +22,7 @@
 #include "mmcore/view/Renderer3DModule.h"
 
 #include "HostArr.h"
+#include <vector>
 
 typedef unsigned int uint;
 
@@ -29,7 +30,9 @@ namespace megamol {
 namespace protein {
 
 /// Filter module that computes a smoothed version of a given trajectory by
-/// calculating the average.
+/// calculating the (weighted) average over a window of frames.
+/// The positions of the frames in the window are kept in a ring buffer, so
+/// stepping through the trajectory only loads the frames entering the window.
 /// Note: Does not take periodic boundary conditions into account, therefore,
 /// particles that wrap around the box will be incorrect!
 class TrajectorySmoothFilter : public core::Module {
@@ -136,6 +139,12 @@ private:
 
     };
 
+    /// The weighting of the frames in the window
+    enum Kernel {
+        KERNEL_BOX = 0,
+        KERNEL_GAUSS = 1
+    };
+
     /**
      * Update all parameters.
      *
@@ -143,6 +152,23 @@ private:
      */
 	void updateParams(megamol::protein_calls::MolecularDataCall *mol);
 
+    /**
+     * Computes the weights of the frames in the window for the current
+     * kernel.
+     */
+    void updateWeights(void);
+
+    /**
+     * Copies the positions of the frame in 'mol' into its slot of the ring
+     * buffer and updates the running sum.
+     *
+     * @param mol      The data call holding the frame.
+     * @param frame    The number of the frame.
+     * @param replaces 'true' if the slot holds a frame leaving the window.
+     */
+    void storeFrame(const megamol::protein_calls::MolecularDataCall& mol,
+            uint frame, bool replaces);
+
 
     /// Caller slot to get unfiltered data
     core::CallerSlot molDataCallerSlot;
@@ -154,9 +180,35 @@ private:
     core::param::ParamSlot nAvgFramesSlot;
     uint nAvgFrames;
 
+    /// Parameter slot for the weighting of the frames
+    core::param::ParamSlot kernelSlot;
+    Kernel kernel;
+
     /// Intermediate storage for smoothed atom positions
     HostArr<float> atomPosSmoothed;
 
+    /// The atom positions of the frames in the window, frame i is stored in
+    /// slot i % nAvgFrames
+    std::vector<float> window;
+
+    /// The sum of the atom positions of all frames in the window
+    std::vector<double> windowSum;
+
+    /// The normalised weights of the frames in the window, oldest first
+    std::vector<float> weights;
+
+    /// The first frame of the window
+    uint windowFirst;
+
+    /// The number of atoms per frame in the window
+    uint windowAtomCnt;
+
+    /// The data hash of the frames in the window
+    SIZE_T windowHash;
+
+    /// Flag whether 'window' holds all frames from 'windowFirst' on
+    bool windowValid;
+
 };
 
 
@@ -15,7 +15,8 @@
 #include "mmcore/param/FilePathParam.h"
 #include "mmcore/param/IntParam.h"
 #include "mmcore/param/EnumParam.h"
-#include "vislib/sys/ASCIIFileBuffer.h"
+#include "mmcore/param/BoolParam.h"
+#include "vislib/sys/File.h"
 #include "vislib/sys/Log.h"
 #include "vislib/String.h"
 #include "vislib/Exception.h"
@@ -25,6 +26,19 @@
 #include "Base64.h"
 #include <ctype.h>
 #include <cmath>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <omp.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else /* _WIN32 */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif /* _WIN32 */
 //#include "vislib_vector_typedefs.h"
 #include "vislib/math/Cuboid.h"
 typedef vislib::math::Cuboid<float> Cubef;
@@ -34,20 +48,228 @@ using namespace megamol::core;
 using namespace megamol::protein;
 
 
+namespace {
+
+    /** The size of the pieces of the text parsed by one thread at a time */
+    const SIZE_T pieceSize = 256 * 1024;
+
+    /** Answer whether 'c' separates the numbers */
+    inline bool isSeparator(char c) {
+        return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t') || (c == '\v') || (c == '\f');
+    }
+
+    /**
+     * Parses the number starting at 'p' and moves 'p' behind it. Plain
+     * decimal numbers are converted directly, anything else is left to
+     * 'strtod'.
+     */
+    inline float parseFloat(const char *&p, const char *end) {
+        static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        const char *start = p;
+        bool negative = false;
+        if ((p < end) && ((*p == '-') || (*p == '+'))) {
+            negative = (*p == '-');
+            p++;
+        }
+        UINT64 mantissa = 0;
+        int exponent = 0, digits = 0;
+        for (; (p < end) && (*p >= '0') && (*p <= '9'); p++, digits++) {
+            if (mantissa < 1000000000000000000ULL) {
+                mantissa = 10 * mantissa + (*p - '0');
+            } else {
+                exponent++;
+            }
+        }
+        if ((p < end) && (*p == '.')) {
+            for (p++; (p < end) && (*p >= '0') && (*p <= '9'); p++, digits++) {
+                if (mantissa < 1000000000000000000ULL) {
+                    mantissa = 10 * mantissa + (*p - '0');
+                    exponent--;
+                }
+            }
+        }
+        if ((digits > 0) && (p < end) && ((*p == 'e') || (*p == 'E'))) {
+            const char *e = p + 1;
+            bool negExp = false;
+            if ((e < end) && ((*e == '-') || (*e == '+'))) {
+                negExp = (*e == '-');
+                e++;
+            }
+            int exp = 0;
+            if ((e < end) && (*e >= '0') && (*e <= '9')) {
+                for (; (e < end) && (*e >= '0') && (*e <= '9'); e++) {
+                    if (exp < 10000) exp = 10 * exp + (*e - '0');
+                }
+                exponent += negExp ? -exp : exp;
+                p = e;
+            }
+        }
+        if ((digits == 0) || ((p < end) && !isSeparator(*p))) {
+            // not a plain decimal number (e.g. 'nan'), let the CRT handle it
+            char num[64];
+            p = start;
+            SIZE_T len = 0;
+            while ((p < end) && !isSeparator(*p)) {
+                if (len < sizeof(num) - 1) num[len++] = *p;
+                p++;
+            }
+            num[len] = '\0';
+            return static_cast<float>(::strtod(num, NULL));
+        }
+        double value = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            value = (exponent >= -22) ? (value / pow10[-exponent]) : (value * std::pow(10.0, exponent));
+        } else if (exponent > 0) {
+            value = (exponent <= 22) ? (value * pow10[exponent]) : (value * std::pow(10.0, exponent));
+        }
+        return static_cast<float>(negative ? -value : value);
+    }
+
+    /**
+     * Read-only view of a whole file mapped into memory. The text is parsed
+     * directly from the mapping, so the pages are only touched once.
+     */
+    class MappedFileView {
+    public:
+
+        MappedFileView(void) : data(NULL), size(0) {
+#ifdef _WIN32
+            this->file = INVALID_HANDLE_VALUE;
+            this->mapping = NULL;
+#else /* _WIN32 */
+            this->file = -1;
+#endif /* _WIN32 */
+        }
+
+        ~MappedFileView(void) {
+            this->Close();
+        }
+
+        /** Maps the file 'filename', answers false on failure */
+        bool Open(const char *filename) {
+            this->Close();
+#ifdef _WIN32
+            this->file = ::CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            LARGE_INTEGER fileSize;
+            if ((this->file == INVALID_HANDLE_VALUE) || !::GetFileSizeEx(this->file, &fileSize)) {
+                this->Close();
+                return false;
+            }
+            this->size = static_cast<SIZE_T>(fileSize.QuadPart);
+            if (this->size > 0) {
+                this->mapping = ::CreateFileMappingA(this->file, NULL, PAGE_READONLY, 0, 0, NULL);
+                if (this->mapping != NULL) {
+                    this->data = static_cast<const char*>(::MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+                }
+                if (this->data == NULL) {
+                    this->Close();
+                    return false;
+                }
+            }
+#else /* _WIN32 */
+            this->file = ::open(filename, O_RDONLY);
+            struct stat st;
+            if ((this->file < 0) || (::fstat(this->file, &st) != 0)) {
+                this->Close();
+                return false;
+            }
+            this->size = static_cast<SIZE_T>(st.st_size);
+            if (this->size > 0) {
+                void *view = ::mmap(NULL, this->size, PROT_READ, MAP_PRIVATE, this->file, 0);
+                if (view == MAP_FAILED) {
+                    this->Close();
+                    return false;
+                }
+                ::madvise(view, this->size, MADV_SEQUENTIAL);
+                this->data = static_cast<const char*>(view);
+            }
+#endif /* _WIN32 */
+            return true;
+        }
+
+        /** Unmaps the file */
+        void Close(void) {
+#ifdef _WIN32
+            if (this->data != NULL) ::UnmapViewOfFile(this->data);
+            if (this->mapping != NULL) ::CloseHandle(this->mapping);
+            if (this->file != INVALID_HANDLE_VALUE) ::CloseHandle(this->file);
+            this->file = INVALID_HANDLE_VALUE;
+            this->mapping = NULL;
+#else /* _WIN32 */
+            if (this->data != NULL) ::munmap(const_cast<char*>(this->data), this->size);
+            if (this->file >= 0) ::close(this->file);
+            this->file = -1;
+#endif /* _WIN32 */
+            this->data = NULL;
+            this->size = 0;
+        }
+
+        /** The mapped bytes, NULL for an empty file */
+        inline const char *Data(void) const {
+            return this->data;
+        }
+
+        /** The number of mapped bytes */
+        inline SIZE_T Size(void) const {
+            return this->size;
+        }
+
+    private:
+
+        /* Forbidden, the view owns the mapping */
+        MappedFileView(const MappedFileView& src);
+        MappedFileView& operator=(const MappedFileView& rhs);
+
+#ifdef _WIN32
+        HANDLE file;
+        HANDLE mapping;
+#else /* _WIN32 */
+        int file;
+#endif /* _WIN32 */
+        const char *data;
+        SIZE_T size;
+    };
+
+    /**
+     * Identifies the content of a file by its size, its modification time
+     * and its first and last bytes.
+     */
+    std::string fingerprintFile(const char *filename, const char *data, SIZE_T size) {
+        struct stat st;
+        const INT64 fileTime = (::stat(filename, &st) == 0) ? static_cast<INT64>(st.st_mtime) : 0;
+        const SIZE_T sample = std::min<SIZE_T>(size, 64 * 1024);
+        UINT64 hash = 14695981039346656037ULL;
+        for (int part = 0; part < 2; part++) {
+            const char *begin = (part == 0) ? data : (data + size - sample);
+            for (SIZE_T i = 0; i < sample; i++) {
+                hash = (hash ^ static_cast<unsigned char>(begin[i])) * 1099511628211ULL;
+            }
+        }
+        std::stringstream ss;
+        ss << size << '|' << fileTime << '|' << hash;
+        return ss.str();
+    }
+
+} /* end anonymous namespace */
+
+
 /*
  * VMDDXLoader::VMDDXLoader
  */
 VMDDXLoader::VMDDXLoader(void) : Module(),
         dataOutSlot("dataout", "The slot providing the loaded data"),
         filenameSlot("filename", "The path to the *.dx data file to be loaded"),
+        useCacheSlot("useCache", "Stores the parsed grids in binary files next to the data files to speed up loading them again"),
         hash(0),
 //        extent(0, 0, 0, 0, 0, 0),
 //        origin(0.0f, 0.0f, 0.0f),
 //        spacing(0.0f, 0.0f, 0.0f),
         filenamesDigits(0),
-        nFrames(-1)
-//        min(0.0f),
-//        max(0.0f)
+        nFrames(-1),
+        dataMin(0.0f),
+        dataMax(0.0f)
 {
 
     this->dataOutSlot.SetCallback(
@@ -63,6 +285,9 @@ VMDDXLoader::VMDDXLoader(void) : Module(),
     this->filenameSlot.SetParameter(new core::param::FilePathParam("/Path/to/file"));
     this->MakeSlotAvailable(&this->filenameSlot);
     this->filenameSlot.Param<param::FilePathParam>()->SetValue("");
+
+    this->useCacheSlot.SetParameter(new core::param::BoolParam(false));
+    this->MakeSlotAvailable(&this->useCacheSlot);
 }
 
 
@@ -87,6 +312,7 @@ bool VMDDXLoader::create(void) {
  */
 void VMDDXLoader::release(void) {
     this->data.Release();
+    this->loadedFile.Clear();
 }
 
 
@@ -121,8 +347,13 @@ bool VMDDXLoader::getData(core::Call& call) {
         frameFile.Append(this->filenamesSuffix);
     }
 
-    if (!this->loadFile(frameFile)) {
-        return false;
+    // the same frame is requested many times in a row
+    if (frameFile != this->loadedFile) {
+        if (!this->loadFile(frameFile)) {
+            this->loadedFile.Clear();
+            return false;
+        }
+        this->loadedFile = frameFile;
     }
 
     // Set image data
@@ -158,6 +389,7 @@ bool VMDDXLoader::getExtent(core::Call& call) {
     if (this->filenameSlot.IsDirty()) { // Files have to be loaded first
         this->filenameSlot.ResetDirty();
         this->scanFolder(); // (Re-)scan the folder
+        this->loadedFile.Clear();
         this->hash++;       // Change data hash
         this->hash = this->hash%10;
     }
@@ -180,11 +412,6 @@ bool VMDDXLoader::loadFile(const vislib::StringA& filename) {
     using namespace vislib::sys;
     using namespace vislib;
 
-    File testFile;
-    ASCIIFileBuffer file(ASCIIFileBuffer::PARSING_WORDS);
-    StringA word;
-    uint lineCnt;
-
     // Test whether the filename is invalid or empty
     if (filename.IsEmpty()) {
         Log::DefaultLog.WriteMsg(Log::LEVEL_INFO, "%s: No file to load (filename empty)",
@@ -192,120 +419,273 @@ bool VMDDXLoader::loadFile(const vislib::StringA& filename) {
         return true;
     }
 
-    if (!file.LoadFile(filename)) {
+    MappedFileView file;
+    if (!file.Open(filename.PeekBuffer())) {
         Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "%s: Unable to open file '%s'",
                 this->ClassName(), filename.PeekBuffer());
         return false;
     }
-
-    File::FileSize fileSize = File::GetSize(filename);
+    const char *text = file.Data();
+    const SIZE_T textLen = file.Size();
 
     time_t t = clock(); // DEBUG
 
     Log::DefaultLog.WriteMsg(Log::LEVEL_INFO, "%s: Parsing file '%s' (%u Bytes) ...",
             this->ClassName(),
             filename.PeekBuffer(),
-            fileSize); // DEBUG
-
-    // File successfully loaded, get extent spacing and origin
-    lineCnt = 0;
-    double min = 0.0f;
-    double max = 0.0f;
-    bool readFloatData = false;
-    uint floatDataCounter = 0;
-    while (lineCnt < file.Count()) {
-
-        if (file[lineCnt].Count() >= 4) {
-            if (StringA(file[lineCnt].Word(3)).Equals("gridpositions")) {
-                // Get extent of the data
-                this->imgdata.SetWholeExtent(Cubeu(0, 0, 0,
-                        this->string2int(TString(file[lineCnt].Word(5)))-1,
-                        this->string2int(TString(file[lineCnt].Word(6)))-1,
-                        this->string2int(TString(file[lineCnt].Word(7)))-1));
-            }
+            static_cast<unsigned int>(textLen)); // DEBUG
+
+    const bool useCache = this->useCacheSlot.Param<core::param::BoolParam>()->Value();
+    std::string fingerprint;
+    if (useCache) {
+        fingerprint = fingerprintFile(filename.PeekBuffer(), text, textLen);
+        if (this->loadCache(filename, fingerprint)) {
+            Log::DefaultLog.WriteMsg(Log::LEVEL_INFO, "%s: ... loaded from cache (%f s)",
+                    this->ClassName(),
+                    (double(clock()-t)/double(CLOCKS_PER_SEC))); // DEBUG
+            return true;
         }
+    }
 
-        if (file[lineCnt].Count() >= 1) {
-            if (StringA(file[lineCnt].Word(0)).Equals("origin")) {
-                // Get origin of the data
-                this->imgdata.SetOrigin(Vec3f(
-                        this->string2float(TString(file[lineCnt].Word(1))),
-                        this->string2float(TString(file[lineCnt].Word(2))),
-                        this->string2float(TString(file[lineCnt].Word(3)))));
-            }
+    // Parse the header line by line, it ends with the declaration of the
+    // data array
+    SIZE_T pos = 0;
+    unsigned int dim[3] = { 0, 0, 0 };
+    unsigned int deltaLine = 0;
+    bool dataFound = false;
+    while (!dataFound && (pos < textLen)) {
+        SIZE_T lineEnd = pos;
+        while ((lineEnd < textLen) && (text[lineEnd] != '\n')) {
+            lineEnd++;
         }
-
-        if (file[lineCnt].Count() >= 1) {
-            if (StringA(file[lineCnt].Word(0)).Equals("delta")) {
-                this->imgdata.SetSpacing(Vec3f(
-                        this->string2float(TString(file[lineCnt+0].Word(1))),
-                        this->string2float(TString(file[lineCnt+1].Word(2))),
-                        this->string2float(TString(file[lineCnt+2].Word(3)))));
-                lineCnt += 2;
-            }
+        std::vector<StringA> words;
+        for (SIZE_T i = pos; i < lineEnd;) {
+            while ((i < lineEnd) && isSeparator(text[i])) i++;
+            SIZE_T w = i;
+            while ((i < lineEnd) && !isSeparator(text[i])) i++;
+            if (i > w) words.push_back(StringA(text + w, static_cast<StringA::Size>(i - w)));
         }
+        pos = lineEnd + 1;
 
-        // Stop reading float data
-        if (file[lineCnt].Count() >= 1) {
-            if ((readFloatData) && (StringA(file[lineCnt].Word(0)).Equals("attribute"))) {
-                readFloatData = false;
-            }
+        if (words.empty() || words[0].StartsWith('#')) {
+            continue;
         }
-
-        if (readFloatData) {
-            //printf("Number of words in the current line %s\n", file[lineCnt].Count());
-            for (uint w = 0; w < file[lineCnt].Count(); ++w) { // Loop through all words
-                //printf("Current word %s\n", file[lineCnt].Word(w));
-                this->data.Peek()[floatDataCounter] = this->string2float(file[lineCnt].Word(w));
-                if (min > this->data.Peek()[floatDataCounter]) {
-                    min = this->data.Peek()[floatDataCounter];
-                }
-                if (max < this->data.Peek()[floatDataCounter]) {
-                    max = this->data.Peek()[floatDataCounter];
-                }
-                floatDataCounter++;
+        if ((words.size() >= 8) && words[3].Equals("gridpositions")) {
+            // Get extent of the data
+            for (int d = 0; d < 3; d++) {
+                dim[d] = static_cast<unsigned int>(this->string2int(words[5 + d]));
             }
-        }
-
-        // Start reading float data
-        if ((!readFloatData) && (file[lineCnt].Count() >= 4)) {
-            if (StringA(file[lineCnt].Word(3)).Equals("array")) {
-                // Read data from now on
-                readFloatData = true;
-                this->data.Validate(
-                        (this->imgdata.GetWholeExtent().Width()+1)*
-                        (this->imgdata.GetWholeExtent().Depth()+1)*
-                        (this->imgdata.GetWholeExtent().Height()+1));
+            this->imgdata.SetWholeExtent(Cubeu(0, 0, 0, dim[0]-1, dim[1]-1, dim[2]-1));
+        } else if ((words.size() >= 4) && words[0].Equals("origin")) {
+            // Get origin of the data
+            this->imgdata.SetOrigin(Vec3f(
+                    this->string2float(words[1]),
+                    this->string2float(words[2]),
+                    this->string2float(words[3])));
+        } else if ((words.size() >= 4) && words[0].Equals("delta")) {
+            // The spacing is the diagonal of the three delta lines
+            Vec3f spacing = (deltaLine == 0) ? Vec3f(0.0f, 0.0f, 0.0f) : this->imgdata.GetSpacing();
+            if (deltaLine < 3) {
+                spacing[deltaLine] = this->string2float(words[1 + deltaLine]);
+                this->imgdata.SetSpacing(spacing);
             }
+            deltaLine++;
+        } else if ((words.size() >= 4) && words[3].Equals("array")) {
+            // Read data from now on
+            dataFound = true;
         }
-
-        lineCnt++;
     }
-
-    // Change ordering from row major to column major
-    this->dataTmp.Validate(this->data.GetCount());
-//#pragma omp parallel for
-    for (int cnt = 0; cnt < static_cast<int>(this->data.GetCount()); ++cnt) {
-        int x = cnt%int((this->imgdata.GetWholeExtent().Width()+1));
-        int y = (cnt/int((this->imgdata.GetWholeExtent().Width()+1)))%int((this->imgdata.GetWholeExtent().Height()+1));
-        int z = (cnt/int((this->imgdata.GetWholeExtent().Width()+1)))/int((this->imgdata.GetWholeExtent().Height()+1));
-        this->dataTmp.Peek()[int((this->imgdata.GetWholeExtent().Depth()+1))*(int((this->imgdata.GetWholeExtent().Height()+1))*x+y)+z] = this->data.Peek()[cnt];
+    const SIZE_T count = static_cast<SIZE_T>(dim[0]) * dim[1] * dim[2];
+    if (!dataFound || (count == 0)) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "%s: File '%s' does not contain a grid",
+                this->ClassName(), filename.PeekBuffer());
+        return false;
+    }
+    this->data.Validate(count);
+
+    // Parse the values straight from the mapped file
+    double min = DBL_MAX;
+    double max = -DBL_MAX;
+    pos = std::min(pos, textLen);
+    const SIZE_T valueCnt = this->parseValues(text + pos, textLen - pos, count, dim, min, max);
+    if (valueCnt < count) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_ERROR, "%s: File '%s' contains only %u of %u values",
+                this->ClassName(), filename.PeekBuffer(), static_cast<unsigned int>(valueCnt),
+                static_cast<unsigned int>(count));
+        return false;
     }
-    memcpy(this->data.Peek(), this->dataTmp.Peek(), this->data.GetSize()*sizeof(float));
+    this->dataMin = static_cast<float>(min);
+    this->dataMax = static_cast<float>(max);
 
     // Setup data array
     this->imgdata.SetNumberOfPieces(1);
-    this->imgdata.SetPointData((const char*)this->data.Peek(), min, max,
+    this->imgdata.SetPointData((const char*)this->data.Peek(), this->dataMin, this->dataMax,
 			protein_calls::VTKImageData::DataArray::VTI_FLOAT, "vmddata", 1, 0);
 
     Log::DefaultLog.WriteMsg(Log::LEVEL_INFO, "%s: ... done (%f s)",
             this->ClassName(),
             (double(clock()-t)/double(CLOCKS_PER_SEC))); // DEBUG
 
+    if (useCache && !this->saveCache(filename, fingerprint)) {
+        Log::DefaultLog.WriteMsg(Log::LEVEL_WARN, "%s: Unable to write the cache of '%s'",
+                this->ClassName(), filename.PeekBuffer());
+    }
+
+    return true;
+}
+
+
+/*
+ * VMDDXLoader::parseValues
+ */
+SIZE_T VMDDXLoader::parseValues(const char *buff, SIZE_T len, SIZE_T count,
+        const unsigned int dim[3], double& min, double& max) {
+    // Split the text into pieces not starting inside a number
+    const int pieceCnt = static_cast<int>((len + pieceSize - 1) / pieceSize);
+    std::vector<SIZE_T> pieceStart(pieceCnt + 1, len);
+    for (int i = 0; i < pieceCnt; ++i) {
+        SIZE_T s = static_cast<SIZE_T>(i) * pieceSize;
+        while ((s > 0) && (s < len) && !isSeparator(buff[s - 1])) s++;
+        pieceStart[i] = s;
+    }
+
+    // Count the numbers of each piece to know where they go
+    std::vector<SIZE_T> pieceFirst(pieceCnt + 1, 0);
+#pragma omp parallel for schedule(dynamic, 4)
+    for (int i = 0; i < pieceCnt; ++i) {
+        SIZE_T cnt = 0;
+        bool inNumber = false;
+        for (SIZE_T c = pieceStart[i]; c < pieceStart[i + 1]; ++c) {
+            const bool sep = isSeparator(buff[c]);
+            cnt += (!sep && !inNumber) ? 1 : 0;
+            inNumber = !sep;
+        }
+        pieceFirst[i + 1] = cnt;
+    }
+    for (int i = 0; i < pieceCnt; ++i) {
+        pieceFirst[i + 1] += pieceFirst[i];
+    }
+
+    // Parse the pieces. The file runs through z fastest, the grid through x.
+    const SIZE_T nx = dim[0], ny = dim[1], nz = dim[2];
+    float *out = this->data.Peek();
+#pragma omp parallel
+    {
+        double localMin = DBL_MAX, localMax = -DBL_MAX;
+#pragma omp for schedule(dynamic, 4)
+        for (int i = 0; i < pieceCnt; ++i) {
+            SIZE_T idx = pieceFirst[i];
+            SIZE_T z = idx % nz;
+            SIZE_T y = (idx / nz) % ny;
+            SIZE_T x = idx / (nz * ny);
+            const char *p = buff + pieceStart[i];
+            const char *end = buff + pieceStart[i + 1];
+            while (idx < count) {
+                while ((p < end) && isSeparator(*p)) p++;
+                if (p >= end) break;
+                const float v = parseFloat(p, end);
+                out[x + nx * (y + ny * z)] = v;
+                localMin = std::min(localMin, static_cast<double>(v));
+                localMax = std::max(localMax, static_cast<double>(v));
+                idx++;
+                if (++z == nz) {
+                    z = 0;
+                    if (++y == ny) {
+                        y = 0;
+                        x++;
+                    }
+                }
+            }
+        }
+#pragma omp critical
+        {
+            min = std::min(min, localMin);
+            max = std::max(max, localMax);
+        }
+    }
+
+    return std::min(pieceFirst[pieceCnt], count);
+}
+
+
+/*
+ * VMDDXLoader::loadCache
+ */
+bool VMDDXLoader::loadCache(const vislib::StringA& filename, const std::string& fingerprint) {
+    using namespace vislib;
+
+    std::ifstream in((std::string(filename.PeekBuffer()) + ".mmcache").c_str(), std::ios::binary);
+    if (!in) return false;
+
+    char magic[8];
+    UINT64 fpLen = 0;
+    in.read(magic, 8);
+    in.read(reinterpret_cast<char*>(&fpLen), sizeof(fpLen));
+    if (!in || (memcmp(magic, "MMDXCA1", 8) != 0) || (fpLen != fingerprint.size())) return false;
+    std::string fp(static_cast<SIZE_T>(fpLen), '\0');
+    in.read(&fp[0], fpLen);
+    if (!in || (fp != fingerprint)) return false;
+
+    unsigned int dim[3];
+    float origin[3], spacing[3], range[2];
+    in.read(reinterpret_cast<char*>(dim), sizeof(dim));
+    in.read(reinterpret_cast<char*>(origin), sizeof(origin));
+    in.read(reinterpret_cast<char*>(spacing), sizeof(spacing));
+    in.read(reinterpret_cast<char*>(range), sizeof(range));
+    const SIZE_T count = static_cast<SIZE_T>(dim[0]) * dim[1] * dim[2];
+    if (!in || (count == 0)) return false;
+    this->data.Validate(count);
+    in.read(reinterpret_cast<char*>(this->data.Peek()), count * sizeof(float));
+    if (!in) return false;
+
+    this->imgdata.SetWholeExtent(Cubeu(0, 0, 0, dim[0]-1, dim[1]-1, dim[2]-1));
+    this->imgdata.SetOrigin(Vec3f(origin[0], origin[1], origin[2]));
+    this->imgdata.SetSpacing(Vec3f(spacing[0], spacing[1], spacing[2]));
+    this->dataMin = range[0];
+    this->dataMax = range[1];
+    this->imgdata.SetNumberOfPieces(1);
+    this->imgdata.SetPointData((const char*)this->data.Peek(), this->dataMin, this->dataMax,
+			protein_calls::VTKImageData::DataArray::VTI_FLOAT, "vmddata", 1, 0);
     return true;
 }
 
 
+/*
+ * VMDDXLoader::saveCache
+ */
+bool VMDDXLoader::saveCache(const vislib::StringA& filename, const std::string& fingerprint) {
+    // write a new file first, so an interruption does not leave a broken
+    // cache behind
+    const std::string path = std::string(filename.PeekBuffer()) + ".mmcache";
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+        const UINT64 fpLen = fingerprint.size();
+        const unsigned int dim[3] = {
+            this->imgdata.GetWholeExtent().Width() + 1,
+            this->imgdata.GetWholeExtent().Height() + 1,
+            this->imgdata.GetWholeExtent().Depth() + 1 };
+        const float origin[3] = { this->imgdata.GetOrigin().GetX(), this->imgdata.GetOrigin().GetY(),
+            this->imgdata.GetOrigin().GetZ() };
+        const float spacing[3] = { this->imgdata.GetSpacing().GetX(), this->imgdata.GetSpacing().GetY(),
+            this->imgdata.GetSpacing().GetZ() };
+        const float range[2] = { this->dataMin, this->dataMax };
+        out.write("MMDXCA1", 8);
+        out.write(reinterpret_cast<const char*>(&fpLen), sizeof(fpLen));
+        out.write(fingerprint.data(), fingerprint.size());
+        out.write(reinterpret_cast<const char*>(dim), sizeof(dim));
+        out.write(reinterpret_cast<const char*>(origin), sizeof(origin));
+        out.write(reinterpret_cast<const char*>(spacing), sizeof(spacing));
+        out.write(reinterpret_cast<const char*>(range), sizeof(range));
+        out.write(reinterpret_cast<const char*>(this->data.Peek()),
+            static_cast<SIZE_T>(dim[0]) * dim[1] * dim[2] * sizeof(float));
+        if (!out) return false;
+    }
+    std::remove(path.c_str());
+    return (std::rename(tmpPath.c_str(), path.c_str()) == 0);
+}
+
+
 /*
  * VMDDXLoader::readDataAscii2Float
  */
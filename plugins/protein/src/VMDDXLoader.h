@@ -37,6 +37,8 @@
 
 #include <fstream>
 #include <map>
+#include <string>
+#include <vector>
 
 typedef unsigned int uint;
 
@@ -126,6 +128,41 @@ protected:
      */
     void readDataAscii2Float(char *buffIn, float* buffOut, SIZE_T sizeOut);
 
+    /**
+     * Parses the numbers in 'buff' in parallel and writes them to their
+     * position in 'data'. The numbers are stored with z running fastest in
+     * the file, and with x running fastest in 'data'. Numbers behind the
+     * last grid value are ignored.
+     *
+     * @param buff     The text following the header of the file.
+     * @param len      The length of the text.
+     * @param count    The total number of values of the grid.
+     * @param dim      The number of grid points in each direction.
+     * @param min, max The range of the values, updated by the new ones.
+     * @return The number of grid values found in the text.
+     */
+    SIZE_T parseValues(const char *buff, SIZE_T len, SIZE_T count,
+            const unsigned int dim[3], double& min, double& max);
+
+    /**
+     * Loads the grid from the binary cache of the file 'filename' if the cache
+     * matches the file.
+     *
+     * @param filename    The name of the *.dx file.
+     * @param fingerprint Identifies the content of the file.
+     * @return 'True' if the grid has been loaded, 'false', otherwise
+     */
+    bool loadCache(const vislib::StringA& filename, const std::string& fingerprint);
+
+    /**
+     * Writes the current grid to the binary cache of the file 'filename'.
+     *
+     * @param filename    The name of the *.dx file.
+     * @param fingerprint Identifies the content of the file.
+     * @return 'True' on success, 'false', otherwise
+     */
+    bool saveCache(const vislib::StringA& filename, const std::string& fingerprint);
+
 private:
 
     /** TODO */
@@ -159,6 +196,9 @@ private:
     /// Parameter slot containing path to the data file
     core::param::ParamSlot filenameSlot;
 
+    /// Parameter slot to enable the binary cache next to the data files
+    core::param::ParamSlot useCacheSlot;
+
 
     /* Data set */
 
@@ -176,9 +216,9 @@ private:
     int nFrames;                     ///> The number of frames in the data set
 
     HostArr<float> data;     ///> Pointer to the data
-    HostArr<float> dataTmp;  ///> Pointer to the temporary data
-//    float min;               ///> Minimum value of the data
-//    float max;               ///> Minimum value of the data
+    float dataMin;           ///> Minimum value of the data
+    float dataMax;           ///> Maximum value of the data
+    vislib::StringA loadedFile; ///> The file currently stored in 'data'
 
 };
 
@@ -0,0 +1,344 @@
+/*
+ * WorkStealingThreadPool.h
+ *
+ * Copyright (C) 2019 by Universitaet Stuttgart (VIS).
+ * Alle Rechte vorbehalten.
+ */
+
+#ifndef VISLIB_WORKSTEALINGTHREADPOOL_H_INCLUDED
+#define VISLIB_WORKSTEALINGTHREADPOOL_H_INCLUDED
+#if (defined(_MSC_VER) && (_MSC_VER > 1000))
+#pragma once
+#endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
+#if defined(_WIN32) && defined(_MANAGED)
+#pragma managed(push, off)
+#endif /* defined(_WIN32) && defined(_MANAGED) */
+
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "vislib/sys/CriticalSection.h"
+#include "vislib/sys/Event.h"
+#include "vislib/sys/Runnable.h"
+#include "vislib/sys/Semaphore.h"
+#include "vislib/sys/Thread.h"
+#include "vislib/types.h"
+
+
+namespace vislib {
+namespace sys {
+
+
+    /**
+     * A thread pool that keeps a separate work item queue for each of its
+     * worker threads instead of a single shared queue. A worker processes the
+     * items of its own queue and steals the most expensive pending item of
+     * the most loaded other worker once its own queue runs dry.
+     *
+     * Each work item can be given an estimated cost. Work items queued before
+     * the pool is started are distributed in descending order of their cost,
+     * each one to the worker with the least total cost so far. This keeps the
+     * expensive items from ending up at the end of the schedule, where they
+     * would leave all other threads idle.
+     *
+     * Work items queued by a worker thread of the pool while it is running are
+     * appended to the queue of that worker, all others to the least loaded
+     * queue.
+     *
+     * As for ThreadPool, the caller is responsible for keeping the Runnables
+     * and the user data alive until the work items have been completed.
+     */
+    class WorkStealingThreadPool {
+
+    public:
+
+        /** Answer of CurrentWorkerIndex() for threads not being a worker. */
+        static const SIZE_T NO_WORKER;
+
+        /** Ctor. */
+        WorkStealingThreadPool(void);
+
+        /** Dtor. */
+        ~WorkStealingThreadPool(void);
+
+        /**
+         * Remove all pending user work items from the queues. Items currently
+         * being processed are not affected.
+         *
+         * @return The number of items actually removed.
+         */
+        SIZE_T AbortPendingUserWorkItems(void);
+
+        /**
+         * Answer the number of work items which have been completed.
+         *
+         * @return The number of completed work items.
+         */
+        SIZE_T CountCompletedUserWorkItems(void) const;
+
+        /**
+         * Answer the number of work items which are either waiting in one of
+         * the queues or currently being processed.
+         *
+         * @return The number of work items that have not yet been completed.
+         */
+        SIZE_T CountUserWorkItems(void) const;
+
+        /**
+         * Answer the index of the calling thread among the worker threads of
+         * its pool. This can be used by work items to access per-worker
+         * resources.
+         *
+         * @return The index of the calling worker thread or NO_WORKER if the
+         *         calling thread is not a worker of any pool.
+         */
+        static SIZE_T CurrentWorkerIndex(void);
+
+        /**
+         * Answer the fraction of the total cost of all work items queued so far
+         * that has already been completed.
+         *
+         * @return The progress in the range [0, 1].
+         */
+        double GetProgress(void) const;
+
+        /**
+         * Answer the total number of threads in the pool.
+         *
+         * @return The number of worker threads, zero if the pool is not
+         *         running.
+         */
+        SIZE_T GetTotalThreads(void) const;
+
+        /**
+         * Queue a new work item for execution in a pool thread.
+         *
+         * @param runnable The Runnable that does the work. This must not be a
+         *                 NULL pointer.
+         * @param userData This pointer is passed to the Runnable once it is
+         *                 executed.
+         * @param cost     The estimated cost of the work item. The unit is
+         *                 arbitrary but must be the same for all items.
+         *
+         * @throws IllegalStateException If the pool is being terminated.
+         * @throws IllegalParamException If 'runnable' is NULL.
+         */
+        void QueueUserWorkItem(Runnable *runnable, void *userData = NULL,
+            const double cost = 1.0);
+
+        /**
+         * Queue a new work item for execution in a pool thread.
+         *
+         * @param runnable The Runnable::Function that does the work. This must
+         *                 not be a NULL pointer.
+         * @param userData This pointer is passed to the Runnable once it is
+         *                 executed.
+         * @param cost     The estimated cost of the work item. The unit is
+         *                 arbitrary but must be the same for all items.
+         *
+         * @throws IllegalStateException If the pool is being terminated.
+         * @throws IllegalParamException If 'runnable' is NULL.
+         */
+        void QueueUserWorkItem(Runnable::Function runnable,
+            void *userData = NULL, const double cost = 1.0);
+
+        /**
+         * Create the worker threads and distribute all work items queued so
+         * far according to their cost.
+         *
+         * @param threadCount The number of worker threads. If zero, one thread
+         *                    for each available processor is created.
+         *
+         * @throws IllegalStateException If the pool has already been started.
+         */
+        void Start(const SIZE_T threadCount = 0);
+
+        /**
+         * Wait for all queued or running work items to be completed and exit
+         * all worker threads afterwards. If the pool has not been started yet,
+         * it is started in order to complete the pending work items.
+         *
+         * @param abortPending If true, all items currently in the queues are
+         *                     removed and only the active items are completed.
+         */
+        void Terminate(const bool abortPending = false);
+
+        /**
+         * Wait for all queued work items to be completed.
+         *
+         * @param timeout A timeout for waiting. Defaults to TIMEOUT_INFINITE.
+         *
+         * @return true If the operation completed successfully,
+         *         false if a timeout occurred.
+         */
+        inline bool Wait(const DWORD timeout = Event::TIMEOUT_INFINITE) {
+            return this->evtAllCompleted.Wait(timeout);
+        }
+
+    private:
+
+        /** Used to store the work items, their input data and their cost. */
+        typedef struct WorkItem_t {
+            Runnable *runnable;
+            Runnable::Function runnableFunction;
+            void *userData;
+            double cost;
+        } WorkItem;
+
+        /** The work item queue of a single worker thread. */
+        typedef struct WorkerQueue_t {
+            /** Protects 'items' and 'cost'. */
+            CriticalSection lock;
+
+            /** The pending work items, the most expensive first. */
+            std::deque<WorkItem> items;
+
+            /** The summed up cost of the pending work items. */
+            double cost;
+        } WorkerQueue;
+
+        /** The start parameter of a worker thread. */
+        typedef struct WorkerContext_t {
+            WorkStealingThreadPool *pool;
+            SIZE_T index;
+        } WorkerContext;
+
+        /**
+         * The thread function of the workers.
+         *
+         * @param userData Pointer to the WorkerContext of the thread.
+         *
+         * @return 0, always.
+         */
+        static DWORD runWorker(void *userData);
+
+        /*
+         * Forbidden copy ctor.
+         *
+         * @param rhs The object to be cloned.
+         *
+         * @throws UnsupportedOperationException Unconditionally.
+         */
+        WorkStealingThreadPool(const WorkStealingThreadPool& rhs);
+
+        /**
+         * Mark a work item as being completed or aborted.
+         *
+         * @param workItem    The work item.
+         * @param isCompleted true if the item has been run, false if it has
+         *                    been aborted.
+         */
+        void completeWorkItem(const WorkItem& workItem,
+            const bool isCompleted);
+
+        /**
+         * Answer the index of the queue with the least pending cost.
+         *
+         * @return The index of the least loaded queue.
+         */
+        SIZE_T leastLoadedQueue(void) const;
+
+        /**
+         * Queue a new work item.
+         *
+         * @param workItem The work item to be queued.
+         *
+         * @throws IllegalStateException If the pool is being terminated.
+         * @throws IllegalParamException If both, the 'runnable' and the
+         *                               'runnnableFunction' in the 'workItem'
+         *                               are both NULL or not NULL.
+         */
+        void queueUserWorkItem(WorkItem& workItem);
+
+        /**
+         * Take the next work item for the given worker, either from its own
+         * queue or from the one of the most loaded other worker.
+         *
+         * @param worker   The index of the worker.
+         * @param workItem Receives the work item.
+         *
+         * @return true if a work item was found, false otherwise.
+         */
+        bool takeWorkItem(const SIZE_T worker, WorkItem& workItem);
+
+        /**
+         * Forbidden assignment.
+         *
+         * @param rhs The right hand side operand.
+         *
+         * @return *this
+         *
+         * @throws IllegalParameException if (this != &rhs).
+         */
+        WorkStealingThreadPool& operator =(const WorkStealingThreadPool& rhs);
+
+        /** The number of work items that have been completed. */
+        SIZE_T cntCompleted;
+
+        /** The number of work items that are pending or being processed. */
+        SIZE_T cntOutstanding;
+
+        /** The summed up cost of the completed work items. */
+        double costCompleted;
+
+        /** The summed up cost of all work items queued so far. */
+        double costTotal;
+
+        /**
+         * This event is in signaled state while no work item is pending or
+         * being processed.
+         */
+        Event evtAllCompleted;
+
+        /**
+         * Determines whether new work items can be queued. When accessing this
+         * attribute, 'lockState' must be held.
+         */
+        bool isQueueOpen;
+
+        /**
+         * Determines whether the worker threads are running. When accessing
+         * this attribute, 'lockState' must be held.
+         */
+        bool isStarted;
+
+        /** Tells the workers without work to exit. */
+        volatile bool isTerminating;
+
+        /** Protects the counters and the cost sums. */
+        mutable CriticalSection lockCounters;
+
+        /**
+         * Protects 'isQueueOpen', 'isStarted', 'pending', the lists of queues
+         * and threads.
+         */
+        mutable CriticalSection lockState;
+
+        /** The work items queued before the pool has been started. */
+        std::vector<WorkItem> pending;
+
+        /** The queues of the worker threads. */
+        std::vector<std::unique_ptr<WorkerQueue> > queues;
+
+        /**
+         * Semaphore for waiting while there is no work. It is released once
+         * for each queued work item.
+         */
+        Semaphore semBlockWorker;
+
+        /** The start parameters of the worker threads. */
+        std::vector<WorkerContext> workerContexts;
+
+        /** The worker threads. */
+        std::vector<std::unique_ptr<Thread> > workers;
+    };
+
+} /* end namespace sys */
+} /* end namespace vislib */
+
+#if defined(_WIN32) && defined(_MANAGED)
+#pragma managed(pop)
+#endif /* defined(_WIN32) && defined(_MANAGED) */
+#endif /* VISLIB_WORKSTEALINGTHREADPOOL_H_INCLUDED */
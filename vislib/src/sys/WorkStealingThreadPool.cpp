@@ -0,0 +1,467 @@
+/*
+ * WorkStealingThreadPool.cpp
+ *
+ * Copyright (C) 2019 by Universitaet Stuttgart (VIS).
+ * Alle Rechte vorbehalten.
+ */
+
+#include "vislib/sys/WorkStealingThreadPool.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "vislib/assert.h"
+#include "vislib/sys/AutoLock.h"
+#include "vislib/IllegalParamException.h"
+#include "vislib/IllegalStateException.h"
+#include "vislib/sys/SystemInformation.h"
+#include "vislib/Trace.h"
+#include "vislib/UnsupportedOperationException.h"
+
+
+namespace {
+
+    /** The pool the calling worker thread belongs to. */
+    thread_local const vislib::sys::WorkStealingThreadPool *currentPool = NULL;
+
+    /** The index of the calling worker thread. */
+    thread_local SIZE_T currentWorkerIndex
+        = vislib::sys::WorkStealingThreadPool::NO_WORKER;
+
+} /* end anonymous namespace */
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::NO_WORKER
+ */
+const SIZE_T vislib::sys::WorkStealingThreadPool::NO_WORKER
+    = static_cast<SIZE_T>(-1);
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::WorkStealingThreadPool
+ */
+vislib::sys::WorkStealingThreadPool::WorkStealingThreadPool(void)
+        : cntCompleted(0), cntOutstanding(0), costCompleted(0.0),
+        costTotal(0.0), evtAllCompleted(true, true), isQueueOpen(true),
+        isStarted(false), isTerminating(false), semBlockWorker(0l, LONG_MAX) {
+    // Nothing to do.
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::~WorkStealingThreadPool
+ */
+vislib::sys::WorkStealingThreadPool::~WorkStealingThreadPool(void) {
+    this->Terminate(true);
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::AbortPendingUserWorkItems
+ */
+SIZE_T vislib::sys::WorkStealingThreadPool::AbortPendingUserWorkItems(void) {
+    SIZE_T retval = 0;
+    AutoLock lock(this->lockState);
+
+    if (!this->isStarted) {
+        for (auto& item : this->pending) {
+            this->completeWorkItem(item, false);
+        }
+        retval = this->pending.size();
+        this->pending.clear();
+
+    } else {
+        for (auto& queue : this->queues) {
+            AutoLock queueLock(queue->lock);
+            while (!queue->items.empty() && this->semBlockWorker.TryLock()) {
+                WorkItem& workItem = queue->items.back();
+                queue->cost -= workItem.cost;
+                this->completeWorkItem(workItem, false);
+                queue->items.pop_back();
+                retval++;
+            }
+        }
+    }
+
+    return retval;
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::CountCompletedUserWorkItems
+ */
+SIZE_T vislib::sys::WorkStealingThreadPool::CountCompletedUserWorkItems(
+        void) const {
+    AutoLock lock(this->lockCounters);
+    return this->cntCompleted;
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::CountUserWorkItems
+ */
+SIZE_T vislib::sys::WorkStealingThreadPool::CountUserWorkItems(void) const {
+    AutoLock lock(this->lockCounters);
+    return this->cntOutstanding;
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::CurrentWorkerIndex
+ */
+SIZE_T vislib::sys::WorkStealingThreadPool::CurrentWorkerIndex(void) {
+    return ::currentWorkerIndex;
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::GetProgress
+ */
+double vislib::sys::WorkStealingThreadPool::GetProgress(void) const {
+    AutoLock lock(this->lockCounters);
+    if (this->cntOutstanding == 0) {
+        return 1.0;
+    }
+    return (this->costTotal > 0.0)
+        ? (this->costCompleted / this->costTotal)
+        : 0.0;
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::GetTotalThreads
+ */
+SIZE_T vislib::sys::WorkStealingThreadPool::GetTotalThreads(void) const {
+    AutoLock lock(this->lockState);
+    return this->workers.size();
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::QueueUserWorkItem
+ */
+void vislib::sys::WorkStealingThreadPool::QueueUserWorkItem(
+        Runnable *runnable, void *userData, const double cost) {
+    WorkItem workItem;
+    workItem.runnable = runnable;
+    workItem.runnableFunction = NULL;
+    workItem.userData = userData;
+    workItem.cost = cost;
+
+    this->queueUserWorkItem(workItem);
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::QueueUserWorkItem
+ */
+void vislib::sys::WorkStealingThreadPool::QueueUserWorkItem(
+        Runnable::Function runnable, void *userData, const double cost) {
+    WorkItem workItem;
+    workItem.runnable = NULL;
+    workItem.runnableFunction = runnable;
+    workItem.userData = userData;
+    workItem.cost = cost;
+
+    this->queueUserWorkItem(workItem);
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::Start
+ */
+void vislib::sys::WorkStealingThreadPool::Start(const SIZE_T threadCount) {
+    AutoLock lock(this->lockState);
+
+    if (this->isStarted) {
+        throw IllegalStateException("The thread pool has already been "
+            "started.", __FILE__, __LINE__);
+    }
+
+    SIZE_T cntThreads = (threadCount > 0) ? threadCount
+        : static_cast<SIZE_T>(SystemInformation::ProcessorCount());
+    this->queues.clear();
+    for (SIZE_T i = 0; i < cntThreads; i++) {
+        this->queues.emplace_back(new WorkerQueue());
+        this->queues.back()->cost = 0.0;
+    }
+
+    /* Distribute the most expensive items first, each to the least loaded. */
+    std::stable_sort(this->pending.begin(), this->pending.end(),
+        [](const WorkItem& lhs, const WorkItem& rhs) {
+            return lhs.cost > rhs.cost;
+        });
+    for (auto& item : this->pending) {
+        WorkerQueue& queue = *this->queues[this->leastLoadedQueue()];
+        queue.items.push_back(item);
+        queue.cost += item.cost;
+    }
+
+    this->isStarted = true;
+    this->workerContexts.resize(cntThreads);
+    this->workers.clear();
+    for (SIZE_T i = 0; i < cntThreads; i++) {
+        this->workerContexts[i].pool = this;
+        this->workerContexts[i].index = i;
+        this->workers.emplace_back(new Thread(
+            &WorkStealingThreadPool::runWorker));
+        this->workers.back()->Start(&this->workerContexts[i]);
+    }
+
+    for (SIZE_T i = 0; i < this->pending.size(); i++) {
+        this->semBlockWorker.Unlock();
+    }
+    this->pending.clear();
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::Terminate
+ */
+void vislib::sys::WorkStealingThreadPool::Terminate(const bool abortPending) {
+    this->lockState.Lock();
+    this->isQueueOpen = false;
+    this->lockState.Unlock();
+
+    if (abortPending) {
+        this->AbortPendingUserWorkItems();
+    }
+
+    this->lockState.Lock();
+    if (!this->isStarted && !this->pending.empty()) {
+        this->lockState.Unlock();
+        this->Start();
+        this->lockState.Lock();
+    }
+    SIZE_T cntThreads = this->workers.size();
+    this->lockState.Unlock();
+
+    if (cntThreads > 0) {
+        this->Wait();
+
+        this->isTerminating = true;
+        for (SIZE_T i = 0; i < cntThreads; i++) {
+            this->semBlockWorker.Unlock();
+        }
+
+        AutoLock lock(this->lockState);
+        for (auto& worker : this->workers) {
+            worker->Join();
+        }
+        this->workers.clear();
+        this->workerContexts.clear();
+        this->queues.clear();
+        this->isStarted = false;
+        this->isTerminating = false;
+    }
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::runWorker
+ */
+DWORD vislib::sys::WorkStealingThreadPool::runWorker(void *userData) {
+    ASSERT(userData != NULL);
+    WorkerContext *ctx = static_cast<WorkerContext *>(userData);
+    WorkStealingThreadPool *pool = ctx->pool;
+    ::currentPool = pool;
+    ::currentWorkerIndex = ctx->index;
+
+    VLTRACE(Trace::LEVEL_VL_INFO, "Work stealing worker [%u] started.\n",
+        Thread::CurrentID());
+
+    while (true) {
+        /* Each permit of the semaphore stands for one queued work item. */
+        pool->semBlockWorker.Lock();
+
+        WorkItem workItem;
+        bool found = false;
+        while (!(found = pool->takeWorkItem(ctx->index, workItem))) {
+            /*
+             * The item belonging to the permit might have been taken by a
+             * worker that got its permit for an item we already passed. The
+             * permit only is a signal to exit if the pool is terminating.
+             */
+            if (pool->isTerminating) {
+                break;
+            }
+            Thread::Reschedule();
+        }
+        if (!found) {
+            break;
+        }
+
+        ASSERT((workItem.runnable != NULL)
+            || (workItem.runnableFunction != NULL));
+        // The exit code is of no interest, because the pool has no way of
+        // reporting it.
+        if (workItem.runnable != NULL) {
+            workItem.runnable->Run(workItem.userData);
+        } else {
+            workItem.runnableFunction(workItem.userData);
+        }
+        VLTRACE(Trace::LEVEL_VL_INFO, "Work stealing worker [%u] completed "
+            "work item.\n", Thread::CurrentID());
+
+        pool->completeWorkItem(workItem, true);
+    }
+
+    VLTRACE(Trace::LEVEL_VL_INFO, "Work stealing worker [%u] is exiting.\n",
+        Thread::CurrentID());
+    ::currentPool = NULL;
+    ::currentWorkerIndex = NO_WORKER;
+    return 0;
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::WorkStealingThreadPool
+ */
+vislib::sys::WorkStealingThreadPool::WorkStealingThreadPool(
+        const WorkStealingThreadPool& rhs) {
+    throw UnsupportedOperationException(
+        "WorkStealingThreadPool::WorkStealingThreadPool", __FILE__, __LINE__);
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::completeWorkItem
+ */
+void vislib::sys::WorkStealingThreadPool::completeWorkItem(
+        const WorkItem& workItem, const bool isCompleted) {
+    AutoLock lock(this->lockCounters);
+    ASSERT(this->cntOutstanding > 0);
+    if (isCompleted) {
+        this->cntCompleted++;
+        this->costCompleted += workItem.cost;
+    } else {
+        this->costTotal -= workItem.cost;
+    }
+    if (--this->cntOutstanding == 0) {
+        this->evtAllCompleted.Set();
+    }
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::leastLoadedQueue
+ */
+SIZE_T vislib::sys::WorkStealingThreadPool::leastLoadedQueue(void) const {
+    ASSERT(!this->queues.empty());
+    SIZE_T retval = 0;
+    double minCost = 0.0;
+    for (SIZE_T i = 0; i < this->queues.size(); i++) {
+        AutoLock lock(this->queues[i]->lock);
+        if ((i == 0) || (this->queues[i]->cost < minCost)) {
+            minCost = this->queues[i]->cost;
+            retval = i;
+        }
+    }
+    return retval;
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::queueUserWorkItem
+ */
+void vislib::sys::WorkStealingThreadPool::queueUserWorkItem(
+        WorkItem& workItem) {
+    /* Sanity checks. */
+    if ((workItem.runnable == NULL) && (workItem.runnableFunction == NULL)) {
+        throw vislib::IllegalParamException("workItem", __FILE__, __LINE__);
+    }
+    if ((workItem.runnable != NULL) && (workItem.runnableFunction != NULL)) {
+        throw vislib::IllegalParamException("workItem", __FILE__, __LINE__);
+    }
+
+    AutoLock lock(this->lockState);
+    if (!this->isQueueOpen) {
+        throw IllegalStateException("The user work item queue has been closed, "
+            "because the thread pool is being terminated.", __FILE__, __LINE__);
+    }
+
+    this->lockCounters.Lock();
+    this->cntOutstanding++;
+    this->costTotal += workItem.cost;
+    this->evtAllCompleted.Reset();  // Signal unfinished work.
+    this->lockCounters.Unlock();
+
+    if (!this->isStarted) {
+        this->pending.push_back(workItem);
+        return;
+    }
+
+    /* Keep items spawned by a worker local, give all others to the idlest. */
+    SIZE_T worker = (::currentPool == this) ? ::currentWorkerIndex
+        : this->leastLoadedQueue();
+    WorkerQueue& queue = *this->queues[worker];
+    queue.lock.Lock();
+    queue.items.push_back(workItem);
+    queue.cost += workItem.cost;
+    queue.lock.Unlock();
+    this->semBlockWorker.Unlock();  // Wake workers.
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::takeWorkItem
+ */
+bool vislib::sys::WorkStealingThreadPool::takeWorkItem(const SIZE_T worker,
+        WorkItem& workItem) {
+    ASSERT(worker < this->queues.size());
+
+    /* Work on the own queue first. */
+    WorkerQueue& own = *this->queues[worker];
+    own.lock.Lock();
+    if (!own.items.empty()) {
+        workItem = own.items.front();
+        own.items.pop_front();
+        own.cost -= workItem.cost;
+        own.lock.Unlock();
+        return true;
+    }
+    own.lock.Unlock();
+
+    /* Steal the most expensive item of the most loaded other worker. */
+    SIZE_T victim = worker;
+    double maxCost = -1.0;
+    for (SIZE_T i = 0; i < this->queues.size(); i++) {
+        if (i == worker) {
+            continue;
+        }
+        AutoLock lock(this->queues[i]->lock);
+        if (!this->queues[i]->items.empty()
+                && (this->queues[i]->cost > maxCost)) {
+            maxCost = this->queues[i]->cost;
+            victim = i;
+        }
+    }
+    if (victim == worker) {
+        return false;
+    }
+
+    WorkerQueue& other = *this->queues[victim];
+    AutoLock lock(other.lock);
+    if (other.items.empty()) {
+        return false;
+    }
+    workItem = other.items.front();
+    other.items.pop_front();
+    other.cost -= workItem.cost;
+    return true;
+}
+
+
+/*
+ * vislib::sys::WorkStealingThreadPool::operator =
+ */
+vislib::sys::WorkStealingThreadPool&
+vislib::sys::WorkStealingThreadPool::operator =(
+        const WorkStealingThreadPool& rhs) {
+    if (this != &rhs) {
+        throw IllegalParamException("rhs", __FILE__, __LINE__);
+    }
+
+    return *this;
+}
@@ -45,6 +45,7 @@
 #include "testserialiser.h"
 #include "testipv6.h"
 #include "testthreadpool.h"
+#include "testworkstealingthreadpool.h"
 #include "testrefcount.h"
 #include "testpoolallocator.h"
 #include "testpoint.h"
@@ -147,6 +148,7 @@ VislibTest tests[] = {
     {_T("SysInfo"), ::TestSysInfo, "Tests vislib::sys::SystemInformation"},
     {_T("Thread"), ::TestThread, "Tests vislib::sys::Thread"},
     {_T("ThreadPool"), ::TestThreadPool, "Tests the thread pool"},
+    {_T("WorkStealingThreadPool"), ::TestWorkStealingThreadPool, "Tests the work stealing thread pool"},
     {_T("TrayIcon"), ::TestTrayIcon, "Tests vislib::sys::TrayIcon"},
     {_T("VIPCStrTabGet"), ::TestVIPCStrTabGet, "Tests the getter functions of vislib::sys::VolatileIPCStringTable"},
     {_T("VIPCStrTabSet"), ::TestVIPCStrTabSet, "Tests the setter functions of vislib::sys::VolatileIPCStringTable"},
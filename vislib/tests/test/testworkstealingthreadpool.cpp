@@ -0,0 +1,85 @@
+/*
+ * testworkstealingthreadpool.cpp
+ *
+ * Copyright (C) 2019 by Universitaet Stuttgart (VIS). Alle Rechte vorbehalten.
+ */
+
+#include "testworkstealingthreadpool.h"
+
+#include "vislib/sys/Interlocked.h"
+#include "vislib/sys/Thread.h"
+#include "vislib/sys/WorkStealingThreadPool.h"
+#include "testhelper.h"
+
+
+using namespace vislib::sys;
+
+
+/** The number of work items that have been run. */
+static volatile INT32 CNT_RUN = 0;
+
+/** The number of work items run outside of a worker thread. */
+static volatile INT32 CNT_NO_WORKER = 0;
+
+
+static DWORD Sleeper(void *userData) {
+    UINT_PTR millis = reinterpret_cast<UINT_PTR>(userData);
+    if (WorkStealingThreadPool::CurrentWorkerIndex()
+            == WorkStealingThreadPool::NO_WORKER) {
+        Interlocked::Increment(&CNT_NO_WORKER);
+    }
+    Thread::Sleep(static_cast<DWORD>(millis));
+    Interlocked::Increment(&CNT_RUN);
+    return 0;
+}
+
+
+void TestWorkStealingThreadPool(void) {
+    const int CNT_THREADS = 4;
+    const int CNT_ITEMS = 40;
+
+    {
+        WorkStealingThreadPool pool;
+        ::AssertEqual("No threads initially.", pool.GetTotalThreads(), SIZE_T(0));
+        ::AssertEqual("Not a worker thread.", WorkStealingThreadPool::CurrentWorkerIndex(),
+            WorkStealingThreadPool::NO_WORKER);
+
+        // Very different costs: a few expensive items and many cheap ones.
+        for (INT_PTR i = 0; i < CNT_ITEMS; i++) {
+            UINT_PTR millis = (i % 10 == 0) ? 50 : 2;
+            pool.QueueUserWorkItem(::Sleeper, reinterpret_cast<void *>(millis),
+                static_cast<double>(millis));
+        }
+        ::AssertEqual("All items pending.", pool.CountUserWorkItems(), SIZE_T(CNT_ITEMS));
+        ::AssertEqual("Nothing done before start.", pool.GetProgress(), 0.0);
+
+        pool.Start(CNT_THREADS);
+        ::AssertEqual("Threads created.", pool.GetTotalThreads(), SIZE_T(CNT_THREADS));
+
+        pool.Wait();
+        ::AssertEqual("Everything completed.", pool.CountCompletedUserWorkItems(), SIZE_T(CNT_ITEMS));
+        ::AssertEqual("Nothing outstanding.", pool.CountUserWorkItems(), SIZE_T(0));
+        ::AssertEqual("Everything run.", static_cast<int>(CNT_RUN), CNT_ITEMS);
+        ::AssertEqual("All items run by workers.", static_cast<int>(CNT_NO_WORKER), 0);
+        ::AssertEqual("Progress complete.", pool.GetProgress(), 1.0);
+
+        // Items queued while running.
+        for (INT_PTR i = 0; i < CNT_ITEMS; i++) {
+            pool.QueueUserWorkItem(::Sleeper, reinterpret_cast<void *>(1));
+        }
+        pool.Terminate();
+        ::AssertEqual("No threads after terminate.", pool.GetTotalThreads(), SIZE_T(0));
+        ::AssertEqual("Everything run after terminate.", static_cast<int>(CNT_RUN), 2 * CNT_ITEMS);
+    }
+
+    {
+        WorkStealingThreadPool pool;
+        for (INT_PTR i = 0; i < CNT_ITEMS; i++) {
+            pool.QueueUserWorkItem(::Sleeper, reinterpret_cast<void *>(1));
+        }
+        ::AssertEqual("Unstarted items aborted.", pool.AbortPendingUserWorkItems(), SIZE_T(CNT_ITEMS));
+        ::AssertEqual("Nothing outstanding after abort.", pool.CountUserWorkItems(), SIZE_T(0));
+        pool.Terminate();
+        ::AssertEqual("Nothing completed after abort.", pool.CountCompletedUserWorkItems(), SIZE_T(0));
+    }
+}
@@ -0,0 +1,15 @@
+/*
+ * testworkstealingthreadpool.h
+ *
+ * Copyright (C) 2019 by Universitaet Stuttgart (VIS). Alle Rechte vorbehalten.
+ */
+
+#ifndef VISLIBTEST_TESTWORKSTEALINGTHREADPOOL_H_INCLUDED
+#define VISLIBTEST_TESTWORKSTEALINGTHREADPOOL_H_INCLUDED
+#if (defined(_MSC_VER) && (_MSC_VER > 1000))
+#pragma once
+#endif /* (defined(_MSC_VER) && (_MSC_VER > 1000)) */
+
+void TestWorkStealingThreadPool(void);
+
+#endif /* VISLIBTEST_TESTWORKSTEALINGTHREADPOOL_H_INCLUDED */